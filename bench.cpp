@@ -0,0 +1,510 @@
+// Benchmark harness, built optimized by `make bench` from every module except visual.cpp.
+//
+// Times the config loaders, the car model transform, scene construction and the batch
+// kernels on the shipped data, then scaling series over synthetic zone sets and synthetic
+// CAD-like meshes. Each case is warmed up and run repeatedly; the table shows percentiles
+// of the per-run time and --json writes them for comparison across releases.
+
+#include "bench_util.h"
+#include "camera_frustum.h"
+#include "camera_projection.h"
+#include "camera_view.h"
+#include "config_loader.h"
+#include "disk_cache.h"
+#include "extrinsics_sweep.h"
+#include "model_cache.h"
+#include "parallel_for.h"
+#include "scene_builder.h"
+#include "undistort_map.h"
+#include "viewtarget.h"
+#include "zone_batch.h"
+#include "zone_bvh.h"
+#include "zone_coverage.h"
+#include "zone_hittest.h"
+#include "zone_label_map.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Material>
+#include <osgDB/WriteFile>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#ifndef VISUAL_BENCH_FLAGS
+#define VISUAL_BENCH_FLAGS "unknown"
+#endif
+
+namespace {
+
+volatile size_t sink;
+
+// Swallows the config loaders' console diagnostics while they are timed
+class QuietStdout {
+public:
+    QuietStdout() : previous_(std::cout.rdbuf(&null_)) {}
+    ~QuietStdout() { std::cout.rdbuf(previous_); }
+
+private:
+    struct NullBuffer : std::streambuf {
+        int overflow(int c) { return c; }
+    };
+    NullBuffer null_;
+    std::streambuf* previous_;
+};
+
+std::string formatDuration(double seconds)
+{
+    std::ostringstream out;
+    out << std::fixed;
+    if (seconds < 1e-6) out << std::setprecision(1) << seconds * 1e9 << " ns";
+    else if (seconds < 1e-3) out << std::setprecision(2) << seconds * 1e6 << " us";
+    else if (seconds < 1.0) out << std::setprecision(2) << seconds * 1e3 << " ms";
+    else out << std::setprecision(3) << seconds << " s";
+    return out.str();
+}
+
+class BenchSuite {
+public:
+    BenchSuite(const std::string& filter, bool listOnly) : filter_(filter), listOnly_(listOnly) {}
+
+    bool selected(const std::string& name) const
+    {
+        return filter_.empty() || name.find(filter_) != std::string::npos;
+    }
+
+    template<typename Fn>
+    void run(const std::string& name, const BenchOptions& options, Fn fn, double items = 1.0, double param = 0.0)
+    {
+        if (!selected(name)) return;
+        if (listOnly_) {
+            std::cout << name << std::endl;
+            return;
+        }
+        BenchResult result = runBench(name, options, fn, items, param);
+        std::cout << std::left << std::setw(44) << name << std::right << std::setw(6) << result.samples.size()
+                  << std::setw(12) << formatDuration(result.percentile(50)) << std::setw(12)
+                  << formatDuration(result.percentile(90)) << std::setw(12) << formatDuration(result.percentile(99))
+                  << std::setw(12) << formatDuration(result.samples.front());
+        if (items > 1.0) {
+            std::cout << std::setw(12) << std::fixed << std::setprecision(2) << items / result.percentile(50) / 1e6
+                      << " M/s";
+        }
+        std::cout << std::endl;
+        results_.push_back(result);
+    }
+
+    static void printHeader()
+    {
+        std::cout << std::left << std::setw(44) << "case" << std::right << std::setw(6) << "runs" << std::setw(12)
+                  << "p50" << std::setw(12) << "p90" << std::setw(12) << "p99" << std::setw(12) << "min"
+                  << std::setw(16) << "items/s (p50)" << std::endl;
+    }
+
+    void writeJson(const std::string& path, const std::string& label, const std::string& model) const
+    {
+        char date[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        char host[256] = "";
+        gethostname(host, sizeof(host) - 1);
+
+        std::ofstream out(path.c_str());
+        if (!out) throw std::runtime_error("Cannot write " + path);
+        out << "{\n";
+        out << "  \"schema\": 1,\n";
+        out << "  \"label\": " << jsonString(label) << ",\n";
+        out << "  \"date\": " << jsonString(date) << ",\n";
+        out << "  \"host\": " << jsonString(host) << ",\n";
+        out << "  \"compiler\": " << jsonString(__VERSION__) << ",\n";
+        out << "  \"flags\": " << jsonString(VISUAL_BENCH_FLAGS) << ",\n";
+        out << "  \"threads\": " << workerCount() << ",\n";
+        out << "  \"model\": " << jsonString(model) << ",\n";
+        out << "  \"results\": [";
+        out << std::setprecision(6);
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const BenchResult& r = results_[i];
+            out << (i ? ",\n" : "\n") << "    {\"name\": " << jsonString(r.name) << ", \"param\": " << r.param
+                << ", \"items\": " << r.items << ", \"warmup\": " << r.warmupRuns << ", \"runs\": " << r.samples.size()
+                << ", \"min_us\": " << r.samples.front() * 1e6 << ", \"p50_us\": " << r.percentile(50) * 1e6
+                << ", \"p90_us\": " << r.percentile(90) * 1e6 << ", \"p99_us\": " << r.percentile(99) * 1e6
+                << ", \"max_us\": " << r.samples.back() * 1e6 << ", \"mean_us\": " << r.mean() * 1e6
+                << ", \"items_per_second\": " << r.items / r.percentile(50) << "}";
+        }
+        out << "\n  ]\n}\n";
+        if (!out) throw std::runtime_error("Cannot write " + path);
+        std::cout << "Wrote " << results_.size() << " results to " << path << std::endl;
+    }
+
+private:
+    std::string filter_;
+    bool listOnly_;
+    std::vector<BenchResult> results_;
+};
+
+// Options for slow cases (disk I/O, whole-model optimization)
+BenchOptions slowOptions()
+{
+    BenchOptions options;
+    options.warmupRuns = 1;
+    options.minRuns = 3;
+    options.minSeconds = 0.0;
+    return options;
+}
+
+// Same rays as `visual zonebench`: from the origin, spread slightly wider than the
+// synthetic zone cap
+GazeRayBatch makeCapRays(size_t count)
+{
+    GazeRayBatch rays;
+    rays.reserve(count);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> azimuth(-1.5f, 1.5f), elevation(-0.95f, 0.95f);
+    for (size_t i = 0; i < count; ++i) {
+        float az = azimuth(rng), el = elevation(rng);
+        rays.push_back(osg::Vec3(0.0f, 0.0f, 0.0f),
+                       osg::Vec3(std::sin(az) * std::cos(el), std::sin(el), std::cos(az) * std::cos(el)));
+    }
+    return rays;
+}
+
+// Rays from a point behind the zones towards random points over the zones' bounding box
+GazeRayBatch makeZoneRays(const std::vector<ViewingZone>& zones, size_t count)
+{
+    osg::Vec3 lo(1e30f, 1e30f, 1e30f), hi(-1e30f, -1e30f, -1e30f);
+    for (const auto& zone : zones) {
+        if (isZoneDegenerate(zone)) continue;
+        for (const auto& v : zone.corners) {
+            for (int k = 0; k < 3; ++k) {
+                lo[k] = std::min(lo[k], v[k]);
+                hi[k] = std::max(hi[k], v[k]);
+            }
+        }
+    }
+    osg::Vec3 center = (lo + hi) * 0.5f, extent = (hi - lo) * 0.6f;
+    osg::Vec3 eye = center - osg::Vec3(0.0f, 0.0f, extent.z() + 0.5f);
+    GazeRayBatch rays;
+    rays.reserve(count);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+    for (size_t i = 0; i < count; ++i) {
+        osg::Vec3 target = center + osg::Vec3(jitter(rng) * extent.x(), jitter(rng) * extent.y(), jitter(rng) * extent.z());
+        rays.push_back(eye, target - eye);
+    }
+    return rays;
+}
+
+// viewingzones.json with the given zones, in the shipped layout
+void writeZonesJson(const std::string& path, const std::vector<ViewingZone>& zones)
+{
+    std::ofstream out(path.c_str());
+    if (!out) throw std::runtime_error("Cannot write " + path);
+    out << "{\n  \"viewing_zones\": [\n" << std::setprecision(9);
+    for (size_t i = 0; i < zones.size(); ++i) {
+        const ViewingZone& zone = zones[i];
+        out << "    {\n      \"id\": " << zone.id << ",\n      \"label\": \"" << zone.label << "\",\n"
+            << "      \"color\": [" << zone.color.r() << ", " << zone.color.g() << ", " << zone.color.b() << ", "
+            << zone.color.a() << "],\n      \"corners\": [";
+        for (size_t c = 0; c < zone.corners.size(); ++c) {
+            for (int k = 0; k < 3; ++k) out << (c || k ? ", " : "") << zone.corners[c][k];
+        }
+        out << "]\n    }" << (i + 1 < zones.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    if (!out) throw std::runtime_error("Cannot write " + path);
+}
+
+// A mesh shaped like a CAD export: many small non-indexed drawables of 200 triangles,
+// each with its own material, tiling a 2 m sphere
+osg::ref_ptr<osg::Node> makeSyntheticModel(size_t triangles)
+{
+    const int patchTriangles = 200;
+    size_t patches = std::max<size_t>(1, triangles / patchTriangles);
+    int rings = std::max(1, static_cast<int>(std::sqrt(patches / 2.0)));
+    int segments = static_cast<int>((patches + rings - 1) / rings);
+
+    osg::ref_ptr<osg::Group> root = new osg::Group;
+    for (size_t p = 0; p < patches; ++p) {
+        int ring = static_cast<int>(p / segments), segment = static_cast<int>(p % segments);
+        double el0 = -1.5 + 3.0 * ring / rings, el1 = -1.5 + 3.0 * (ring + 1) / rings;
+        double az0 = 2.0 * osg::PI * segment / segments, az1 = 2.0 * osg::PI * (segment + 1) / segments;
+
+        // 10 x 10 cells, two triangles each
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+        auto point = [&](int i, int j) {
+            double az = az0 + (az1 - az0) * i / 10.0, el = el0 + (el1 - el0) * j / 10.0;
+            osg::Vec3 n(std::cos(az) * std::cos(el), std::sin(el), std::sin(az) * std::cos(el));
+            vertices->push_back(n * 2000.0f);
+            normals->push_back(n);
+        };
+        for (int j = 0; j < 10; ++j) {
+            for (int i = 0; i < 10; ++i) {
+                point(i, j); point(i + 1, j); point(i + 1, j + 1);
+                point(i, j); point(i + 1, j + 1); point(i, j + 1);
+            }
+        }
+        osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+        geometry->setVertexArray(vertices.get());
+        geometry->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+        geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, vertices->size()));
+        osg::ref_ptr<osg::Material> material = new osg::Material;
+        material->setDiffuse(osg::Material::FRONT_AND_BACK, osg::Vec4(0.6f, 0.6f, 0.65f, 1.0f));
+        geometry->getOrCreateStateSet()->setAttributeAndModes(material.get());
+
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->addDrawable(geometry.get());
+        root->addChild(geode.get());
+    }
+    return root;
+}
+
+void printUsage()
+{
+    std::cout << "Usage: visual_bench [--filter <text>] [--json <file>] [--label <text>] [--model <name>] [--quick] [--list]" << std::endl;
+    std::cout << "  --filter <text>  Run only cases whose name contains <text> (e.g. scaling/, kernels/)" << std::endl;
+    std::cout << "  --json <file>    Write the results (percentiles in microseconds) as JSON" << std::endl;
+    std::cout << "  --label <text>   Stored in the JSON, e.g. a release tag" << std::endl;
+    std::cout << "  --quick          Smaller scaling series, fewer runs" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string filter, jsonPath, label, carModelName = "Sharan";
+    bool quick = false, listOnly = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+        else if (arg == "--json" && i + 1 < argc) jsonPath = argv[++i];
+        else if (arg == "--label" && i + 1 < argc) label = argv[++i];
+        else if (arg == "--model" && i + 1 < argc) carModelName = argv[++i];
+        else if (arg == "--quick") quick = true;
+        else if (arg == "--list") listOnly = true;
+        else if (arg == "--help" || arg == "-h") { printUsage(); return 0; }
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+    BenchOptions fast;
+    if (quick) {
+        fast.minRuns = 5;
+        fast.minSeconds = 0.1;
+    }
+    BenchOptions slow = slowOptions();
+    BenchSuite suite(filter, listOnly);
+    std::string configPath = "carmodels/" + carModelName + "/config";
+
+    try {
+        if (!listOnly) {
+            std::cout << "Benchmarks for " << carModelName << ", " << workerCount() << " threads, built with "
+                      << VISUAL_BENCH_FLAGS << std::endl;
+            BenchSuite::printHeader();
+        }
+
+        // ---- Config loading (the viewer's loaders print diagnostics; those are discarded)
+        CarModelConfig carModel = parseCarModelFile("carmodels/carmodels.json", carModelName);
+        suite.run("config/loadCarModel", fast, [&]() {
+            QuietStdout quiet;
+            sink += loadCarModel(carModelName).transformations.size();
+        });
+        suite.run("config/loadCalibration", fast, [&]() {
+            QuietStdout quiet;
+            sink += static_cast<size_t>(loadCalibration(configPath)[0].focal_length_X);
+        });
+        suite.run("config/loadViewingZones", fast, [&]() {
+            QuietStdout quiet;
+            sink += loadViewingZones(configPath).size();
+        });
+        suite.run("config/parseViewTargetFile", fast, [&]() { sink += parseViewTargetFile("viewtarget.txt").size(); });
+        suite.run("config/applyCarModelTransformations", fast, [&]() {
+            std::ostringstream log;
+            sink += static_cast<size_t>(applyCarModelTransformations(carModel, log)(3, 3));
+        });
+
+        // ---- Scene construction: what main() waits for before the window opens, and the
+        // full scene with the car mesh (the optimized model cache is warm after the warm-up run)
+        suite.run("scene/buildModelSceneWithoutMesh", fast, [&]() {
+            QuietStdout quiet;
+            ModelScene scene;
+            if (!buildModelSceneWithoutMesh(carModelName, 0, false, scene)) {
+                throw std::runtime_error("buildModelSceneWithoutMesh failed");
+            }
+            sink += scene.zones.size();
+        });
+        suite.run("scene/buildModelScene", slow, [&]() {
+            QuietStdout quiet;
+            ModelScene scene;
+            if (!buildModelScene(carModelName, 0, false, scene)) throw std::runtime_error("buildModelScene failed");
+            sink += scene.zones.size();
+        });
+        std::vector<ViewingZone> zones = parseViewingZonesFile(configPath + "/viewingzones.json");
+        suite.run("scene/ZoneBatch", fast, [&]() {
+            osg::ref_ptr<ZoneBatch> batch = new ZoneBatch(zones, 1000.0f);
+            sink += batch->vertexCount();
+        });
+
+        // ---- Kernels
+        {
+            ZoneHitTester tester(zones);
+            GazeRayBatch rays = makeZoneRays(zones, 1 << 20);
+            std::vector<int> ids(rays.size());
+            std::vector<float> distances(rays.size());
+            suite.run("kernels/classify_bvh", fast, [&]() { tester.classify(rays, ids.data(), distances.data()); },
+                      rays.size());
+            suite.run("kernels/classify_bruteforce", fast,
+                      [&]() { tester.classifyBruteForce(rays, ids.data(), distances.data()); }, rays.size());
+            GazeRayBatch fewRays = makeZoneRays(zones, 1 << 16);
+            suite.run("kernels/classify_scalar", fast,
+                      [&]() { tester.classifyScalar(fewRays, ids.data(), distances.data()); }, fewRays.size());
+            suite.run("kernels/bvh_build", fast, [&]() { sink += ZoneBvh(zones).nodes().size(); });
+
+            // The ECU dump's zones overlap with four priority levels
+            ZoneHitTester targets(parseViewTargetFile("viewtarget.txt"));
+            suite.run("kernels/classify_bvh_priorities", fast,
+                      [&]() { targets.classify(rays, ids.data(), distances.data()); }, rays.size());
+
+            CoverageOptions coverage;
+            coverage.samples = uint64_t(1) << 22;
+            suite.run("kernels/zoneCoverage_sobol", fast,
+                      [&]() { sink += computeZoneCoverage(zones, coverage).gaps.size(); }, coverage.samples);
+        }
+        CameraModel camera(parseCalibrationFile(configPath + "/calibraton.json"));
+        {
+            const size_t count = 1 << 20;
+            std::vector<float> x(count), y(count), z(count), u(count), v(count);
+            std::mt19937 rng(5);
+            std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+            for (size_t i = 0; i < count; ++i) {
+                osg::Vec3d p = camera.cameraToCar(osg::Vec3d(spread(rng) * 0.8, spread(rng) * 0.6, 1.0 + spread(rng) * 0.5));
+                x[i] = p.x();
+                y[i] = p.y();
+                z[i] = p.z();
+            }
+            suite.run("kernels/projectPoints", fast,
+                      [&]() { projectPoints(camera, x.data(), y.data(), z.data(), count, u.data(), v.data()); }, count);
+            suite.run("kernels/projectPoints_1thread", fast,
+                      [&]() { projectPoints(camera, x.data(), y.data(), z.data(), count, u.data(), v.data(), 1); }, count);
+            suite.run("kernels/projectPointsScalar", fast,
+                      [&]() { projectPointsScalar(camera, x.data(), y.data(), z.data(), count, u.data(), v.data()); }, count);
+        }
+        {
+            // Candidate mountings within 5 cm and 5 degrees of the calibration
+            std::vector<CameraModel> mounts;
+            std::mt19937 rng(6);
+            std::uniform_real_distribution<double> spread(-1.0, 1.0);
+            for (int i = 0; i < 4096; ++i) {
+                osg::Vec3d offset(spread(rng), spread(rng), spread(rng));
+                mounts.push_back(perturbCamera(camera, offset * 0.05, spread(rng) * 5.0, spread(rng) * 5.0, spread(rng) * 5.0));
+            }
+            suite.run("kernels/visibleZoneFractions", fast,
+                      [&]() { sink += visibleZoneFractions(mounts, zones).size(); }, mounts.size());
+        }
+        {
+            // The default +-2 mm / +-0.2 deg grid, 5^6 poses
+            SweepOptions options;
+            suite.run("kernels/extrinsicsSweep", fast, [&]() {
+                sink += computeExtrinsicsSweep(camera, zones, options).corners.size();
+            }, 15625);
+        }
+        // The camera's-eye warp mesh at the default 16-pixel cells (158x125 cells)
+        suite.run("kernels/lensWarp", fast, [&]() {
+            sink += computeLensWarp(camera, 16).triangles.size();
+        }, 159 * 126);
+        if (suite.selected("kernels/pixelsToRays") || suite.selected("kernels/zoneAt")) {
+            UndistortMap undistort;
+            ZoneLabelMap labels;
+            if (!listOnly) {
+                undistort.load(camera);
+                labels.load(camera, zones);
+            }
+            const size_t count = 1 << 20;
+            std::vector<float> u(count), v(count), rx(count), ry(count);
+            std::vector<int> iu(count), iv(count);
+            std::mt19937 rng(6);
+            std::uniform_real_distribution<float> pu(0.0f, camera.imageWidth - 1.0f), pv(0.0f, camera.imageHeight - 1.0f);
+            for (size_t i = 0; i < count; ++i) {
+                u[i] = pu(rng);
+                v[i] = pv(rng);
+                iu[i] = static_cast<int>(u[i]);
+                iv[i] = static_cast<int>(v[i]);
+            }
+            suite.run("kernels/pixelsToRays", fast,
+                      [&]() { undistort.pixelsToRays(u.data(), v.data(), count, rx.data(), ry.data()); }, count);
+            suite.run("kernels/zoneAt", fast, [&]() {
+                size_t hits = 0;
+                for (size_t i = 0; i < count; ++i) hits += labels.zoneAt(iu[i], iv[i]) != 0;
+                sink += hits;
+            }, count);
+        }
+
+        // ---- Scaling: synthetic zone sets
+        std::vector<int> zoneCounts = quick ? std::vector<int>{20, 1000} : std::vector<int>{20, 100, 1000, 10000};
+        GazeRayBatch capRays = makeCapRays(1 << 18);
+        std::vector<int> ids(capRays.size());
+        for (int count : zoneCounts) {
+            std::string n = std::to_string(count);
+            std::vector<ViewingZone> synthetic = makeSyntheticZones(count);
+            if (suite.selected("scaling/parseViewingZones/" + n) && !listOnly) {
+                makeDirectories(cacheDirectory());
+                writeZonesJson(cacheDirectory() + "/bench_zones_" + n + ".json", synthetic);
+            }
+            suite.run("scaling/parseViewingZones/" + n, fast, [&]() {
+                sink += parseViewingZonesFile(cacheDirectory() + "/bench_zones_" + n + ".json").size();
+            }, count, count);
+            suite.run("scaling/bvh_build/" + n, fast, [&]() { sink += ZoneBvh(synthetic).nodes().size(); }, count, count);
+            if (suite.selected("scaling/classify/" + n)) {
+                ZoneHitTester tester(synthetic);
+                suite.run("scaling/classify/" + n, fast, [&]() { tester.classify(capRays, ids.data()); },
+                          capRays.size(), count);
+            }
+            suite.run("scaling/ZoneBatch/" + n, fast, [&]() {
+                osg::ref_ptr<ZoneBatch> batch = new ZoneBatch(synthetic, 1000.0f);
+                sink += batch->vertexCount();
+            }, count, count);
+        }
+
+        // ---- Scaling: synthetic model sizes through the model optimizer and cache
+        std::vector<size_t> triangleCounts = quick ? std::vector<size_t>{10000, 100000}
+                                                   : std::vector<size_t>{10000, 100000, 1000000};
+        for (size_t triangles : triangleCounts) {
+            std::string n = std::to_string(triangles);
+            std::string path = cacheDirectory() + "/bench_model_" + n + ".osgb";
+            bool wanted = suite.selected("scaling/model_optimize/" + n) || suite.selected("scaling/model_cached/" + n);
+            if (wanted && !listOnly && access(path.c_str(), R_OK) != 0) {
+                makeDirectories(cacheDirectory());
+                if (!osgDB::writeNodeFile(*makeSyntheticModel(triangles), path)) {
+                    throw std::runtime_error("Cannot write " + path);
+                }
+            }
+            suite.run("scaling/model_optimize/" + n, slow, [&]() {
+                QuietStdout quiet;
+                sink += loadOptimizedModel(path, osg::Matrix::identity(), true).valid();
+            }, triangles, triangles);
+            suite.run("scaling/model_cached/" + n, slow, [&]() {
+                QuietStdout quiet;
+                sink += loadOptimizedModel(path, osg::Matrix::identity(), false).valid();
+            }, triangles, triangles);
+        }
+
+        if (!jsonPath.empty() && !listOnly) suite.writeJson(jsonPath, label, carModelName);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Run fn repeatedly for at least minSeconds (at most 100 runs) and return the best time
+// per call in seconds
+template<typename Fn>
+double timeBest(Fn fn, double minSeconds)
+{
+    typedef std::chrono::steady_clock Clock;
+    double best = 1e30, total = 0.0;
+    int runs = 0;
+    do {
+        Clock::time_point t0 = Clock::now();
+        fn();
+        double s = std::chrono::duration<double>(Clock::now() - t0).count();
+        best = std::min(best, s);
+        total += s;
+        ++runs;
+    } while (total < minSeconds && runs < 100);
+    return best;
+}
+
+// Quoted JSON string for the benchmark and trace reports: quotes and backslashes escaped,
+// control characters dropped
+inline std::string jsonString(const std::string& s)
+{
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) out += c;
+    }
+    return out + "\"";
+}
+
+// Timed runs of one benchmark case (seconds per run, sorted)
+struct BenchResult {
+    std::string name;
+    double param = 0.0;     // size of a scaling series point (zones, triangles...), 0 = none
+    double items = 1.0;     // work items per run (rays, points...), for throughput
+    int warmupRuns = 0;
+    std::vector<double> samples;
+
+    // Nearest-rank percentile, p in [0, 100]
+    double percentile(double p) const
+    {
+        if (samples.empty()) return 0.0;
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+        return samples[std::min(samples.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+    double mean() const
+    {
+        double total = 0.0;
+        for (double s : samples) total += s;
+        return samples.empty() ? 0.0 : total / samples.size();
+    }
+};
+
+struct BenchOptions {
+    int warmupRuns = 2;
+    int minRuns = 10;
+    int maxRuns = 1000;
+    double minSeconds = 0.5;  // keep running fast cases until this much time is spent
+};
+
+// Run fn `warmupRuns` times untimed, then time at least minRuns runs, continuing until
+// minSeconds have been spent (at most maxRuns)
+template<typename Fn>
+BenchResult runBench(const std::string& name, const BenchOptions& options, Fn fn, double items = 1.0,
+                     double param = 0.0)
+{
+    typedef std::chrono::steady_clock Clock;
+    BenchResult result;
+    result.name = name;
+    result.param = param;
+    result.items = items;
+    result.warmupRuns = options.warmupRuns;
+    for (int i = 0; i < options.warmupRuns; ++i) fn();
+
+    double total = 0.0;
+    while (static_cast<int>(result.samples.size()) < options.minRuns ||
+           (total < options.minSeconds && static_cast<int>(result.samples.size()) < options.maxRuns)) {
+        Clock::time_point t0 = Clock::now();
+        fn();
+        double s = std::chrono::duration<double>(Clock::now() - t0).count();
+        result.samples.push_back(s);
+        total += s;
+    }
+    std::sort(result.samples.begin(), result.samples.end());
+    return result;
+}
+
+#endif
@@ -0,0 +1,442 @@
+#include "camera_frustum.h"
+#include "csv_util.h"
+#include "disk_cache.h"
+#include "parallel_for.h"
+#include "viewtarget.h"
+#include "zone_bvh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+const double kDegrees = 180.0 / 3.14159265358979323846;
+
+// Plane n.p + d >= 0 (inside)
+struct ClipPlane {
+    osg::Vec3d n;
+    double d;
+};
+
+struct FrustumPlanes {
+    ClipPlane planes[5];
+
+    explicit FrustumPlanes(const CameraFrustum& frustum)
+    {
+        for (int i = 0; i < 4; ++i) planes[i] = ClipPlane{ frustum.normals[i], -(frustum.normals[i] * frustum.apex) };
+        planes[4] = ClipPlane{ frustum.axis, -(frustum.axis * frustum.apex) - frustum.nearDistance };
+    }
+};
+
+// Zone fan triangle in carCoord
+struct ZoneTriangle {
+    osg::Vec3d a, b, c;
+    int zone;  // index into the zone list
+};
+
+double polygonArea(const osg::Vec3d* p, int count)
+{
+    osg::Vec3d sum;
+    for (int i = 1; i + 1 < count; ++i) sum += (p[i] - p[0]) ^ (p[i + 1] - p[0]);
+    return 0.5 * sum.length();
+}
+
+// Sutherland-Hodgman against the five planes; a triangle gains at most one vertex per plane
+double clippedTriangleArea(const FrustumPlanes& frustum, const ZoneTriangle& triangle)
+{
+    osg::Vec3d buffers[2][8];
+    osg::Vec3d* in = buffers[0];
+    osg::Vec3d* out = buffers[1];
+    in[0] = triangle.a;
+    in[1] = triangle.b;
+    in[2] = triangle.c;
+    int count = 3;
+    for (const ClipPlane& plane : frustum.planes) {
+        int kept = 0;
+        for (int i = 0; i < count; ++i) {
+            const osg::Vec3d& p = in[i];
+            const osg::Vec3d& q = in[(i + 1) % count];
+            double dp = plane.n * p + plane.d, dq = plane.n * q + plane.d;
+            if (dp >= 0.0) out[kept++] = p;
+            if ((dp >= 0.0) != (dq >= 0.0)) out[kept++] = p + (q - p) * (dp / (dp - dq));
+        }
+        count = kept;
+        if (count < 3) return 0.0;
+        std::swap(in, out);
+    }
+    return polygonArea(in, count);
+}
+
+// Non-degenerate zones' fan triangles and each zone's total area
+void zoneTriangles(const std::vector<ViewingZone>& zones, std::vector<ZoneTriangle>& triangles,
+                   std::vector<double>& areas)
+{
+    areas.assign(zones.size(), 0.0);
+    for (size_t z = 0; z < zones.size(); ++z) {
+        const ViewingZone& zone = zones[z];
+        if (isZoneDegenerate(zone)) continue;
+        for (size_t i = 1; i + 1 < zone.corners.size(); ++i) {
+            ZoneTriangle triangle = { osg::Vec3d(zone.corners[0]), osg::Vec3d(zone.corners[i]),
+                                      osg::Vec3d(zone.corners[i + 1]), static_cast<int>(z) };
+            osg::Vec3d p[3] = { triangle.a, triangle.b, triangle.c };
+            areas[z] += polygonArea(p, 3);
+            triangles.push_back(triangle);
+        }
+    }
+}
+
+void zoneFractions(const CameraModel& camera, const std::vector<ZoneTriangle>& triangles,
+                   const std::vector<double>& areas, float* fractions)
+{
+    FrustumPlanes planes((CameraFrustum(camera)));
+    std::vector<double> visible(areas.size(), 0.0);
+    for (const ZoneTriangle& triangle : triangles) visible[triangle.zone] += clippedTriangleArea(planes, triangle);
+    for (size_t z = 0; z < areas.size(); ++z) {
+        fractions[z] = areas[z] > 0.0 ? static_cast<float>(std::min(1.0, visible[z] / areas[z])) : 0.0f;
+    }
+}
+
+} // namespace
+
+CameraFrustum::CameraFrustum(const CameraModel& camera, double nearDistance)
+    : nearDistance(nearDistance)
+{
+    apex = osg::Vec3d(camera.t[0], camera.t[1], camera.t[2]);
+    axis = osg::Vec3d(camera.R[2][0], camera.R[2][1], camera.R[2][2]);
+    axis.normalize();
+    const double w = camera.imageWidth, h = camera.imageHeight;
+    const double pixels[4][2] = { { 0, 0 }, { w, 0 }, { w, h }, { 0, h } };
+    for (int i = 0; i < 4; ++i) {
+        osg::Vec3d ray((pixels[i][0] - camera.cx) / camera.fx, (pixels[i][1] - camera.cy) / camera.fy, 1.0);
+        corners[i] = camera.cameraToCar(ray) - apex;
+    }
+    for (int i = 0; i < 4; ++i) {
+        normals[i] = corners[i] ^ corners[(i + 1) % 4];
+        if (normals[i] * axis < 0.0) normals[i] = -normals[i];
+        normals[i].normalize();
+    }
+    horizontalFov = (std::atan(camera.cx / camera.fx) + std::atan((w - camera.cx) / camera.fx)) * kDegrees;
+    verticalFov = (std::atan(camera.cy / camera.fy) + std::atan((h - camera.cy) / camera.fy)) * kDegrees;
+}
+
+bool CameraFrustum::contains(const osg::Vec3d& p) const
+{
+    osg::Vec3d d = p - apex;
+    if (d * axis < nearDistance) return false;
+    for (int i = 0; i < 4; ++i) {
+        if (d * normals[i] < 0.0) return false;
+    }
+    return true;
+}
+
+osg::Matrixd cameraPoseMatrix(const CameraModel& camera)
+{
+    // The rows of R are the camera axes in carCoord: p_car = p_cam R + t for row vectors
+    const double (*R)[3] = camera.R;
+    return osg::Matrixd(R[0][0], R[0][1], R[0][2], 0.0,
+                        R[1][0], R[1][1], R[1][2], 0.0,
+                        R[2][0], R[2][1], R[2][2], 0.0,
+                        camera.t[0], camera.t[1], camera.t[2], 1.0);
+}
+
+osg::Matrixd cameraViewMatrix(const CameraModel& camera, double metersToMmScale)
+{
+    // Camera coordinates have y down and z forward; OpenGL eye coordinates y up and -z forward
+    return osg::Matrixd::inverse(cameraPoseMatrix(camera) * osg::Matrixd::scale(metersToMmScale, metersToMmScale, metersToMmScale)) *
+           osg::Matrixd::scale(1.0, -1.0, -1.0);
+}
+
+osg::Matrixd cameraProjectionMatrix(const CameraModel& camera, double nearDistance, double farDistance)
+{
+    // u = fx x/z + cx with pixel centers at integers, so the left edge of the viewport is
+    // u = -0.5: x_ndc = 2 (u + 0.5) / W - 1, and likewise for y with v pointing down
+    const double w = camera.imageWidth, h = camera.imageHeight, n = nearDistance, f = farDistance;
+    return osg::Matrixd(2.0 * camera.fx / w, 0.0, 0.0, 0.0,
+                        0.0, 2.0 * camera.fy / h, 0.0, 0.0,
+                        1.0 - 2.0 * (camera.cx + 0.5) / w, 2.0 * (camera.cy + 0.5) / h - 1.0, -(f + n) / (f - n), -1.0,
+                        0.0, 0.0, -2.0 * f * n / (f - n), 0.0);
+}
+
+double visibleZoneFraction(const CameraFrustum& frustum, const ViewingZone& zone)
+{
+    std::vector<ZoneTriangle> triangles;
+    std::vector<double> areas;
+    zoneTriangles(std::vector<ViewingZone>(1, zone), triangles, areas);
+    if (areas[0] <= 0.0) return 0.0;
+    FrustumPlanes planes(frustum);
+    double visible = 0.0;
+    for (const ZoneTriangle& triangle : triangles) visible += clippedTriangleArea(planes, triangle);
+    return std::min(1.0, visible / areas[0]);
+}
+
+std::vector<float> visibleZoneFractions(const std::vector<CameraModel>& cameras, const std::vector<ViewingZone>& zones,
+                                        unsigned threads)
+{
+    std::vector<ZoneTriangle> triangles;
+    std::vector<double> areas;
+    zoneTriangles(zones, triangles, areas);
+    std::vector<float> fractions(cameras.size() * zones.size());
+    parallelFor(cameras.size(), 64, 1, threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) zoneFractions(cameras[i], triangles, areas, &fractions[i * zones.size()]);
+    });
+    return fractions;
+}
+
+namespace {
+
+void printFrustumUsage()
+{
+    std::cout << "Usage: visual frustum [model <name>] [--calibration <calibraton.json>] [--viewtarget <file>]" << std::endl;
+    std::cout << "                      [--sensor WxH] [--near <m>]" << std::endl;
+    std::cout << "       visual frustum --batch <file.json | directory> ... [--poses <poses.csv>] [--random N]" << std::endl;
+    std::cout << "                      [--spread <mm>,<deg>] [--jobs N] [-o <results.csv>]" << std::endl;
+    std::cout << "  Builds the pinhole frustum of the calibration (focal lengths, principal point, sensor size;" << std::endl;
+    std::cout << "  default 2 x principal point) at its extrinsic pose and prints the area fraction of every" << std::endl;
+    std::cout << "  zone inside it." << std::endl;
+    std::cout << "  Batch mode evaluates candidate calibrations in parallel: every *.json below the --batch" << std::endl;
+    std::cout << "  paths, the poses in a CSV (dx,dy,dz meters, yaw,pitch,roll degrees relative to the model's" << std::endl;
+    std::cout << "  calibration, or 9 rotation + 3 translation values), and/or N random poses within" << std::endl;
+    std::cout << "  +-spread (default 50 mm, 5 deg). -o writes one row per candidate." << std::endl;
+}
+
+struct Candidate {
+    std::string source;
+    CameraModel camera;
+};
+
+} // namespace
+
+int runFrustumCommand(int argc, char** argv)
+{
+    std::string carModelName = "Sharan";
+    std::string calibrationPath, viewTargetPath, posesPath, outputPath;
+    std::vector<std::string> batchPaths;
+    size_t randomCount = 0;
+    double spreadMm = 50.0, spreadDeg = 5.0, nearDistance = 0.01;
+    int sensorWidth = 0, sensorHeight = 0;
+    unsigned jobs = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "model" && i + 1 < argc) carModelName = argv[++i];
+        else if (arg == "--calibration" && i + 1 < argc) calibrationPath = argv[++i];
+        else if (arg == "--viewtarget" && i + 1 < argc) viewTargetPath = argv[++i];
+        else if (arg == "--batch" && i + 1 < argc) {
+            batchPaths.push_back(argv[++i]);
+            while (i + 1 < argc && argv[i + 1][0] != '-') batchPaths.push_back(argv[++i]);
+        }
+        else if (arg == "--poses" && i + 1 < argc) posesPath = argv[++i];
+        else if (arg == "--random" && i + 1 < argc) randomCount = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--spread" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%lf,%lf", &spreadMm, &spreadDeg) != 2) {
+                std::cerr << "Error: --spread expects <mm>,<deg>" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--sensor" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &sensorWidth, &sensorHeight) != 2 || sensorWidth <= 0 || sensorHeight <= 0) {
+                std::cerr << "Error: --sensor expects <width>x<height> in pixels" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--near" && i + 1 < argc) nearDistance = std::atof(argv[++i]);
+        else if (arg == "--jobs" && i + 1 < argc) jobs = std::atoi(argv[++i]);
+        else if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--help" || arg == "-h") { printFrustumUsage(); return 0; }
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printFrustumUsage();
+            return 1;
+        }
+    }
+
+    std::vector<ViewingZone> zones;
+    CameraModel base;
+    try {
+        std::string configPath = "carmodels/" + carModelName + "/config";
+        base = CameraModel(parseCalibrationFile(calibrationPath.empty() ? configPath + "/calibraton.json" : calibrationPath));
+        if (!viewTargetPath.empty()) {
+            std::vector<std::string> warnings;
+            zones = parseViewTargetFile(viewTargetPath, &warnings);
+            for (const auto& warning : warnings) std::cerr << "Warning: " << warning << std::endl;
+        } else {
+            zones = parseViewingZonesFile(configPath + "/viewingzones.json");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    auto applySensor = [&](CameraModel& camera) {
+        if (sensorWidth > 0) {
+            camera.imageWidth = sensorWidth;
+            camera.imageHeight = sensorHeight;
+        }
+    };
+    applySensor(base);
+
+    // ---- One calibration
+    if (batchPaths.empty() && posesPath.empty() && randomCount == 0) {
+        CameraFrustum frustum(base, nearDistance);
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Camera center (m): " << frustum.apex.x() << ", " << frustum.apex.y() << ", " << frustum.apex.z() << std::endl;
+        std::cout << "Optical axis:      " << frustum.axis.x() << ", " << frustum.axis.y() << ", " << frustum.axis.z() << std::endl;
+        std::cout << "Sensor " << base.imageWidth << "x" << base.imageHeight << " px, field of view " << std::setprecision(1)
+                  << frustum.horizontalFov << " x " << frustum.verticalFov << " deg (pinhole, near plane "
+                  << std::setprecision(3) << nearDistance << " m)" << std::endl;
+        int full = 0, partial = 0;
+        for (const auto& zone : zones) {
+            if (isZoneDegenerate(zone)) continue;
+            double fraction = visibleZoneFraction(frustum, zone);
+            if (fraction >= 0.999) ++full;
+            else if (fraction > 0.0) ++partial;
+            std::cout << "  " << std::left << std::setw(10) << zone.label << std::right << std::setprecision(1)
+                      << std::setw(7) << 100.0 * fraction << " % in view" << std::endl;
+        }
+        std::cout << full << " zone(s) fully and " << partial << " partly in view" << std::endl;
+        return 0;
+    }
+
+    // ---- Batch over candidate calibrations
+    std::vector<Candidate> candidates;
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point t0 = Clock::now();
+    try {
+        std::vector<std::string> files;
+        for (const auto& path : batchPaths) {
+            std::vector<std::string> found = findFiles(path, ".json");
+            files.insert(files.end(), found.begin(), found.end());
+        }
+        std::vector<Candidate> parsed(files.size());
+        std::vector<std::string> errors(files.size());
+        parallelForEach(files.size(), jobs, [&](size_t i) {
+            parsed[i].source = files[i];
+            try {
+                parsed[i].camera = CameraModel(parseCalibrationFile(files[i]));
+                applySensor(parsed[i].camera);
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+            }
+        });
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (errors[i].empty()) candidates.push_back(parsed[i]);
+            else std::cerr << "Warning: Skipping " << files[i] << ": " << errors[i] << std::endl;
+        }
+
+        if (!posesPath.empty()) {
+            size_t row = 0;
+            forEachCsvRow(posesPath, 6, 12, "6 or 12 pose values", [&](const float* v, int count) {
+                ++row;
+                Candidate candidate;
+                candidate.source = posesPath + ":" + std::to_string(row);
+                if (count == 12) {
+                    candidate.camera = base;
+                    for (int k = 0; k < 9; ++k) candidate.camera.R[k / 3][k % 3] = v[k];
+                    for (int k = 0; k < 3; ++k) candidate.camera.t[k] = v[9 + k];
+                } else if (count == 6) {
+                    candidate.camera = perturbCamera(base, osg::Vec3d(v[0], v[1], v[2]), v[3], v[4], v[5]);
+                } else {
+                    throw std::runtime_error(posesPath + ": pose row " + std::to_string(row) + " has " +
+                                             std::to_string(count) + " values, expected 6 or 12");
+                }
+                candidates.push_back(candidate);
+            });
+        }
+
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<double> unit(-1.0, 1.0);
+        for (size_t i = 0; i < randomCount; ++i) {
+            Candidate candidate;
+            candidate.source = "random:" + std::to_string(i + 1);
+            osg::Vec3d offset(unit(rng), unit(rng), unit(rng));
+            double yaw = unit(rng), pitch = unit(rng), roll = unit(rng);
+            candidate.camera = perturbCamera(base, offset * (spreadMm * 0.001), yaw * spreadDeg, pitch * spreadDeg,
+                                             roll * spreadDeg);
+            candidates.push_back(candidate);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    double loadSeconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    if (candidates.empty()) {
+        std::cerr << "Error: No candidate calibrations" << std::endl;
+        return 1;
+    }
+
+    std::vector<CameraModel> cameras;
+    cameras.reserve(candidates.size());
+    for (const auto& candidate : candidates) cameras.push_back(candidate.camera);
+    t0 = Clock::now();
+    std::vector<float> fractions = visibleZoneFractions(cameras, zones, jobs);
+    double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::vector<size_t> zoneIndices;
+    for (size_t z = 0; z < zones.size(); ++z) {
+        if (!isZoneDegenerate(zones[z])) zoneIndices.push_back(z);
+    }
+    const size_t n = zones.size();
+    std::vector<double> meanFraction(candidates.size(), 0.0);
+    std::vector<int> fullCount(candidates.size(), 0);
+    for (size_t c = 0; c < candidates.size(); ++c) {
+        for (size_t z : zoneIndices) {
+            meanFraction[c] += fractions[c * n + z];
+            if (fractions[c * n + z] >= 0.999f) fullCount[c]++;
+        }
+        if (!zoneIndices.empty()) meanFraction[c] /= zoneIndices.size();
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << candidates.size() << " candidate calibration(s) loaded in " << loadSeconds << " s; "
+              << zoneIndices.size() << " zones clipped in " << seconds << " s (" << std::setprecision(0)
+              << candidates.size() / seconds << " calibrations/s on " << (jobs ? jobs : workerCount())
+              << " thread(s))" << std::endl;
+    std::cout << std::setprecision(1) << "Zones in view across candidates:" << std::endl;
+    for (size_t z : zoneIndices) {
+        double mean = 0.0;
+        size_t full = 0;
+        for (size_t c = 0; c < candidates.size(); ++c) {
+            mean += fractions[c * n + z];
+            if (fractions[c * n + z] >= 0.999f) ++full;
+        }
+        std::cout << "  " << std::left << std::setw(10) << zones[z].label << std::right << " mean " << std::setw(5)
+                  << 100.0 * mean / candidates.size() << " %, fully in view for " << 100.0 * full / candidates.size()
+                  << " % of candidates" << std::endl;
+    }
+    std::vector<size_t> order(candidates.size());
+    for (size_t c = 0; c < order.size(); ++c) order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return meanFraction[a] > meanFraction[b]; });
+    std::cout << "Best candidates (mean visible fraction):" << std::endl;
+    for (size_t i = 0; i < order.size() && i < 5; ++i) {
+        size_t c = order[i];
+        std::cout << "  " << candidates[c].source << ": " << 100.0 * meanFraction[c] << " %, " << fullCount[c]
+                  << " zone(s) fully in view" << std::endl;
+    }
+
+    if (!outputPath.empty()) {
+        std::ofstream out(outputPath.c_str());
+        out << "candidate,source,tx,ty,tz,zones_fully_in_view,mean_visible_fraction";
+        for (size_t z : zoneIndices) out << ",zone_" << zones[z].id;
+        out << "\n" << std::setprecision(6);
+        for (size_t c = 0; c < candidates.size(); ++c) {
+            const CameraModel& camera = candidates[c].camera;
+            out << c << "," << candidates[c].source << "," << camera.t[0] << "," << camera.t[1] << "," << camera.t[2]
+                << "," << fullCount[c] << "," << meanFraction[c];
+            for (size_t z : zoneIndices) out << "," << fractions[c * n + z];
+            out << "\n";
+        }
+        if (!out) {
+            std::cerr << "Error: Cannot write " << outputPath << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << outputPath << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef CAMERA_FRUSTUM_H
+#define CAMERA_FRUSTUM_H
+
+#include "camera_projection.h"
+#include "config_loader.h"
+
+#include <osg/Matrixd>
+#include <osg/Vec3d>
+#include <vector>
+
+// The pinhole view volume of a calibrated camera in carCoord space (meters): the pyramid
+// from the camera center through the four sensor corners, given by the focal lengths,
+// the principal point and the image size, and cut off by a near plane. Lens distortion
+// bends the real image border outwards; the frustum ignores it.
+struct CameraFrustum {
+    osg::Vec3d apex;        // camera center
+    osg::Vec3d axis;        // optical axis (unit)
+    osg::Vec3d corners[4];  // rays through pixels (0,0), (W,0), (W,H), (0,H) at unit depth along the axis
+    osg::Vec3d normals[4];  // inward normals of the side planes through the apex (unit)
+    double nearDistance;
+    double horizontalFov, verticalFov;  // degrees
+
+    CameraFrustum() : nearDistance(0.01), horizontalFov(0.0), verticalFov(0.0) {}
+    explicit CameraFrustum(const CameraModel& camera, double nearDistance = 0.01);
+
+    bool contains(const osg::Vec3d& p) const;
+};
+
+// Camera-to-carCoord transform of the calibrated pose (OSG row-vector convention): camera
+// coordinates (x right, y down, z along the optical axis) times this matrix give carCoord
+osg::Matrixd cameraPoseMatrix(const CameraModel& camera);
+
+// Looking through the calibrated camera in OpenGL: the view matrix for a scene drawn in
+// carCoord scaled by metersToMmScale (eye coordinates in meters), and the projection that
+// maps the whole sensor onto the viewport, so undistorted pixel (u, v) lands on the same
+// pixel of a WxH viewport. Lens distortion is not applied. near/far in meters.
+osg::Matrixd cameraViewMatrix(const CameraModel& camera, double metersToMmScale);
+osg::Matrixd cameraProjectionMatrix(const CameraModel& camera, double nearDistance, double farDistance);
+
+// Part of the zone's area inside the frustum (0 to 1). The zone is split into the triangle
+// fan the viewer draws and every triangle is clipped against the five planes. Degenerate
+// zones return 0.
+double visibleZoneFraction(const CameraFrustum& frustum, const ViewingZone& zone);
+
+// Visible fractions of many zones for many candidate cameras, candidates split across
+// threads (threads = 0: one per core). Result: fractions[candidate * zones.size() + zone].
+std::vector<float> visibleZoneFractions(const std::vector<CameraModel>& cameras, const std::vector<ViewingZone>& zones,
+                                        unsigned threads = 0);
+
+// `visual frustum ...` - the calibrated frustum and each zone's visible fraction, for one
+// calibration or in batch over candidate calibrations
+int runFrustumCommand(int argc, char** argv);
+
+#endif
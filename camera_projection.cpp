@@ -0,0 +1,449 @@
+#include "camera_projection.h"
+#include "csv_util.h"
+#include "bench_util.h"
+#include "parallel_for.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <stdexcept>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CAMERA_PROJECTION_X86 1
+#endif
+
+namespace {
+
+// Points closer to the image plane than this (meters) are treated as behind the camera
+const double kMinDepth = 1e-6;
+
+// Batches smaller than this are not worth a thread
+const size_t kMinPointsPerThread = 16384;
+
+// Float copy of the model for the batch kernels
+struct ProjectionParams {
+    float r[9];
+    float t[3];
+    float fx, fy, cx, cy;
+    float k[6];
+    float p1, p2;
+
+    explicit ProjectionParams(const CameraModel& c) {
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) r[i * 3 + j] = static_cast<float>(c.R[i][j]);
+            t[i] = static_cast<float>(c.t[i]);
+        }
+        fx = static_cast<float>(c.fx); fy = static_cast<float>(c.fy);
+        cx = static_cast<float>(c.cx); cy = static_cast<float>(c.cy);
+        for (int i = 0; i < 6; ++i) k[i] = static_cast<float>(c.k[i]);
+        p1 = static_cast<float>(c.p1); p2 = static_cast<float>(c.p2);
+    }
+};
+
+void projectRangeScalar(const ProjectionParams& c, const float* px, const float* py, const float* pz,
+                        size_t begin, size_t end, float* u, float* v)
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (size_t i = begin; i < end; ++i) {
+        float dx = px[i] - c.t[0], dy = py[i] - c.t[1], dz = pz[i] - c.t[2];
+        float X = c.r[0] * dx + c.r[1] * dy + c.r[2] * dz;
+        float Y = c.r[3] * dx + c.r[4] * dy + c.r[5] * dz;
+        float Z = c.r[6] * dx + c.r[7] * dy + c.r[8] * dz;
+        if (!(Z > static_cast<float>(kMinDepth))) {
+            u[i] = v[i] = nan;
+            continue;
+        }
+        float invZ = 1.0f / Z;
+        float x = X * invZ, y = Y * invZ;
+        float r2 = x * x + y * y, r4 = r2 * r2, r6 = r4 * r2;
+        float radial = (1.0f + c.k[0] * r2 + c.k[1] * r4 + c.k[2] * r6) /
+                       (1.0f + c.k[3] * r2 + c.k[4] * r4 + c.k[5] * r6);
+        float xy = x * y;
+        float xd = x * radial + 2.0f * c.p1 * xy + c.p2 * (r2 + 2.0f * x * x);
+        float yd = y * radial + c.p1 * (r2 + 2.0f * y * y) + 2.0f * c.p2 * xy;
+        u[i] = c.fx * xd + c.cx;
+        v[i] = c.fy * yd + c.cy;
+    }
+}
+
+#ifdef CAMERA_PROJECTION_X86
+
+// Returns the number of points done (a multiple of 8 from `begin`)
+__attribute__((target("avx")))
+size_t projectRangeAvx(const ProjectionParams& c, const float* px, const float* py, const float* pz,
+                       size_t begin, size_t end, float* u, float* v)
+{
+    const __m256 r0 = _mm256_set1_ps(c.r[0]), r1 = _mm256_set1_ps(c.r[1]), r2c = _mm256_set1_ps(c.r[2]);
+    const __m256 r3 = _mm256_set1_ps(c.r[3]), r4c = _mm256_set1_ps(c.r[4]), r5 = _mm256_set1_ps(c.r[5]);
+    const __m256 r6c = _mm256_set1_ps(c.r[6]), r7 = _mm256_set1_ps(c.r[7]), r8 = _mm256_set1_ps(c.r[8]);
+    const __m256 tx = _mm256_set1_ps(c.t[0]), ty = _mm256_set1_ps(c.t[1]), tz = _mm256_set1_ps(c.t[2]);
+    const __m256 k1 = _mm256_set1_ps(c.k[0]), k2 = _mm256_set1_ps(c.k[1]), k3 = _mm256_set1_ps(c.k[2]);
+    const __m256 k4 = _mm256_set1_ps(c.k[3]), k5 = _mm256_set1_ps(c.k[4]), k6 = _mm256_set1_ps(c.k[5]);
+    const __m256 twoP1 = _mm256_set1_ps(2.0f * c.p1), twoP2 = _mm256_set1_ps(2.0f * c.p2);
+    const __m256 p1 = _mm256_set1_ps(c.p1), p2 = _mm256_set1_ps(c.p2);
+    const __m256 fx = _mm256_set1_ps(c.fx), fy = _mm256_set1_ps(c.fy);
+    const __m256 cx = _mm256_set1_ps(c.cx), cy = _mm256_set1_ps(c.cy);
+    const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+    const __m256 minDepth = _mm256_set1_ps(static_cast<float>(kMinDepth));
+    const __m256 nan = _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN());
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(px + i), tx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(py + i), ty);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(pz + i), tz);
+        __m256 X = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r0, dx), _mm256_mul_ps(r1, dy)), _mm256_mul_ps(r2c, dz));
+        __m256 Y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r3, dx), _mm256_mul_ps(r4c, dy)), _mm256_mul_ps(r5, dz));
+        __m256 Z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r6c, dx), _mm256_mul_ps(r7, dy)), _mm256_mul_ps(r8, dz));
+        __m256 inFront = _mm256_cmp_ps(Z, minDepth, _CMP_GT_OQ);
+
+        __m256 invZ = _mm256_div_ps(one, Z);
+        __m256 x = _mm256_mul_ps(X, invZ), y = _mm256_mul_ps(Y, invZ);
+        __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), xy = _mm256_mul_ps(x, y);
+        __m256 rr2 = _mm256_add_ps(xx, yy);
+        __m256 rr4 = _mm256_mul_ps(rr2, rr2);
+        __m256 rr6 = _mm256_mul_ps(rr4, rr2);
+        __m256 num = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(one, _mm256_mul_ps(k1, rr2)), _mm256_mul_ps(k2, rr4)), _mm256_mul_ps(k3, rr6));
+        __m256 den = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(one, _mm256_mul_ps(k4, rr2)), _mm256_mul_ps(k5, rr4)), _mm256_mul_ps(k6, rr6));
+        __m256 radial = _mm256_div_ps(num, den);
+
+        __m256 xd = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, radial), _mm256_mul_ps(twoP1, xy)),
+                                  _mm256_mul_ps(p2, _mm256_add_ps(rr2, _mm256_mul_ps(two, xx))));
+        __m256 yd = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(y, radial), _mm256_mul_ps(p1, _mm256_add_ps(rr2, _mm256_mul_ps(two, yy)))),
+                                  _mm256_mul_ps(twoP2, xy));
+        __m256 pu = _mm256_add_ps(_mm256_mul_ps(fx, xd), cx);
+        __m256 pv = _mm256_add_ps(_mm256_mul_ps(fy, yd), cy);
+        _mm256_storeu_ps(u + i, _mm256_blendv_ps(nan, pu, inFront));
+        _mm256_storeu_ps(v + i, _mm256_blendv_ps(nan, pv, inFront));
+    }
+    return i - begin;
+}
+
+bool cpuHasAvx()
+{
+    static const bool hasAvx = __builtin_cpu_supports("avx");
+    return hasAvx;
+}
+
+#endif
+
+void projectRange(const ProjectionParams& c, const float* x, const float* y, const float* z,
+                  size_t begin, size_t end, float* u, float* v)
+{
+    size_t done = 0;
+#ifdef CAMERA_PROJECTION_X86
+    if (cpuHasAvx()) done = projectRangeAvx(c, x, y, z, begin, end, u, v);
+#endif
+    projectRangeScalar(c, x, y, z, begin + done, end, u, v);
+}
+
+} // namespace
+
+CameraModel::CameraModel(const CameraCalibration& calibration)
+{
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) R[i][j] = calibration.rotation_matrix[i][j];
+        t[i] = calibration.translation_vector[i];
+    }
+    fx = calibration.focal_length_X;
+    fy = calibration.focal_length_Y;
+    cx = calibration.principal_point_X;
+    cy = calibration.principal_point_Y;
+    k[0] = calibration.distortion_k1;
+    k[1] = calibration.distortion_k2;
+    k[2] = calibration.distortion_k3;
+    k[3] = calibration.distortion_k4;
+    k[4] = calibration.distortion_k5;
+    k[5] = calibration.distortion_k6;
+    p1 = calibration.distortion_p1;
+    p2 = calibration.distortion_p2;
+    imageWidth = static_cast<int>(std::floor(2.0 * cx / 8.0 + 0.5)) * 8;
+    imageHeight = static_cast<int>(std::floor(2.0 * cy / 8.0 + 0.5)) * 8;
+}
+
+osg::Vec3d CameraModel::carToCamera(const osg::Vec3d& p) const
+{
+    osg::Vec3d d(p.x() - t[0], p.y() - t[1], p.z() - t[2]);
+    return osg::Vec3d(R[0][0] * d.x() + R[0][1] * d.y() + R[0][2] * d.z(),
+                      R[1][0] * d.x() + R[1][1] * d.y() + R[1][2] * d.z(),
+                      R[2][0] * d.x() + R[2][1] * d.y() + R[2][2] * d.z());
+}
+
+osg::Vec3d CameraModel::cameraToCar(const osg::Vec3d& p) const
+{
+    return osg::Vec3d(R[0][0] * p.x() + R[1][0] * p.y() + R[2][0] * p.z() + t[0],
+                      R[0][1] * p.x() + R[1][1] * p.y() + R[2][1] * p.z() + t[1],
+                      R[0][2] * p.x() + R[1][2] * p.y() + R[2][2] * p.z() + t[2]);
+}
+
+CameraModel perturbCamera(const CameraModel& camera, const osg::Vec3d& offset, double yawDeg, double pitchDeg,
+                          double rollDeg)
+{
+    const double toRadians = 3.14159265358979323846 / 180.0;
+    double cy = std::cos(yawDeg * toRadians), sy = std::sin(yawDeg * toRadians);
+    double cp = std::cos(pitchDeg * toRadians), sp = std::sin(pitchDeg * toRadians);
+    double cr = std::cos(rollDeg * toRadians), sr = std::sin(rollDeg * toRadians);
+    // Camera-frame rotation D = Rz(roll) Rx(pitch) Ry(yaw); the new rows are D R
+    const double yaw[3][3] = { { cy, 0, sy }, { 0, 1, 0 }, { -sy, 0, cy } };
+    const double pitch[3][3] = { { 1, 0, 0 }, { 0, cp, -sp }, { 0, sp, cp } };
+    const double roll[3][3] = { { cr, -sr, 0 }, { sr, cr, 0 }, { 0, 0, 1 } };
+    double rx[3][3], d[3][3];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) rx[i][j] = pitch[i][0] * yaw[0][j] + pitch[i][1] * yaw[1][j] + pitch[i][2] * yaw[2][j];
+    }
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) d[i][j] = roll[i][0] * rx[0][j] + roll[i][1] * rx[1][j] + roll[i][2] * rx[2][j];
+    }
+
+    CameraModel moved = camera;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) moved.R[i][j] = d[i][0] * camera.R[0][j] + d[i][1] * camera.R[1][j] + d[i][2] * camera.R[2][j];
+        moved.t[i] = camera.t[i] + offset[i];
+    }
+    return moved;
+}
+
+osg::Vec2d CameraModel::distortNormalized(double x, double y) const
+{
+    double r2 = x * x + y * y, r4 = r2 * r2, r6 = r4 * r2;
+    double radial = (1.0 + k[0] * r2 + k[1] * r4 + k[2] * r6) / (1.0 + k[3] * r2 + k[4] * r4 + k[5] * r6);
+    double xd = x * radial + 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
+    double yd = y * radial + p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
+    return osg::Vec2d(xd, yd);
+}
+
+osg::Vec2d CameraModel::distort(double x, double y) const
+{
+    osg::Vec2d d = distortNormalized(x, y);
+    return osg::Vec2d(fx * d.x() + cx, fy * d.y() + cy);
+}
+
+bool CameraModel::undistort(const osg::Vec2d& pixel, osg::Vec2d& normalized) const
+{
+    const double targetX = (pixel.x() - cx) / fx;
+    const double targetY = (pixel.y() - cy) / fy;
+    const double h = 1e-7;
+
+    // Newton on distortNormalized(x, y) = target with a numeric Jacobian, starting from the
+    // distorted point itself
+    double x = targetX, y = targetY;
+    for (int iteration = 0; iteration < 50; ++iteration) {
+        osg::Vec2d f = distortNormalized(x, y);
+        double ex = f.x() - targetX, ey = f.y() - targetY;
+        if (ex * ex + ey * ey < 1e-24) {
+            normalized.set(x, y);
+            return true;
+        }
+        osg::Vec2d fdx = distortNormalized(x + h, y), fdy = distortNormalized(x, y + h);
+        double j00 = (fdx.x() - f.x()) / h, j01 = (fdy.x() - f.x()) / h;
+        double j10 = (fdx.y() - f.y()) / h, j11 = (fdy.y() - f.y()) / h;
+        double det = j00 * j11 - j01 * j10;
+        if (std::fabs(det) < 1e-12) return false;
+        double stepX = (j11 * ex - j01 * ey) / det;
+        double stepY = (j00 * ey - j10 * ex) / det;
+        // Damp large steps, the rational model flattens out far from the center
+        double length = std::sqrt(stepX * stepX + stepY * stepY);
+        double limit = 0.5 * (1.0 + std::sqrt(x * x + y * y));
+        if (length > limit) { stepX *= limit / length; stepY *= limit / length; }
+        x -= stepX;
+        y -= stepY;
+    }
+    return false;
+}
+
+bool CameraModel::project(const osg::Vec3d& carPoint, osg::Vec2d& pixel) const
+{
+    osg::Vec3d p = carToCamera(carPoint);
+    if (!(p.z() > kMinDepth)) return false;
+    pixel = distort(p.x() / p.z(), p.y() / p.z());
+    return true;
+}
+
+void projectPoints(const CameraModel& camera, const float* x, const float* y, const float* z,
+                   size_t count, float* u, float* v, unsigned threads)
+{
+    const ProjectionParams params(camera);
+    parallelFor(count, kMinPointsPerThread, 8, threads, [&](size_t begin, size_t end) {
+        projectRange(params, x, y, z, begin, end, u, v);
+    });
+}
+
+std::vector<osg::Vec2> projectPoints(const CameraModel& camera, const std::vector<osg::Vec3>& points)
+{
+    std::vector<float> x(points.size()), y(points.size()), z(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        x[i] = points[i].x(); y[i] = points[i].y(); z[i] = points[i].z();
+    }
+    std::vector<float> u(points.size()), v(points.size());
+    projectPoints(camera, x.data(), y.data(), z.data(), points.size(), u.data(), v.data(), 1);
+
+    std::vector<osg::Vec2> pixels(points.size());
+    for (size_t i = 0; i < points.size(); ++i) pixels[i].set(u[i], v[i]);
+    return pixels;
+}
+
+void projectPointsScalar(const CameraModel& camera, const float* x, const float* y, const float* z,
+                         size_t count, float* u, float* v)
+{
+    projectRangeScalar(ProjectionParams(camera), x, y, z, 0, count, u, v);
+}
+
+// ----------- visual project -----------
+
+namespace {
+
+struct PointBatch {
+    std::vector<float> x, y, z;
+    size_t size() const { return x.size(); }
+    void push_back(float px, float py, float pz) { x.push_back(px); y.push_back(py); z.push_back(pz); }
+};
+
+// Random points in front of the camera, within a ~90 degree cone, 0.3 - 2 m away
+void makeRandomPoints(const CameraModel& camera, size_t count, PointBatch& points)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> lateral(-1.0, 1.0), depth(0.3, 2.0);
+    points.x.reserve(count); points.y.reserve(count); points.z.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        double d = depth(rng);
+        osg::Vec3d p = camera.cameraToCar(osg::Vec3d(lateral(rng) * d, lateral(rng) * d, d));
+        points.push_back(static_cast<float>(p.x()), static_cast<float>(p.y()), static_cast<float>(p.z()));
+    }
+}
+
+void printProjectUsage()
+{
+    std::cout << "Usage: visual project <points.csv> [model <name>] [-o <pixels.csv>] [--threads N]" << std::endl;
+    std::cout << "       visual project --random <count> [model <name>] [--threads N]" << std::endl;
+    std::cout << "       visual project --zones [model <name>]" << std::endl;
+    std::cout << "  Points CSV columns: [timestamp,] x, y, z  (carCoord, meters)" << std::endl;
+    std::cout << "  Output CSV columns: point, u, v  (empty for points behind the camera)" << std::endl;
+}
+
+int printZoneProjection(const CameraModel& camera, const std::vector<ViewingZone>& zones)
+{
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& zone : zones) {
+        std::vector<osg::Vec2> pixels = projectPoints(camera, zone.corners);
+        std::cout << zone.label << " (id " << zone.id << "):";
+        for (const auto& p : pixels) {
+            if (std::isnan(p.x())) std::cout << "  (behind camera)";
+            else std::cout << "  (" << p.x() << ", " << p.y() << ")";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+} // namespace
+
+int runProjectCommand(int argc, char** argv)
+{
+    std::string pointsPath, outputPath;
+    std::string carModelName = "Sharan";
+    size_t randomCount = 0;
+    unsigned threads = 0;
+    bool zonesOnly = false;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "model" && i + 1 < argc) carModelName = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--random" && i + 1 < argc) randomCount = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (arg == "--zones") zonesOnly = true;
+        else if (arg == "--help" || arg == "-h") { printProjectUsage(); return 0; }
+        else if (pointsPath.empty() && arg[0] != '-') pointsPath = arg;
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printProjectUsage();
+            return 1;
+        }
+    }
+    if (pointsPath.empty() && randomCount == 0 && !zonesOnly) {
+        printProjectUsage();
+        return 1;
+    }
+
+    std::string configPath = "carmodels/" + carModelName + "/config";
+    CameraModel camera;
+    PointBatch points;
+    try {
+        camera = CameraModel(parseCalibrationFile(configPath + "/calibraton.json"));
+        if (zonesOnly) return printZoneProjection(camera, parseViewingZonesFile(configPath + "/viewingzones.json"));
+
+        if (!pointsPath.empty()) {
+            forEachCsvRow(pointsPath, 3, 4, "3 or 4 numeric columns", [&](const float* values, int count) {
+                const float* p = values + (count - 3);
+                points.push_back(p[0], p[1], p[2]);
+            });
+        } else {
+            makeRandomPoints(camera, randomCount, points);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    const size_t n = points.size();
+    std::cout << "Projecting " << n << " points with " << (threads ? threads : workerCount()) << " thread(s)" << std::endl;
+
+    std::vector<float> u(n), v(n);
+    double batchSeconds = timeBest([&]() {
+        projectPoints(camera, points.x.data(), points.y.data(), points.z.data(), n, u.data(), v.data(), threads);
+    }, 0.25);
+    double singleSeconds = timeBest([&]() {
+        projectPoints(camera, points.x.data(), points.y.data(), points.z.data(), n, u.data(), v.data(), 1);
+    }, 0.25);
+    std::vector<float> su(n), sv(n);
+    double scalarSeconds = timeBest([&]() {
+        projectPointsScalar(camera, points.x.data(), points.y.data(), points.z.data(), n, su.data(), sv.data());
+    }, 0.25);
+    std::cout << std::fixed << std::setprecision(1)
+              << "  batch:          " << n / batchSeconds / 1e6 << " M points/s" << std::endl
+              << "  single thread:  " << n / singleSeconds / 1e6 << " M points/s" << std::endl
+              << "  scalar:         " << n / scalarSeconds / 1e6 << " M points/s" << std::endl;
+
+    // Compare against the double precision reference
+    double maxError = 0.0;
+    size_t behind = 0, disagree = 0;
+    for (size_t i = 0; i < n; ++i) {
+        osg::Vec2d ref;
+        bool inFront = camera.project(osg::Vec3d(points.x[i], points.y[i], points.z[i]), ref);
+        if (!inFront) ++behind;
+        if (inFront != !std::isnan(u[i])) {
+            ++disagree;
+            continue;
+        }
+        if (inFront) maxError = std::max(maxError, std::max(std::fabs(u[i] - ref.x()), std::fabs(v[i] - ref.y())));
+    }
+    std::cout << "Double precision reference: max error " << std::setprecision(5) << maxError << " px, "
+              << behind << " point(s) behind the camera" << std::endl;
+    if (disagree) {
+        std::cerr << "Error: " << disagree << " point(s) disagree with the reference on visibility" << std::endl;
+        return 1;
+    }
+
+    if (!outputPath.empty()) {
+        std::ofstream out(outputPath.c_str());
+        if (!out) {
+            std::cerr << "Error: Cannot write " << outputPath << std::endl;
+            return 1;
+        }
+        out << "point,u,v\n" << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < n; ++i) {
+            out << i << ',';
+            if (!std::isnan(u[i])) out << u[i] << ',' << v[i];
+            else out << ',';
+            out << '\n';
+        }
+        std::cout << "Wrote " << outputPath << std::endl;
+    }
+    return 0;
+}
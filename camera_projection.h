@@ -0,0 +1,74 @@
+#ifndef CAMERA_PROJECTION_H
+#define CAMERA_PROJECTION_H
+
+#include "config_loader.h"
+
+#include <osg/Vec2>
+#include <osg/Vec2d>
+#include <osg/Vec3d>
+#include <vector>
+
+// Pinhole camera with the rational distortion model of our camera stack (OpenCV
+// CALIB_RATIONAL_MODEL):
+//   x' = X/Z, y' = Y/Z, r2 = x'^2 + y'^2
+//   radial = (1 + k1 r2 + k2 r4 + k3 r6) / (1 + k4 r2 + k5 r4 + k6 r6)
+//   x'' = x' radial + 2 p1 x'y' + p2 (r2 + 2x'^2)
+//   y'' = y' radial + p1 (r2 + 2y'^2) + 2 p2 x'y'
+//   u = fx x'' + cx, v = fy y'' + cy
+//
+// The extrinsics are the camera pose in carCoord space (meters): rows of rotation_matrix
+// are the camera axes and translation_vector is the camera center, so
+//   p_cam = R (p_car - t)
+struct CameraModel {
+    double R[3][3];
+    double t[3];
+    double fx, fy, cx, cy;
+    double k[6];
+    double p1, p2;
+
+    // calibraton.json has no image size; it is taken as twice the principal point,
+    // rounded to a multiple of 8 (2520x2000 for the shipped calibrations)
+    int imageWidth, imageHeight;
+
+    CameraModel() {}
+    explicit CameraModel(const CameraCalibration& calibration);
+
+    osg::Vec3d carToCamera(const osg::Vec3d& p) const;
+    osg::Vec3d cameraToCar(const osg::Vec3d& p) const;
+
+    // Normalized image coordinates (x', y') to distorted normalized / pixel coordinates
+    osg::Vec2d distortNormalized(double x, double y) const;
+    osg::Vec2d distort(double x, double y) const;
+
+    // Inverse of distort() by Newton iteration (slow; see UndistortMap for bulk use).
+    // Returns false if the solve does not converge.
+    bool undistort(const osg::Vec2d& pixel, osg::Vec2d& normalized) const;
+
+    // Double precision reference. Returns false (and leaves `pixel` untouched) for points
+    // on or behind the image plane.
+    bool project(const osg::Vec3d& carPoint, osg::Vec2d& pixel) const;
+};
+
+// The same camera moved by `offset` (carCoord meters) and turned by yaw, pitch and roll
+// (degrees, about its own y, x and z axes, applied in that order). Mounting studies and
+// tolerance sweeps start from the calibrated pose.
+CameraModel perturbCamera(const CameraModel& camera, const osg::Vec3d& offset, double yawDeg, double pitchDeg,
+                          double rollDeg);
+
+// Batch projection of carCoord points (SoA, meters) to distorted pixel coordinates.
+// Runs 8 points at a time with AVX where available and splits large batches across
+// threads (threads = 0: one per core). Points behind the camera produce NaN.
+void projectPoints(const CameraModel& camera, const float* x, const float* y, const float* z,
+                   size_t count, float* u, float* v, unsigned threads = 0);
+
+// Convenience overload for small point lists (zone corners, landmarks)
+std::vector<osg::Vec2> projectPoints(const CameraModel& camera, const std::vector<osg::Vec3>& points);
+
+// Single-threaded scalar float version of the batch kernel, for verification and timing
+void projectPointsScalar(const CameraModel& camera, const float* x, const float* y, const float* z,
+                         size_t count, float* u, float* v);
+
+// `visual project ...` - reproject points or zone corners into the camera image
+int runProjectCommand(int argc, char** argv);
+
+#endif
@@ -0,0 +1,443 @@
+#include "camera_view.h"
+#include "camera_frustum.h"
+#include "parallel_for.h"
+#include "render_batch.h"
+#include "scene_builder.h"
+
+#include <osgViewer/Viewer>
+#include <osgDB/WriteFile>
+#include <osg/Geode>
+#include <osg/Image>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+#ifndef GL_TEXTURE_CUBE_MAP_SEAMLESS
+#define GL_TEXTURE_CUBE_MAP_SEAMLESS 0x884F
+#endif
+
+namespace {
+
+// Eye space of the camera's-eye renders, meters
+const double kNear = 0.02;
+const double kFar = 20.0;
+
+// Rays are looked up as directions in the calibrated camera's OpenGL eye space, where the
+// camera's (x', y', 1) is (x', -y', -1). The rotations take them into the eye space of the
+// camera that renders a cube map face, so that the face pixel the GL cube map lookup reads
+// for a direction is the one that direction was rendered to. Looking backwards (+Z) is
+// never needed.
+struct CubeFace {
+    osg::TextureCubeMap::Face face;
+    osg::Matrixd rotation;
+};
+
+std::vector<CubeFace> forwardFaces()
+{
+    std::vector<CubeFace> faces(5);
+    faces[0].face = osg::TextureCubeMap::NEGATIVE_Z;
+    faces[0].rotation.set(-1, 0, 0, 0,  0, -1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1);
+    faces[1].face = osg::TextureCubeMap::POSITIVE_X;
+    faces[1].rotation.set(0, 0, -1, 0,  0, -1, 0, 0,  -1, 0, 0, 0,  0, 0, 0, 1);
+    faces[2].face = osg::TextureCubeMap::NEGATIVE_X;
+    faces[2].rotation.set(0, 0, 1, 0,  0, -1, 0, 0,  1, 0, 0, 0,  0, 0, 0, 1);
+    faces[3].face = osg::TextureCubeMap::POSITIVE_Y;
+    faces[3].rotation.set(1, 0, 0, 0,  0, 0, -1, 0,  0, 1, 0, 0,  0, 0, 0, 1);
+    faces[4].face = osg::TextureCubeMap::NEGATIVE_Y;
+    faces[4].rotation.set(1, 0, 0, 0,  0, 0, 1, 0,  0, -1, 0, 0,  0, 0, 0, 1);
+    return faces;
+}
+
+// Unit length: the mesh interpolates directions linearly, and between unit vectors that
+// follows the lens far better than interpolating (x', y') where it exceeds 1 off axis
+osg::Vec3d rayDirection(const osg::Vec2d& ray)
+{
+    osg::Vec3d d(ray.x(), -ray.y(), -1.0);
+    d.normalize();
+    return d;
+}
+
+// Index into forwardFaces() of the face a direction is looked up in (its major axis)
+int majorFace(const osg::Vec3d& d)
+{
+    double ax = std::fabs(d.x()), ay = std::fabs(d.y()), az = std::fabs(d.z());
+    if (az >= ax && az >= ay) return 0;
+    if (ax >= ay) return d.x() > 0.0 ? 1 : 2;
+    return d.y() > 0.0 ? 3 : 4;
+}
+
+// Part of a cube map face, in its normalized coordinates (-1 to 1)
+struct FaceBounds {
+    double x0, y0, x1, y1;
+};
+
+bool sameIntrinsics(const CameraModel& a, const CameraModel& b)
+{
+    if (a.fx != b.fx || a.fy != b.fy || a.cx != b.cx || a.cy != b.cy || a.p1 != b.p1 || a.p2 != b.p2) return false;
+    if (a.imageWidth != b.imageWidth || a.imageHeight != b.imageHeight) return false;
+    for (int i = 0; i < 6; ++i) {
+        if (a.k[i] != b.k[i]) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+osg::Vec2d LensWarp::nodePixel(int column, int row) const
+{
+    return osg::Vec2d(std::min(column * cellPixels, width) - 0.5, std::min(row * cellPixels, height) - 0.5);
+}
+
+LensWarp computeLensWarp(const CameraModel& camera, int cellPixels, unsigned threads)
+{
+    if (cellPixels < 2) throw std::runtime_error("The warp cell size must be at least 2 pixels");
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point t0 = Clock::now();
+
+    LensWarp warp;
+    warp.width = camera.imageWidth;
+    warp.height = camera.imageHeight;
+    warp.cellPixels = cellPixels;
+    warp.columns = (warp.width + cellPixels - 1) / cellPixels + 1;
+    warp.rows = (warp.height + cellPixels - 1) / cellPixels + 1;
+    warp.rays.resize(static_cast<size_t>(warp.columns) * warp.rows);
+
+    // Newton solves per node, a row at a time
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    parallelFor(warp.rows, 4, 1, threads, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            for (int column = 0; column < warp.columns; ++column) {
+                osg::Vec2d ray;
+                if (!camera.undistort(warp.nodePixel(column, static_cast<int>(row)), ray)) ray.set(nan, nan);
+                warp.rays[row * warp.columns + column] = ray;
+            }
+        }
+    });
+
+    // Two triangles per cell, split along the diagonal from the top left node. The cell
+    // center lies on the diagonal, where the interpolated direction is the mean of its two
+    // ends; reprojecting it gives the warp error.
+    std::mutex mutex;
+    double errorSum = 0.0;
+    size_t errorCount = 0;
+    std::vector<std::vector<unsigned> > rowTriangles(warp.rows - 1);
+    parallelFor(warp.rows - 1, 4, 1, threads, [&](size_t begin, size_t end) {
+        double maxError = 0.0, sum = 0.0;
+        size_t count = 0;
+        for (size_t row = begin; row < end; ++row) {
+            std::vector<unsigned>& triangles = rowTriangles[row];
+            for (int column = 0; column + 1 < warp.columns; ++column) {
+                unsigned a = static_cast<unsigned>(row * warp.columns + column);
+                unsigned b = a + 1, c = a + warp.columns + 1, d = a + warp.columns;
+                if (std::isnan(warp.rays[a].x()) || std::isnan(warp.rays[b].x()) ||
+                    std::isnan(warp.rays[c].x()) || std::isnan(warp.rays[d].x())) {
+                    continue;
+                }
+                unsigned cell[6] = { a, b, c, a, c, d };
+                triangles.insert(triangles.end(), cell, cell + 6);
+
+                osg::Vec2d center = (warp.nodePixel(column, static_cast<int>(row)) +
+                                     warp.nodePixel(column + 1, static_cast<int>(row) + 1)) * 0.5;
+                osg::Vec3d direction = rayDirection(warp.rays[a]) + rayDirection(warp.rays[c]);
+                double error = (camera.distort(direction.x() / -direction.z(), direction.y() / direction.z()) - center).length();
+                maxError = std::max(maxError, error);
+                sum += error;
+                ++count;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        warp.maxError = std::max(warp.maxError, maxError);
+        errorSum += sum;
+        errorCount += count;
+    });
+    for (const auto& triangles : rowTriangles) warp.triangles.insert(warp.triangles.end(), triangles.begin(), triangles.end());
+    for (const auto& ray : warp.rays) {
+        if (std::isnan(ray.x())) ++warp.invalidNodes;
+    }
+    warp.meanError = errorCount ? errorSum / errorCount : 0.0;
+    warp.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    return warp;
+}
+
+CameraEyeView::CameraEyeView(osg::Node* scene, int cellPixels, int faceSize)
+    : scene_(scene), cellPixels_(cellPixels), requestedFaceSize_(faceSize), faceSize_(0), built_(false)
+{
+    setName("camera eye view");
+}
+
+bool CameraEyeView::setCamera(const CameraModel& camera, float metersToMmScale)
+{
+    bool rebuilt = !built_ || !sameIntrinsics(camera, camera_);
+    if (rebuilt) rebuild(camera);
+    camera_ = camera;
+    osg::Matrixd view = cameraViewMatrix(camera, metersToMmScale);
+    for (size_t i = 0; i < faces_.size(); ++i) faces_[i]->setViewMatrix(view * faceRotations_[i]);
+    return rebuilt;
+}
+
+size_t CameraEyeView::facePixels() const
+{
+    size_t pixels = 0;
+    for (const auto& face : faces_) {
+        const osg::Viewport* viewport = face->getViewport();
+        pixels += static_cast<size_t>(viewport->width() * viewport->height());
+    }
+    return pixels;
+}
+
+osg::Matrixd CameraEyeView::outputProjection() const
+{
+    return osg::Matrixd::ortho2D(0.0, warp_.width, 0.0, warp_.height);
+}
+
+void CameraEyeView::rebuild(const CameraModel& camera)
+{
+    warp_ = computeLensWarp(camera, cellPixels_);
+    faceSize_ = requestedFaceSize_;
+    if (faceSize_ <= 0) {
+        // The front face spans x' from -1 to 1, so 2 fx pixels match the sensor at the center
+        faceSize_ = std::min(2048, static_cast<int>(std::ceil(2.0 * std::max(camera.fx, camera.fy) / 64.0)) * 64);
+    }
+    removeChildren(0, getNumChildren());
+    faces_.clear();
+    faceRotations_.clear();
+
+    cubeMap_ = new osg::TextureCubeMap;
+    cubeMap_->setTextureSize(faceSize_, faceSize_);
+    cubeMap_->setInternalFormat(GL_RGBA);
+    cubeMap_->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
+    cubeMap_->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+    cubeMap_->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    cubeMap_->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    cubeMap_->setWrap(osg::Texture::WRAP_R, osg::Texture::CLAMP_TO_EDGE);
+
+    // Part of each face the mesh reads: every triangle touching a face is projected onto
+    // it whole, since the lookup may cross the face edge inside the triangle
+    std::vector<CubeFace> cubeFaces = forwardFaces();
+    const double inf = std::numeric_limits<double>::infinity();
+    FaceBounds empty = { inf, inf, -inf, -inf };
+    std::vector<FaceBounds> bounds(cubeFaces.size(), empty);
+    for (size_t t = 0; t < warp_.triangles.size(); t += 3) {
+        osg::Vec3d d[3];
+        for (int v = 0; v < 3; ++v) d[v] = rayDirection(warp_.rays[warp_.triangles[t + v]]);
+        for (int v = 0; v < 3; ++v) {
+            int f = majorFace(d[v]);
+            FaceBounds& box = bounds[f];
+            for (int w = 0; w < 3; ++w) {
+                osg::Vec3d e = d[w] * cubeFaces[f].rotation;
+                if (!(-e.z() > 1e-9)) {
+                    FaceBounds whole = { -1.0, -1.0, 1.0, 1.0 };
+                    box = whole;
+                    break;
+                }
+                double a = e.x() / -e.z(), b = e.y() / -e.z();
+                box.x0 = std::min(box.x0, a);
+                box.y0 = std::min(box.y0, b);
+                box.x1 = std::max(box.x1, a);
+                box.y1 = std::max(box.y1, b);
+            }
+        }
+    }
+
+    for (size_t f = 0; f < cubeFaces.size(); ++f) {
+        const FaceBounds& box = bounds[f];
+        if (!(box.x0 <= box.x1)) continue;
+        // Face pixels, one texel of margin for the linear filter
+        int x0 = std::max(0, static_cast<int>(std::floor((std::max(box.x0, -1.0) + 1.0) * 0.5 * faceSize_)) - 1);
+        int y0 = std::max(0, static_cast<int>(std::floor((std::max(box.y0, -1.0) + 1.0) * 0.5 * faceSize_)) - 1);
+        int x1 = std::min(faceSize_, static_cast<int>(std::ceil((std::min(box.x1, 1.0) + 1.0) * 0.5 * faceSize_)) + 1);
+        int y1 = std::min(faceSize_, static_cast<int>(std::ceil((std::min(box.y1, 1.0) + 1.0) * 0.5 * faceSize_)) + 1);
+        double scale = 2.0 * kNear / faceSize_;
+
+        osg::ref_ptr<osg::Camera> face = new osg::Camera;
+        face->setName("camera eye face");
+        face->setRenderOrder(osg::Camera::PRE_RENDER);
+        face->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+        face->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+        face->attach(osg::Camera::COLOR_BUFFER, cubeMap_.get(), 0, cubeFaces[f].face);
+        face->setViewport(x0, y0, x1 - x0, y1 - y0);
+        face->setProjectionMatrixAsFrustum(x0 * scale - kNear, x1 * scale - kNear, y0 * scale - kNear,
+                                           y1 * scale - kNear, kNear, kFar);
+        face->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+        face->setClearColor(osg::Vec4(0.2f, 0.2f, 0.4f, 1.0f));
+        face->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        face->setCullMask(~kCameraMarkerMask);
+        face->addChild(scene_.get());
+        addChild(face.get());
+        faces_.push_back(face);
+        faceRotations_.push_back(cubeFaces[f].rotation);
+    }
+
+    // The mesh in window coordinates (origin bottom left), the rays as cube map directions
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array(warp_.rays.size());
+    osg::ref_ptr<osg::Vec3Array> texCoords = new osg::Vec3Array(warp_.rays.size());
+    for (int row = 0; row < warp_.rows; ++row) {
+        for (int column = 0; column < warp_.columns; ++column) {
+            size_t i = static_cast<size_t>(row) * warp_.columns + column;
+            osg::Vec2d pixel = warp_.nodePixel(column, row);
+            (*vertices)[i].set(pixel.x() + 0.5, warp_.height - (pixel.y() + 0.5), 0.0);
+            (*texCoords)[i] = std::isnan(warp_.rays[i].x()) ? osg::Vec3(0, 0, -1) : osg::Vec3(rayDirection(warp_.rays[i]));
+        }
+    }
+    mesh_ = new osg::Geometry;
+    mesh_->setUseVertexBufferObjects(true);
+    mesh_->setVertexArray(vertices.get());
+    mesh_->setTexCoordArray(0, texCoords.get(), osg::Array::BIND_PER_VERTEX);
+    mesh_->addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES, static_cast<unsigned>(warp_.triangles.size()),
+                                                     warp_.triangles.empty() ? nullptr : &warp_.triangles[0]));
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->setName("lens warp");
+    geode->addDrawable(mesh_.get());
+    osg::StateSet* state = geode->getOrCreateStateSet();
+    state->setTextureAttributeAndModes(0, cubeMap_.get(), osg::StateAttribute::ON);
+    state->setMode(GL_TEXTURE_CUBE_MAP_SEAMLESS, osg::StateAttribute::ON);
+    state->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    state->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF);
+    addChild(geode.get());
+    built_ = true;
+}
+
+namespace {
+
+void printCameraViewUsage()
+{
+    std::cout << "Usage: visual cameraview [model <name>] [--calibration <calibraton.json>] [--camera <n|name>]" << std::endl;
+    std::cout << "                         [--zone <id>] [--cell <px>] [--face <px>] [--no-distortion]" << std::endl;
+    std::cout << "                         [--frames N] [--no-fbo] [-o <file.png>]" << std::endl;
+    std::cout << "  Renders the model as the calibrated camera sees it, at sensor resolution, from the" << std::endl;
+    std::cout << "  extrinsic pose and through the lens: the scene goes into a cube map (--face pixels per" << std::endl;
+    std::cout << "  side; default 2 fx, at most 2048) and a warp mesh over the sensor with nodes every" << std::endl;
+    std::cout << "  --cell pixels (default 16) applies the distortion. --no-distortion renders the pinhole" << std::endl;
+    std::cout << "  image directly. --camera picks a camera of a rig (default the first). Writes" << std::endl;
+    std::cout << "  <model>_camera<n>.png; --frames N then renders N more frames and reports the frame rate." << std::endl;
+    std::cout << "  Without a display, run under xvfb-run (Mesa software rendering works)" << std::endl;
+}
+
+} // namespace
+
+int runCameraViewCommand(int argc, char** argv)
+{
+    std::string carModelName = "Sharan";
+    std::string calibrationPath, cameraName, outputPath;
+    int zone = 0, cellPixels = 16, faceSize = 0, frames = 0;
+    bool distortion = true, useFbo = true;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "model" && i + 1 < argc) carModelName = argv[++i];
+        else if (arg == "--calibration" && i + 1 < argc) calibrationPath = argv[++i];
+        else if (arg == "--camera" && i + 1 < argc) cameraName = argv[++i];
+        else if (arg == "--zone" && i + 1 < argc) zone = std::atoi(argv[++i]);
+        else if (arg == "--cell" && i + 1 < argc) cellPixels = std::atoi(argv[++i]);
+        else if (arg == "--face" && i + 1 < argc) faceSize = std::atoi(argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc) frames = std::atoi(argv[++i]);
+        else if (arg == "--no-distortion") distortion = false;
+        else if (arg == "--no-fbo") useFbo = false;
+        else if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--help" || arg == "-h") { printCameraViewUsage(); return 0; }
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printCameraViewUsage();
+            return 1;
+        }
+    }
+    if (cellPixels < 2 || faceSize < 0 || frames < 0 || zone < 0) {
+        std::cerr << "Error: --cell needs at least 2 pixels; --face, --frames and --zone cannot be negative" << std::endl;
+        return 1;
+    }
+
+    ModelScene scene;
+    if (!buildModelScene(carModelName, zone, false, scene)) return 1;
+    std::vector<CameraCalibration> cameras = scene.cameras;
+    if (!calibrationPath.empty()) {
+        try {
+            cameras = parseCalibrationRig(calibrationPath);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    size_t index = 0;
+    if (!cameraName.empty()) {
+        index = cameras.size();
+        int number = std::atoi(cameraName.c_str());
+        if (number >= 1 && std::to_string(number) == cameraName) index = static_cast<size_t>(number - 1);
+        for (size_t i = 0; i < cameras.size() && index >= cameras.size(); ++i) {
+            if (cameras[i].name == cameraName) index = i;
+        }
+        if (index >= cameras.size()) {
+            std::cerr << "Error: No camera '" << cameraName << "' (" << cameras.size() << " in the calibration)" << std::endl;
+            return 1;
+        }
+    }
+    CameraModel camera(cameras[index]);
+    if (outputPath.empty()) outputPath = carModelName + "_camera" + std::to_string(index + 1) + ".png";
+
+    typedef std::chrono::steady_clock Clock;
+    osgViewer::Viewer viewer;
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    if (!setupOffscreenViewer(viewer, camera.imageWidth, camera.imageHeight, useFbo, image.get())) return 1;
+    osg::Camera* output = viewer.getCamera();
+    output->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+
+    osg::ref_ptr<CameraEyeView> eyeView;
+    if (distortion) {
+        eyeView = new CameraEyeView(scene.root.get(), cellPixels, faceSize);
+        try {
+            eyeView->setCamera(camera, scene.metersToMmScale);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        const LensWarp& warp = eyeView->warp();
+        std::cout << "Lens warp: " << warp.columns << "x" << warp.rows << " nodes every " << warp.cellPixels << " px, "
+                  << warp.triangles.size() / 3 << " triangles, " << warp.invalidNodes << " node(s) not invertible, in "
+                  << std::fixed << std::setprecision(1) << warp.seconds * 1000.0 << " ms; interpolation error mean "
+                  << std::setprecision(3) << warp.meanError << " px, max " << warp.maxError << " px" << std::endl;
+        std::cout << "Cube map: " << eyeView->faceSize() << " px faces, " << std::setprecision(2)
+                  << eyeView->facePixels() / 1e6 << " Mpx rendered per frame" << std::defaultfloat << std::endl;
+        viewer.setSceneData(eyeView.get());
+        output->setProjectionMatrix(eyeView->outputProjection());
+        output->setViewMatrix(osg::Matrixd::identity());
+    } else {
+        viewer.setSceneData(scene.root.get());
+        output->setProjectionMatrix(cameraProjectionMatrix(camera, kNear, kFar));
+        output->setViewMatrix(cameraViewMatrix(camera, scene.metersToMmScale));
+        output->setCullMask(~kCameraMarkerMask);
+    }
+
+    // The first frame compiles the scene's display lists and textures
+    Clock::time_point t0 = Clock::now();
+    viewer.frame();
+    double firstMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    t0 = Clock::now();
+    if (!osgDB::writeImageFile(*image, outputPath)) {
+        std::cerr << "Error: Cannot write " << outputPath << std::endl;
+        return 1;
+    }
+    double writeMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    std::string name = cameras[index].name.empty() ? std::string() : " (" + cameras[index].name + ")";
+    std::cout << "Wrote " << outputPath << ": " << carModelName << " camera " << index + 1 << name << ", "
+              << camera.imageWidth << "x" << camera.imageHeight << (distortion ? " with" : " without")
+              << " lens distortion; first frame " << std::fixed << std::setprecision(1) << firstMs << " ms, PNG "
+              << writeMs << " ms" << std::defaultfloat << std::endl;
+
+    if (frames > 0) {
+        // Render and read back into the image, without writing
+        const std::string renderer = offscreenRendererName(viewer);
+        t0 = Clock::now();
+        for (int i = 0; i < frames; ++i) viewer.frame();
+        double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+        std::cout << frames << " frames: " << std::fixed << std::setprecision(2) << seconds * 1000.0 / frames
+                  << " ms per frame (" << std::setprecision(1) << frames / seconds << " fps), including read back, on "
+                  << renderer << std::defaultfloat << std::endl;
+    }
+    return 0;
+}
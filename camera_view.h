@@ -0,0 +1,78 @@
+#ifndef CAMERA_VIEW_H
+#define CAMERA_VIEW_H
+
+#include "camera_projection.h"
+
+#include <osg/Camera>
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/Matrixd>
+#include <osg/TextureCubeMap>
+#include <osg/Vec2d>
+#include <vector>
+
+// Lens distortion as a coarse mesh over the sensor: nodes every `cellPixels` pixels (and on
+// the last row and column) hold the undistorted normalized ray (x', y') of their pixel, so
+// an image rendered through a pinhole is warped into the distorted one by drawing the mesh
+// with the rays as texture coordinates. The rays are solved once per calibration; between
+// nodes the GPU interpolates their directions linearly, which is what `maxError` measures
+// (for the shipped lenses, 0.06 px on average and under 1 px in the far corners with
+// 16-pixel cells).
+struct LensWarp {
+    int width = 0, height = 0;  // sensor, pixels
+    int cellPixels = 0;
+    int columns = 0, rows = 0;  // nodes
+    std::vector<osg::Vec2d> rays;      // rows x columns, NaN where the distortion could not be inverted
+    std::vector<unsigned> triangles;   // node indices, three per triangle; cells with a NaN node are left out
+    size_t invalidNodes = 0;
+    double maxError = 0.0, meanError = 0.0;  // pixels, at the cell centers
+    double seconds = 0.0;
+
+    // Sensor pixel (u, v) of a node. Pixel centers are at integer (u, v), so the outer nodes
+    // lie on the image border at -0.5 and W - 0.5.
+    osg::Vec2d nodePixel(int column, int row) const;
+};
+
+// Solves the node rays on all cores (threads = 0: one per core).
+// Throws std::runtime_error for cellPixels < 2.
+LensWarp computeLensWarp(const CameraModel& camera, int cellPixels, unsigned threads = 0);
+
+// The calibrated camera's image, with its lens: the scene is rendered from the extrinsic
+// pose into the cube map faces the warp samples (the front and the forward parts of the
+// four sides; the shipped lenses see about 85 degrees off axis in the corners, too wide for
+// one pinhole image), and the warp mesh resamples the cube map at sensor resolution. Each
+// face renders only the rectangle the mesh reads. Add the node to a camera with
+// outputProjection() and an identity view matrix, sized to the sensor.
+class CameraEyeView : public osg::Group
+{
+public:
+    // faceSize 0: the sensor's resolution at the image center (2 fx), at most 2048 pixels
+    explicit CameraEyeView(osg::Node* scene, int cellPixels = 16, int faceSize = 0);
+
+    // Points the face cameras along the calibrated pose. The warp mesh and the cube map are
+    // rebuilt only when the intrinsics change; returns true if they were.
+    bool setCamera(const CameraModel& camera, float metersToMmScale);
+
+    const LensWarp& warp() const { return warp_; }
+    int faceSize() const { return faceSize_; }
+    size_t facePixels() const;  // rendered per frame, over all faces
+    osg::Matrixd outputProjection() const;
+
+private:
+    void rebuild(const CameraModel& camera);
+
+    osg::ref_ptr<osg::Node> scene_;
+    int cellPixels_, requestedFaceSize_, faceSize_;
+    bool built_;
+    CameraModel camera_;
+    LensWarp warp_;
+    osg::ref_ptr<osg::TextureCubeMap> cubeMap_;
+    std::vector<osg::ref_ptr<osg::Camera> > faces_;
+    std::vector<osg::Matrixd> faceRotations_;  // camera eye space to face eye space
+    osg::ref_ptr<osg::Geometry> mesh_;
+};
+
+// `visual cameraview ...` - the camera's-eye image at sensor resolution, headless
+int runCameraViewCommand(int argc, char** argv);
+
+#endif
@@ -0,0 +1,515 @@
+#include "config_bundle.h"
+#include "bench_util.h"
+#include "disk_cache.h"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+static_assert(sizeof(ConfigBundleHeader) == 64, "bundle header layout");
+static_assert(sizeof(BundleSource) % 8 == 0 && sizeof(BundleModel) % 8 == 0 && sizeof(BundleCalibration) % 8 == 0 &&
+              sizeof(BundleTransformation) % 8 == 0 && sizeof(BundleZone) % 8 == 0,
+              "bundle records must keep 8-byte alignment");
+
+namespace {
+
+const char kBundleMagic[8] = { 'V', 'C', 'F', 'G', 'B', 'N', 'D', 'L' };
+
+bool statFile(const std::string& path, int64_t& mtimeNs, uint64_t& size)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+    mtimeNs = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+    size = static_cast<uint64_t>(info.st_size);
+    return true;
+}
+
+std::string directoryOf(const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+}
+
+// Collects the sections while compiling
+class BundleBuilder {
+public:
+    BundleString addString(const std::string& s)
+    {
+        BundleString ref = { static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(s.size()) };
+        strings.insert(strings.end(), s.begin(), s.end());
+        return ref;
+    }
+
+    uint32_t addSource(const std::string& path)
+    {
+        BundleSource source;
+        std::memset(&source, 0, sizeof(source));
+        source.path = addString(path);
+        if (!statFile(path, source.mtimeNs, source.size)) throw std::runtime_error("Cannot stat " + path);
+        source.contentHash = hashFileContents(path);
+        sources.push_back(source);
+        return static_cast<uint32_t>(sources.size() - 1);
+    }
+
+    // A file the bundle would read if it existed
+    void addMissingSource(const std::string& path)
+    {
+        BundleSource source;
+        std::memset(&source, 0, sizeof(source));
+        source.path = addString(path);
+        source.size = kBundleSourceMissing;
+        sources.push_back(source);
+    }
+
+    std::vector<BundleSource> sources;
+    std::vector<BundleModel> models;
+    std::vector<BundleCalibration> cameras;
+    std::vector<BundleTransformation> transformations;
+    std::vector<BundleZone> zones;
+    std::vector<float> corners;
+    std::vector<char> strings;
+};
+
+void packCalibration(const CameraCalibration& c, BundleString name, BundleCalibration& out)
+{
+    std::memset(&out, 0, sizeof(out));
+    out.name = name;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) out.rotation[i * 3 + j] = c.rotation_matrix[i][j];
+        out.translation[i] = c.translation_vector[i];
+    }
+    const double intrinsics[12] = { c.principal_point_X, c.principal_point_Y, c.focal_length_X, c.focal_length_Y,
+                                    c.distortion_k1, c.distortion_k2, c.distortion_k3, c.distortion_k4,
+                                    c.distortion_k5, c.distortion_k6, c.distortion_p1, c.distortion_p2 };
+    std::memcpy(out.intrinsics, intrinsics, sizeof(intrinsics));
+    out.visualization[0] = c.meters_to_mm_scale;
+    out.visualization[1] = c.frustum_scale_factor;
+    out.visualization[2] = c.camera_sphere_radius_mm;
+    out.visualization[3] = c.axes_length_mm;
+    out.visualization[4] = c.axes_arrow_wing_mm;
+}
+
+void unpackCalibration(const BundleCalibration& packed, CameraCalibration& c)
+{
+    for (int r = 0; r < 3; ++r) {
+        for (int col = 0; col < 3; ++col) c.rotation_matrix[r][col] = packed.rotation[r * 3 + col];
+        c.translation_vector[r] = packed.translation[r];
+    }
+    const double* in = packed.intrinsics;
+    c.principal_point_X = in[0];
+    c.principal_point_Y = in[1];
+    c.focal_length_X = in[2];
+    c.focal_length_Y = in[3];
+    c.distortion_k1 = in[4];
+    c.distortion_k2 = in[5];
+    c.distortion_k3 = in[6];
+    c.distortion_k4 = in[7];
+    c.distortion_k5 = in[8];
+    c.distortion_k6 = in[9];
+    c.distortion_p1 = in[10];
+    c.distortion_p2 = in[11];
+    c.meters_to_mm_scale = packed.visualization[0];
+    c.frustum_scale_factor = packed.visualization[1];
+    c.camera_sphere_radius_mm = packed.visualization[2];
+    c.axes_length_mm = packed.visualization[3];
+    c.axes_arrow_wing_mm = packed.visualization[4];
+}
+
+size_t padTo8(size_t bytes)
+{
+    return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+} // namespace
+
+void writeConfigBundle(const std::string& carModelsFile, const std::string& path, std::ostream& log)
+{
+    BundleBuilder builder;
+    builder.addSource(carModelsFile);
+    const std::string modelsDirectory = directoryOf(carModelsFile);
+
+    std::ostream quiet(nullptr);
+    for (const auto& name : listCarModels(carModelsFile)) {
+        CarModelConfig carModel = parseCarModelFile(carModelsFile, name);
+
+        BundleModel model;
+        std::memset(&model, 0, sizeof(model));
+        model.name = builder.addString(name);
+        model.path = builder.addString(carModel.path);
+        osg::Matrix transform = applyCarModelTransformations(carModel, quiet);
+        std::memcpy(model.transform, transform.ptr(), sizeof(model.transform));
+
+        model.firstTransformation = static_cast<uint32_t>(builder.transformations.size());
+        for (const auto& step : carModel.transformations) {
+            BundleTransformation packed;
+            packed.type = builder.addString(step.type);
+            packed.angle = step.angle;
+            packed.x = step.x;
+            packed.y = step.y;
+            packed.z = step.z;
+            packed.value = step.value;
+            builder.transformations.push_back(packed);
+        }
+        model.transformationCount = static_cast<uint32_t>(carModel.transformations.size());
+
+        const std::string configPath = modelsDirectory + "/" + name + "/config";
+        struct stat info;
+        model.firstZone = static_cast<uint32_t>(builder.zones.size());
+        model.firstCamera = static_cast<uint32_t>(builder.cameras.size());
+        if (stat(configPath.c_str(), &info) != 0) {
+            log << "Warning: " << configPath << " not found; " << name << " is bundled without calibration and zones"
+                << std::endl;
+            builder.addMissingSource(configPath + "/calibraton.json");
+            builder.addMissingSource(configPath + "/viewingzones.json");
+        } else {
+            std::vector<CameraCalibration> rig = parseCalibrationRig(configPath + "/calibraton.json");
+            for (const auto& camera : rig) {
+                BundleCalibration packed;
+                packCalibration(camera, builder.addString(camera.name), packed);
+                builder.cameras.push_back(packed);
+            }
+            model.cameraCount = static_cast<uint32_t>(rig.size());
+            builder.addSource(configPath + "/calibraton.json");
+            std::vector<ViewingZone> zones = parseViewingZonesFile(configPath + "/viewingzones.json");
+            builder.addSource(configPath + "/viewingzones.json");
+            for (const auto& zone : zones) {
+                BundleZone packed;
+                std::memset(&packed, 0, sizeof(packed));
+                packed.id = zone.id;
+                packed.label = builder.addString(zone.label);
+                for (int c = 0; c < 4; ++c) packed.color[c] = zone.color[c];
+                packed.firstCorner = static_cast<uint32_t>(builder.corners.size() / 3);
+                packed.cornerCount = static_cast<uint32_t>(zone.corners.size());
+                packed.category = zone.category;
+                packed.priority = zone.priority;
+                packed.flags = zone.highwaySpeedEnabled ? BundleZoneHighwaySpeedEnabled : 0;
+                for (const auto& corner : zone.corners) {
+                    builder.corners.push_back(corner.x());
+                    builder.corners.push_back(corner.y());
+                    builder.corners.push_back(corner.z());
+                }
+                builder.zones.push_back(packed);
+            }
+            model.zoneCount = static_cast<uint32_t>(zones.size());
+            model.flags |= BundleHasConfig;
+        }
+        builder.models.push_back(model);
+    }
+
+    ConfigBundleHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kBundleMagic, sizeof(header.magic));
+    header.version = kConfigBundleVersion;
+    header.modelCount = static_cast<uint32_t>(builder.models.size());
+    header.sourceCount = static_cast<uint32_t>(builder.sources.size());
+    header.cameraCount = static_cast<uint32_t>(builder.cameras.size());
+    header.transformationCount = static_cast<uint32_t>(builder.transformations.size());
+    header.zoneCount = static_cast<uint32_t>(builder.zones.size());
+    header.cornerCount = static_cast<uint32_t>(builder.corners.size() / 3);
+    header.stringBytes = builder.strings.size();
+
+    const size_t cornerBytes = builder.corners.size() * sizeof(float);
+    std::vector<char> cornerPadding(padTo8(cornerBytes) - cornerBytes, 0);
+    header.fileSize = sizeof(header) + builder.sources.size() * sizeof(BundleSource) +
+                      builder.models.size() * sizeof(BundleModel) +
+                      builder.cameras.size() * sizeof(BundleCalibration) +
+                      builder.transformations.size() * sizeof(BundleTransformation) +
+                      builder.zones.size() * sizeof(BundleZone) + padTo8(cornerBytes) + builder.strings.size();
+
+    std::vector<std::pair<const void*, size_t> > parts;
+    parts.push_back(std::make_pair(&header, sizeof(header)));
+    parts.push_back(std::make_pair(builder.sources.data(), builder.sources.size() * sizeof(BundleSource)));
+    parts.push_back(std::make_pair(builder.models.data(), builder.models.size() * sizeof(BundleModel)));
+    parts.push_back(std::make_pair(builder.cameras.data(), builder.cameras.size() * sizeof(BundleCalibration)));
+    parts.push_back(std::make_pair(builder.transformations.data(),
+                                   builder.transformations.size() * sizeof(BundleTransformation)));
+    parts.push_back(std::make_pair(builder.zones.data(), builder.zones.size() * sizeof(BundleZone)));
+    parts.push_back(std::make_pair(builder.corners.data(), cornerBytes));
+    parts.push_back(std::make_pair(cornerPadding.data(), cornerPadding.size()));
+    parts.push_back(std::make_pair(builder.strings.data(), builder.strings.size()));
+    writeFileAtomically(path, parts);
+}
+
+void ConfigBundle::open(const std::string& path)
+{
+    header_ = nullptr;
+    file_.open(path, MappedFile::Random);
+    const char* data = file_.data();
+    const ConfigBundleHeader* header = reinterpret_cast<const ConfigBundleHeader*>(data);
+    if (file_.size() < sizeof(ConfigBundleHeader) || std::memcmp(header->magic, kBundleMagic, sizeof(kBundleMagic)) != 0) {
+        throw std::runtime_error(path + " is not a config bundle");
+    }
+    if (header->version != kConfigBundleVersion) {
+        throw std::runtime_error(path + " is a version " + std::to_string(header->version) +
+                                 " config bundle; rebuild it with 'visual bundle'");
+    }
+
+    size_t offset = sizeof(ConfigBundleHeader);
+    sources_ = reinterpret_cast<const BundleSource*>(data + offset);
+    offset += header->sourceCount * sizeof(BundleSource);
+    models_ = reinterpret_cast<const BundleModel*>(data + offset);
+    offset += header->modelCount * sizeof(BundleModel);
+    cameras_ = reinterpret_cast<const BundleCalibration*>(data + offset);
+    offset += header->cameraCount * sizeof(BundleCalibration);
+    transformations_ = reinterpret_cast<const BundleTransformation*>(data + offset);
+    offset += header->transformationCount * sizeof(BundleTransformation);
+    zones_ = reinterpret_cast<const BundleZone*>(data + offset);
+    offset += header->zoneCount * sizeof(BundleZone);
+    corners_ = reinterpret_cast<const float*>(data + offset);
+    offset += padTo8(header->cornerCount * 3 * sizeof(float));
+    strings_ = data + offset;
+    offset += header->stringBytes;
+    if (header->fileSize != file_.size() || offset != file_.size()) {
+        throw std::runtime_error(path + " is truncated or corrupt");
+    }
+
+    // Every reference must stay inside its section, so lookups need no further checks
+    auto validString = [&](const BundleString& s) { return uint64_t(s.offset) + s.length <= header->stringBytes; };
+    bool valid = true;
+    for (uint32_t i = 0; i < header->sourceCount; ++i) valid = valid && validString(sources_[i].path);
+    for (uint32_t i = 0; i < header->modelCount; ++i) {
+        const BundleModel& m = models_[i];
+        valid = valid && validString(m.name) && validString(m.path) &&
+                uint64_t(m.firstTransformation) + m.transformationCount <= header->transformationCount &&
+                uint64_t(m.firstZone) + m.zoneCount <= header->zoneCount &&
+                uint64_t(m.firstCamera) + m.cameraCount <= header->cameraCount &&
+                (m.cameraCount > 0 || !(m.flags & BundleHasConfig));
+    }
+    for (uint32_t i = 0; i < header->cameraCount; ++i) valid = valid && validString(cameras_[i].name);
+    for (uint32_t i = 0; i < header->transformationCount; ++i) valid = valid && validString(transformations_[i].type);
+    for (uint32_t i = 0; i < header->zoneCount; ++i) {
+        valid = valid && validString(zones_[i].label) &&
+                uint64_t(zones_[i].firstCorner) + zones_[i].cornerCount <= header->cornerCount;
+    }
+    if (!valid) throw std::runtime_error(path + " is truncated or corrupt");
+    header_ = header;
+}
+
+std::vector<std::string> ConfigBundle::modelNames() const
+{
+    std::vector<std::string> names;
+    for (size_t i = 0; i < modelCount(); ++i) names.push_back(modelName(i));
+    return names;
+}
+
+int ConfigBundle::indexOf(const std::string& name) const
+{
+    for (size_t i = 0; i < modelCount(); ++i) {
+        const BundleString& s = models_[i].name;
+        if (s.length == name.size() && std::memcmp(strings_ + s.offset, name.data(), s.length) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+CarModelConfig ConfigBundle::carModel(size_t i) const
+{
+    const BundleModel& model = models_[i];
+    CarModelConfig config;
+    config.name = str(model.name);
+    config.path = str(model.path);
+    for (uint32_t t = 0; t < model.transformationCount; ++t) {
+        const BundleTransformation& packed = transformations_[model.firstTransformation + t];
+        CarModelTransformation step;
+        step.type = str(packed.type);
+        step.angle = packed.angle;
+        step.x = packed.x;
+        step.y = packed.y;
+        step.z = packed.z;
+        step.value = packed.value;
+        config.transformations.push_back(step);
+    }
+    return config;
+}
+
+osg::Matrix ConfigBundle::modelTransform(size_t i) const
+{
+    return osg::Matrix(models_[i].transform);
+}
+
+CameraCalibration ConfigBundle::calibration(size_t i) const
+{
+    std::vector<CameraCalibration> rig = cameras(i);
+    if (!rig.empty()) return rig[0];
+    CameraCalibration c;
+    unpackCalibration(BundleCalibration(), c);
+    return c;
+}
+
+std::vector<CameraCalibration> ConfigBundle::cameras(size_t i) const
+{
+    const BundleModel& model = models_[i];
+    std::vector<CameraCalibration> rig(model.cameraCount);
+    for (uint32_t c = 0; c < model.cameraCount; ++c) {
+        const BundleCalibration& packed = cameras_[model.firstCamera + c];
+        unpackCalibration(packed, rig[c]);
+        rig[c].name = str(packed.name);
+    }
+    return rig;
+}
+
+std::vector<ViewingZone> ConfigBundle::zones(size_t i) const
+{
+    const BundleModel& model = models_[i];
+    std::vector<ViewingZone> zones(model.zoneCount);
+    for (uint32_t z = 0; z < model.zoneCount; ++z) {
+        const BundleZone& packed = zones_[model.firstZone + z];
+        ViewingZone& zone = zones[z];
+        zone.id = packed.id;
+        zone.label = str(packed.label);
+        zone.color = osg::Vec4(packed.color[0], packed.color[1], packed.color[2], packed.color[3]);
+        zone.category = packed.category;
+        zone.priority = packed.priority;
+        zone.highwaySpeedEnabled = (packed.flags & BundleZoneHighwaySpeedEnabled) != 0;
+        const float* corner = corners_ + 3 * packed.firstCorner;
+        zone.corners.reserve(packed.cornerCount);
+        for (uint32_t c = 0; c < packed.cornerCount; ++c, corner += 3) {
+            zone.corners.push_back(osg::Vec3(corner[0], corner[1], corner[2]));
+        }
+    }
+    return zones;
+}
+
+std::vector<std::string> ConfigBundle::staleSources() const
+{
+    std::vector<std::string> stale;
+    for (uint32_t i = 0; i < header_->sourceCount; ++i) {
+        const BundleSource& source = sources_[i];
+        std::string path = str(source.path);
+        int64_t mtimeNs;
+        uint64_t size;
+        bool exists = statFile(path, mtimeNs, size);
+        if (source.size == kBundleSourceMissing) {
+            if (exists) stale.push_back(path);
+        } else if (!exists || size != source.size) {
+            stale.push_back(path);
+        } else if (mtimeNs != source.mtimeNs) {
+            // Touched or checked out again, but possibly unchanged
+            try {
+                if (hashFileContents(path) != source.contentHash) stale.push_back(path);
+            } catch (const std::exception&) {
+                stale.push_back(path);
+            }
+        }
+    }
+    return stale;
+}
+
+std::vector<std::string> ConfigBundle::sources() const
+{
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < header_->sourceCount; ++i) paths.push_back(str(sources_[i].path));
+    return paths;
+}
+
+namespace {
+
+void printBundleUsage()
+{
+    std::cout << "Usage: visual bundle [<output>] [--check] [--bench]" << std::endl;
+    std::cout << "  Compiles carmodels/carmodels.json and every carmodels/<model>/config/*.json into one" << std::endl;
+    std::cout << "  binary bundle (default output: carmodels/carmodels.vbundle); load it with --bundle." << std::endl;
+    std::cout << "  --check  Do not compile; list the bundle's models and report changed source files" << std::endl;
+    std::cout << "           (exit code 1 if the bundle is stale)" << std::endl;
+    std::cout << "  --bench  Time loading every model from the bundle against parsing the JSON files" << std::endl;
+}
+
+// Everything buildModelScene needs from the configs, from either source
+struct LoadedConfig {
+    CarModelConfig carModel;
+    osg::Matrix transform;
+    std::vector<CameraCalibration> cameras;
+    std::vector<ViewingZone> zones;
+};
+
+} // namespace
+
+int runBundleCommand(int argc, char** argv)
+{
+    std::string output = "carmodels/carmodels.vbundle";
+    const std::string carModelsFile = "carmodels/carmodels.json";
+    bool check = false, bench = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--check") check = true;
+        else if (arg == "--bench") bench = true;
+        else if (arg == "--help" || arg == "-h") { printBundleUsage(); return 0; }
+        else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printBundleUsage();
+            return 1;
+        }
+        else output = arg;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    try {
+        if (!check) {
+            Clock::time_point t0 = Clock::now();
+            writeConfigBundle(carModelsFile, output, std::cerr);
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+            ConfigBundle bundle(output);
+            std::cout << "Wrote " << output << ": " << bundle.modelCount() << " models, " << bundle.sources().size()
+                      << " source files, " << MappedFile(output).size() << " bytes (" << std::fixed
+                      << std::setprecision(1) << ms << " ms)" << std::defaultfloat << std::endl;
+        }
+
+        ConfigBundle bundle(output);
+        if (check) {
+            std::cout << output << ": version " << kConfigBundleVersion << ", " << bundle.modelCount() << " models" << std::endl;
+            for (size_t i = 0; i < bundle.modelCount(); ++i) {
+                std::cout << "  " << std::left << std::setw(16) << bundle.modelName(i) << std::right;
+                if (bundle.hasConfig(i)) {
+                    size_t cameras = bundle.cameras(i).size();
+                    std::cout << bundle.zones(i).size() << " zones, " << cameras << (cameras == 1 ? " camera" : " cameras");
+                }
+                else std::cout << "(no config)";
+                std::cout << std::endl;
+            }
+            std::vector<std::string> stale = bundle.staleSources();
+            for (const auto& path : stale) std::cout << "  changed since the bundle was written: " << path << std::endl;
+            std::cout << (stale.empty() ? "Bundle is up to date" : "Bundle is stale; run 'visual bundle' again")
+                      << std::endl;
+            if (!stale.empty()) return 1;
+        }
+
+        if (bench) {
+            const double minSeconds = 0.2;
+            volatile size_t sink = 0;
+            std::cout << std::fixed << std::setprecision(1) << "Per-run load times (best of many), microseconds:"
+                      << std::endl << "  model             bundle (open+load)   JSON (parse)" << std::endl;
+            for (const auto& name : bundle.modelNames()) {
+                if (!bundle.hasConfig(bundle.indexOf(name))) continue;
+                double fromBundle = timeBest([&]() {
+                    ConfigBundle b(output);
+                    int i = b.indexOf(name);
+                    LoadedConfig config = { b.carModel(i), b.modelTransform(i), b.cameras(i), b.zones(i) };
+                    sink += config.zones.size();
+                }, minSeconds);
+                double fromJson = timeBest([&]() {
+                    std::ostream quiet(nullptr);
+                    std::string configPath = "carmodels/" + name + "/config";
+                    LoadedConfig config;
+                    config.carModel = parseCarModelFile(carModelsFile, name);
+                    config.transform = applyCarModelTransformations(config.carModel, quiet);
+                    config.cameras = parseCalibrationRig(configPath + "/calibraton.json");
+                    config.zones = parseViewingZonesFile(configPath + "/viewingzones.json");
+                    sink += config.zones.size();
+                }, minSeconds);
+                std::cout << "  " << std::left << std::setw(16) << name << std::right << std::setw(12)
+                          << fromBundle * 1e6 << std::setw(20) << fromJson * 1e6 << std::endl;
+            }
+            double staleCheck = timeBest([&]() { sink += bundle.staleSources().size(); }, minSeconds);
+            std::cout << "  staleness check (stat of " << bundle.sources().size() << " files): " << staleCheck * 1e6
+                      << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+#ifndef CONFIG_BUNDLE_H
+#define CONFIG_BUNDLE_H
+
+#include "config_loader.h"
+#include "mapped_file.h"
+
+#include <stdint.h>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Precompiled config bundle (.vbundle): carmodels.json and every model's calibraton.json
+// and viewingzones.json in one flat binary file, for batch jobs that start the tool many
+// times. Loading a model from it is a name lookup and a few copies out of the mapping.
+//
+//   ConfigBundleHeader                          64 bytes
+//   BundleSource[sourceCount]                   the JSON files it was compiled from
+//   BundleModel[modelCount]                     carmodels.json order
+//   BundleCalibration[cameraCount]              each model's cameras, calibraton.json order
+//   BundleTransformation[transformationCount]   each model's carmodels.json steps
+//   BundleZone[zoneCount]                       each model's zones, file order
+//   float[3][cornerCount]                       zone corners (carCoord meters), padded to 8 bytes
+//   char[stringBytes]                           names, paths and labels (not NUL-terminated)
+//
+// Sections follow each other without gaps; every record is a multiple of 8 bytes. Values
+// are little-endian. Each source's mtime, size and content hash are recorded so a stale
+// bundle is detected before use (see staleSources).
+
+const uint32_t kConfigBundleVersion = 3;
+
+struct BundleString {
+    uint32_t offset;  // into the string section
+    uint32_t length;
+};
+
+struct ConfigBundleHeader {
+    char magic[8];             // "VCFGBNDL"
+    uint32_t version;
+    uint32_t modelCount;
+    uint32_t sourceCount;
+    uint32_t transformationCount;
+    uint32_t zoneCount;
+    uint32_t cornerCount;
+    uint64_t stringBytes;
+    uint64_t fileSize;
+    uint32_t cameraCount;
+    uint32_t reserved0;
+    uint64_t reserved1;
+};
+
+// BundleSource::size of a file that did not exist when the bundle was written
+const uint64_t kBundleSourceMissing = ~uint64_t(0);
+
+struct BundleSource {
+    BundleString path;
+    int64_t mtimeNs;
+    uint64_t size;             // kBundleSourceMissing: expected but absent (a model without config)
+    uint64_t contentHash;      // hashFileContents()
+};
+
+struct BundleCalibration {
+    double rotation[9];        // row-major
+    double translation[3];
+    double intrinsics[12];     // principal point X/Y, focal length X/Y, k1-k6, p1, p2
+    float visualization[6];    // meters_to_mm_scale, frustum_scale_factor, camera_sphere_radius_mm,
+                               // axes_length_mm, axes_arrow_wing_mm, (unused)
+    BundleString name;         // camera name in a rig, empty for a single camera
+};
+
+// BundleModel::flags
+enum BundleModelFlags {
+    BundleHasConfig = 1        // calibration and zones are present
+};
+
+struct BundleModel {
+    BundleString name;
+    BundleString path;         // model file
+    double transform[16];      // applyCarModelTransformations(), osg::Matrixd order
+    uint32_t firstTransformation, transformationCount;
+    uint32_t firstZone, zoneCount;
+    uint32_t firstCamera, cameraCount;
+    uint32_t flags;            // BundleModelFlags
+    uint32_t reserved;
+};
+
+struct BundleTransformation {
+    BundleString type;
+    double angle, x, y, z, value;
+};
+
+// BundleZone::flags
+enum BundleZoneFlags {
+    BundleZoneHighwaySpeedEnabled = 1
+};
+
+struct BundleZone {
+    int32_t id;
+    BundleString label;
+    float color[4];
+    uint32_t firstCorner, cornerCount;
+    int32_t category, priority;
+    uint32_t flags;            // BundleZoneFlags
+};
+
+// Compile carModelsFile and every listed model's config directory (next to it:
+// <dir>/<model>/config) into a bundle at `path`. Models without a config directory are
+// included without calibration and zones, with a warning on `log`; their config files are
+// recorded as missing sources, so the bundle goes stale once they are added.
+// Throws std::runtime_error on parse or write errors.
+void writeConfigBundle(const std::string& carModelsFile, const std::string& path, std::ostream& log);
+
+// Read-only view of a bundle file. open() throws std::runtime_error if the file is not a
+// bundle of this version or is truncated.
+class ConfigBundle {
+public:
+    ConfigBundle() : header_(nullptr) {}
+    explicit ConfigBundle(const std::string& path) : header_(nullptr) { open(path); }
+
+    void open(const std::string& path);
+    const std::string& path() const { return file_.path(); }
+
+    size_t modelCount() const { return header_->modelCount; }
+    std::string modelName(size_t i) const { return str(models_[i].name); }
+    std::vector<std::string> modelNames() const;
+    int indexOf(const std::string& name) const;  // -1 if unknown
+    bool hasConfig(size_t i) const { return (models_[i].flags & BundleHasConfig) != 0; }
+
+    CarModelConfig carModel(size_t i) const;
+    osg::Matrix modelTransform(size_t i) const;
+    CameraCalibration calibration(size_t i) const;  // the first camera
+    std::vector<CameraCalibration> cameras(size_t i) const;
+    std::vector<ViewingZone> zones(size_t i) const;
+
+    // Source files that changed since the bundle was written: missing, or with a different
+    // size, or with a different mtime and different contents, or created since (config
+    // files of a model bundled without them). Empty if the bundle is current.
+    std::vector<std::string> staleSources() const;
+    // All recorded sources, for reports
+    std::vector<std::string> sources() const;
+
+private:
+    ConfigBundle(const ConfigBundle&) = delete;
+    ConfigBundle& operator=(const ConfigBundle&) = delete;
+
+    std::string str(const BundleString& s) const { return std::string(strings_ + s.offset, s.length); }
+
+    MappedFile file_;
+    const ConfigBundleHeader* header_;
+    const BundleSource* sources_;
+    const BundleModel* models_;
+    const BundleCalibration* cameras_;
+    const BundleTransformation* transformations_;
+    const BundleZone* zones_;
+    const float* corners_;
+    const char* strings_;
+};
+
+// `visual bundle [<output>] [--check] [--bench]` - compile, check or time a config bundle
+int runBundleCommand(int argc, char** argv);
+
+#endif
@@ -0,0 +1,720 @@
+#include "config_loader.h"
+#include "mapped_file.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <chrono>
+#include <cmath>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// A string token pointing straight into the mapped file (no copy until str() is called)
+struct JsonString {
+    const char* begin;
+    size_t length;
+    bool escaped;
+
+    bool operator==(const char* s) const {
+        return !escaped && std::strlen(s) == length && std::memcmp(begin, s, length) == 0;
+    }
+    bool operator!=(const char* s) const { return !(*this == s); }
+
+    std::string str() const {
+        if (!escaped) return std::string(begin, length);
+        std::string out;
+        out.reserve(length);
+        for (size_t i = 0; i < length; ++i) {
+            char c = begin[i];
+            if (c != '\\' || i + 1 >= length) { out += c; continue; }
+            c = begin[++i];
+            switch (c) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    // Only ASCII code points are meaningful in our config files
+                    unsigned int code = 0;
+                    if (i + 4 < length) code = std::strtoul(std::string(begin + i + 1, 4).c_str(), nullptr, 16);
+                    out += code < 0x80 ? static_cast<char>(code) : '?';
+                    i += 4;
+                    break;
+                }
+                default: out += c; break;  // \" \\ \/
+            }
+        }
+        return out;
+    }
+};
+
+// Minimal single-pass pull parser over an in-memory JSON buffer.
+// Values are consumed in document order; anything the caller does not ask for is skipped.
+class JsonReader {
+public:
+    JsonReader(const char* data, size_t size, const std::string& fileName)
+        : begin_(data), cur_(data), end_(data + size), fileName_(fileName), justOpened_(false) {}
+
+    void beginObject() { expect('{'); justOpened_ = true; }
+    void beginArray() { expect('['); justOpened_ = true; }
+
+    // Advance to the next "key": of the current object, or consume '}' and return false
+    bool nextMember(JsonString& key) {
+        if (!nextItem('}')) return false;
+        if (peek() != '"') fail("expected member name");
+        key = readString();
+        expect(':');
+        return true;
+    }
+
+    // Advance to the next element of the current array, or consume ']' and return false
+    bool nextElement() { return nextItem(']'); }
+
+    JsonString readString() {
+        if (peek() != '"') fail("expected string");
+        const char* start = ++cur_;
+        bool escaped = false;
+        while (cur_ < end_ && *cur_ != '"') {
+            if (*cur_ == '\n') fail("unterminated string");
+            if (*cur_ == '\\') { escaped = true; ++cur_; }
+            ++cur_;
+        }
+        if (cur_ >= end_) fail("unterminated string");
+        JsonString s = { start, static_cast<size_t>(cur_ - start), escaped };
+        ++cur_;
+        return s;
+    }
+
+    double readNumber() {
+        peek();
+        const char* start = cur_;
+        while (cur_ < end_ && (std::isdigit(static_cast<unsigned char>(*cur_)) || *cur_ == '-' || *cur_ == '+' ||
+                               *cur_ == '.' || *cur_ == 'e' || *cur_ == 'E')) {
+            ++cur_;
+        }
+        size_t len = static_cast<size_t>(cur_ - start);
+        // strtod needs a terminated buffer; the mapping is not terminated, so copy the token to the stack
+        char buf[64];
+        if (len == 0 || len >= sizeof(buf)) { cur_ = start; fail("expected number"); }
+        std::memcpy(buf, start, len);
+        buf[len] = '\0';
+        char* parsedEnd = nullptr;
+        double value = std::strtod(buf, &parsedEnd);
+        if (parsedEnd != buf + len) { cur_ = start; fail("malformed number"); }
+        return value;
+    }
+
+    int readInt() {
+        const char* start = cur_;
+        double value = readNumber();
+        // Converting a double outside int's range (or NaN) is undefined, so check first
+        if (!(value >= INT_MIN && value <= INT_MAX)) { cur_ = start; peek(); fail("integer out of range"); }
+        int i = static_cast<int>(value);
+        if (static_cast<double>(i) != value) { cur_ = start; peek(); fail("expected integer"); }
+        return i;
+    }
+
+    // Read an array of exactly `count` numbers into `out`
+    void readNumberArray(double* out, size_t count, const char* what) {
+        const char* start = (peek(), cur_);
+        beginArray();
+        size_t n = 0;
+        while (nextElement()) {
+            double v = readNumber();
+            if (n < count) out[n] = v;
+            ++n;
+        }
+        if (n != count) {
+            cur_ = start;
+            std::ostringstream msg;
+            msg << what << " must have " << count << " values, got " << n;
+            fail(msg.str());
+        }
+    }
+
+    void skipValue() {
+        switch (peek()) {
+            case '{': {
+                beginObject();
+                JsonString key;
+                while (nextMember(key)) skipValue();
+                break;
+            }
+            case '[':
+                beginArray();
+                while (nextElement()) skipValue();
+                break;
+            case '"': readString(); break;
+            case 't': literal("true"); break;
+            case 'f': literal("false"); break;
+            case 'n': literal("null"); break;
+            default: readNumber(); break;
+        }
+    }
+
+    void expectEnd() {
+        if (peek() != '\0') fail("unexpected content after top-level value");
+    }
+
+    // Position of the next token, for errors raised by the caller after the fact
+    const char* position() { peek(); return cur_; }
+    void rewind(const char* pos) { cur_ = pos; }
+
+    [[noreturn]] void fail(const std::string& message) const {
+        int line = 1, column = 1;
+        for (const char* p = begin_; p < cur_ && p < end_; ++p) {
+            if (*p == '\n') { ++line; column = 1; }
+            else ++column;
+        }
+        std::ostringstream msg;
+        msg << fileName_ << ":" << line << ":" << column << ": " << message;
+        throw std::runtime_error(msg.str());
+    }
+
+private:
+    // Skip whitespace and return the next character ('\0' at end of buffer)
+    char peek() {
+        while (cur_ < end_ && (*cur_ == ' ' || *cur_ == '\n' || *cur_ == '\r' || *cur_ == '\t')) ++cur_;
+        return cur_ < end_ ? *cur_ : '\0';
+    }
+
+    void expect(char c) {
+        if (peek() != c) {
+            std::string msg = "expected '";
+            msg += c;
+            msg += "'";
+            fail(msg);
+        }
+        ++cur_;
+    }
+
+    bool nextItem(char close) {
+        char c = peek();
+        if (c == close) { ++cur_; justOpened_ = false; return false; }
+        if (!justOpened_) {
+            if (c != ',') {
+                std::string msg = "expected ',' or '";
+                msg += close;
+                msg += "'";
+                fail(msg);
+            }
+            ++cur_;
+            if (peek() == close) fail("trailing comma");
+        }
+        justOpened_ = false;
+        return true;
+    }
+
+    void literal(const char* word) {
+        size_t len = std::strlen(word);
+        if (static_cast<size_t>(end_ - cur_) < len || std::memcmp(cur_, word, len) != 0) fail("invalid literal");
+        cur_ += len;
+    }
+
+    const char* begin_;
+    const char* cur_;
+    const char* end_;
+    std::string fileName_;
+    bool justOpened_;
+};
+
+struct DoubleField { const char* name; double CameraCalibration::* member; };
+struct FloatField { const char* name; float CameraCalibration::* member; };
+
+const DoubleField kIntrinsicFields[] = {
+    { "principal_point_X", &CameraCalibration::principal_point_X },
+    { "principal_point_Y", &CameraCalibration::principal_point_Y },
+    { "focal_length_X", &CameraCalibration::focal_length_X },
+    { "focal_length_Y", &CameraCalibration::focal_length_Y },
+    { "distortion_k1", &CameraCalibration::distortion_k1 },
+    { "distortion_k2", &CameraCalibration::distortion_k2 },
+    { "distortion_k3", &CameraCalibration::distortion_k3 },
+    { "distortion_k4", &CameraCalibration::distortion_k4 },
+    { "distortion_k5", &CameraCalibration::distortion_k5 },
+    { "distortion_k6", &CameraCalibration::distortion_k6 },
+    { "distortion_p1", &CameraCalibration::distortion_p1 },
+    { "distortion_p2", &CameraCalibration::distortion_p2 },
+};
+const size_t kNumIntrinsicFields = sizeof(kIntrinsicFields) / sizeof(kIntrinsicFields[0]);
+
+const FloatField kVisualizationFields[] = {
+    { "meters_to_mm_scale", &CameraCalibration::meters_to_mm_scale },
+    { "frustum_scale_factor", &CameraCalibration::frustum_scale_factor },
+    { "camera_sphere_radius_mm", &CameraCalibration::camera_sphere_radius_mm },
+    { "axes_length_mm", &CameraCalibration::axes_length_mm },
+    { "axes_arrow_wing_mm", &CameraCalibration::axes_arrow_wing_mm },
+};
+
+void parseExtrinsics(JsonReader& json, CameraCalibration& config, bool& found)
+{
+    // { "CameraExtrinsics": { "extrinsics": [[r11,r12,r13],[r21,r22,r23],[r31,r32,r33],[tx,ty,tz]] } }
+    JsonString key;
+    json.beginObject();
+    while (json.nextMember(key)) {
+        if (key != "CameraExtrinsics") { json.skipValue(); continue; }
+        json.beginObject();
+        while (json.nextMember(key)) {
+            if (key != "extrinsics") { json.skipValue(); continue; }
+            const char* start = json.position();
+            json.beginArray();
+            int row = 0;
+            while (json.nextElement()) {
+                if (row < 3) json.readNumberArray(config.rotation_matrix[row], 3, "extrinsics rotation row");
+                else if (row == 3) json.readNumberArray(config.translation_vector, 3, "extrinsics translation row");
+                else json.skipValue();
+                ++row;
+            }
+            if (row != 4) {
+                json.rewind(start);
+                json.fail("extrinsics must have 4 rows (3 rotation rows + translation), got " + std::to_string(row));
+            }
+            found = true;
+        }
+    }
+}
+
+void parseIntrinsics(JsonReader& json, CameraCalibration& config, unsigned int& foundMask)
+{
+    JsonString key;
+    json.beginObject();
+    while (json.nextMember(key)) {
+        if (key != "CameraIntrinsics") { json.skipValue(); continue; }
+        json.beginObject();
+        while (json.nextMember(key)) {
+            size_t i = 0;
+            while (i < kNumIntrinsicFields && key != kIntrinsicFields[i].name) ++i;
+            if (i == kNumIntrinsicFields) { json.skipValue(); continue; }  // e.g. "comment"
+            config.*(kIntrinsicFields[i].member) = json.readNumber();
+            foundMask |= 1u << i;
+        }
+    }
+}
+
+void parseVisualization(JsonReader& json, CameraCalibration& config)
+{
+    JsonString key;
+    json.beginObject();
+    while (json.nextMember(key)) {
+        bool known = false;
+        for (const auto& field : kVisualizationFields) {
+            if (key == field.name) {
+                config.*(field.member) = static_cast<float>(json.readNumber());
+                known = true;
+                break;
+            }
+        }
+        if (!known) json.skipValue();
+    }
+}
+
+void parseColor(JsonReader& json, osg::Vec4& color)
+{
+    double rgba[4];
+    json.readNumberArray(rgba, 4, "color");
+    color.set(rgba[0], rgba[1], rgba[2], rgba[3]);
+}
+
+void parseZone(JsonReader& json, ViewingZone& zone)
+{
+    const char* start = json.position();
+    bool hasId = false, hasCorners = false, hasColor = false;
+
+    JsonString key;
+    json.beginObject();
+    while (json.nextMember(key)) {
+        if (key == "id") {
+            zone.id = json.readInt();
+            hasId = true;
+        } else if (key == "label") {
+            zone.label = json.readString().str();
+        } else if (key == "color") {
+            parseColor(json, zone.color);
+            hasColor = true;
+        } else if (key == "corners") {
+            // 1x12 matrix format: [x1,y1,z1, x2,y2,z2, x3,y3,z3, x4,y4,z4]
+            double c[12];
+            json.readNumberArray(c, 12, "corners");
+            zone.corners.clear();
+            zone.corners.reserve(4);
+            for (int j = 0; j < 4; ++j) {
+                zone.corners.push_back(carCoord(c[j * 3], c[j * 3 + 1], c[j * 3 + 2]));
+            }
+            hasCorners = true;
+        } else if (key == "category") {
+            zone.category = json.readInt();
+        } else if (key == "priority") {
+            zone.priority = json.readInt();
+        } else if (key == "highway_speed_enabled") {
+            zone.highwaySpeedEnabled = json.readInt() != 0;
+        } else {
+            json.skipValue();
+        }
+    }
+
+    if (!hasId || !hasCorners) {
+        json.rewind(start);
+        json.fail(!hasId ? "viewing zone without \"id\"" : "viewing zone without \"corners\"");
+    }
+    if (zone.label.empty()) zone.label = "Zone " + std::to_string(zone.id);
+    if (!hasColor) zone.color = defaultZoneColor(zone.id);
+}
+
+void parseTransformation(JsonReader& json, CarModelTransformation& transform)
+{
+    transform.angle = transform.x = transform.y = transform.z = transform.value = 0.0;
+
+    JsonString key;
+    json.beginObject();
+    while (json.nextMember(key)) {
+        if (key == "type") transform.type = json.readString().str();
+        else if (key == "angle") transform.angle = json.readNumber();
+        else if (key == "x") transform.x = json.readNumber();
+        else if (key == "y") transform.y = json.readNumber();
+        else if (key == "z") transform.z = json.readNumber();
+        else if (key == "value") transform.value = json.readNumber();
+        else json.skipValue();
+    }
+}
+
+void parseCarModelEntry(JsonReader& json, CarModelConfig& config)
+{
+    JsonString key;
+    json.beginObject();
+    while (json.nextMember(key)) {
+        if (key == "path") {
+            config.path = json.readString().str();
+        } else if (key == "transformations") {
+            json.beginArray();
+            while (json.nextElement()) {
+                config.transformations.push_back(CarModelTransformation());
+                parseTransformation(json, config.transformations.back());
+            }
+        } else {
+            json.skipValue();
+        }
+    }
+}
+
+} // namespace
+
+osg::Vec4 defaultZoneColor(int zoneId)
+{
+    static const osg::Vec4 palette[20] = {
+        osg::Vec4(1.0f,0.0f,1.0f,0.7f), osg::Vec4(0.0f,1.0f,1.0f,0.7f), osg::Vec4(1.0f,0.5f,0.0f,0.7f), osg::Vec4(0.5f,0.0f,1.0f,0.7f),
+        osg::Vec4(0.0f,1.0f,0.5f,0.7f), osg::Vec4(1.0f,0.0f,0.5f,0.7f), osg::Vec4(0.5f,1.0f,0.0f,0.7f), osg::Vec4(0.0f,0.5f,1.0f,0.7f),
+        osg::Vec4(0.5f,0.5f,0.5f,0.7f), osg::Vec4(1.0f,1.0f,0.0f,0.7f), osg::Vec4(0.0f,1.0f,1.0f,0.7f), osg::Vec4(1.0f,0.0f,1.0f,0.7f),
+        osg::Vec4(1.0f,0.5f,0.0f,0.7f), osg::Vec4(0.5f,0.0f,1.0f,0.7f), osg::Vec4(0.0f,1.0f,0.5f,0.7f), osg::Vec4(1.0f,0.0f,0.5f,0.7f),
+        osg::Vec4(0.5f,1.0f,0.0f,0.7f), osg::Vec4(0.0f,0.5f,1.0f,0.7f), osg::Vec4(1.0f,1.0f,0.0f,0.7f), osg::Vec4(0.5f,0.5f,0.5f,0.7f)
+    };
+    if (zoneId >= 1 && zoneId <= 20) return palette[zoneId - 1];
+
+    // Beyond the palette: step the hue by the golden angle so neighbouring ids stay distinct
+    float h = std::fmod(zoneId * 0.618033988749895f, 1.0f) * 6.0f;
+    float x = 1.0f - std::fabs(std::fmod(h, 2.0f) - 1.0f);
+    switch (static_cast<int>(h)) {
+        case 0: return osg::Vec4(1.0f, x, 0.0f, 0.7f);
+        case 1: return osg::Vec4(x, 1.0f, 0.0f, 0.7f);
+        case 2: return osg::Vec4(0.0f, 1.0f, x, 0.7f);
+        case 3: return osg::Vec4(0.0f, x, 1.0f, 0.7f);
+        case 4: return osg::Vec4(x, 0.0f, 1.0f, 0.7f);
+        default: return osg::Vec4(1.0f, 0.0f, x, 0.7f);
+    }
+}
+
+namespace {
+
+// Checks one camera's required fields; `where` names it in the error ("" or "cameras[1]: ")
+void checkCamera(const std::string& filePath, const std::string& where, bool hasExtrinsics, unsigned int intrinsicsMask)
+{
+    if (!hasExtrinsics) {
+        throw std::runtime_error(filePath + ": " + where + "missing IsspItfcParamCameraExtrinsics.CameraExtrinsics.extrinsics");
+    }
+    for (size_t i = 0; i < kNumIntrinsicFields; ++i) {
+        if (!(intrinsicsMask & (1u << i))) {
+            throw std::runtime_error(filePath + ": " + where + "missing IsspItfcParamCameraIntrinsics.CameraIntrinsics." +
+                                     kIntrinsicFields[i].name);
+        }
+    }
+}
+
+// One entry of the "cameras" list
+void parseRigCamera(JsonReader& json, const std::string& filePath, size_t index, CameraCalibration& camera)
+{
+    bool hasExtrinsics = false;
+    unsigned int intrinsicsMask = 0;
+    JsonString key;
+    json.beginObject();
+    while (json.nextMember(key)) {
+        if (key == "name") camera.name = json.readString().str();
+        else if (key == "IsspItfcParamCameraExtrinsics") parseExtrinsics(json, camera, hasExtrinsics);
+        else if (key == "IsspItfcParamCameraIntrinsics") parseIntrinsics(json, camera, intrinsicsMask);
+        else json.skipValue();
+    }
+    checkCamera(filePath, "cameras[" + std::to_string(index) + "]: ", hasExtrinsics, intrinsicsMask);
+    if (camera.name.empty()) camera.name = "camera " + std::to_string(index + 1);
+}
+
+} // namespace
+
+std::vector<CameraCalibration> parseCalibrationRig(const std::string& filePath)
+{
+    MappedFile file(filePath);
+    JsonReader json(file.data(), file.size(), filePath);
+
+    CameraCalibration config;
+    // Visualization parameters are optional; these are the historical defaults
+    config.meters_to_mm_scale = 1000.0f;
+    config.frustum_scale_factor = 0.7f;
+    config.camera_sphere_radius_mm = 20.0f;
+    config.axes_length_mm = 1500.0f;
+    config.axes_arrow_wing_mm = 300.0f;
+
+    bool hasExtrinsics = false, hasRig = false;
+    unsigned int intrinsicsMask = 0;
+    std::vector<CameraCalibration> rig;
+
+    JsonString key;
+    json.beginObject();
+    while (json.nextMember(key)) {
+        if (key == "IsspItfcParamCameraExtrinsics") parseExtrinsics(json, config, hasExtrinsics);
+        else if (key == "IsspItfcParamCameraIntrinsics") parseIntrinsics(json, config, intrinsicsMask);
+        else if (key == "visualization") parseVisualization(json, config);
+        else if (key == "cameras") {
+            const char* start = json.position();
+            json.beginArray();
+            while (json.nextElement()) {
+                rig.push_back(CameraCalibration());
+                parseRigCamera(json, filePath, rig.size() - 1, rig.back());
+            }
+            if (rig.empty()) {
+                json.rewind(start);
+                json.fail("cameras must list at least one camera");
+            }
+            hasRig = true;
+        }
+        else json.skipValue();
+    }
+    json.expectEnd();
+
+    if (!hasRig) {
+        checkCamera(filePath, "", hasExtrinsics, intrinsicsMask);
+        rig.push_back(config);
+        return rig;
+    }
+    if (hasExtrinsics || intrinsicsMask) {
+        throw std::runtime_error(filePath + ": camera parameters both at the top level and in the cameras list");
+    }
+    // The visualization block is shared by the whole rig
+    for (auto& camera : rig) {
+        camera.meters_to_mm_scale = config.meters_to_mm_scale;
+        camera.frustum_scale_factor = config.frustum_scale_factor;
+        camera.camera_sphere_radius_mm = config.camera_sphere_radius_mm;
+        camera.axes_length_mm = config.axes_length_mm;
+        camera.axes_arrow_wing_mm = config.axes_arrow_wing_mm;
+    }
+    return rig;
+}
+
+CameraCalibration parseCalibrationFile(const std::string& filePath)
+{
+    return parseCalibrationRig(filePath)[0];
+}
+
+std::vector<ViewingZone> parseViewingZonesFile(const std::string& filePath)
+{
+    MappedFile file(filePath);
+    JsonReader json(file.data(), file.size(), filePath);
+
+    std::vector<ViewingZone> zones;
+    bool hasZones = false;
+
+    JsonString key;
+    json.beginObject();
+    while (json.nextMember(key)) {
+        if (key != "viewing_zones") { json.skipValue(); continue; }
+        json.beginArray();
+        while (json.nextElement()) {
+            zones.push_back(ViewingZone());
+            parseZone(json, zones.back());
+        }
+        hasZones = true;
+    }
+    json.expectEnd();
+
+    if (!hasZones) {
+        throw std::runtime_error(filePath + ": missing \"viewing_zones\" array");
+    }
+    return zones;
+}
+
+CarModelConfig parseCarModelFile(const std::string& filePath, const std::string& carModelName)
+{
+    MappedFile file(filePath);
+    JsonReader json(file.data(), file.size(), filePath);
+
+    CarModelConfig config;
+    config.name = carModelName;
+
+    JsonString key;
+    json.beginObject();
+    while (json.nextMember(key)) {
+        if (key.length == carModelName.size() && !key.escaped &&
+            std::memcmp(key.begin, carModelName.data(), key.length) == 0) {
+            // Found it - the remaining models are never touched
+            parseCarModelEntry(json, config);
+            if (config.path.empty()) {
+                throw std::runtime_error(filePath + ": car model '" + carModelName + "' has no \"path\"");
+            }
+            return config;
+        }
+        json.skipValue();
+    }
+    throw std::runtime_error("Car model '" + carModelName + "' not found in " + filePath);
+}
+
+std::vector<std::string> listCarModels(const std::string& filePath)
+{
+    MappedFile file(filePath);
+    JsonReader json(file.data(), file.size(), filePath);
+
+    std::vector<std::string> names;
+    JsonString key;
+    json.beginObject();
+    while (json.nextMember(key)) {
+        names.push_back(key.str());
+        json.skipValue();
+    }
+    json.expectEnd();
+    return names;
+}
+
+std::vector<CameraCalibration> loadCalibration(const std::string& configPath) {
+    std::vector<CameraCalibration> rig = parseCalibrationRig(configPath + "/calibraton.json");
+
+    std::cout << "Loaded camera calibration from: " << configPath << "/calibraton.json";
+    if (rig.size() > 1) std::cout << " (" << rig.size() << " cameras)";
+    std::cout << std::endl;
+
+    // Print loaded intrinsics for verification
+    for (const auto& config : rig) {
+        std::cout << "\nCamera Intrinsics" << (config.name.empty() ? "" : " (" + config.name + ")") << ":" << std::endl;
+        std::cout << "  Principal Point: (" << config.principal_point_X << ", " << config.principal_point_Y << ")" << std::endl;
+        std::cout << "  Focal Length: (" << config.focal_length_X << ", " << config.focal_length_Y << ")" << std::endl;
+        std::cout << "  Distortion: k1=" << config.distortion_k1 << ", k2=" << config.distortion_k2
+                  << ", p1=" << config.distortion_p1 << ", p2=" << config.distortion_p2 << std::endl;
+    }
+
+    return rig;
+}
+
+std::vector<ViewingZone> loadViewingZones(const std::string& configPath) {
+    std::vector<ViewingZone> zones = parseViewingZonesFile(configPath + "/viewingzones.json");
+
+    std::cout << "Loaded " << zones.size() << " viewing zones from: " << configPath << "/viewingzones.json" << std::endl;
+    std::cout << "Using 1x12 matrix format: [x1,y1,z1, x2,y2,z2, x3,y3,z3, x4,y4,z4]" << std::endl;
+    return zones;
+}
+
+CarModelConfig loadCarModel(const std::string& carModelName) {
+    CarModelConfig config = parseCarModelFile("carmodels/carmodels.json", carModelName);
+
+    std::cout << "Loaded car model '" << carModelName << "' with " << config.transformations.size() << " transformations" << std::endl;
+    std::cout << "Model path: " << config.path << std::endl;
+
+    return config;
+}
+
+osg::Matrix applyCarModelTransformations(const CarModelConfig& config, std::ostream& log) {
+    osg::Matrix matrix;
+    matrix.makeIdentity();
+
+    log << "Applying transformations for " << config.name << ":" << std::endl;
+
+    for (const auto& transform : config.transformations) {
+        if (transform.type == "rotate") {
+            osg::Matrix rotation;
+            osg::Vec3 axis(transform.x, transform.y, transform.z);
+            rotation.makeRotate(osg::DegreesToRadians(transform.angle), axis);
+            matrix = matrix * rotation;
+            log << "  - Rotate " << transform.angle << "° around axis ("
+                      << transform.x << ", " << transform.y << ", " << transform.z << ")" << std::endl;
+        }
+        else if (transform.type == "scale") {
+            osg::Matrix scale;
+            scale.makeScale(transform.value, transform.value, transform.value);
+            matrix = matrix * scale;
+            log << "  - Scale by " << transform.value << std::endl;
+        }
+        else if (transform.type == "translate") {
+            osg::Matrix translation;
+            translation.makeTranslate(transform.x, transform.y, transform.z);
+            matrix = matrix * translation;
+            log << "  - Translate by (" << transform.x << ", " << transform.y << ", " << transform.z << ")" << std::endl;
+        }
+    }
+
+    return matrix;
+}
+
+namespace {
+
+template<typename ParseFn>
+void timeLoad(const std::string& label, const std::string& filePath, int iterations, ParseFn parse)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    size_t bytes = 0;
+    {
+        MappedFile file(filePath);
+        bytes = file.size();
+    }
+
+    parse();  // warm-up: page cache and allocator
+
+    double total = 0.0, best = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+        Clock::time_point t0 = Clock::now();
+        parse();
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+        total += us;
+        if (us < best) best = us;
+    }
+    double mean = total / iterations;
+
+    std::cout << "  " << std::left << std::setw(20) << label << std::right
+              << std::setw(8) << bytes << " bytes"
+              << "   min " << std::setw(9) << std::fixed << std::setprecision(2) << best << " us"
+              << "   mean " << std::setw(9) << mean << " us"
+              << "   " << std::setw(8) << std::setprecision(1) << (bytes / mean) << " MB/s" << std::endl;
+}
+
+} // namespace
+
+int runLoadBenchmark(const std::string& carModelName, int iterations)
+{
+    std::string configPath = "carmodels/" + carModelName + "/config";
+    volatile size_t sink = 0;
+
+    std::cout << "Config load benchmark for '" << carModelName << "' (" << iterations << " iterations per file)" << std::endl;
+    try {
+        timeLoad("carmodels.json", "carmodels/carmodels.json", iterations, [&]() {
+            sink += parseCarModelFile("carmodels/carmodels.json", carModelName).transformations.size();
+        });
+        timeLoad("calibraton.json", configPath + "/calibraton.json", iterations, [&]() {
+            sink += static_cast<size_t>(parseCalibrationFile(configPath + "/calibraton.json").focal_length_X);
+        });
+        timeLoad("viewingzones.json", configPath + "/viewingzones.json", iterations, [&]() {
+            sink += parseViewingZonesFile(configPath + "/viewingzones.json").size();
+        });
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+#ifndef CONFIG_LOADER_H
+#define CONFIG_LOADER_H
+
+#include <osg/Vec3>
+#include <osg/Vec4>
+#include <osg/Matrix>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Desired coordinate system: X=red (left/driver side), Y=green (up/roof), Z=blue (forward)
+// NOTE: This function defines coordinates in the desired system
+inline osg::Vec3 carCoord(float x, float y, float z) {
+    return osg::Vec3(x, y, z);
+}
+
+// Configuration structures
+struct CameraCalibration {
+    // Name of the camera in a multi-camera calibraton.json; empty for a single camera
+    std::string name;
+
+    // Extrinsics (from IsspItfcParamCameraExtrinsics)
+    double rotation_matrix[3][3];
+    double translation_vector[3];
+
+    // Intrinsics (from IsspItfcParamCameraIntrinsics)
+    double principal_point_X;
+    double principal_point_Y;
+    double focal_length_X;
+    double focal_length_Y;
+    double distortion_k1;
+    double distortion_k2;
+    double distortion_k3;
+    double distortion_k4;
+    double distortion_k5;
+    double distortion_k6;
+    double distortion_p1;
+    double distortion_p2;
+
+    // Visualization parameters
+    float meters_to_mm_scale;
+    float frustum_scale_factor;
+    float camera_sphere_radius_mm;
+    float axes_length_mm;
+    float axes_arrow_wing_mm;
+};
+
+struct ViewingZone {
+    int id;
+    std::string label;
+    osg::Vec4 color;
+    std::vector<osg::Vec3> corners;  // Will be populated from 1x12 matrix
+
+    // ECU view target attributes (viewtarget.txt, optional in viewingzones.json)
+    int category = 0;
+    int priority = 0;                  // where zones overlap, the highest priority wins
+    bool highwaySpeedEnabled = true;   // still a gaze target at highway speed
+};
+
+struct CarModelTransformation {
+    std::string type;      // "rotate", "scale", "translate"
+    double angle;          // For rotation
+    double x, y, z;        // For rotation axis and translation
+    double value;          // For scale
+};
+
+struct CarModelConfig {
+    std::string name;
+    std::string path;
+    std::vector<CarModelTransformation> transformations;
+};
+
+// Fallback colour for zones that do not specify one. Ids 1-20 use the historical palette.
+osg::Vec4 defaultZoneColor(int zoneId);
+
+// Quiet parsers: read one JSON file in a single pass over a memory-mapped buffer.
+// Syntax and schema errors are thrown as std::runtime_error with "file:line:column: message".
+// calibraton.json holds either one camera (extrinsics and intrinsics at the top level) or a
+// rig: a "cameras" list of {"name", extrinsics, intrinsics} objects. The "visualization"
+// block stays at the top level and applies to every camera. parseCalibrationRig returns
+// every camera in file order; parseCalibrationFile returns the first.
+CameraCalibration parseCalibrationFile(const std::string& filePath);
+std::vector<CameraCalibration> parseCalibrationRig(const std::string& filePath);
+std::vector<ViewingZone> parseViewingZonesFile(const std::string& filePath);
+CarModelConfig parseCarModelFile(const std::string& filePath, const std::string& carModelName);
+
+// Names of all car models in carmodels.json, in file order
+std::vector<std::string> listCarModels(const std::string& filePath);
+
+// Loaders used by the viewer (parse + console diagnostics)
+std::vector<CameraCalibration> loadCalibration(const std::string& configPath);
+std::vector<ViewingZone> loadViewingZones(const std::string& configPath);
+CarModelConfig loadCarModel(const std::string& carModelName);
+
+// Combined transformation matrix; each step is described on `log`
+osg::Matrix applyCarModelTransformations(const CarModelConfig& config, std::ostream& log = std::cout);
+
+// Time repeated parses of the three config files of a model and print per-file load times
+int runLoadBenchmark(const std::string& carModelName, int iterations);
+
+#endif
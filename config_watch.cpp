@@ -0,0 +1,88 @@
+#include "config_watch.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+ConfigWatcher::ConfigWatcher()
+    : fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+    if (fd_ < 0) throw std::runtime_error(std::string("Cannot start inotify: ") + std::strerror(errno));
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    close(fd_);
+}
+
+int ConfigWatcher::addDirectory(const std::string& directory)
+{
+    // The directory rather than the files: saving by rename replaces the file's inode
+    int wd = inotify_add_watch(fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) throw std::runtime_error("Cannot watch " + directory + ": " + std::strerror(errno));
+    auto existing = watches_.find(wd);
+    if (existing != watches_.end()) return existing->second;
+    watches_[wd] = static_cast<int>(directories_.size());
+    directories_.push_back(directory);
+    return watches_[wd];
+}
+
+std::vector<ConfigWatcher::Change> ConfigWatcher::poll()
+{
+    std::vector<Change> changes;
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t n = read(fd_, buffer, sizeof(buffer));
+        if (n <= 0) break;  // EAGAIN: nothing (more) pending
+        for (char* p = buffer; p < buffer + n;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+            auto watch = watches_.find(event->wd);
+            if (watch == watches_.end() || event->len == 0) continue;
+
+            Change change;
+            change.directory = watch->second;
+            change.file = event->name;
+            bool seen = std::any_of(changes.begin(), changes.end(), [&](const Change& c) {
+                return c.directory == change.directory && c.file == change.file;
+            });
+            if (!seen) changes.push_back(change);
+        }
+    }
+    return changes;
+}
+
+bool ConfigWatcher::pending() const
+{
+    pollfd fd = {fd_, POLLIN, 0};
+    return ::poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN);
+}
+
+ZoneDiff diffViewingZones(const std::vector<ViewingZone>& before, const std::vector<ViewingZone>& after)
+{
+    std::map<int, const ViewingZone*> old;
+    for (const auto& zone : before) old.insert(std::make_pair(zone.id, &zone));
+
+    ZoneDiff diff;
+    std::map<int, bool> present;
+    for (const auto& zone : after) {
+        present[zone.id] = true;
+        auto it = old.find(zone.id);
+        if (it == old.end()) {
+            diff.added.push_back(zone.id);
+        } else if (it->second->label != zone.label || it->second->color != zone.color ||
+                   it->second->corners != zone.corners || it->second->category != zone.category ||
+                   it->second->priority != zone.priority ||
+                   it->second->highwaySpeedEnabled != zone.highwaySpeedEnabled) {
+            diff.changed.push_back(zone.id);
+        }
+    }
+    for (const auto& entry : old) {
+        if (!present.count(entry.first)) diff.removed.push_back(entry.first);
+    }
+    return diff;
+}
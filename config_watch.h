@@ -0,0 +1,50 @@
+#ifndef CONFIG_WATCH_H
+#define CONFIG_WATCH_H
+
+#include "config_loader.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Watches config directories (carmodels/<model>/config) with inotify and reports files that
+// were rewritten. A file is reported once it is closed after writing, or when it is moved
+// into place, which is how most editors save; half-written files are never reported.
+// poll() never blocks, so it can run every frame.
+// Throws std::runtime_error if inotify is unavailable or a directory cannot be watched.
+class ConfigWatcher {
+public:
+    struct Change {
+        int directory;  // as returned by addDirectory
+        std::string file;
+    };
+
+    ConfigWatcher();
+    ~ConfigWatcher();
+
+    int addDirectory(const std::string& directory);
+    const std::string& directory(int index) const { return directories_[index]; }
+
+    // Files changed since the last call, each reported once
+    std::vector<Change> poll();
+    // True if poll() has events to read (of any file in the directories); consumes nothing
+    bool pending() const;
+
+private:
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    int fd_;
+    std::map<int, int> watches_;  // inotify watch descriptor -> directory index
+    std::vector<std::string> directories_;
+};
+
+// Zone ids added, removed and changed (label, color, corners or target attributes) between
+// two zone lists
+struct ZoneDiff {
+    std::vector<int> added, removed, changed;
+    bool empty() const { return added.empty() && removed.empty() && changed.empty(); }
+};
+ZoneDiff diffViewingZones(const std::vector<ViewingZone>& before, const std::vector<ViewingZone>& after);
+
+#endif
@@ -0,0 +1,41 @@
+#include "csv_util.h"
+
+#include <cstdlib>
+
+namespace {
+
+// Copies the next field into `buf` (NUL-terminated); false at end of line or if too long
+bool nextCsvField(const char*& p, const char* lineEnd, char (&buf)[64], size_t& len)
+{
+    while (p < lineEnd && (*p == ',' || *p == ';' || *p == ' ' || *p == '\t')) ++p;
+    if (p >= lineEnd) return false;
+    const char* start = p;
+    while (p < lineEnd && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') ++p;
+    len = static_cast<size_t>(p - start);
+    if (len == 0 || len >= sizeof(buf)) return false;
+    std::memcpy(buf, start, len);
+    buf[len] = '\0';
+    return true;
+}
+
+} // namespace
+
+bool nextCsvNumber(const char*& p, const char* lineEnd, float& value)
+{
+    char buf[64];
+    size_t len;
+    if (!nextCsvField(p, lineEnd, buf, len)) return false;
+    char* end = nullptr;
+    value = std::strtof(buf, &end);
+    return end == buf + len;
+}
+
+bool nextCsvNumber(const char*& p, const char* lineEnd, double& value)
+{
+    char buf[64];
+    size_t len;
+    if (!nextCsvField(p, lineEnd, buf, len)) return false;
+    char* end = nullptr;
+    value = std::strtod(buf, &end);
+    return end == buf + len;
+}
@@ -0,0 +1,51 @@
+#ifndef CSV_UTIL_H
+#define CSV_UTIL_H
+
+#include "mapped_file.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Parse the next number in a CSV line (separators: ',', ';', space, tab).
+// Returns false at end of line or if the field is not a number.
+bool nextCsvNumber(const char*& p, const char* lineEnd, float& value);
+// Same, at double precision (long recordings' timestamps)
+bool nextCsvNumber(const char*& p, const char* lineEnd, double& value);
+
+// Call fn(values, count) for each line of a memory-mapped numeric CSV file.
+// Up to maxColumns leading numbers are parsed per line (maxColumns <= 16); lines that do
+// not start with a number (headers, '#' comments) are skipped. Line counts other than the
+// accepted ones are reported as "path:line: expected <what>, got N".
+// forEachCsvRow<double> parses at double precision, for files with timestamp columns.
+template<typename Value = float, typename Fn>
+void forEachCsvRow(const std::string& path, int minColumns, int maxColumns, const char* what, Fn fn)
+{
+    MappedFile file(path);
+    const char* p = file.data();
+    const char* end = p + file.size();
+
+    int lineNumber = 0;
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!lineEnd) lineEnd = end;
+        ++lineNumber;
+
+        Value values[16];
+        int count = 0;
+        const char* q = p;
+        while (count < maxColumns && nextCsvNumber(q, lineEnd, values[count])) ++count;
+
+        if (count >= minColumns) {
+            fn(values, count);
+        } else if (count > 0) {
+            std::ostringstream msg;
+            msg << path << ":" << lineNumber << ": expected " << what << ", got " << count;
+            throw std::runtime_error(msg.str());
+        }
+        p = lineEnd + 1;
+    }
+}
+
+#endif
@@ -0,0 +1,180 @@
+#include "disk_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+std::string cacheDirectory()
+{
+    const char* dir = std::getenv("VISUAL_CACHE_DIR");
+    return dir && *dir ? std::string(dir) : std::string("cache");
+}
+
+std::string cacheFilePath(const std::string& prefix, uint64_t key, const std::string& extension)
+{
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+    return cacheDirectory() + "/" + prefix + "_" + hex + extension;
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uint64_t hashFileContents(const std::string& path, uint64_t seed)
+{
+    MappedFile file(path, MappedFile::Sequential);
+    const char* p = file.data();
+    size_t words = file.size() / 8;
+
+    // Four independent multiply-rotate lanes keep the multiplier pipeline busy
+    const uint64_t prime = 0x9E3779B97F4A7C15ULL;
+    uint64_t lanes[4] = { seed, seed ^ 1, seed ^ 2, seed ^ 3 };
+    size_t i = 0;
+    for (; i + 4 <= words; i += 4) {
+        for (int l = 0; l < 4; ++l) {
+            uint64_t w;
+            std::memcpy(&w, p + (i + l) * 8, 8);
+            lanes[l] = (lanes[l] ^ w) * prime;
+            lanes[l] ^= lanes[l] >> 29;
+        }
+    }
+    uint64_t h = hashBytes(lanes, sizeof(lanes), seed);
+    uint64_t size = file.size();
+    h = hashBytes(&size, sizeof(size), h);
+    return hashBytes(p + i * 8, file.size() - i * 8, h);
+}
+
+namespace {
+
+bool endsWith(const std::string& s, const std::string& suffix)
+{
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void collectFiles(const std::string& directory, const std::string& suffix, std::vector<std::string>& files)
+{
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) throw std::runtime_error("Cannot open directory " + directory + ": " + std::strerror(errno));
+    std::vector<std::string> subdirectories;
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        std::string path = directory + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) continue;
+        if (S_ISDIR(info.st_mode)) subdirectories.push_back(path);
+        else if (S_ISREG(info.st_mode) && endsWith(name, suffix)) files.push_back(path);
+    }
+    closedir(dir);
+    for (const auto& subdirectory : subdirectories) collectFiles(subdirectory, suffix, files);
+}
+
+} // namespace
+
+std::vector<std::string> findFiles(const std::string& path, const std::string& suffix)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    std::vector<std::string> files;
+    if (!S_ISDIR(info.st_mode)) {
+        files.push_back(path);
+        return files;
+    }
+    std::string directory = path;
+    while (directory.size() > 1 && directory[directory.size() - 1] == '/') directory.erase(directory.size() - 1);
+    collectFiles(directory, suffix, files);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+void makeDirectories(const std::string& path)
+{
+    for (size_t pos = 1; pos <= path.size(); ++pos) {
+        if (pos < path.size() && path[pos] != '/') continue;
+        std::string prefix = path.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw std::runtime_error("Cannot create directory " + prefix + ": " + std::strerror(errno));
+        }
+    }
+}
+
+void writeFileAtomically(const std::string& path, const std::vector<std::pair<const void*, size_t> >& parts)
+{
+    std::string tmpPath = path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot write " + tmpPath + ": " + std::strerror(errno));
+    }
+    for (const auto& part : parts) {
+        const char* p = static_cast<const char*>(part.first);
+        size_t left = part.second;
+        while (left > 0) {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                std::string reason = std::strerror(errno);
+                ::close(fd);
+                unlink(tmpPath.c_str());
+                throw std::runtime_error("Cannot write " + tmpPath + ": " + reason);
+            }
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+    }
+    if (::close(fd) != 0 || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::string reason = std::strerror(errno);
+        unlink(tmpPath.c_str());
+        throw std::runtime_error("Cannot write " + path + ": " + reason);
+    }
+}
+
+void writeCacheFile(const std::string& path, const char* magic, uint32_t version, uint64_t key,
+                    const std::vector<std::pair<const void*, size_t> >& payload)
+{
+    CacheFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic, std::min(std::strlen(magic), sizeof(header.magic)));
+    header.version = version;
+    header.key = key;
+    for (const auto& part : payload) header.payloadSize += part.second;
+
+    std::vector<std::pair<const void*, size_t> > parts;
+    parts.push_back(std::make_pair(static_cast<const void*>(&header), sizeof(header)));
+    parts.insert(parts.end(), payload.begin(), payload.end());
+
+    size_t slash = path.rfind('/');
+    if (slash != std::string::npos) makeDirectories(path.substr(0, slash));
+    writeFileAtomically(path, parts);
+}
+
+const char* openCacheFile(MappedFile& file, const std::string& path, const char* magic, uint32_t version,
+                          uint64_t key, size_t& payloadSize)
+{
+    if (access(path.c_str(), R_OK) != 0) return nullptr;
+    file.open(path, MappedFile::Random);
+
+    CacheFileHeader header;
+    if (file.size() < sizeof(header)) return nullptr;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::strncmp(header.magic, magic, sizeof(header.magic)) != 0 || header.version != version ||
+        header.key != key || header.payloadSize != file.size() - sizeof(header)) {
+        return nullptr;
+    }
+    payloadSize = static_cast<size_t>(header.payloadSize);
+    return file.data() + sizeof(header);
+}
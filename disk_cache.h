@@ -0,0 +1,55 @@
+#ifndef DISK_CACHE_H
+#define DISK_CACHE_H
+
+#include "mapped_file.h"
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Derived data (lookup maps, label images, ...) is cached in binary files under
+// cacheDirectory(). Each file starts with a 32-byte CacheFileHeader; the payload that
+// follows is 32-byte aligned when mapped, so it can be used in place.
+struct CacheFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t key;          // hash of every input the payload depends on
+    uint64_t payloadSize;
+};
+
+// $VISUAL_CACHE_DIR, or "cache" in the working directory
+std::string cacheDirectory();
+
+// "<cacheDirectory()>/<prefix>_<16 hex digits of key><extension>"
+std::string cacheFilePath(const std::string& prefix, uint64_t key, const std::string& extension);
+
+// 64-bit FNV-1a, chainable through `seed`
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
+
+// Hash of a whole file's contents, read 8 bytes at a time (much faster than hashBytes on
+// large inputs such as model files). Throws std::runtime_error if it cannot be read.
+uint64_t hashFileContents(const std::string& path, uint64_t seed = 14695981039346656037ULL);
+
+// `path` itself if it is a file, else every file below it whose name ends with `suffix`,
+// sorted. Throws std::runtime_error if `path` does not exist or a directory cannot be read.
+std::vector<std::string> findFiles(const std::string& path, const std::string& suffix);
+
+// Create a directory and its parents if missing. Throws std::runtime_error on failure.
+void makeDirectories(const std::string& path);
+
+// Write to a temporary file next to `path` and rename it into place, so readers never see
+// a partially written file. Throws std::runtime_error on failure.
+void writeFileAtomically(const std::string& path, const std::vector<std::pair<const void*, size_t> >& parts);
+
+// Write header + payload parts to `path` (creating the cache directory if needed)
+void writeCacheFile(const std::string& path, const char* magic, uint32_t version, uint64_t key,
+                    const std::vector<std::pair<const void*, size_t> >& payload);
+
+// Map a cache file and validate its header. Returns the payload, or nullptr if the file
+// is missing, was written for another key/version, or is truncated.
+const char* openCacheFile(MappedFile& file, const std::string& path, const char* magic, uint32_t version,
+                          uint64_t key, size_t& payloadSize);
+
+#endif
@@ -0,0 +1,465 @@
+#include "extrinsics_sweep.h"
+#include "camera_frustum.h"
+#include "parallel_for.h"
+#include "viewtarget.h"
+#include "zone_bvh.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/LineWidth>
+#include <osg/MatrixTransform>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// Error histogram: 32 log-spaced bins per octave from 2^-16 to 2^16 pixels
+const int kBinsPerOctave = 32;
+const int kMinExponent = -16;
+const int kHistogramBins = 32 * kBinsPerOctave;
+
+// 95% of a 2-D normal distribution lies inside sqrt(chi2(2, 0.95)) standard deviations
+const double kChiSquare95 = 5.991464547;
+
+int histogramBin(double error)
+{
+    if (!(error > std::ldexp(1.0, kMinExponent))) return 0;
+    int bin = static_cast<int>((std::log2(error) - kMinExponent) * kBinsPerOctave);
+    return std::min(bin, kHistogramBins - 1);
+}
+
+uint64_t splitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Offsets of pose `index`: translation in meters, then yaw, pitch and roll in degrees
+void sweepPose(const SweepOptions& options, uint64_t index, double pose[6])
+{
+    const double t = options.translationMm / 1000.0, r = options.rotationDeg;
+    const double limits[6] = { t, t, t, r, r, r };
+    if (options.sampling == SweepGrid) {
+        const uint64_t steps = static_cast<uint64_t>(options.gridSteps);
+        for (int a = 0; a < 6; ++a) {
+            pose[a] = limits[a] * (2.0 * double(index % steps) / double(steps - 1) - 1.0);
+            index /= steps;
+        }
+        return;
+    }
+    uint64_t state = options.seed;
+    state = splitMix64(state) ^ (index * 0xD1B54A32D192ED03ull);
+    splitMix64(state);
+    for (int a = 0; a < 6; ++a) {
+        double u = (splitMix64(state) >> 11) * (1.0 / 9007199254740992.0);  // [0, 1)
+        pose[a] = limits[a] * (2.0 * u - 1.0);
+    }
+}
+
+// One corner's errors (or a zone's, merged from its corners) as collected by one thread
+struct ErrorAccumulator {
+    uint64_t count = 0, behindCamera = 0;
+    double sum = 0.0, min = HUGE_VAL, max = 0.0;
+    double sumU = 0.0, sumV = 0.0, sumUU = 0.0, sumUV = 0.0, sumVV = 0.0;
+    std::vector<uint64_t> histogram = std::vector<uint64_t>(kHistogramBins, 0);
+
+    void add(const osg::Vec2d& offset)
+    {
+        double du = offset.x(), dv = offset.y();
+        double error = std::sqrt(du * du + dv * dv);
+        ++count;
+        sum += error;
+        min = std::min(min, error);
+        max = std::max(max, error);
+        sumU += du;
+        sumV += dv;
+        sumUU += du * du;
+        sumUV += du * dv;
+        sumVV += dv * dv;
+        histogram[histogramBin(error)]++;
+    }
+
+    void merge(const ErrorAccumulator& other)
+    {
+        count += other.count;
+        behindCamera += other.behindCamera;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        sumU += other.sumU;
+        sumV += other.sumV;
+        sumUU += other.sumUU;
+        sumUV += other.sumUV;
+        sumVV += other.sumVV;
+        for (int i = 0; i < kHistogramBins; ++i) histogram[i] += other.histogram[i];
+    }
+
+    SweepErrorStats stats() const
+    {
+        SweepErrorStats s;
+        s.count = count;
+        if (!count) return s;
+        s.min = min;
+        s.max = max;
+        s.mean = sum / count;
+        // Geometric middle of the bin holding the 95th percentile, within the exact range
+        uint64_t target = (count * 95 + 99) / 100, seen = 0;
+        for (int i = 0; i < kHistogramBins; ++i) {
+            seen += histogram[i];
+            if (seen < target) continue;
+            s.p95 = std::ldexp(1.0, kMinExponent) * std::exp2((i + 0.5) / kBinsPerOctave);
+            break;
+        }
+        s.p95 = std::min(std::max(s.p95, min), max);
+        return s;
+    }
+};
+
+void writeStats(std::ostream& out, const SweepErrorStats& stats)
+{
+    if (!stats.count) {
+        out << "null";
+        return;
+    }
+    out << "{\"count\": " << stats.count << ", \"min_px\": " << stats.min << ", \"mean_px\": " << stats.mean
+        << ", \"p95_px\": " << stats.p95 << ", \"max_px\": " << stats.max << "}";
+}
+
+} // namespace
+
+ExtrinsicsSweep computeExtrinsicsSweep(const CameraModel& camera, const std::vector<ViewingZone>& zones,
+                                       const SweepOptions& options)
+{
+    if (!(options.translationMm >= 0.0) || !(options.rotationDeg >= 0.0) ||
+        (options.translationMm == 0.0 && options.rotationDeg == 0.0)) {
+        throw std::runtime_error("The translation and rotation tolerances must not be negative, and not both zero");
+    }
+    if (options.rotationDeg > 45.0) throw std::runtime_error("The rotation tolerance is limited to 45 degrees");
+    if (options.sampling == SweepGrid && (options.gridSteps < 2 || options.gridSteps > 15)) {
+        throw std::runtime_error("The grid needs 2 to 15 steps per axis");
+    }
+    if (options.sampling == SweepRandom && options.samples == 0) throw std::runtime_error("The pose count must be positive");
+    if (zones.empty()) throw std::runtime_error("No zones to reproject");
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    ExtrinsicsSweep sweep;
+    sweep.options = options;
+    sweep.poses = options.samples;
+    if (options.sampling == SweepGrid) {
+        sweep.poses = 1;
+        for (int a = 0; a < 6; ++a) sweep.poses *= static_cast<uint64_t>(options.gridSteps);
+    }
+
+    // Corners inside the calibrated image are the ones whose error matters. The rational
+    // model folds some points far outside the field of view back into the image, so the
+    // corner must also lie inside the pinhole frustum.
+    const CameraFrustum frustum(camera);
+    std::vector<size_t> cornerZone;
+    for (size_t z = 0; z < zones.size(); ++z) {
+        SweepZone zone;
+        zone.id = zones[z].id;
+        zone.degenerate = isZoneDegenerate(zones[z]);
+        zone.corners = 0;
+        // A placeholder zone's corners all sit at the carCoord origin, which is in view
+        for (size_t c = 0; !zone.degenerate && c < zones[z].corners.size(); ++c) {
+            SweepCorner corner;
+            corner.zoneId = zones[z].id;
+            corner.corner = static_cast<int>(c);
+            corner.position = osg::Vec3d(zones[z].corners[c]);
+            if (!frustum.contains(corner.position) || !camera.project(corner.position, corner.pixel) || corner.pixel.x() < 0.0 || corner.pixel.y() < 0.0 ||
+                corner.pixel.x() >= camera.imageWidth || corner.pixel.y() >= camera.imageHeight) {
+                continue;
+            }
+            sweep.corners.push_back(corner);
+            cornerZone.push_back(z);
+            zone.corners++;
+        }
+        sweep.zones.push_back(zone);
+    }
+
+    const size_t cornerCount = sweep.corners.size();
+    std::vector<ErrorAccumulator> merged(cornerCount);
+    std::mutex mergeMutex;
+    parallelFor(sweep.poses, 256, 1, options.threads, [&](size_t begin, size_t end) {
+        std::vector<ErrorAccumulator> acc(cornerCount);
+        for (size_t i = begin; i < end; ++i) {
+            double pose[6];
+            sweepPose(options, i, pose);
+            CameraModel moved = perturbCamera(camera, osg::Vec3d(pose[0], pose[1], pose[2]), pose[3], pose[4], pose[5]);
+            for (size_t c = 0; c < cornerCount; ++c) {
+                osg::Vec2d pixel;
+                if (moved.project(sweep.corners[c].position, pixel)) acc[c].add(pixel - sweep.corners[c].pixel);
+                else acc[c].behindCamera++;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        for (size_t c = 0; c < cornerCount; ++c) merged[c].merge(acc[c]);
+    });
+
+    std::vector<ErrorAccumulator> zoneErrors(zones.size());
+    ErrorAccumulator overall;
+    for (size_t c = 0; c < cornerCount; ++c) {
+        const ErrorAccumulator& acc = merged[c];
+        SweepCorner& corner = sweep.corners[c];
+        corner.error = acc.stats();
+        corner.behindCamera = acc.behindCamera;
+        corner.meanOffset.set(0.0, 0.0);
+        corner.covariance[0] = corner.covariance[1] = corner.covariance[2] = 0.0;
+        if (acc.count) {
+            double n = static_cast<double>(acc.count);
+            corner.meanOffset.set(acc.sumU / n, acc.sumV / n);
+            corner.covariance[0] = acc.sumUU / n - corner.meanOffset.x() * corner.meanOffset.x();
+            corner.covariance[1] = acc.sumUV / n - corner.meanOffset.x() * corner.meanOffset.y();
+            corner.covariance[2] = acc.sumVV / n - corner.meanOffset.y() * corner.meanOffset.y();
+        }
+        zoneErrors[cornerZone[c]].merge(acc);
+        overall.merge(acc);
+    }
+    for (size_t z = 0; z < zones.size(); ++z) sweep.zones[z].error = zoneErrors[z].stats();
+    sweep.overall = overall.stats();
+    sweep.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return sweep;
+}
+
+void sweepErrorEllipse(const SweepCorner& corner, double& major, double& minor, double& angleDeg)
+{
+    double a = corner.covariance[0], b = corner.covariance[1], c = corner.covariance[2];
+    double middle = 0.5 * (a + c), radius = std::sqrt(0.25 * (a - c) * (a - c) + b * b);
+    major = std::sqrt(kChiSquare95 * std::max(0.0, middle + radius));
+    minor = std::sqrt(kChiSquare95 * std::max(0.0, middle - radius));
+    angleDeg = 0.5 * std::atan2(2.0 * b, a - c) * 180.0 / kPi;
+}
+
+void writeSweepJson(const std::string& path, const ExtrinsicsSweep& sweep)
+{
+    const SweepOptions& options = sweep.options;
+    std::ofstream out(path.c_str());
+    out << std::setprecision(9);
+    out << "{\n  \"translation_mm\": " << options.translationMm << ",\n"
+        << "  \"rotation_deg\": " << options.rotationDeg << ",\n"
+        << "  \"sampling\": \"" << (options.sampling == SweepGrid ? "grid" : "random") << "\",\n";
+    if (options.sampling == SweepGrid) out << "  \"grid_steps\": " << options.gridSteps << ",\n";
+    else out << "  \"seed\": " << options.seed << ",\n";
+    out << "  \"poses\": " << sweep.poses << ",\n"
+        << "  \"seconds\": " << sweep.seconds << ",\n"
+        << "  \"overall\": ";
+    writeStats(out, sweep.overall);
+
+    out << ",\n  \"zones\": [";
+    for (size_t i = 0; i < sweep.zones.size(); ++i) {
+        const SweepZone& zone = sweep.zones[i];
+        out << (i ? ",\n" : "\n") << "    {\"id\": " << zone.id << ", \"degenerate\": " << (zone.degenerate ? "true" : "false")
+            << ", \"corners_in_image\": " << zone.corners << ", \"error\": ";
+        writeStats(out, zone.error);
+        out << "}";
+    }
+    out << "\n  ],\n  \"corners\": [";
+    for (size_t i = 0; i < sweep.corners.size(); ++i) {
+        const SweepCorner& corner = sweep.corners[i];
+        double major, minor, angle;
+        sweepErrorEllipse(corner, major, minor, angle);
+        out << (i ? ",\n" : "\n") << "    {\"zone\": " << corner.zoneId << ", \"corner\": " << corner.corner
+            << ", \"position_m\": [" << corner.position.x() << ", " << corner.position.y() << ", " << corner.position.z()
+            << "], \"pixel\": [" << corner.pixel.x() << ", " << corner.pixel.y() << "], \"error\": ";
+        writeStats(out, corner.error);
+        out << ", \"mean_offset_px\": [" << corner.meanOffset.x() << ", " << corner.meanOffset.y()
+            << "], \"covariance_px2\": [" << corner.covariance[0] << ", " << corner.covariance[1] << ", "
+            << corner.covariance[2] << "], \"ellipse_95\": {\"major_px\": " << major << ", \"minor_px\": " << minor
+            << ", \"angle_deg\": " << angle << "}, \"behind_camera\": " << corner.behindCamera << "}";
+    }
+    out << "\n  ]\n}\n";
+    if (!out) throw std::runtime_error("Cannot write " + path);
+}
+
+osg::ref_ptr<osg::Node> createSweepEllipses(const ExtrinsicsSweep& sweep, const CameraModel& camera,
+                                            const std::vector<ViewingZone>& zones, float magnify,
+                                            float metersToMmScale)
+{
+    const int segments = 48;
+    std::map<int, osg::Vec4> zoneColors;
+    for (const auto& zone : zones) zoneColors[zone.id] = osg::Vec4(zone.color.r(), zone.color.g(), zone.color.b(), 1.0f);
+
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    for (const SweepCorner& corner : sweep.corners) {
+        if (!corner.error.count) continue;
+        double major, minor, angle;
+        sweepErrorEllipse(corner, major, minor, angle);
+        angle *= kPi / 180.0;
+
+        // Pixels per meter of a sideways move of the corner at its depth (numerically,
+        // distortion included), inverted to carry pixel offsets into that plane
+        osg::Vec3d q = camera.carToCamera(corner.position);
+        double h = 1e-4 * q.z();
+        osg::Vec2d p0 = camera.distort(q.x() / q.z(), q.y() / q.z());
+        osg::Vec2d px = (camera.distort((q.x() + h) / q.z(), q.y() / q.z()) - p0) / h;
+        osg::Vec2d py = (camera.distort(q.x() / q.z(), (q.y() + h) / q.z()) - p0) / h;
+        double det = px.x() * py.y() - py.x() * px.y();
+        if (std::fabs(det) < 1e-12) continue;
+
+        GLint first = static_cast<GLint>(vertices->size());
+        for (int i = 0; i < segments; ++i) {
+            double phi = 2.0 * kPi * i / segments;
+            double a = major * std::cos(phi), b = minor * std::sin(phi);
+            double du = corner.meanOffset.x() + a * std::cos(angle) - b * std::sin(angle);
+            double dv = corner.meanOffset.y() + a * std::sin(angle) + b * std::cos(angle);
+            double dx = magnify * (py.y() * du - py.x() * dv) / det, dy = magnify * (px.x() * dv - px.y() * du) / det;
+            vertices->push_back(osg::Vec3(camera.cameraToCar(q + osg::Vec3d(dx, dy, 0.0))));
+            colors->push_back(zoneColors.count(corner.zoneId) ? zoneColors[corner.zoneId] : osg::Vec4(1, 1, 1, 1));
+        }
+        geometry->addPrimitiveSet(new osg::DrawArrays(GL_LINE_LOOP, first, segments));
+    }
+    geometry->setVertexArray(vertices.get());
+    geometry->setColorArray(colors.get(), osg::Array::BIND_PER_VERTEX);
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+    osg::StateSet* state = geode->getOrCreateStateSet();
+    state->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    state->setAttributeAndModes(new osg::LineWidth(2.0f));
+
+    osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform;
+    transform->setMatrix(osg::Matrix::scale(metersToMmScale, metersToMmScale, metersToMmScale));
+    transform->setName("sweep ellipses");
+    transform->addChild(geode.get());
+    return transform;
+}
+
+namespace {
+
+void printSweepUsage()
+{
+    std::cout << "Usage: visual sweep [model <name>] [--calibration <calibraton.json>] [--viewtarget <file>]" << std::endl;
+    std::cout << "                    [--translation <mm>] [--rotation <deg>] [--grid N | --random N] [--seed S]" << std::endl;
+    std::cout << "                    [--jobs N] [-o <sweep.json>]" << std::endl;
+    std::cout << "  Moves the calibrated camera by up to +-translation (default 2 mm) along X, Y and Z and" << std::endl;
+    std::cout << "  turns it by up to +-rotation (default 0.2 deg) in yaw, pitch and roll, over a grid of N" << std::endl;
+    std::cout << "  values per axis (default 5, N^6 poses) or N random poses, on all cores (--jobs N threads)." << std::endl;
+    std::cout << "  Every zone corner inside the image is reprojected through the intrinsics and distortion;" << std::endl;
+    std::cout << "  prints the min/mean/p95/max pixel error per zone. -o also writes each corner's statistics" << std::endl;
+    std::cout << "  and 95% error ellipse as JSON." << std::endl;
+}
+
+void printStats(const SweepErrorStats& stats)
+{
+    std::cout << std::setw(10) << stats.min << std::setw(10) << stats.mean << std::setw(10) << stats.p95
+              << std::setw(10) << stats.max << std::endl;
+}
+
+} // namespace
+
+int runSweepCommand(int argc, char** argv)
+{
+    std::string carModelName = "Sharan";
+    std::string calibrationPath, viewTargetPath, outputPath;
+    SweepOptions options;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "model" && i + 1 < argc) carModelName = argv[++i];
+        else if (arg == "--calibration" && i + 1 < argc) calibrationPath = argv[++i];
+        else if (arg == "--viewtarget" && i + 1 < argc) viewTargetPath = argv[++i];
+        else if (arg == "--translation" && i + 1 < argc) options.translationMm = std::atof(argv[++i]);
+        else if (arg == "--rotation" && i + 1 < argc) options.rotationDeg = std::atof(argv[++i]);
+        else if (arg == "--grid" && i + 1 < argc) {
+            options.sampling = SweepGrid;
+            options.gridSteps = std::atoi(argv[++i]);
+        }
+        else if (arg == "--random" && i + 1 < argc) {
+            options.sampling = SweepRandom;
+            options.samples = static_cast<uint64_t>(std::strtod(argv[++i], nullptr));
+        }
+        else if (arg == "--seed" && i + 1 < argc) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--jobs" && i + 1 < argc) options.threads = std::atoi(argv[++i]);
+        else if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--help" || arg == "-h") { printSweepUsage(); return 0; }
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printSweepUsage();
+            return 1;
+        }
+    }
+
+    ExtrinsicsSweep sweep;
+    try {
+        std::string configPath = "carmodels/" + carModelName + "/config";
+        CameraModel camera(parseCalibrationFile(calibrationPath.empty() ? configPath + "/calibraton.json" : calibrationPath));
+        std::vector<ViewingZone> zones;
+        if (!viewTargetPath.empty()) {
+            std::vector<std::string> warnings;
+            zones = parseViewTargetFile(viewTargetPath, &warnings);
+            for (const auto& warning : warnings) std::cerr << "Warning: " << warning << std::endl;
+        } else {
+            zones = parseViewingZonesFile(configPath + "/viewingzones.json");
+        }
+        sweep = computeExtrinsicsSweep(camera, zones, options);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    unsigned threads = options.threads ? options.threads : workerCount();
+    std::cout << "Extrinsics sweep: +-" << options.translationMm << " mm, +-" << options.rotationDeg << " deg, ";
+    if (options.sampling == SweepGrid) std::cout << options.gridSteps << " steps per axis (" << sweep.poses << " poses)";
+    else std::cout << sweep.poses << " random poses (seed " << options.seed << ")";
+    std::cout << std::endl;
+    std::cout << sweep.corners.size() << " zone corners in the image, " << sweep.poses * sweep.corners.size()
+              << " reprojections on " << threads << " thread(s) in " << std::fixed << std::setprecision(3)
+              << sweep.seconds << " s (" << std::setprecision(1)
+              << sweep.poses * sweep.corners.size() / std::max(sweep.seconds, 1e-9) / 1e6 << " M/s)" << std::endl;
+
+    std::cout << std::setw(8) << "zone" << std::setw(9) << "corners" << std::setw(10) << "min px" << std::setw(10)
+              << "mean px" << std::setw(10) << "p95 px" << std::setw(10) << "max px" << std::endl;
+    std::cout << std::setprecision(3);
+    for (const SweepZone& zone : sweep.zones) {
+        std::cout << std::setw(8) << zone.id << std::setw(9) << zone.corners;
+        if (zone.degenerate) std::cout << "    ignored (degenerate)" << std::endl;
+        else if (zone.error.count) printStats(zone.error);
+        else std::cout << "    not in view" << std::endl;
+    }
+    if (sweep.overall.count) {
+        std::cout << std::setw(17) << "all";
+        printStats(sweep.overall);
+    }
+
+    const SweepCorner* worst = nullptr;
+    uint64_t behindCamera = 0;
+    for (const SweepCorner& corner : sweep.corners) {
+        behindCamera += corner.behindCamera;
+        if (corner.error.count && (!worst || corner.error.max > worst->error.max)) worst = &corner;
+    }
+    if (worst) {
+        double major, minor, angle;
+        sweepErrorEllipse(*worst, major, minor, angle);
+        std::cout << "Most sensitive: zone " << worst->zoneId << " corner " << worst->corner << " at pixel ("
+                  << std::setprecision(1) << worst->pixel.x() << ", " << worst->pixel.y() << "), up to "
+                  << worst->error.max << " px, 95% ellipse " << major << " x " << minor << " px at " << angle
+                  << " deg" << std::endl;
+    }
+    if (behindCamera) std::cout << "Warning: " << behindCamera << " reprojections fell behind the camera" << std::endl;
+
+    if (!outputPath.empty()) {
+        try {
+            writeSweepJson(outputPath, sweep);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << outputPath << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef EXTRINSICS_SWEEP_H
+#define EXTRINSICS_SWEEP_H
+
+#include "camera_projection.h"
+#include "config_loader.h"
+
+#include <osg/Node>
+#include <osg/Vec2d>
+#include <osg/Vec3d>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Sensitivity of the zone reprojection to extrinsics errors: the camera is moved by up to
+// +-translation along the carCoord axes and turned by up to +-rotation in yaw, pitch and
+// roll (perturbCamera), every zone corner that the calibrated camera sees is reprojected
+// through the intrinsics and the distortion, and the pixel distance to its calibrated
+// reprojection is collected per corner and per zone.
+//
+// Poses are either the full grid of `gridSteps` values per axis (gridSteps^6 poses,
+// the calibrated pose included for odd step counts) or uniform random poses in the box,
+// each drawn from a stream seeded by the seed and the pose index only. Poses are split
+// across threads; each thread collects into its own accumulators, merged at the end.
+
+enum SweepSampling {
+    SweepGrid,
+    SweepRandom
+};
+
+struct SweepOptions {
+    double translationMm = 2.0;  // +- along X, Y and Z
+    double rotationDeg = 0.2;    // +- yaw, pitch and roll
+    SweepSampling sampling = SweepGrid;
+    int gridSteps = 5;           // values per axis (2 - 15)
+    uint64_t samples = 100000;   // random poses
+    uint64_t seed = 1;
+    unsigned threads = 0;        // 0 = workerCount()
+};
+
+// Pixel error distribution. p95 comes from a log histogram (32 bins per octave), so it is
+// within 1.1% of the exact percentile; the others are exact.
+struct SweepErrorStats {
+    uint64_t count = 0;
+    double min = 0.0, mean = 0.0, p95 = 0.0, max = 0.0;
+};
+
+struct SweepCorner {
+    int zoneId, corner;
+    osg::Vec3d position;  // carCoord, meters
+    osg::Vec2d pixel;     // calibrated reprojection
+    SweepErrorStats error;
+    osg::Vec2d meanOffset;   // mean (du, dv), pixels
+    double covariance[3];    // of (du, dv): uu, uv, vv (pixels^2)
+    uint64_t behindCamera;   // poses that moved the corner behind the camera
+};
+
+struct SweepZone {
+    int id;
+    bool degenerate;  // all-zero corners (isZoneDegenerate): ignored, no corners
+    size_t corners;   // corners inside the calibrated image
+    SweepErrorStats error;
+};
+
+struct ExtrinsicsSweep {
+    SweepOptions options;
+    uint64_t poses = 0;
+    std::vector<SweepZone> zones;      // every zone, in file order
+    std::vector<SweepCorner> corners;  // only corners inside the calibrated frustum and image
+    SweepErrorStats overall;
+    double seconds = 0.0;
+};
+
+// Throws std::runtime_error for invalid options
+ExtrinsicsSweep computeExtrinsicsSweep(const CameraModel& camera, const std::vector<ViewingZone>& zones,
+                                       const SweepOptions& options);
+
+// Half-axes (pixels) and angle (degrees from the u axis) of a corner's 95% error ellipse,
+// from its covariance as if the offsets were normally distributed
+void sweepErrorEllipse(const SweepCorner& corner, double& major, double& minor, double& angleDeg);
+
+// Options, per-zone statistics and per-corner statistics with their error ellipses.
+// Throws std::runtime_error if the file cannot be written.
+void writeSweepJson(const std::string& path, const ExtrinsicsSweep& sweep);
+
+// Each corner's 95% ellipse carried back into carCoord: drawn around the corner, in the plane
+// at its depth facing the camera, so that it projects onto the pixel ellipse (`magnify`
+// times enlarged, since a few pixels are only millimeters at the zones). Lines in the
+// colour of the zone, scaled like the zones.
+osg::ref_ptr<osg::Node> createSweepEllipses(const ExtrinsicsSweep& sweep, const CameraModel& camera,
+                                            const std::vector<ViewingZone>& zones, float magnify,
+                                            float metersToMmScale);
+
+// `visual sweep [model <name>] ...` - reprojection error of the zones under extrinsics tolerances
+int runSweepCommand(int argc, char** argv);
+
+#endif
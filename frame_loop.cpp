@@ -0,0 +1,230 @@
+#include "frame_loop.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <time.h>
+
+namespace {
+
+// Idle checks poll the window system and the wake sources; 100 per second keeps the added
+// latency at 10 ms and costs well under 1% of a core
+const double kIdlePollSeconds = 0.01;
+
+// Frame time and latency histograms: 0.25 ms bins up to 1 s, longer times in the last bin
+const double kHistogramBinSeconds = 0.00025;
+const size_t kHistogramBins = 4000;
+
+struct ThreadingName {
+    const char* name;
+    osgViewer::ViewerBase::ThreadingModel model;
+};
+
+const ThreadingName kThreadingNames[] = {
+    {"single", osgViewer::ViewerBase::SingleThreaded},
+    {"cull-draw", osgViewer::ViewerBase::CullDrawThreadPerContext},
+    {"draw", osgViewer::ViewerBase::DrawThreadPerContext},
+    {"cull-per-camera", osgViewer::ViewerBase::CullThreadPerCameraDrawThreadPerContext},
+    {"auto", osgViewer::ViewerBase::AutomaticSelection},
+};
+
+double wallSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// All threads of the process: the draw threads and the loaders as well as the main loop
+double processCpuSeconds()
+{
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) return 0.0;
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void addToHistogram(std::vector<uint32_t>& histogram, double seconds)
+{
+    size_t bin = static_cast<size_t>(std::max(0.0, seconds) / kHistogramBinSeconds);
+    ++histogram[std::min(bin, kHistogramBins - 1)];
+}
+
+// Upper edge of the bin holding the q-quantile, but at most the maximum, in milliseconds
+double histogramQuantileMs(const std::vector<uint32_t>& histogram, double q, double maxSeconds)
+{
+    uint64_t count = 0;
+    for (uint32_t n : histogram) count += n;
+    uint64_t rank = static_cast<uint64_t>(q * count), seen = 0;
+    for (size_t bin = 0; bin < histogram.size(); ++bin) {
+        seen += histogram[bin];
+        if (seen > rank) return std::min((bin + 1) * kHistogramBinSeconds, maxSeconds) * 1000.0;
+    }
+    return 0.0;
+}
+
+double percent(double part, double whole)
+{
+    return whole > 0.0 ? 100.0 * part / whole : 0.0;
+}
+
+} // namespace
+
+FrameLoop::Counters::Counters()
+{
+    reset();
+}
+
+void FrameLoop::Counters::reset()
+{
+    wallSeconds = cpuSeconds = idleWallSeconds = idleCpuSeconds = 0.0;
+    maxFrameTime = maxLatency = 0.0;
+    frames = idleChecks = 0;
+    std::fill(wakes.begin(), wakes.end(), 0);
+    frameTimes.assign(kHistogramBins, 0);
+    latencies.assign(kHistogramBins, 0);
+}
+
+FrameLoop::FrameLoop(osgViewer::ViewerBase& viewer, bool onDemand, double maxFrameRate)
+    : viewer_(viewer), onDemand_(onDemand), maxFrameRate_(maxFrameRate), reportInterval_(0.0)
+{
+    // Window events, and redraws the handlers and the camera manipulator request
+    addWakeSource("input", [this]() { return viewer_.checkNeedToDoFrame(); });
+}
+
+void FrameLoop::addWakeSource(const std::string& name, std::function<bool()> needsFrame)
+{
+    names_.push_back(name);
+    sources_.push_back(needsFrame);
+    total_.wakes.push_back(0);
+    interval_.wakes.push_back(0);
+}
+
+int FrameLoop::wakeSource()
+{
+    for (size_t i = 0; i < sources_.size(); ++i) {
+        if (sources_[i]()) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+int FrameLoop::run()
+{
+    if (!viewer_.isRealized()) viewer_.realize();
+    total_.reset();
+    interval_.reset();
+    Counters* counters[] = {&total_, &interval_};
+
+    const double minFrameTime = maxFrameRate_ > 0.0 ? 1.0 / maxFrameRate_ : 0.0;
+    double lastWall = wallSeconds(), lastCpu = processCpuSeconds();
+    double lastCheck = lastWall, lastFrameStart = lastWall - minFrameTime, reportStart = lastWall;
+    bool first = true, idleBefore = false;
+    while (!viewer_.done()) {
+        double check = wallSeconds();
+        int source = -1;
+        bool draw = first || !onDemand_ || (source = wakeSource()) >= 0;
+        if (draw) {
+            double wait = lastFrameStart + minFrameTime - wallSeconds();
+            if (wait > 0.0) std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+            double start = wallSeconds();
+            viewer_.frame();
+            double end = wallSeconds();
+            for (Counters* c : counters) {
+                ++c->frames;
+                if (source >= 0) ++c->wakes[source];
+                addToHistogram(c->frameTimes, end - start);
+                c->maxFrameTime = std::max(c->maxFrameTime, end - start);
+                if (!first) {
+                    // Whatever triggered this frame was not there at the previous check
+                    addToHistogram(c->latencies, end - lastCheck);
+                    c->maxLatency = std::max(c->maxLatency, end - lastCheck);
+                }
+            }
+            lastFrameStart = start;
+            first = false;
+        } else {
+            std::this_thread::sleep_for(std::chrono::duration<double>(kIdlePollSeconds));
+        }
+        lastCheck = check;
+
+        // The check right after a frame still pays for its draw threads, so it is not idle
+        double wall = wallSeconds(), cpu = processCpuSeconds();
+        for (Counters* c : counters) {
+            c->wallSeconds += wall - lastWall;
+            c->cpuSeconds += cpu - lastCpu;
+            if (!draw && idleBefore) {
+                ++c->idleChecks;
+                c->idleWallSeconds += wall - lastWall;
+                c->idleCpuSeconds += cpu - lastCpu;
+            }
+        }
+        idleBefore = !draw;
+        lastWall = wall;
+        lastCpu = cpu;
+
+        if (reportInterval_ > 0.0 && wall - reportStart >= reportInterval_) {
+            print(interval_, "last interval");
+            interval_.reset();
+            reportStart = wall;
+        }
+    }
+    return 0;
+}
+
+void FrameLoop::printReport() const
+{
+    print(total_, "session");
+}
+
+void FrameLoop::print(const Counters& c, const char* period) const
+{
+    std::cout << "Frame loop (" << (onDemand_ ? "on demand" : "continuous") << ", "
+              << threadingModelName(viewer_.getThreadingModel()) << " threading";
+    if (maxFrameRate_ > 0.0) std::cout << ", max " << maxFrameRate_ << " fps";
+    std::cout << "), " << period << ": " << c.frames << " frames in " << std::fixed << std::setprecision(1)
+              << c.wallSeconds << " s (" << std::setprecision(2) << (c.wallSeconds > 0.0 ? c.frames / c.wallSeconds : 0.0)
+              << "/s)";
+    if (onDemand_) {
+        std::cout << "; woken by";
+        for (size_t i = 0; i < names_.size(); ++i) std::cout << (i ? ", " : " ") << names_[i] << " " << c.wakes[i];
+    }
+    std::cout << std::endl;
+    if (c.frames > 0) {
+        std::cout << std::setprecision(1) << "  frame time p50 " << histogramQuantileMs(c.frameTimes, 0.5, c.maxFrameTime)
+                  << " ms, p95 " << histogramQuantileMs(c.frameTimes, 0.95, c.maxFrameTime) << " ms, max "
+                  << c.maxFrameTime * 1000.0 << " ms";
+        if (c.maxLatency > 0.0) {
+            std::cout << "; latency p50 " << histogramQuantileMs(c.latencies, 0.5, c.maxLatency) << " ms, p95 "
+                      << histogramQuantileMs(c.latencies, 0.95, c.maxLatency) << " ms, max " << c.maxLatency * 1000.0 << " ms";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << std::setprecision(2) << "  CPU " << percent(c.cpuSeconds, c.wallSeconds) << "% of a core overall";
+    if (c.idleChecks > 0) {
+        std::cout << ", " << percent(c.idleCpuSeconds, c.idleWallSeconds) << "% while idle ("
+                  << std::setprecision(1) << c.idleWallSeconds << " s)";
+    }
+    double busyWall = c.wallSeconds - c.idleWallSeconds;
+    if (c.frames > 0 && busyWall > 0.0) {
+        std::cout << std::setprecision(2) << ", " << percent(c.cpuSeconds - c.idleCpuSeconds, busyWall) << "% while drawing";
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
+
+bool parseThreadingModel(const std::string& name, osgViewer::ViewerBase::ThreadingModel& model)
+{
+    for (const ThreadingName& entry : kThreadingNames) {
+        if (name == entry.name) {
+            model = entry.model;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* threadingModelName(osgViewer::ViewerBase::ThreadingModel model)
+{
+    for (const ThreadingName& entry : kThreadingNames) {
+        if (model == entry.model) return entry.name;
+    }
+    return "unknown";
+}
@@ -0,0 +1,66 @@
+#ifndef FRAME_LOOP_H
+#define FRAME_LOOP_H
+
+#include <osgViewer/ViewerBase>
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// The viewer's main loop, in place of ViewerBase::run(). Continuously, frames are drawn back
+// to back. On demand, a frame is drawn only when the viewer has input or a redraw request
+// (checkNeedToDoFrame) or a wake source has something new to show; in between, the loop
+// checks every kIdlePollSeconds and sleeps. A frame rate cap applies to both.
+//
+// The loop reports what the session cost: frames and what woke them, frame times, the
+// latency from the last check that found nothing to the end of the frame it triggered (an
+// upper bound on event-to-frame latency), and process CPU time while idle and while drawing.
+class FrameLoop {
+public:
+    // maxFrameRate = 0: no cap
+    FrameLoop(osgViewer::ViewerBase& viewer, bool onDemand, double maxFrameRate = 0.0);
+
+    // On demand: polled on the main thread before each frame and at every idle check, in the
+    // order added; returns true when there is something to draw. The name is for the report.
+    void addWakeSource(const std::string& name, std::function<bool()> needsFrame);
+
+    // Also print the report every `seconds` (for that interval); 0 = only printReport()
+    void setReportInterval(double seconds) { reportInterval_ = seconds; }
+
+    // Realizes the viewer if needed and draws frames until it is done; returns 0
+    int run();
+
+    // Totals since run() started
+    void printReport() const;
+
+private:
+    struct Counters {
+        Counters();
+        void reset();
+
+        double wallSeconds, cpuSeconds;
+        double idleWallSeconds, idleCpuSeconds;  // checks with no frame, after the first
+        double maxFrameTime, maxLatency;
+        uint64_t frames, idleChecks;
+        std::vector<uint64_t> wakes;  // frames per wake source
+        std::vector<uint32_t> frameTimes, latencies;  // histograms, kHistogramBinSeconds per bin
+    };
+
+    int wakeSource();  // index of the first source that needs a frame, -1 if none
+    void print(const Counters& counters, const char* period) const;
+
+    osgViewer::ViewerBase& viewer_;
+    bool onDemand_;
+    double maxFrameRate_;
+    double reportInterval_;
+    std::vector<std::string> names_;
+    std::vector<std::function<bool()> > sources_;
+    Counters total_, interval_;
+};
+
+// --threading names: "single", "cull-draw", "draw", "cull-per-camera", "auto".
+// Returns false for any other name.
+bool parseThreadingModel(const std::string& name, osgViewer::ViewerBase::ThreadingModel& model);
+const char* threadingModelName(osgViewer::ViewerBase::ThreadingModel model);
+
+#endif
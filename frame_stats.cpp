@@ -0,0 +1,169 @@
+#include "frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <osg/Camera>
+#include <osg/FrameStamp>
+#include <osg/Stats>
+
+namespace {
+
+// Cull and draw of a frame can still be running (threaded models) a couple of frames later
+const unsigned kFrameLag = 2;
+
+double statOrNaN(const osg::Stats* stats, unsigned frame, const char* name, double scale)
+{
+    double value = 0.0;
+    if (stats && stats->getAttribute(frame, name, value)) return value * scale;
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+// Sum over all cameras; NaN only if no camera has the attribute
+double cameraSum(const osgViewer::ViewerBase::Cameras& cameras, unsigned frame, const char* name)
+{
+    double total = std::numeric_limits<double>::quiet_NaN();
+    for (osg::Camera* camera : cameras) {
+        double value = statOrNaN(camera->getStats(), frame, name, 1000.0);
+        if (!std::isnan(value)) total = std::isnan(total) ? value : total + value;
+    }
+    return total;
+}
+
+bool endsWith(const std::string& s, const std::string& suffix)
+{
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+FrameStatsRecorder::FrameStatsRecorder(osgViewer::ViewerBase& viewer, unsigned maxFrames)
+    : viewer_(viewer), maxFrames_(maxFrames)
+{
+    frames_.reserve(maxFrames > 0 ? maxFrames : 4096);
+}
+
+void FrameStatsRecorder::setCollecting(bool collecting)
+{
+    if (osg::Stats* stats = viewer_.getViewerStats()) {
+        stats->collectStats("frame_rate", collecting);
+        stats->collectStats("event", collecting);
+        stats->collectStats("update", collecting);
+    }
+    osgViewer::ViewerBase::Cameras cameras;
+    viewer_.getCameras(cameras);
+    for (osg::Camera* camera : cameras) {
+        if (osg::Stats* stats = camera->getStats()) {
+            stats->collectStats("rendering", collecting);
+            stats->collectStats("gpu", collecting);
+        }
+    }
+    collecting_ = collecting;
+}
+
+bool FrameStatsRecorder::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter&)
+{
+    if (ea.getEventType() != osgGA::GUIEventAdapter::FRAME || done_) return false;
+    const osg::FrameStamp* frameStamp = viewer_.getViewerFrameStamp();
+    if (!frameStamp) return false;
+    unsigned frame = frameStamp->getFrameNumber();
+
+    // Cameras and their stats only exist once the viewer is realized, so start here
+    if (!collecting_) {
+        setCollecting(true);
+        nextFrame_ = frame + 1;
+        return false;
+    }
+    if (frame >= nextFrame_ + kFrameLag) harvest(frame - kFrameLag);
+    return false;
+}
+
+void FrameStatsRecorder::finish()
+{
+    if (done_ || !collecting_) return;
+    if (osg::Stats* stats = viewer_.getViewerStats()) harvest(stats->getLatestFrameNumber());
+    setCollecting(false);
+    done_ = true;
+}
+
+void FrameStatsRecorder::harvest(unsigned lastFrame)
+{
+    const osg::Stats* stats = viewer_.getViewerStats();
+    if (!stats) return;
+    osgViewer::ViewerBase::Cameras cameras;
+    viewer_.getCameras(cameras);
+
+    // Frames that already dropped out of the history are lost; skip ahead
+    unsigned first = std::max(nextFrame_, stats->getEarliestFrameNumber());
+    for (unsigned frame = first; frame <= lastFrame; ++frame) {
+        double referenceTime = 0.0;
+        if (!stats->getAttribute(frame, "Reference time", referenceTime)) continue;
+        FrameTimes times;
+        times.frame = frame;
+        times.referenceTime = referenceTime;
+        times.frameDuration = statOrNaN(stats, frame, "Frame duration", 1000.0);
+        times.event = statOrNaN(stats, frame, "Event traversal time taken", 1000.0);
+        times.update = statOrNaN(stats, frame, "Update traversal time taken", 1000.0);
+        times.cull = cameraSum(cameras, frame, "Cull traversal time taken");
+        times.draw = cameraSum(cameras, frame, "Draw traversal time taken");
+        times.gpu = cameraSum(cameras, frame, "GPU draw time taken");
+        frames_.push_back(times);
+
+        if (maxFrames_ > 0 && frames_.size() >= maxFrames_) {
+            setCollecting(false);
+            done_ = true;
+            std::cout << "Recorded frame statistics for " << frames_.size() << " frames" << std::endl;
+            break;
+        }
+    }
+    nextFrame_ = std::max(nextFrame_, lastFrame + 1);
+}
+
+bool FrameStatsRecorder::write(const std::string& path) const
+{
+    const bool json = endsWith(path, ".json");
+    std::ofstream out(path.c_str());
+    out << std::fixed << std::setprecision(3);
+
+    auto number = [&](double value) -> std::ostream& {
+        if (std::isnan(value)) return out << (json ? "null" : "");
+        return out << value;
+    };
+
+    if (json) {
+        out << "{\"units\": \"ms\", \"frames\": [";
+        for (size_t i = 0; i < frames_.size(); ++i) {
+            const FrameTimes& f = frames_[i];
+            out << (i ? ",\n" : "\n") << "  {\"frame\": " << f.frame << ", \"reference_time_s\": " << std::setprecision(6)
+                << f.referenceTime << std::setprecision(3) << ", \"frame_duration\": ";
+            number(f.frameDuration) << ", \"event\": ";
+            number(f.event) << ", \"update\": ";
+            number(f.update) << ", \"cull\": ";
+            number(f.cull) << ", \"draw\": ";
+            number(f.draw) << ", \"gpu\": ";
+            number(f.gpu) << "}";
+        }
+        out << "\n]}\n";
+    } else {
+        out << "frame,reference_time_s,frame_duration_ms,event_ms,update_ms,cull_ms,draw_ms,gpu_ms\n";
+        for (const FrameTimes& f : frames_) {
+            out << f.frame << "," << std::setprecision(6) << f.referenceTime << std::setprecision(3) << ",";
+            number(f.frameDuration) << ",";
+            number(f.event) << ",";
+            number(f.update) << ",";
+            number(f.cull) << ",";
+            number(f.draw) << ",";
+            number(f.gpu) << "\n";
+        }
+    }
+
+    if (!out) {
+        std::cerr << "Error: Cannot write frame statistics " << path << std::endl;
+        return false;
+    }
+    std::cout << "Wrote frame statistics " << path << " (" << frames_.size() << " frames)" << std::endl;
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <osgGA/GUIEventHandler>
+#include <osgViewer/ViewerBase>
+#include <string>
+#include <vector>
+
+// Copies per-frame timings out of osgViewer's Stats (the numbers behind the 'S' overlay)
+// into a table that is written as CSV or JSON when the viewer exits. Stats collection is
+// only switched on while a recorder is installed and still has frames to record.
+class FrameStatsRecorder : public osgGA::GUIEventHandler {
+public:
+    // maxFrames = 0 records until the viewer exits
+    FrameStatsRecorder(osgViewer::ViewerBase& viewer, unsigned maxFrames = 0);
+
+    virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa);
+
+    // Collect the frames still held in the stats history and stop collecting
+    void finish();
+
+    // CSV unless the path ends in .json. Returns false (after printing an error) on failure.
+    bool write(const std::string& path) const;
+
+    size_t frameCount() const { return frames_.size(); }
+
+private:
+    // Times in milliseconds; NaN where the stats have no value (e.g. no GPU timer queries)
+    struct FrameTimes {
+        unsigned frame;
+        double referenceTime;  // seconds since the viewer started
+        double frameDuration, event, update, cull, draw, gpu;
+    };
+
+    void setCollecting(bool collecting);
+    void harvest(unsigned lastFrame);
+
+    osgViewer::ViewerBase& viewer_;
+    unsigned maxFrames_;
+    bool collecting_ = false;
+    bool done_ = false;
+    unsigned nextFrame_ = 0;  // first frame not yet copied
+    std::vector<FrameTimes> frames_;
+};
+
+#endif
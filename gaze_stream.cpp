@@ -0,0 +1,429 @@
+#include "gaze_stream.h"
+#include "csv_util.h"
+
+#include <osg/LineWidth>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kReadBufferSize = 64 * 1024;
+
+std::runtime_error sourceError(const std::string& source, const char* what)
+{
+    return std::runtime_error("Cannot open gaze source " + source + ": " + what + " (" + std::strerror(errno) + ")");
+}
+
+sockaddr_un makeSocketAddress(const std::string& path)
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+} // namespace
+
+GazeStream::GazeStream(size_t capacity)
+    : ring_(capacity), kind_(File), fd_(-1), listenFd_(-1), replayRate_(0.0), replayed_(0),
+      stop_(false), finished_(false), received_(0), dropped_(0), late_(0), parseErrors_(0)
+{
+}
+
+GazeStream::~GazeStream()
+{
+    stop();
+}
+
+void GazeStream::start(const std::string& source, double replayRate)
+{
+    stop();
+    source_ = source;
+    replayRate_ = replayRate;
+    replayed_ = 0;
+
+    if (source == "-") {
+        kind_ = Stdin;
+        fd_ = STDIN_FILENO;
+    } else if (source.compare(0, 5, "unix:") == 0) {
+        kind_ = SocketServer;
+        socketPath_ = source.substr(5);
+        sockaddr_un address = makeSocketAddress(socketPath_);
+        listenFd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd_ < 0) throw sourceError(source, "socket");
+        unlink(socketPath_.c_str());  // left over from an earlier run
+        if (bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd_, 1) != 0) {
+            close(listenFd_);
+            listenFd_ = -1;
+            throw sourceError(source, "bind");
+        }
+    } else {
+        struct stat info;
+        if (stat(source.c_str(), &info) != 0) throw sourceError(source, "stat");
+        if (S_ISSOCK(info.st_mode)) {
+            kind_ = SocketClient;
+            sockaddr_un address = makeSocketAddress(source);
+            fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd_ < 0) throw sourceError(source, "socket");
+            if (connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+                close(fd_);
+                fd_ = -1;
+                throw sourceError(source, "connect");
+            }
+        } else if (S_ISFIFO(info.st_mode)) {
+            // Opened read-write so the FIFO always has a writer: the open does not block, and
+            // a tracker closing its end does not turn into an endless stream of EOFs
+            kind_ = Fifo;
+            fd_ = open(source.c_str(), O_RDWR);
+            if (fd_ < 0) throw sourceError(source, "open");
+        } else {
+            kind_ = File;
+            fd_ = open(source.c_str(), O_RDONLY);
+            if (fd_ < 0) throw sourceError(source, "open");
+        }
+    }
+
+    buffer_.resize(kReadBufferSize);
+    stop_ = false;
+    finished_ = false;
+    start_ = std::chrono::steady_clock::now();
+    thread_ = std::thread(&GazeStream::run, this);
+}
+
+void GazeStream::stop()
+{
+    stop_ = true;
+    if (thread_.joinable()) thread_.join();
+    closeInput();
+    if (listenFd_ >= 0) {
+        close(listenFd_);
+        listenFd_ = -1;
+        unlink(socketPath_.c_str());
+    }
+}
+
+double GazeStream::now() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+}
+
+GazeStream::Counters GazeStream::counters() const
+{
+    Counters counters;
+    counters.received = received_.load(std::memory_order_relaxed);
+    counters.dropped = dropped_.load(std::memory_order_relaxed);
+    counters.late = late_.load(std::memory_order_relaxed);
+    counters.parseErrors = parseErrors_.load(std::memory_order_relaxed);
+    return counters;
+}
+
+void GazeStream::closeInput()
+{
+    if (fd_ >= 0 && fd_ != STDIN_FILENO) close(fd_);
+    fd_ = -1;
+}
+
+// Waits up to 100 ms so stop() is noticed while the source is idle
+bool GazeStream::waitReadable(int fd)
+{
+    pollfd entry;
+    entry.fd = fd;
+    entry.events = POLLIN;
+    entry.revents = 0;
+    return poll(&entry, 1, 100) > 0;
+}
+
+void GazeStream::run()
+{
+    char* buffer = buffer_.data();
+    size_t used = 0;
+
+    while (!stop_.load(std::memory_order_relaxed)) {
+        if (kind_ == SocketServer && fd_ < 0) {
+            if (!waitReadable(listenFd_)) continue;
+            fd_ = accept(listenFd_, nullptr, nullptr);
+            used = 0;
+            continue;
+        }
+        if (kind_ != File && !waitReadable(fd_)) continue;
+
+        ssize_t count = read(fd_, buffer + used, buffer_.size() - used);
+        if (count < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            count = 0;  // treat read errors like the end of the input
+        }
+        if (count == 0) {
+            if (kind_ == SocketServer) {
+                closeInput();  // wait for the next client
+                continue;
+            }
+            if (used > 0) parseLine(buffer, buffer + used);  // last line without '\n'
+            finished_ = true;
+            break;
+        }
+        used += count;
+
+        // Parse every complete line, keep the incomplete tail for the next read
+        const char* p = buffer;
+        const char* end = buffer + used;
+        while (!stop_.load(std::memory_order_relaxed)) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!lineEnd) break;
+            parseLine(p, lineEnd);
+            p = lineEnd + 1;
+        }
+        used = end - p;
+        if (used == buffer_.size()) {
+            parseErrors_.fetch_add(1, std::memory_order_relaxed);  // no newline in 64 KB
+            used = 0;
+        } else if (used > 0 && p != buffer) {
+            std::memmove(buffer, p, used);
+        }
+    }
+}
+
+void GazeStream::parseLine(const char* p, const char* lineEnd)
+{
+    float values[7];
+    int count = 0;
+    while (count < 7 && nextCsvNumber(p, lineEnd, values[count])) ++count;
+    if (count == 0) return;  // blank line, header or comment
+    if (count < 6) {
+        parseErrors_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Files are replayed against a fixed schedule, so sleep overshoot is caught up rather
+    // than accumulated
+    if (kind_ == File && replayRate_ > 0.0) {
+        std::chrono::steady_clock::time_point due =
+            start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                         std::chrono::duration<double>(replayed_ / replayRate_));
+        while (!stop_.load(std::memory_order_relaxed)) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (now >= due) break;
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(due - now, std::chrono::milliseconds(100)));
+        }
+        ++replayed_;
+    }
+
+    const float* v = values + (count - 6);
+    GazeSample sample;
+    sample.timestamp = count == 7 ? values[0] : -1.0f;
+    sample.origin.set(v[0], v[1], v[2]);
+    sample.direction.set(v[3], v[4], v[5]);
+    sample.direction.normalize();
+    sample.receivedAt = now();
+
+    received_.fetch_add(1, std::memory_order_relaxed);
+    if (!ring_.push(sample)) dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ----------- GazeRayNode -----------
+
+GazeRayNode::GazeRayNode()
+    : geometry_(new osg::Geometry), vertices_(new osg::Vec3Array(2))
+{
+    osg::ref_ptr<osg::Vec4Array> color = new osg::Vec4Array;
+    color->push_back(osg::Vec4(1.0f, 0.9f, 0.1f, 1.0f));
+    geometry_->setDataVariance(osg::Object::DYNAMIC);
+    geometry_->setUseDisplayList(false);
+    geometry_->setUseVertexBufferObjects(true);
+    geometry_->setVertexArray(vertices_.get());
+    geometry_->setColorArray(color.get(), osg::Array::BIND_OVERALL);
+    geometry_->addPrimitiveSet(new osg::DrawArrays(GL_LINES, 0, 2));
+    addDrawable(geometry_.get());
+    setNodeMask(0);
+    osg::StateSet* state = getOrCreateStateSet();
+    state->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    state->setAttributeAndModes(new osg::LineWidth(2.0f));
+}
+
+void GazeRayNode::setRay(const osg::Vec3& start, const osg::Vec3& end)
+{
+    (*vertices_)[0] = start;
+    (*vertices_)[1] = end;
+    vertices_->dirty();
+    geometry_->dirtyBound();
+    setNodeMask(~0u);
+}
+
+// ----------- GazeOverlay -----------
+
+GazeOverlay::GazeOverlay(GazeStream& stream, double maxAge)
+    : stream_(stream), maxAge_(maxAge), ray_(new GazeRayNode), lastReport_(0.0), lastReceived_(0)
+{
+}
+
+void GazeOverlay::attach(const std::vector<ViewingZone>& zones, ZoneBatch* zoneBatch)
+{
+    if (zoneBatch_.valid()) {
+        zoneBatch_->setEventCallback(nullptr);
+        zoneBatch_->removeChild(ray_.get());
+    }
+    bvh_ = ZoneBvh(zones);
+    zoneBatch_ = zoneBatch;
+    // Under the zone transform, so the ray is drawn in meters like the zones
+    zoneBatch_->addChild(ray_.get());
+    zoneBatch_->setEventCallback(this);
+}
+
+void GazeOverlay::operator()(osg::Node* node, osg::NodeVisitor* nv)
+{
+    // Only the newest sample is drawn; everything queued before it is consumed
+    double now = stream_.now();
+    GazeSample sample, latest;
+    bool any = false;
+    uint64_t late = 0;
+    while (stream_.pop(sample)) {
+        if (now - sample.receivedAt > maxAge_) ++late;
+        latest = sample;
+        any = true;
+    }
+    if (late) stream_.countLate(late);
+
+    if (any) {
+        float distance = 2.0f;  // length of a ray that misses every zone, meters
+        int zoneId = bvh_.intersect(latest.origin, latest.direction, &distance);
+        zoneBatch_->setHighlight(zoneId);
+        ray_->setRay(latest.origin, latest.origin + latest.direction * (zoneId ? distance : 2.0f));
+    }
+
+    if (now - lastReport_ >= 10.0) printCounters();
+    traverse(node, nv);
+}
+
+void GazeOverlay::printCounters()
+{
+    GazeStream::Counters c = stream_.counters();
+    double now = stream_.now();
+    double rate = now > lastReport_ ? (c.received - lastReceived_) / (now - lastReport_) : 0.0;
+    lastReport_ = now;
+    lastReceived_ = c.received;
+    std::cout << "Gaze " << stream_.source() << ": " << c.received << " samples (" << std::fixed
+              << std::setprecision(0) << rate << "/s), " << c.dropped << " dropped, " << c.late
+              << " late, " << c.parseErrors << " parse errors" << std::defaultfloat << std::endl;
+}
+
+// ----------- visual gazestream -----------
+
+namespace {
+
+void printGazeStreamUsage()
+{
+    std::cout << "Usage: visual gazestream <source> [model <name>] [--rate HZ] [--seconds N] [--fps N] [--max-age MS]" << std::endl;
+    std::cout << "  source: gaze CSV file (replayed at --rate, default 1000/s, 0 = unpaced), '-' for stdin," << std::endl;
+    std::cout << "          a FIFO, a Unix socket to connect to, or unix:<path> to listen on" << std::endl;
+    std::cout << "  Runs until the file ends or for --seconds (default 10 for live sources); a simulated" << std::endl;
+    std::cout << "  render loop at --fps (default 60) pops and classifies the samples" << std::endl;
+}
+
+} // namespace
+
+int runGazeStreamCommand(int argc, char** argv)
+{
+    std::string source;
+    std::string carModelName = "Sharan";
+    double rate = 1000.0, seconds = 0.0, fps = 60.0, maxAgeMs = 50.0;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "model" && i + 1 < argc) carModelName = argv[++i];
+        else if (arg == "--rate" && i + 1 < argc) rate = std::atof(argv[++i]);
+        else if (arg == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (arg == "--fps" && i + 1 < argc) fps = std::atof(argv[++i]);
+        else if (arg == "--max-age" && i + 1 < argc) maxAgeMs = std::atof(argv[++i]);
+        else if (arg == "--help" || arg == "-h") { printGazeStreamUsage(); return 0; }
+        else if (source.empty() && (arg == "-" || arg[0] != '-')) source = arg;
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printGazeStreamUsage();
+            return 1;
+        }
+    }
+    if (source.empty() || fps <= 0.0) {
+        printGazeStreamUsage();
+        return 1;
+    }
+
+    ZoneBvh bvh;
+    GazeStream stream;
+    try {
+        bvh.build(parseViewingZonesFile("carmodels/" + carModelName + "/config/viewingzones.json"));
+        stream.start(source, rate);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    // Files and stdin end by themselves, FIFOs and sockets do not
+    struct stat info;
+    bool live = source.compare(0, 5, "unix:") == 0 ||
+                (source != "-" && stat(source.c_str(), &info) == 0 && !S_ISREG(info.st_mode));
+    if (seconds <= 0.0 && live) seconds = 10.0;
+    std::cout << "Reading gaze samples from " << source << std::endl;
+
+    // The same work the overlay does per frame, without the scene graph
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point nextFrame = Clock::now();
+    Clock::duration frame = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    uint64_t frames = 0, consumed = 0, zoneChanges = 0;
+    double maxAge = 0.0, firstSample = -1.0, lastSample = 0.0;
+    int zone = 0;
+    std::map<int, uint64_t> histogram;
+    for (;;) {
+        bool finished = stream.finished();  // read before draining, so nothing is left behind
+        double now = stream.now();
+        GazeSample sample;
+        uint64_t late = 0;
+        while (stream.pop(sample)) {
+            double age = now - sample.receivedAt;
+            if (age > maxAgeMs * 1e-3) ++late;
+            maxAge = std::max(maxAge, age);
+            if (firstSample < 0.0) firstSample = sample.receivedAt;
+            lastSample = sample.receivedAt;
+            int id = bvh.intersect(sample.origin, sample.direction);
+            histogram[id]++;
+            if (id != zone) ++zoneChanges;
+            zone = id;
+            ++consumed;
+        }
+        if (late) stream.countLate(late);
+        ++frames;
+        if (finished || (seconds > 0.0 && now >= seconds)) break;
+        nextFrame += frame;
+        std::this_thread::sleep_until(nextFrame);
+    }
+    stream.stop();
+
+    GazeStream::Counters c = stream.counters();
+    double span = lastSample - firstSample;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Received " << c.received << " samples";
+    if (span > 0.0) std::cout << " at " << (consumed - 1) / span << " samples/s";
+    std::cout << ", consumed " << consumed << " in " << frames << " frames" << std::endl;
+    std::cout << "  dropped: " << c.dropped << ", late (> " << maxAgeMs << " ms): " << c.late
+              << ", parse errors: " << c.parseErrors << ", oldest sample when consumed: "
+              << maxAge * 1e3 << " ms" << std::endl;
+    std::cout << "  zone changes: " << zoneChanges << std::endl;
+    for (const auto& entry : histogram) {
+        std::cout << "  " << (entry.first ? "Zone " + std::to_string(entry.first) : std::string("no zone"))
+                  << ": " << entry.second << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#ifndef GAZE_STREAM_H
+#define GAZE_STREAM_H
+
+#include "config_loader.h"
+#include "spsc_ring.h"
+#include "zone_batch.h"
+#include "zone_bvh.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/NodeCallback>
+#include <osg/Vec3>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One gaze ray from the eye tracker, carCoord meters
+struct GazeSample {
+    float timestamp;     // first CSV column if the line has 7 columns, else -1
+    osg::Vec3 origin, direction;
+    double receivedAt;   // GazeStream::now() when the input thread parsed the line
+};
+
+// Reads gaze samples ("[timestamp,] ox,oy,oz,dx,dy,dz" lines, as for `visual classify`) on
+// a background thread and hands them to one consumer through a lock-free ring buffer.
+//
+// Sources:
+//   path to a regular file  replayed at `replayRate` samples/s (0 = as fast as possible)
+//   "-"                     standard input
+//   path to a FIFO          lines as they are written; writers may come and go
+//   path to a Unix socket   connect to it and read what the server sends
+//   "unix:<path>"           create a Unix socket at <path> and accept one client at a time
+//
+// The input thread never waits for the consumer: a sample that does not fit into the ring
+// is counted as dropped. The consumer counts samples it pops too late to be useful.
+class GazeStream {
+public:
+    struct Counters {
+        uint64_t received;     // lines parsed into samples
+        uint64_t dropped;      // samples lost because the ring was full
+        uint64_t late;         // samples older than the consumer's limit when popped
+        uint64_t parseErrors;  // lines with 1-5 numbers, or longer than the read buffer
+    };
+
+    explicit GazeStream(size_t capacity = 4096);
+    ~GazeStream();
+
+    // Opens the source and starts the input thread. Throws std::runtime_error if the
+    // source cannot be opened.
+    void start(const std::string& source, double replayRate = 1000.0);
+    void stop();
+
+    // True once a file or standard input has been read to the end
+    bool finished() const { return finished_.load(std::memory_order_acquire); }
+    const std::string& source() const { return source_; }
+
+    // Consumer side
+    bool pop(GazeSample& sample) { return ring_.pop(sample); }
+    bool pending() const { return ring_.size() > 0; }
+    void countLate(uint64_t count) { late_.fetch_add(count, std::memory_order_relaxed); }
+
+    // Seconds since start() on the clock used for GazeSample::receivedAt
+    double now() const;
+    Counters counters() const;
+
+private:
+    GazeStream(const GazeStream&) = delete;
+    GazeStream& operator=(const GazeStream&) = delete;
+
+    enum Kind { File, Stdin, Fifo, SocketClient, SocketServer };
+
+    void run();
+    bool waitReadable(int fd);
+    void parseLine(const char* p, const char* lineEnd);
+    void closeInput();
+
+    SpscRing<GazeSample> ring_;
+    std::string source_;
+    std::string socketPath_;
+    Kind kind_;
+    int fd_, listenFd_;
+    double replayRate_;
+    uint64_t replayed_;
+    std::chrono::steady_clock::time_point start_;
+    std::vector<char> buffer_;
+    std::thread thread_;
+    std::atomic<bool> stop_, finished_;
+    std::atomic<uint64_t> received_, dropped_, late_, parseErrors_;
+};
+
+// A gaze ray as one line segment, for a child of a ZoneBatch (zone space, meters).
+// Hidden until the first setRay(); moving it rewrites two vertices and allocates nothing.
+class GazeRayNode : public osg::Geode {
+public:
+    GazeRayNode();
+
+    void setRay(const osg::Vec3& start, const osg::Vec3& end);
+    void hide() { setNodeMask(0); }
+
+protected:
+    virtual ~GazeRayNode() {}
+
+private:
+    osg::ref_ptr<osg::Geometry> geometry_;
+    osg::ref_ptr<osg::Vec3Array> vertices_;
+};
+
+// Event callback for a ZoneBatch that drains a GazeStream every frame, highlights the zone
+// hit by the newest sample and draws that gaze ray. Everything the callback touches is
+// allocated up front; a frame only rewrites two vertices and the highlight. It runs in the
+// event rather than the update traversal so the scene never asks for update traversals,
+// which would keep an on-demand viewer drawing (see FrameLoop and GazeStream::pending).
+class GazeOverlay : public osg::NodeCallback {
+public:
+    // Samples that waited in the ring longer than maxAge seconds count as late
+    explicit GazeOverlay(GazeStream& stream, double maxAge = 0.05);
+
+    // Move the callback and the ray to another model's zones (after a model switch)
+    void attach(const std::vector<ViewingZone>& zones, ZoneBatch* zoneBatch);
+
+    virtual void operator()(osg::Node* node, osg::NodeVisitor* nv);
+
+    // Counters and sample rate since the last report; also printed every 10 s
+    void printCounters();
+
+protected:
+    virtual ~GazeOverlay() {}
+
+private:
+    GazeStream& stream_;
+    double maxAge_;
+    ZoneBvh bvh_;
+    osg::ref_ptr<ZoneBatch> zoneBatch_;
+    osg::ref_ptr<GazeRayNode> ray_;
+    double lastReport_;
+    uint64_t lastReceived_;
+};
+
+// `visual gazestream <source> [options]` - run a gaze stream without a window: a simulated
+// render loop pops and classifies samples; prints throughput and the stream counters
+int runGazeStreamCommand(int argc, char** argv);
+
+#endif
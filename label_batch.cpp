@@ -0,0 +1,531 @@
+#include "label_batch.h"
+#include "render_batch.h"
+#include "scene_builder.h"
+
+#include <osg/Image>
+#include <osg/MatrixTransform>
+#include <osg/Program>
+#include <osg/Shader>
+#include <osg/Texture2D>
+#include <osg/Viewport>
+#include <osgUtil/CullVisitor>
+#include <osgViewer/Viewer>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+// 5x7 bitmap font, one byte per row (top row first, bit 4 = leftmost column)
+const char kCharset[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ-.? ";
+const unsigned char kGlyphRows[][7] = {
+    {0x0E,0x11,0x13,0x15,0x19,0x11,0x0E}, {0x04,0x0C,0x04,0x04,0x04,0x04,0x0E}, // 0 1
+    {0x0E,0x11,0x01,0x02,0x04,0x08,0x1F}, {0x1F,0x02,0x04,0x02,0x01,0x11,0x0E}, // 2 3
+    {0x02,0x06,0x0A,0x12,0x1F,0x02,0x02}, {0x1F,0x10,0x1E,0x01,0x01,0x11,0x0E}, // 4 5
+    {0x06,0x08,0x10,0x1E,0x11,0x11,0x0E}, {0x1F,0x01,0x02,0x04,0x08,0x08,0x08}, // 6 7
+    {0x0E,0x11,0x11,0x0E,0x11,0x11,0x0E}, {0x0E,0x11,0x11,0x0F,0x01,0x02,0x0C}, // 8 9
+    {0x0E,0x11,0x11,0x11,0x1F,0x11,0x11}, {0x1E,0x11,0x11,0x1E,0x11,0x11,0x1E}, // A B
+    {0x0E,0x11,0x10,0x10,0x10,0x11,0x0E}, {0x1C,0x12,0x11,0x11,0x11,0x12,0x1C}, // C D
+    {0x1F,0x10,0x10,0x1E,0x10,0x10,0x1F}, {0x1F,0x10,0x10,0x1E,0x10,0x10,0x10}, // E F
+    {0x0E,0x11,0x10,0x17,0x11,0x11,0x0F}, {0x11,0x11,0x11,0x1F,0x11,0x11,0x11}, // G H
+    {0x0E,0x04,0x04,0x04,0x04,0x04,0x0E}, {0x07,0x02,0x02,0x02,0x02,0x12,0x0C}, // I J
+    {0x11,0x12,0x14,0x18,0x14,0x12,0x11}, {0x10,0x10,0x10,0x10,0x10,0x10,0x1F}, // K L
+    {0x11,0x1B,0x15,0x15,0x11,0x11,0x11}, {0x11,0x11,0x19,0x15,0x13,0x11,0x11}, // M N
+    {0x0E,0x11,0x11,0x11,0x11,0x11,0x0E}, {0x1E,0x11,0x11,0x1E,0x10,0x10,0x10}, // O P
+    {0x0E,0x11,0x11,0x11,0x15,0x12,0x0D}, {0x1E,0x11,0x11,0x1E,0x14,0x12,0x11}, // Q R
+    {0x0F,0x10,0x10,0x0E,0x01,0x01,0x1E}, {0x1F,0x04,0x04,0x04,0x04,0x04,0x04}, // S T
+    {0x11,0x11,0x11,0x11,0x11,0x11,0x0E}, {0x11,0x11,0x11,0x11,0x11,0x0A,0x04}, // U V
+    {0x11,0x11,0x11,0x15,0x15,0x15,0x0A}, {0x11,0x11,0x0A,0x04,0x0A,0x11,0x11}, // W X
+    {0x11,0x11,0x11,0x0A,0x04,0x04,0x04}, {0x1F,0x01,0x02,0x04,0x08,0x10,0x1F}, // Y Z
+    {0x00,0x00,0x00,0x1F,0x00,0x00,0x00}, {0x00,0x00,0x00,0x00,0x00,0x0C,0x0C}, // - .
+    {0x0E,0x11,0x01,0x02,0x04,0x00,0x04}, {0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // ? space
+};
+const int kGlyphCount = sizeof(kGlyphRows) / sizeof(kGlyphRows[0]);
+
+// Atlas layout: each font pixel is kScale x kScale texels, with kPad texels of room around
+// the glyph for the outline (kPad - 1 texels wide)
+const int kScale = 4;
+const int kPad = 4;
+const int kCellWidth = 5 * kScale + 2 * kPad;
+const int kCellHeight = 7 * kScale + 2 * kPad;
+const int kAtlasSize = 256;
+const int kAtlasColumns = kAtlasSize / kCellWidth;
+
+int glyphIndex(char c)
+{
+    const char* p = std::strchr(kCharset, std::toupper(static_cast<unsigned char>(c)));
+    return p && *p ? static_cast<int>(p - kCharset) : static_cast<int>(std::strchr(kCharset, '?') - kCharset);
+}
+
+void glyphCell(int glyph, int& x, int& y)
+{
+    x = (glyph % kAtlasColumns) * kCellWidth;
+    y = (glyph / kAtlasColumns) * kCellHeight;
+}
+
+// Luminance = glyph (1) or outline (0), alpha = covered by either
+osg::ref_ptr<osg::Texture2D> createGlyphAtlas()
+{
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(kAtlasSize, kAtlasSize, 1, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE);
+    unsigned char* texels = image->data();
+    std::memset(texels, 0, kAtlasSize * kAtlasSize * 2);
+
+    const int radius = kPad - 1;
+    for (int g = 0; g < kGlyphCount; ++g) {
+        int cx, cy;
+        glyphCell(g, cx, cy);
+        auto on = [&](int tx, int ty) {
+            // Image rows run bottom-up; font rows top-down
+            int col = (tx - kPad) / kScale, row = 6 - (ty - kPad) / kScale;
+            if (tx < kPad || ty < kPad || col > 4 || row < 0) return false;
+            return ((kGlyphRows[g][row] >> (4 - col)) & 1) != 0;
+        };
+        for (int ty = 0; ty < kCellHeight; ++ty) {
+            for (int tx = 0; tx < kCellWidth; ++tx) {
+                bool glyph = on(tx, ty), outline = false;
+                for (int dy = -radius; dy <= radius && !glyph && !outline; ++dy) {
+                    for (int dx = -radius; dx <= radius && !outline; ++dx) {
+                        outline = dx * dx + dy * dy <= radius * radius && on(tx + dx, ty + dy);
+                    }
+                }
+                unsigned char* texel = texels + ((cy + ty) * kAtlasSize + cx + tx) * 2;
+                texel[0] = glyph ? 255 : 0;
+                texel[1] = glyph || outline ? 255 : 0;
+            }
+        }
+    }
+
+    osg::ref_ptr<osg::Texture2D> atlas = new osg::Texture2D(image.get());
+    atlas->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
+    atlas->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+    atlas->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    atlas->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    return atlas;
+}
+
+const char* kLabelVertexShader =
+    "#version 120\n"
+    "uniform vec2 viewportSize;\n"
+    "varying vec2 atlasCoord;\n"
+    "void main()\n"
+    "{\n"
+    "    // Every corner of a glyph quad is at the label anchor; spread them in pixels\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
+    "    gl_Position.xy += gl_MultiTexCoord1.xy * 2.0 / viewportSize * gl_Position.w;\n"
+    "    atlasCoord = gl_MultiTexCoord0.xy;\n"
+    "}\n";
+
+const char* kLabelFragmentShader =
+    "#version 120\n"
+    "uniform sampler2D glyphAtlas;\n"
+    "uniform vec4 textColor;\n"
+    "uniform vec4 outlineColor;\n"
+    "varying vec2 atlasCoord;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 texel = texture2D(glyphAtlas, atlasCoord);\n"
+    "    if (texel.a < 0.05) discard;\n"
+    "    gl_FragColor = vec4(mix(outlineColor.rgb, textColor.rgb, texel.r), texel.a * mix(outlineColor.a, textColor.a, texel.r));\n"
+    "}\n";
+
+// Atlas, shaders and render state are the same for every batch
+osg::ref_ptr<osg::StateSet> createLabelStateSet()
+{
+    osg::ref_ptr<osg::StateSet> state = new osg::StateSet;
+    osg::ref_ptr<osg::Program> program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, kLabelVertexShader));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT, kLabelFragmentShader));
+    state->setAttributeAndModes(program.get());
+    state->setTextureAttributeAndModes(0, createGlyphAtlas().get());
+    state->addUniform(new osg::Uniform("glyphAtlas", 0));
+    state->addUniform(new osg::Uniform("textColor", osg::Vec4(1, 1, 1, 1)));  // White text
+    state->addUniform(new osg::Uniform("outlineColor", osg::Vec4(0, 0, 0, 0.8f)));  // Semi-transparent black outline
+    state->setMode(GL_BLEND, osg::StateAttribute::ON);
+    state->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    state->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF); // Always visible
+    state->setRenderBinDetails(1000, "RenderBin"); // Render on top
+    return state;
+}
+
+osg::StateSet* sharedLabelStateSet()
+{
+    static osg::ref_ptr<osg::StateSet> state = createLabelStateSet();
+    return state.get();
+}
+
+// Draws the culling camera's own geometry in place of the batch's drawable
+class LabelCullCallback : public osg::NodeCallback
+{
+public:
+    virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+    {
+        osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+        if (!cv) {
+            traverse(node, nv);
+            return;
+        }
+        if (cv->getViewport()) {
+            osg::Geometry* geometry = static_cast<LabelBatch*>(node)->cull(
+                cv->getCurrentCamera(), *cv->getModelViewMatrix(), *cv->getProjectionMatrix(), cv->getViewport());
+            geometry->accept(*nv);
+        }
+    }
+};
+
+} // namespace
+
+LabelBatch::LabelBatch(float glyphHeightPixels)
+    : glyphHeight_(glyphHeightPixels), maxDistance_(0.0f), removeOverlaps_(false), drawn_(0), revision_(0),
+      anchors_(new osg::Vec3Array), atlasCoords_(new osg::Vec2Array), pixelOffsets_(new osg::Vec2Array),
+      quads_(new osg::DrawElementsUInt(GL_TRIANGLES)), firstCamera_(nullptr)
+{
+    geometry_ = createGeometry(quads_.get());
+    geometry_->getOrCreateStateSet()->addUniform(new osg::Uniform("viewportSize", osg::Vec2(1280.0f, 960.0f)));
+    addDrawable(geometry_.get());
+
+    setStateSet(sharedLabelStateSet());
+    setCullCallback(new LabelCullCallback);
+}
+
+osg::ref_ptr<osg::Geometry> LabelBatch::createGeometry(osg::DrawElementsUInt* quads) const
+{
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setDataVariance(osg::Object::DYNAMIC);  // the index list changes at runtime
+    geometry->setUseDisplayList(false);
+    geometry->setUseVertexBufferObjects(true);
+    geometry->setVertexArray(anchors_.get());
+    geometry->setTexCoordArray(0, atlasCoords_.get(), osg::Array::BIND_PER_VERTEX);
+    geometry->setTexCoordArray(1, pixelOffsets_.get(), osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(quads);
+    // The bound only covers the anchors, not the text around them
+    geometry->setCullingActive(false);
+    return geometry;
+}
+
+LabelBatch::CameraLabels& LabelBatch::cameraLabels(const osg::Camera* camera)
+{
+    std::lock_guard<std::mutex> lock(camerasMutex_);
+    auto it = cameras_.find(camera);
+    if (it != cameras_.end()) return it->second;
+
+    CameraLabels& view = cameras_[camera];
+    view.quads = new osg::DrawElementsUInt(GL_TRIANGLES);
+    view.geometry = createGeometry(view.quads.get());
+    view.viewportSize = new osg::Uniform("viewportSize", osg::Vec2(1.0f, 1.0f));
+    osg::StateSet* state = view.geometry->getOrCreateStateSet();
+    state->setDataVariance(osg::Object::DYNAMIC);  // the uniform is set at every cull
+    state->addUniform(view.viewportSize.get());
+    view.revision = revision_ - 1;  // builds the index list at the first cull
+    view.drawn = 0;
+    if (!firstCamera_) firstCamera_ = camera;
+    return view;
+}
+
+unsigned LabelBatch::addLabel(const osg::Vec3& anchor, const std::string& text)
+{
+    const float pixelsPerTexel = glyphHeight_ / (7 * kScale);
+    const float cellWidth = kCellWidth * pixelsPerTexel, cellHeight = kCellHeight * pixelsPerTexel;
+    const float advance = 6 * kScale * pixelsPerTexel;  // glyph plus one font pixel of spacing
+
+    Label label;
+    label.anchor = anchor;
+    label.halfWidth = text.empty() ? 0.0f : 0.5f * ((text.size() - 1) * advance + cellWidth);
+    label.halfHeight = 0.5f * cellHeight;
+    label.firstIndex = static_cast<unsigned>(allIndices_.size());
+    label.visible = true;
+
+    // Centered on the anchor, like the CENTER_CENTER osgText labels
+    float x = -label.halfWidth, y = -label.halfHeight;
+    for (size_t i = 0; i < text.size(); ++i, x += advance) {
+        if (text[i] == ' ') continue;
+        int cx, cy;
+        glyphCell(glyphIndex(text[i]), cx, cy);
+        float u0 = float(cx) / kAtlasSize, v0 = float(cy) / kAtlasSize;
+        float u1 = float(cx + kCellWidth) / kAtlasSize, v1 = float(cy + kCellHeight) / kAtlasSize;
+
+        GLuint base = static_cast<GLuint>(anchors_->size());
+        for (int corner = 0; corner < 4; ++corner) anchors_->push_back(anchor);
+        atlasCoords_->push_back(osg::Vec2(u0, v0));
+        atlasCoords_->push_back(osg::Vec2(u1, v0));
+        atlasCoords_->push_back(osg::Vec2(u1, v1));
+        atlasCoords_->push_back(osg::Vec2(u0, v1));
+        pixelOffsets_->push_back(osg::Vec2(x, y));
+        pixelOffsets_->push_back(osg::Vec2(x + cellWidth, y));
+        pixelOffsets_->push_back(osg::Vec2(x + cellWidth, y + cellHeight));
+        pixelOffsets_->push_back(osg::Vec2(x, y + cellHeight));
+        const GLuint quad[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+        allIndices_.insert(allIndices_.end(), quad, quad + 6);
+    }
+    label.indexCount = static_cast<unsigned>(allIndices_.size()) - label.firstIndex;
+    labels_.push_back(label);
+
+    anchors_->dirty();
+    atlasCoords_->dirty();
+    pixelOffsets_->dirty();
+    geometry_->dirtyBound();
+    // New labels start visible and come last, so they just extend the drawn list
+    quads_->insert(quads_->end(), allIndices_.begin() + label.firstIndex, allIndices_.end());
+    quads_->dirty();
+    ++drawn_;
+    ++revision_;
+    return static_cast<unsigned>(labels_.size() - 1);
+}
+
+void LabelBatch::setLabelVisible(unsigned index, bool visible)
+{
+    if (index >= labels_.size() || labels_[index].visible == visible) return;
+    labels_[index].visible = visible;
+    ++revision_;
+    updateIndices(*quads_, nullptr, drawn_);
+}
+
+void LabelBatch::setLabelAnchor(unsigned index, const osg::Vec3& anchor)
+{
+    if (index >= labels_.size()) return;
+    Label& label = labels_[index];
+    label.anchor = anchor;
+    if (label.indexCount == 0) return;
+
+    // A label's glyph quads are consecutive vertices, four per glyph
+    GLuint first = allIndices_[label.firstIndex];
+    GLuint end = first + label.indexCount / 6 * 4;
+    for (GLuint v = first; v < end; ++v) (*anchors_)[v] = anchor;
+    anchors_->dirty();
+    geometry_->dirtyBound();
+}
+
+void LabelBatch::setCulling(float maxDistance, bool removeOverlaps)
+{
+    maxDistance_ = maxDistance;
+    removeOverlaps_ = removeOverlaps;
+}
+
+size_t LabelBatch::drawnLabelCount() const
+{
+    std::lock_guard<std::mutex> lock(camerasMutex_);
+    auto it = cameras_.find(firstCamera_);
+    return it != cameras_.end() ? it->second.drawn : drawn_;
+}
+
+osg::Geometry* LabelBatch::cull(const osg::Camera* camera, const osg::Matrix& modelView, const osg::Matrix& projection,
+                                const osg::Viewport* viewport)
+{
+    CameraLabels& view = cameraLabels(camera);
+    const float width = static_cast<float>(viewport->width()), height = static_cast<float>(viewport->height());
+    view.viewportSize->set(osg::Vec2(width, height));
+
+    bool changed = view.revision != revision_;
+    view.culled.resize(labels_.size(), 0);
+    if (maxDistance_ <= 0.0f && !removeOverlaps_) {
+        for (char& culled : view.culled) {
+            changed = changed || culled;
+            culled = 0;
+        }
+    } else {
+        cullLabels(view, modelView, projection, width, height, changed);
+    }
+    if (changed) {
+        updateIndices(*view.quads, &view.culled, view.drawn);
+        view.revision = revision_;
+    }
+    return view.geometry.get();
+}
+
+void LabelBatch::cullLabels(CameraLabels& view, const osg::Matrix& modelView, const osg::Matrix& projection,
+                            float width, float height, bool& changed) const
+{
+    // Overlap test against earlier accepted labels in a screen grid whose cells are at
+    // least as large as any label, so each label only touches up to 2x2 cells
+    float cell = 1.0f;
+    for (const auto& label : labels_) cell = std::max(cell, 2.0f * std::max(label.halfWidth, label.halfHeight));
+    const int gridWidth = static_cast<int>(width / cell) + 1, gridHeight = static_cast<int>(height / cell) + 1;
+    std::vector<std::vector<unsigned> > grid(removeOverlaps_ ? gridWidth * gridHeight : 0);
+    std::vector<osg::Vec2> screen(labels_.size());
+
+    const osg::Matrix modelViewProjection = modelView * projection;
+    for (size_t i = 0; i < labels_.size(); ++i) {
+        const Label& label = labels_[i];
+        if (!label.visible) continue;
+
+        bool culled = maxDistance_ > 0.0f && (label.anchor * modelView).length() > maxDistance_;
+        if (!culled && removeOverlaps_) {
+            osg::Vec4 clip = osg::Vec4(label.anchor, 1.0f) * modelViewProjection;
+            float sx = (clip.x() / clip.w() * 0.5f + 0.5f) * width;
+            float sy = (clip.y() / clip.w() * 0.5f + 0.5f) * height;
+            screen[i] = osg::Vec2(sx, sy);
+            // Behind the eye or entirely off screen: not drawn anyway, and takes no room
+            culled = clip.w() <= 0.0f || sx + label.halfWidth < 0.0f || sx - label.halfWidth > width ||
+                     sy + label.halfHeight < 0.0f || sy - label.halfHeight > height;
+        }
+        if (!culled && removeOverlaps_) {
+            const float sx = screen[i].x(), sy = screen[i].y();
+            int gx0 = std::max(0, static_cast<int>((sx - label.halfWidth) / cell));
+            int gx1 = std::min(gridWidth - 1, static_cast<int>((sx + label.halfWidth) / cell));
+            int gy0 = std::max(0, static_cast<int>((sy - label.halfHeight) / cell));
+            int gy1 = std::min(gridHeight - 1, static_cast<int>((sy + label.halfHeight) / cell));
+            for (int gy = gy0; gy <= gy1 && !culled; ++gy) {
+                for (int gx = gx0; gx <= gx1 && !culled; ++gx) {
+                    for (unsigned j : grid[gy * gridWidth + gx]) {
+                        if (std::fabs(sx - screen[j].x()) < label.halfWidth + labels_[j].halfWidth &&
+                            std::fabs(sy - screen[j].y()) < label.halfHeight + labels_[j].halfHeight) {
+                            culled = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if (!culled) {
+                for (int gy = gy0; gy <= gy1; ++gy) {
+                    for (int gx = gx0; gx <= gx1; ++gx) grid[gy * gridWidth + gx].push_back(static_cast<unsigned>(i));
+                }
+            }
+        }
+        changed = changed || culled != (view.culled[i] != 0);
+        view.culled[i] = culled;
+    }
+}
+
+void LabelBatch::updateIndices(osg::DrawElementsUInt& quads, const std::vector<char>* culled, size_t& drawn) const
+{
+    quads.clear();
+    drawn = 0;
+    for (size_t i = 0; i < labels_.size(); ++i) {
+        const Label& label = labels_[i];
+        if (!label.visible || (culled && (*culled)[i])) continue;
+        quads.insert(quads.end(), allIndices_.begin() + label.firstIndex,
+                     allIndices_.begin() + label.firstIndex + label.indexCount);
+        ++drawn;
+    }
+    quads.dirty();
+}
+
+namespace {
+
+struct FrameTimes {
+    double mean, p95;
+};
+
+FrameTimes timeFrames(osgViewer::Viewer& viewer, int frames)
+{
+    typedef std::chrono::steady_clock Clock;
+    for (int i = 0; i < 10; ++i) viewer.frame();  // compile GL objects, settle caches
+
+    // The attached image is read back every frame, so frame() includes the GPU work
+    std::vector<double> ms;
+    for (int i = 0; i < frames; ++i) {
+        Clock::time_point t0 = Clock::now();
+        viewer.frame();
+        ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    }
+    std::sort(ms.begin(), ms.end());
+    FrameTimes times;
+    times.mean = 0.0;
+    for (double t : ms) times.mean += t;
+    times.mean /= ms.size();
+    times.p95 = ms[std::min(ms.size() - 1, ms.size() * 95 / 100)];
+    return times;
+}
+
+// Labels on a square grid facing the camera, spanning about 2000 units at 4000 units away
+std::vector<osg::Vec3> labelGrid(int count)
+{
+    std::vector<osg::Vec3> positions;
+    int side = static_cast<int>(std::ceil(std::sqrt(double(count))));
+    float spacing = 2000.0f / side;
+    for (int i = 0; i < count; ++i) {
+        positions.push_back(osg::Vec3((i % side - 0.5f * (side - 1)) * spacing,
+                                      (i / side - 0.5f * (side - 1)) * spacing, 0.0f));
+    }
+    return positions;
+}
+
+void printLabelBenchUsage()
+{
+    std::cout << "Usage: visual labelbench [--counts 20,200,2000] [--frames N] [--size WxH] [--no-fbo]" << std::endl;
+    std::cout << "  Offscreen frame times for N labels drawn as outlined osgText (one per label)" << std::endl;
+    std::cout << "  versus one LabelBatch, without and with overlap culling" << std::endl;
+}
+
+} // namespace
+
+int runLabelBenchmark(int argc, char** argv)
+{
+    std::vector<int> counts = { 20, 200, 2000 };
+    int frames = 200, width = 1280, height = 960;
+    bool useFbo = true;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--counts" && i + 1 < argc) {
+            counts.clear();
+            std::stringstream ss(argv[++i]);
+            std::string item;
+            while (std::getline(ss, item, ',')) if (std::atoi(item.c_str()) > 0) counts.push_back(std::atoi(item.c_str()));
+        }
+        else if (arg == "--frames" && i + 1 < argc) frames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--size" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                std::cerr << "Error: Invalid size '" << argv[i] << "'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--no-fbo") useFbo = false;
+        else if (arg == "--help" || arg == "-h") { printLabelBenchUsage(); return 0; }
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printLabelBenchUsage();
+            return 1;
+        }
+    }
+
+    osgViewer::Viewer viewer;
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    if (!setupOffscreenViewer(viewer, width, height, useFbo, image.get())) return 1;
+    viewer.getCamera()->setViewMatrixAsLookAt(osg::Vec3d(0, 0, 4000), osg::Vec3d(0, 0, 0), osg::Vec3d(0, 1, 0));
+
+    std::cout << "Label frame times at " << width << "x" << height << ", " << frames
+              << " frames each (ms/frame, mean / p95) on " << offscreenRendererName(viewer) << std::endl;
+    std::cout << std::setw(7) << "labels" << std::setw(22) << "osgText outline" << std::setw(20) << "batched"
+              << std::setw(28) << "batched + overlap cull" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (int count : counts) {
+        std::vector<osg::Vec3> positions = labelGrid(count);
+
+        // As the viewer built them before the label batch: a Geode per outlined Text
+        osg::ref_ptr<osg::Group> textLabels = new osg::Group;
+        for (int i = 0; i < count; ++i) {
+            osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+            geode->addDrawable(createZoneLabel(positions[i], "Zone " + std::to_string(i + 1)).get());
+            geode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+            geode->getOrCreateStateSet()->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF);
+            geode->getOrCreateStateSet()->setRenderBinDetails(1000, "RenderBin");
+            textLabels->addChild(geode.get());
+        }
+        viewer.setSceneData(textLabels.get());
+        FrameTimes text = timeFrames(viewer, frames);
+
+        osg::ref_ptr<LabelBatch> batch = new LabelBatch;
+        for (int i = 0; i < count; ++i) batch->addLabel(positions[i], std::to_string(i + 1));
+        viewer.setSceneData(batch.get());
+        FrameTimes batched = timeFrames(viewer, frames);
+
+        batch->setCulling(0.0f, true);
+        FrameTimes culled = timeFrames(viewer, frames);
+
+        std::ostringstream culledColumn;
+        culledColumn << std::fixed << std::setprecision(2) << culled.mean << " / " << culled.p95
+                     << " (" << batch->drawnLabelCount() << " drawn)";
+        std::cout << std::setw(7) << count
+                  << std::setw(14) << text.mean << " / " << std::setw(5) << text.p95
+                  << std::setw(12) << batched.mean << " / " << std::setw(5) << batched.p95
+                  << std::setw(28) << culledColumn.str() << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+#ifndef LABEL_BATCH_H
+#define LABEL_BATCH_H
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Uniform>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace osg { class Camera; class Viewport; }
+
+// Screen-aligned text labels (zone numbers) drawn as a single drawable.
+//
+// Glyphs come from a small built-in bitmap font (digits, A-Z and a few symbols) packed
+// once into a shared texture atlas, with the dark outline already baked in, so no
+// per-label backdrop passes are needed. Each glyph is a quad whose four vertices all sit at
+// the label's anchor point; the vertex shader offsets them in pixels after projection, so
+// labels keep a constant on-screen size and the vertex data never changes with the view.
+// Each label owns a contiguous range of the index list. Hiding labels rewrites that list.
+//
+// Every camera that draws the batch (the main view and the camera insets, culled in
+// parallel with CullThreadPerCameraDrawThreadPerContext) gets its own geometry over the
+// shared vertex arrays, with its own index list, culling results and viewport size uniform,
+// so the cameras' culls never write the same data.
+class LabelBatch : public osg::Geode
+{
+public:
+    explicit LabelBatch(float glyphHeightPixels = 18.0f);
+
+    // Lower-case letters are drawn as upper case, unknown characters as '?'.
+    // Returns the label's index.
+    unsigned addLabel(const osg::Vec3& anchor, const std::string& text);
+    size_t labelCount() const { return labels_.size(); }
+
+    void setLabelVisible(unsigned index, bool visible);
+    // Move a label; only its anchor vertices are rewritten
+    void setLabelAnchor(unsigned index, const osg::Vec3& anchor);
+
+    // Optional culling, done per camera and frame during the cull traversal: labels farther
+    // than maxDistance from the eye (in eye coordinates; 0 = no limit) and, with
+    // removeOverlaps, labels whose screen rectangle overlaps an earlier (lower index) label
+    // are not drawn.
+    void setCulling(float maxDistance, bool removeOverlaps);
+
+    // Labels drawn in the last frame by the first camera that drew the batch (the main
+    // view); before any frame, the visible labels
+    size_t drawnLabelCount() const;
+
+    // Called by the cull callback, on the camera's cull thread; returns the geometry to draw
+    // for this camera
+    osg::Geometry* cull(const osg::Camera* camera, const osg::Matrix& modelView, const osg::Matrix& projection,
+                        const osg::Viewport* viewport);
+
+protected:
+    virtual ~LabelBatch() {}
+
+private:
+    struct Label {
+        osg::Vec3 anchor;
+        float halfWidth, halfHeight;  // pixels, outline included
+        unsigned firstIndex, indexCount;
+        bool visible;
+    };
+
+    // What one camera draws. Only that camera's cull thread touches it after creation.
+    struct CameraLabels {
+        osg::ref_ptr<osg::Geometry> geometry;
+        osg::ref_ptr<osg::DrawElementsUInt> quads;
+        osg::ref_ptr<osg::Uniform> viewportSize;
+        std::vector<char> culled;  // per label
+        unsigned revision;         // of the labels the index list was built from
+        size_t drawn;
+    };
+
+    osg::ref_ptr<osg::Geometry> createGeometry(osg::DrawElementsUInt* quads) const;
+    CameraLabels& cameraLabels(const osg::Camera* camera);
+    // Distance and overlap culling into view.culled; sets `changed` if any flag flips
+    void cullLabels(CameraLabels& view, const osg::Matrix& modelView, const osg::Matrix& projection, float width,
+                    float height, bool& changed) const;
+    void updateIndices(osg::DrawElementsUInt& quads, const std::vector<char>* culled, size_t& drawn) const;
+
+    float glyphHeight_;
+    float maxDistance_;
+    bool removeOverlaps_;
+    size_t drawn_;       // visible labels
+    unsigned revision_;  // bumped when labels are added, shown or hidden
+    std::vector<Label> labels_;
+    std::vector<GLuint> allIndices_;
+
+    // The Geode's own drawable, with every visible label, for bounds, picking and GL object
+    // compilation; cameras draw their own geometries instead
+    osg::ref_ptr<osg::Geometry> geometry_;
+    osg::ref_ptr<osg::Vec3Array> anchors_;
+    osg::ref_ptr<osg::Vec2Array> atlasCoords_, pixelOffsets_;
+    osg::ref_ptr<osg::DrawElementsUInt> quads_;
+
+    // Keyed by camera; entries are never removed, cameras live as long as the viewer
+    std::map<const osg::Camera*, CameraLabels> cameras_;
+    const osg::Camera* firstCamera_;
+    mutable std::mutex camerasMutex_;
+};
+
+// `visual labelbench [options]` - offscreen frame times for 20/200/2000 labels with
+// osgText (outlined, as before) versus LabelBatch with and without culling
+int runLabelBenchmark(int argc, char** argv);
+
+#endif
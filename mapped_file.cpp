@@ -0,0 +1,67 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile()
+    : data_(nullptr), size_(0), opened_(false)
+{
+}
+
+MappedFile::MappedFile(const std::string& path, Access access)
+    : data_(nullptr), size_(0), opened_(false)
+{
+    open(path, access);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+void MappedFile::open(const std::string& path, Access access)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat " + path);
+    }
+
+    path_ = path;
+    size_ = static_cast<size_t>(st.st_size);
+    opened_ = true;
+
+    // An empty file cannot be mapped, but is still a valid (empty) buffer
+    if (size_ > 0) {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            opened_ = false;
+            throw std::runtime_error("Cannot map " + path);
+        }
+        madvise(p, size_, access == Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        data_ = static_cast<const char*>(p);
+    }
+    ::close(fd);
+}
+
+void MappedFile::close()
+{
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    opened_ = false;
+}
@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file.
+// Throws std::runtime_error if the file cannot be opened or mapped.
+class MappedFile {
+public:
+    // Read-ahead hint: config files are parsed front to back, lookup tables are not
+    enum Access { Sequential, Random };
+
+    MappedFile();
+    explicit MappedFile(const std::string& path, Access access = Sequential);
+    ~MappedFile();
+
+    void open(const std::string& path, Access access = Sequential);
+    void close();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool isOpen() const { return opened_; }
+    const std::string& path() const { return path_; }
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string path_;
+    const char* data_;
+    size_t size_;
+    bool opened_;
+};
+
+#endif
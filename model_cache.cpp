@@ -0,0 +1,289 @@
+#include "model_cache.h"
+#include "config_loader.h"
+#include "disk_cache.h"
+#include "trace.h"
+
+#include <osg/Geometry>
+#include <osg/KdTree>
+#include <osg/MatrixTransform>
+#include <osg/NodeVisitor>
+#include <osg/PrimitiveSet>
+#include <osgDB/Options>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgUtil/Optimizer>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+
+// Bump when the optimization pass changes, so old cache files are not reused
+const uint64_t kModelCacheVersion = 1;
+
+typedef std::chrono::steady_clock Clock;
+
+double millisecondsSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+class ModelStatsVisitor : public osg::NodeVisitor
+{
+public:
+    ModelStatsVisitor() : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN), stats_(ModelStats()) {}
+
+    virtual void apply(osg::Node& node)
+    {
+        if (node.getStateSet()) stateSets_.insert(node.getStateSet());
+        traverse(node);
+    }
+
+    virtual void apply(osg::Geometry& geometry)
+    {
+        if (geometry.getStateSet()) stateSets_.insert(geometry.getStateSet());
+        ++stats_.geometries;
+        if (geometry.getVertexArray()) stats_.vertices += geometry.getVertexArray()->getNumElements();
+        for (unsigned i = 0; i < geometry.getNumPrimitiveSets(); ++i) {
+            osg::PrimitiveSet* primitives = geometry.getPrimitiveSet(i);
+            stats_.primitives += primitives->getNumPrimitives();
+            if (primitives->getType() == osg::PrimitiveSet::DrawArrayLengthsPrimitiveType) {
+                stats_.drawCalls += static_cast<unsigned>(static_cast<osg::DrawArrayLengths*>(primitives)->size());
+            } else {
+                ++stats_.drawCalls;
+            }
+        }
+    }
+
+    ModelStats stats()
+    {
+        stats_.stateSets = static_cast<unsigned>(stateSets_.size());
+        return stats_;
+    }
+
+private:
+    ModelStats stats_;
+    std::set<const osg::StateSet*> stateSets_;
+};
+
+// Display lists are compiled per context and cannot be updated; VBOs are the fast path
+class UseVertexBufferObjectsVisitor : public osg::NodeVisitor
+{
+public:
+    UseVertexBufferObjectsVisitor() : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN) {}
+
+    virtual void apply(osg::Geometry& geometry)
+    {
+        geometry.setUseDisplayList(false);
+        geometry.setUseVertexBufferObjects(true);
+    }
+};
+
+// The optimization pass run on a cold load. The transform is flattened into the vertices
+// first so that geometry from differently transformed subgraphs can be merged.
+osg::ref_ptr<osg::Node> optimizeModel(osg::Node* model, const osg::Matrix& transform)
+{
+    osg::ref_ptr<osg::MatrixTransform> carTransform = new osg::MatrixTransform(transform);
+    carTransform->addChild(model);
+    osg::ref_ptr<osg::Group> root = new osg::Group;  // flattening needs a non-transform root
+    root->addChild(carTransform.get());
+
+    osgUtil::Optimizer optimizer;
+    optimizer.optimize(root.get(),
+        osgUtil::Optimizer::STATIC_OBJECT_DETECTION |
+        osgUtil::Optimizer::FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS |
+        osgUtil::Optimizer::REMOVE_REDUNDANT_NODES |
+        osgUtil::Optimizer::COMBINE_ADJACENT_LODS |
+        osgUtil::Optimizer::SHARE_DUPLICATE_STATE |
+        osgUtil::Optimizer::OPTIMIZE_TEXTURE_SETTINGS |
+        osgUtil::Optimizer::MERGE_GEODES |
+        osgUtil::Optimizer::MERGE_GEOMETRY |
+        osgUtil::Optimizer::CHECK_GEOMETRY |
+        osgUtil::Optimizer::TRISTRIP_GEOMETRY);
+
+    UseVertexBufferObjectsVisitor vbos;
+    root->accept(vbos);
+    return root;
+}
+
+void writeModelCache(osg::Node* node, const std::string& path)
+{
+    makeDirectories(cacheDirectory());
+    // Same write-then-rename as writeFileAtomically; the extension picks the plugin
+    std::string tmpPath = path + ".tmp." + std::to_string(getpid()) + ".osgb";
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options("WriteImageHint=IncludeData");
+    if (!osgDB::writeNodeFile(*node, tmpPath, options.get())) {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("Cannot write " + tmpPath);
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+} // namespace
+
+ModelStats computeModelStats(osg::Node* node)
+{
+    ModelStatsVisitor visitor;
+    if (node) node->accept(visitor);
+    return visitor.stats();
+}
+
+uint64_t modelCacheKey(const std::string& sourcePath, const osg::Matrix& transform)
+{
+    uint64_t key = hashBytes(&kModelCacheVersion, sizeof(kModelCacheVersion));
+    key = hashFileContents(sourcePath, key);
+    return hashBytes(transform.ptr(), 16 * sizeof(*transform.ptr()), key);
+}
+
+osg::ref_ptr<osg::Node> loadOptimizedModel(const std::string& sourcePath, const osg::Matrix& transform,
+                                           bool rebuild, ModelLoadInfo* info)
+{
+    ModelLoadInfo local;
+    ModelLoadInfo& out = info ? *info : local;
+    out = ModelLoadInfo();
+
+    Clock::time_point t0 = Clock::now();
+    uint64_t key;
+    try {
+        ScopedPhase phase("hash model source", sourcePath);
+        key = modelCacheKey(sourcePath, transform);
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+    out.hashMs = millisecondsSince(t0);
+    out.cachePath = cacheFilePath("model", key, ".osgb");
+
+    osg::ref_ptr<osg::Node> node;
+    if (!rebuild && access(out.cachePath.c_str(), R_OK) == 0) {
+        ScopedPhase phase("read cached model", out.cachePath);
+        t0 = Clock::now();
+        node = osgDB::readRefNodeFile(out.cachePath);
+        out.readMs = millisecondsSince(t0);
+        out.fromCache = node.valid();
+    }
+
+    if (!node) {
+        osg::ref_ptr<osg::Node> source;
+        {
+            ScopedPhase phase("read source model", sourcePath);
+            t0 = Clock::now();
+            source = osgDB::readRefNodeFile(sourcePath);
+            out.readMs = millisecondsSince(t0);
+        }
+        if (!source) return nullptr;
+        out.source = computeModelStats(source.get());
+
+        {
+            ScopedPhase phase("optimize model");
+            t0 = Clock::now();
+            node = optimizeModel(source.get(), transform);
+            out.optimizeMs = millisecondsSince(t0);
+        }
+
+        ScopedPhase phase("write model cache", out.cachePath);
+        t0 = Clock::now();
+        try {
+            writeModelCache(node.get(), out.cachePath);
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: model cache not written: " << e.what() << std::endl;
+        }
+        out.writeMs = millisecondsSince(t0);
+    }
+
+    ScopedPhase phase("build kd-trees");
+    t0 = Clock::now();
+    osg::ref_ptr<osg::KdTreeBuilder> kdTrees = new osg::KdTreeBuilder;
+    node->accept(*kdTrees);
+    out.kdTreeMs = millisecondsSince(t0);
+
+    out.optimized = computeModelStats(node.get());
+    return node;
+}
+
+namespace {
+
+void printStats(const char* what, const ModelStats& stats)
+{
+    std::cout << "  " << std::left << std::setw(10) << what << std::right
+              << std::setw(8) << stats.drawCalls << " draw calls, "
+              << std::setw(7) << stats.geometries << " geometries, "
+              << std::setw(6) << stats.stateSets << " state sets, "
+              << std::setw(9) << stats.vertices << " vertices, "
+              << std::setw(9) << stats.primitives << " primitives" << std::endl;
+}
+
+void printModelCacheUsage()
+{
+    std::cout << "Usage: visual modelcache [<model> ...] [--keep]" << std::endl;
+    std::cout << "  Rebuilds the optimized .osgb cache of each model (default: all in carmodels.json)," << std::endl;
+    std::cout << "  then loads it again, and reports cold versus warm load times and draw calls" << std::endl;
+    std::cout << "  before and after optimization. --keep reuses existing cache files (warm only)." << std::endl;
+}
+
+} // namespace
+
+int runModelCacheCommand(int argc, char** argv)
+{
+    std::vector<std::string> models;
+    bool keep = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--keep") keep = true;
+        else if (arg == "--help" || arg == "-h") { printModelCacheUsage(); return 0; }
+        else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printModelCacheUsage();
+            return 1;
+        }
+        else models.push_back(arg);
+    }
+
+    int failures = 0;
+    try {
+        if (models.empty()) models = listCarModels("carmodels/carmodels.json");
+        for (const auto& name : models) {
+            CarModelConfig config = parseCarModelFile("carmodels/carmodels.json", name);
+            std::ostream quiet(nullptr);
+            osg::Matrix transform = applyCarModelTransformations(config, quiet);
+
+            std::cout << name << " (" << config.path << ")" << std::endl;
+            ModelLoadInfo cold, warm;
+            if (!keep) {
+                if (!loadOptimizedModel(config.path, transform, true, &cold)) {
+                    std::cerr << "Error: Unable to load file: " << config.path << std::endl;
+                    ++failures;
+                    continue;
+                }
+            }
+            if (!loadOptimizedModel(config.path, transform, false, &warm)) {
+                std::cerr << "Error: Unable to load file: " << config.path << std::endl;
+                ++failures;
+                continue;
+            }
+
+            std::cout << std::fixed << std::setprecision(1);
+            if (!keep) {
+                std::cout << "  cold load " << std::setw(8) << cold.totalMs() << " ms  (hash " << cold.hashMs
+                          << ", read " << cold.readMs << ", optimize " << cold.optimizeMs << ", write "
+                          << cold.writeMs << ", kd-trees " << cold.kdTreeMs << ")" << std::endl;
+            }
+            std::cout << "  warm load " << std::setw(8) << warm.totalMs() << " ms  (hash " << warm.hashMs
+                      << ", read " << warm.readMs << ", kd-trees " << warm.kdTreeMs << ")"
+                      << (warm.fromCache ? "" : "  [cache not used]") << std::endl;
+            if (!keep) printStats("before", cold.source);
+            printStats("after", warm.optimized);
+            std::cout << "  cache     " << warm.cachePath << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#include <osg/Matrix>
+#include <osg/Node>
+#include <stdint.h>
+#include <string>
+
+// What the renderer will have to do for a subgraph
+struct ModelStats {
+    unsigned geometries;
+    unsigned drawCalls;     // one per primitive set (one per length for DrawArrayLengths)
+    unsigned stateSets;     // distinct StateSet objects
+    size_t vertices;
+    size_t primitives;
+};
+
+ModelStats computeModelStats(osg::Node* node);
+
+// Timings (milliseconds) and statistics of one loadOptimizedModel() call
+struct ModelLoadInfo {
+    bool fromCache = false;
+    std::string cachePath;
+    double hashMs = 0.0, readMs = 0.0, optimizeMs = 0.0, writeMs = 0.0, kdTreeMs = 0.0;
+    ModelStats source = ModelStats();     // as exported (cold loads only)
+    ModelStats optimized = ModelStats();
+
+    double totalMs() const { return hashMs + readMs + optimizeMs + writeMs + kdTreeMs; }
+};
+
+// Hash of the source file's contents and the car model transform
+uint64_t modelCacheKey(const std::string& sourcePath, const osg::Matrix& transform);
+
+// Load a car model with `transform` baked into its vertices. The first load reads the
+// CAD export, flattens the transform, merges geometry, shares state, builds indexed
+// triangle strips and switches drawables to VBOs, then writes the result to
+// cacheDirectory()/model_<key>.osgb; later loads read that file directly. KdTrees (for
+// picking) are built after either path since .osgb does not store them.
+// Returns null if the source file cannot be read; a failed cache write only warns.
+osg::ref_ptr<osg::Node> loadOptimizedModel(const std::string& sourcePath, const osg::Matrix& transform,
+                                           bool rebuild = false, ModelLoadInfo* info = nullptr);
+
+// `visual modelcache ...` - rebuild the optimized model cache and report cold versus warm
+// load times and draw calls before/after optimization
+int runModelCacheCommand(int argc, char** argv);
+
+#endif
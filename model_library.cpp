@@ -0,0 +1,168 @@
+#include "model_library.h"
+#include "parallel_for.h"
+#include "trace.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+ModelLibrary::ModelLibrary()
+    : next_(0), first_(0), verboseFirst_(true), bundle_(nullptr)
+{
+}
+
+ModelLibrary::~ModelLibrary()
+{
+    // Let the workers run out of models instead of abandoning half-built scenes
+    next_ = order_.size();
+    for (auto& thread : threads_) thread.join();
+}
+
+void ModelLibrary::start(const std::vector<std::string>& names, size_t first, bool verboseFirst, unsigned threads,
+                         const ConfigBundle* bundle)
+{
+    entries_.resize(names.size());
+    order_.clear();
+    for (size_t i = 0; i < names.size(); ++i) {
+        entries_[i].name = names[i];
+        entries_[i].state = Pending;
+        entries_[i].seconds = 0.0;
+        entries_[i].meshState = Pending;
+        entries_[i].meshSeconds = 0.0;
+    }
+    if (names.empty()) return;
+
+    first_ = first < names.size() ? first : 0;
+    verboseFirst_ = verboseFirst;
+    bundle_ = bundle;
+    order_.push_back(first_);
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (i != first_) order_.push_back(i);
+    }
+
+    // osgDB::readNodeFile is safe to call concurrently for different files; model loading
+    // is mostly file I/O and plugin decoding, so a few threads are enough
+    if (threads == 0) threads = workerCount();
+    threads = static_cast<unsigned>(std::min<size_t>(threads, names.size()));
+    next_ = 0;
+    for (unsigned t = 0; t < threads; ++t) threads_.push_back(std::thread(&ModelLibrary::worker, this));
+}
+
+void ModelLibrary::worker()
+{
+    typedef std::chrono::steady_clock Clock;
+    static std::atomic<int> workerNumber(0);
+    Trace::setThreadName("model loader " + std::to_string(++workerNumber));
+    for (size_t n = next_++; n < order_.size(); n = next_++) {
+        size_t i = order_[n];
+        Entry& entry = entries_[i];
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            entry.state = Loading;
+        }
+
+        // Scenes are built off to the side and only published under the lock, so readers
+        // never see a half-built ModelScene
+        Clock::time_point t0 = Clock::now();
+        ModelScene scene;
+        bool verbose = verboseFirst_ && i == first_;
+        bool ok;
+        {
+            ScopedPhase phase("load model scene", entry.name);
+            ok = buildModelSceneWithoutMesh(entry.name, 0, verbose, scene, bundle_);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ok) entry.scene = scene;
+            entry.state = ok ? Ready : Failed;
+            entry.seconds = seconds;
+            entry.meshState = ok ? Loading : Failed;
+        }
+        done_.notify_all();
+        if (!ok) continue;
+
+        // The published scene is only read from here on; the mesh goes to a separate
+        // node that the viewer attaches (see takeCarNode)
+        osg::ref_ptr<osg::Node> carNode;
+        {
+            ScopedPhase phase("load car mesh", entry.name);
+            osg::ref_ptr<osg::Node> mesh = loadModelMesh(scene, verbose);
+            if (mesh) carNode = createCarNode(scene, mesh.get(), verbose);
+        }
+        ok = carNode.valid();
+        seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            entry.carNode = carNode;
+            entry.meshState = ok ? Ready : Failed;
+            entry.meshSeconds = seconds;
+        }
+
+        if (ok) {
+            // One write per line so concurrent loads do not interleave mid-line
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(2);
+            if (i == first_) line << "Loaded car mesh for " << entry.name << " (" << seconds << " s)\n";
+            else line << "Loaded model " << entry.name << " in the background (" << seconds << " s, "
+                      << scene.zones.size() << " zones)\n";
+            std::cout << line.str() << std::flush;
+        }
+    }
+}
+
+int ModelLibrary::indexOf(const std::string& name) const
+{
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].name == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+ModelLibrary::State ModelLibrary::state(size_t i) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_[i].state;
+}
+
+double ModelLibrary::loadSeconds(size_t i) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_[i].seconds;
+}
+
+ModelLibrary::State ModelLibrary::meshState(size_t i) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_[i].meshState;
+}
+
+double ModelLibrary::meshSeconds(size_t i) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_[i].meshSeconds;
+}
+
+ModelScene* ModelLibrary::get(size_t i)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_[i].state == Ready ? &entries_[i].scene : nullptr;
+}
+
+ModelScene* ModelLibrary::wait(size_t i)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&]() { return entries_[i].state == Ready || entries_[i].state == Failed; });
+    return entries_[i].state == Ready ? &entries_[i].scene : nullptr;
+}
+
+osg::ref_ptr<osg::Node> ModelLibrary::takeCarNode(size_t i)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    osg::ref_ptr<osg::Node> node = entries_[i].carNode;
+    entries_[i].carNode = nullptr;
+    return node;
+}
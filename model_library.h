@@ -0,0 +1,75 @@
+#ifndef MODEL_LIBRARY_H
+#define MODEL_LIBRARY_H
+
+#include "scene_builder.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every car model scene, built on a small pool of background threads so the viewer can
+// switch between models without reloading. Each model is a full ModelScene (its own
+// carmodels.json transform, calibration and zones) with all zones built.
+//
+// A model is loaded in two steps. Its scene without the car mesh (configs, zones, frustum)
+// is Ready within milliseconds; the mesh is loaded after it on the same thread and handed
+// out once by takeCarNode(), so the caller decides when it joins the live scene graph.
+class ModelLibrary {
+public:
+    enum State { Pending, Loading, Ready, Failed };
+
+    ModelLibrary();
+    ~ModelLibrary();  // waits for loads in flight
+
+    // Start loading `names`, model `first` ahead of the others. `verboseFirst` prints the
+    // usual scene diagnostics for that model. threads = 0 uses workerCount(). A config
+    // bundle, if given, must outlive the library.
+    void start(const std::vector<std::string>& names, size_t first, bool verboseFirst = true,
+               unsigned threads = 0, const ConfigBundle* bundle = nullptr);
+
+    size_t size() const { return entries_.size(); }
+    const std::string& name(size_t i) const { return entries_[i].name; }
+    int indexOf(const std::string& name) const;  // -1 if unknown
+
+    State state(size_t i) const;
+    double loadSeconds(size_t i) const;  // 0 until loaded
+    State meshState(size_t i) const;
+    double meshSeconds(size_t i) const;  // from the start of the model's load, 0 until loaded
+
+    // The model's scene once Ready, nullptr otherwise (never blocks)
+    ModelScene* get(size_t i);
+    // Block until the model is Ready (scene) or Failed (nullptr)
+    ModelScene* wait(size_t i);
+
+    // The car node (see createCarNode) for scene.carTransform the first time it is
+    // called after the mesh is loaded, nullptr otherwise (never blocks)
+    osg::ref_ptr<osg::Node> takeCarNode(size_t i);
+
+private:
+    struct Entry {
+        std::string name;
+        ModelScene scene;
+        State state;
+        double seconds;
+        osg::ref_ptr<osg::Node> carNode;
+        State meshState;
+        double meshSeconds;
+    };
+
+    void worker();
+
+    std::vector<Entry> entries_;
+    std::vector<size_t> order_;
+    std::atomic<size_t> next_;
+    size_t first_;
+    bool verboseFirst_;
+    const ConfigBundle* bundle_;
+    std::vector<std::thread> threads_;
+    mutable std::mutex mutex_;
+    std::condition_variable done_;
+};
+
+#endif
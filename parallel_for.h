@@ -0,0 +1,66 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Number of worker threads for data-parallel loops (hardware concurrency, at least 1)
+inline unsigned workerCount()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+// Split [0, count) into contiguous chunks and call fn(begin, end) for each on its own thread.
+// Chunks are at least minChunk long and a multiple of `align` (except the last), so SIMD
+// kernels only see a partial packet at the very end. threads = 0 uses workerCount().
+template<typename Fn>
+void parallelFor(size_t count, size_t minChunk, size_t align, unsigned threads, Fn fn)
+{
+    if (threads == 0) threads = workerCount();
+    if (align == 0) align = 1;
+    size_t chunks = std::min<size_t>(threads, std::max<size_t>(1, count / std::max<size_t>(minChunk, 1)));
+    if (chunks <= 1) {
+        fn(size_t(0), count);
+        return;
+    }
+
+    size_t chunk = (count + chunks - 1) / chunks;
+    chunk = (chunk + align - 1) / align * align;
+
+    std::vector<std::thread> workers;
+    workers.reserve(chunks - 1);
+    for (size_t begin = chunk; begin < count; begin += chunk) {
+        workers.push_back(std::thread(fn, begin, std::min(count, begin + chunk)));
+    }
+    fn(size_t(0), std::min(count, chunk));
+    for (auto& worker : workers) worker.join();
+}
+
+// Call fn(i) for every i in [0, count), handing out indices to threads one at a time.
+// For work items of uneven cost (image tiles, ...). threads = 0 uses workerCount().
+template<typename Fn>
+void parallelForEach(size_t count, unsigned threads, Fn fn)
+{
+    if (threads == 0) threads = workerCount();
+    threads = static_cast<unsigned>(std::min<size_t>(threads, count));
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) fn(i);
+    };
+    if (threads <= 1) {
+        worker();
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t) workers.push_back(std::thread(worker));
+    worker();
+    for (auto& w : workers) w.join();
+}
+
+#endif
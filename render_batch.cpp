@@ -0,0 +1,317 @@
+#include "render_batch.h"
+#include "scene_builder.h"
+#include "config_bundle.h"
+#include "zone_bvh.h"
+#include "disk_cache.h"
+#include "parallel_for.h"
+
+#include <osgViewer/Viewer>
+#include <osgDB/WriteFile>
+#include <osg/GraphicsContext>
+#include <osg/Image>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+
+std::vector<CameraPreset> cameraPresets(const ModelScene& scene)
+{
+    std::vector<CameraPreset> presets;
+    const osg::BoundingSphere bs = scene.root->getBound();
+    const osg::Vec3d c = bs.center();
+    const double r = bs.radius();
+
+    CameraPreset home = { "home", osg::Vec3d(0, -200, -5000), osg::Vec3d(0, 0, 0), osg::Vec3d(0, 1, 0) };
+    CameraPreset front = { "front", c + osg::Vec3d(0, 0.3 * r, 2.5 * r), c, osg::Vec3d(0, 1, 0) };
+    CameraPreset side = { "side", c + osg::Vec3d(2.5 * r, 0.3 * r, 0), c, osg::Vec3d(0, 1, 0) };
+    CameraPreset top = { "top", c + osg::Vec3d(0, 2.5 * r, 0), c, osg::Vec3d(0, 0, 1) };
+    presets.push_back(home);
+    presets.push_back(front);
+    presets.push_back(side);
+    presets.push_back(top);
+
+    // Camera axes in carCoord are the rows of the extrinsics rotation; image y points down
+    const CameraCalibration& cal = scene.calibration;
+    const double s = scene.metersToMmScale;
+    osg::Vec3d eye(cal.translation_vector[0] * s, cal.translation_vector[1] * s, cal.translation_vector[2] * s);
+    osg::Vec3d forward(cal.rotation_matrix[2][0], cal.rotation_matrix[2][1], cal.rotation_matrix[2][2]);
+    osg::Vec3d down(cal.rotation_matrix[1][0], cal.rotation_matrix[1][1], cal.rotation_matrix[1][2]);
+    CameraPreset camera = { "camera", eye, eye + forward * 1000.0, -down };
+    presets.push_back(camera);
+    return presets;
+}
+
+namespace {
+
+struct RenderJob {
+    std::string model;
+    int zone;            // 0 = all zones
+    std::string preset;
+};
+
+struct RenderOptions {
+    std::string outputDir = "renders";
+    int width = 1280, height = 960;
+    bool useFbo = true;
+    const ConfigBundle* bundle = nullptr;  // configs from a bundle instead of the JSON files
+};
+
+std::vector<std::string> splitList(const std::string& s)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+std::string outputPath(const RenderOptions& options, const RenderJob& job)
+{
+    char zone[32];
+    if (job.zone) snprintf(zone, sizeof(zone), "zone%02d", job.zone);
+    else snprintf(zone, sizeof(zone), "allzones");
+    return options.outputDir + "/" + job.model + "_" + zone + "_" + job.preset + ".png";
+}
+
+// Render a contiguous slice of the job list; one scene is built per model
+int renderJobs(const std::vector<RenderJob>& jobs, const RenderOptions& options, const std::string& workerName)
+{
+    typedef std::chrono::steady_clock Clock;
+    osgViewer::Viewer viewer;
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    if (!setupOffscreenViewer(viewer, options.width, options.height, options.useFbo, image.get())) return 1;
+
+    ModelScene scene;
+    std::vector<CameraPreset> presets;
+    int failures = 0;
+    for (const auto& job : jobs) {
+        if (scene.name != job.model) {
+            Clock::time_point t0 = Clock::now();
+            scene = ModelScene();
+            if (!buildModelScene(job.model, 0, false, scene, options.bundle)) {
+                ++failures;
+                continue;
+            }
+            viewer.setSceneData(scene.root.get());
+            presets = cameraPresets(scene);
+            std::cout << workerName << "loaded " << job.model << " in " << std::fixed << std::setprecision(2)
+                      << std::chrono::duration<double>(Clock::now() - t0).count() << " s" << std::endl;
+        }
+        if (!scene.root.valid()) {
+            ++failures;
+            continue;
+        }
+
+        auto preset = std::find_if(presets.begin(), presets.end(),
+                                   [&](const CameraPreset& p) { return p.name == job.preset; });
+        if (preset == presets.end()) {
+            std::cerr << workerName << "Error: Unknown camera preset '" << job.preset << "'" << std::endl;
+            ++failures;
+            continue;
+        }
+
+        Clock::time_point t0 = Clock::now();
+        showZone(scene, job.zone);
+        viewer.getCamera()->setViewMatrixAsLookAt(preset->eye, preset->center, preset->up);
+        viewer.frame();
+
+        std::string path = outputPath(options, job);
+        if (!osgDB::writeImageFile(*image, path)) {
+            std::cerr << workerName << "Error: Cannot write " << path << std::endl;
+            ++failures;
+            continue;
+        }
+        std::cout << workerName << path << " (" << std::fixed << std::setprecision(0)
+                  << std::chrono::duration<double, std::milli>(Clock::now() - t0).count() << " ms)" << std::endl;
+    }
+    return failures ? 1 : 0;
+}
+
+void printRenderUsage()
+{
+    std::cout << "Usage: visual render [-o <dir>] [--models a,b,...] [--zones 0,9,...] [--presets home,front,...]" << std::endl;
+    std::cout << "                     [--size WxH] [--jobs N] [--no-fbo] [--bundle <file.vbundle>]" << std::endl;
+    std::cout << "  Renders every model x zone x preset combination to <dir>/<model>_<zone>_<preset>.png" << std::endl;
+    std::cout << "  Defaults: all models in carmodels.json; every zone plus 0 (all zones);" << std::endl;
+    std::cout << "  presets home, front, side, top, camera; 1280x960; one worker process per core" << std::endl;
+    std::cout << "  --bundle reads the configs from a bundle (see visual bundle); the JSON files if it is stale" << std::endl;
+    std::cout << "  Without a display, run under xvfb-run (Mesa software rendering works)" << std::endl;
+}
+
+} // namespace
+
+std::string offscreenRendererName(osgViewer::Viewer& viewer)
+{
+    if (!viewer.isRealized()) viewer.realize();
+    osg::GraphicsContext* gc = viewer.getCamera()->getGraphicsContext();
+    // The offscreen viewer is single-threaded, so the main thread may borrow the context
+    if (!gc || !gc->makeCurrent()) return "unknown renderer";
+    const GLubyte* renderer = glGetString(GL_RENDERER);
+    const GLubyte* version = glGetString(GL_VERSION);
+    std::string name = renderer ? reinterpret_cast<const char*>(renderer) : "unknown renderer";
+    if (version) name += std::string(", OpenGL ") + reinterpret_cast<const char*>(version);
+    gc->releaseContext();
+    return name;
+}
+
+bool setupOffscreenViewer(osgViewer::Viewer& viewer, int width, int height, bool useFbo, osg::Image* image)
+{
+    osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits;
+    traits->readDISPLAY();
+    traits->x = 0;
+    traits->y = 0;
+    traits->width = width;
+    traits->height = height;
+    traits->red = traits->green = traits->blue = traits->alpha = 8;
+    traits->depth = 24;
+    traits->windowDecoration = false;
+    traits->doubleBuffer = false;
+    traits->pbuffer = true;
+
+    osg::ref_ptr<osg::GraphicsContext> gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+    if (!gc.valid()) {
+        std::cerr << "Error: Cannot create an offscreen (pbuffer) context. "
+                  << "On machines without a display run under xvfb-run; Mesa software rendering is supported."
+                  << std::endl;
+        return false;
+    }
+
+    image->allocateImage(width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    osg::Camera* camera = viewer.getCamera();
+    camera->setGraphicsContext(gc.get());
+    camera->setViewport(0, 0, width, height);
+    camera->setProjectionMatrixAsPerspective(30.0, double(width) / height, 1.0, 100000.0);
+    camera->setClearColor(osg::Vec4(0.2f, 0.2f, 0.4f, 1.0f));
+    if (useFbo) camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    camera->attach(osg::Camera::COLOR_BUFFER, image);
+
+    viewer.setThreadingModel(osgViewer::Viewer::SingleThreaded);
+    viewer.realize();
+    return true;
+}
+
+int runRenderCommand(int argc, char** argv)
+{
+    RenderOptions options;
+    std::vector<std::string> models, presetNames;
+    std::vector<int> zoneFilter;
+    unsigned jobs = 0;
+    std::string bundlePath;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) options.outputDir = argv[++i];
+        else if (arg == "--models" && i + 1 < argc) models = splitList(argv[++i]);
+        else if (arg == "--presets" && i + 1 < argc) presetNames = splitList(argv[++i]);
+        else if (arg == "--zones" && i + 1 < argc) {
+            for (const auto& z : splitList(argv[++i])) zoneFilter.push_back(std::atoi(z.c_str()));
+        }
+        else if (arg == "--size" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 || options.height <= 0) {
+                std::cerr << "Error: Invalid size '" << argv[i] << "'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--jobs" && i + 1 < argc) jobs = std::atoi(argv[++i]);
+        else if (arg == "--no-fbo") options.useFbo = false;
+        else if (arg == "--bundle" && i + 1 < argc) bundlePath = argv[++i];
+        else if (arg == "--help" || arg == "-h") { printRenderUsage(); return 0; }
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printRenderUsage();
+            return 1;
+        }
+    }
+    if (presetNames.empty()) presetNames = { "home", "front", "side", "top", "camera" };
+
+    // Job list, grouped by model so each worker loads as few models as possible
+    ConfigBundle bundle;
+    std::vector<RenderJob> allJobs;
+    try {
+        if (!bundlePath.empty()) {
+            bundle.open(bundlePath);
+            std::vector<std::string> stale = bundle.staleSources();
+            for (const auto& path : stale) {
+                std::cerr << "Warning: " << path << " changed since " << bundlePath << " was written" << std::endl;
+            }
+            if (stale.empty()) options.bundle = &bundle;
+            else std::cerr << "Warning: Loading the JSON configs instead; run 'visual bundle' to update it" << std::endl;
+        }
+        if (models.empty()) models = options.bundle ? bundle.modelNames() : listCarModels("carmodels/carmodels.json");
+        for (const auto& model : models) {
+            std::vector<int> zoneIds = zoneFilter;
+            if (zoneIds.empty()) {
+                zoneIds.push_back(0);
+                int index = options.bundle ? bundle.indexOf(model) : -1;
+                std::vector<ViewingZone> zones;
+                if (index >= 0) zones = bundle.zones(index);
+                else zones = parseViewingZonesFile("carmodels/" + model + "/config/viewingzones.json");
+                for (const auto& zone : zones) {
+                    if (!isZoneDegenerate(zone)) zoneIds.push_back(zone.id);
+                }
+            }
+            for (int zone : zoneIds) {
+                for (const auto& preset : presetNames) {
+                    RenderJob job = { model, zone, preset };
+                    allJobs.push_back(job);
+                }
+            }
+        }
+        makeDirectories(options.outputDir);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (jobs == 0) jobs = workerCount();
+    jobs = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(jobs, allJobs.size())));
+    std::cout << "Rendering " << allJobs.size() << " images (" << models.size() << " model(s)) at "
+              << options.width << "x" << options.height << " with " << jobs << " worker(s)" << std::endl;
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point t0 = Clock::now();
+    int exitCode = 0;
+    if (jobs == 1) {
+        exitCode = renderJobs(allJobs, options, "");
+    } else {
+        // GL contexts do not mix well with threads, so each worker is a separate process
+        // with its own context, rendering a contiguous slice of the job list
+        std::cout.flush();
+        std::vector<pid_t> workers;
+        size_t chunk = (allJobs.size() + jobs - 1) / jobs;
+        for (unsigned w = 0; w < jobs; ++w) {
+            size_t begin = w * chunk, end = std::min(allJobs.size(), begin + chunk);
+            if (begin >= end) break;
+            pid_t pid = fork();
+            if (pid < 0) {
+                std::cerr << "Error: fork failed" << std::endl;
+                exitCode = 1;
+                break;
+            }
+            if (pid == 0) {
+                std::vector<RenderJob> slice(allJobs.begin() + begin, allJobs.begin() + end);
+                int code = renderJobs(slice, options, "[worker " + std::to_string(w) + "] ");
+                std::cout.flush();
+                _exit(code);
+            }
+            workers.push_back(pid);
+        }
+        for (pid_t pid : workers) {
+            int status = 0;
+            if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) exitCode = 1;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    std::cout << "Rendered " << allJobs.size() << " images in " << std::fixed << std::setprecision(1) << seconds
+              << " s" << (exitCode ? " (with errors)" : "") << std::endl;
+    return exitCode;
+}
@@ -0,0 +1,36 @@
+#ifndef RENDER_BATCH_H
+#define RENDER_BATCH_H
+
+#include <osg/Vec3d>
+#include <string>
+#include <vector>
+
+struct ModelScene;
+namespace osg { class Image; }
+namespace osgViewer { class Viewer; }
+
+// A named view of a model scene
+struct CameraPreset {
+    std::string name;
+    osg::Vec3d eye, center, up;
+};
+
+// home   - the interactive viewer's start view (behind the car)
+// front, side, top - looking at the scene bounds from +Z, +X and +Y
+// camera - from the DMS camera center along its optical axis
+std::vector<CameraPreset> cameraPresets(const ModelScene& scene);
+
+// Offscreen single-threaded viewer. The context is a pbuffer (works with Mesa llvmpipe
+// under Xvfb); the camera renders into an FBO (or the pbuffer itself) and each frame is
+// read back into `image`. Prints an error and returns false if no context can be created.
+bool setupOffscreenViewer(osgViewer::Viewer& viewer, int width, int height, bool useFbo, osg::Image* image);
+
+// GL_RENDERER and GL_VERSION of the offscreen viewer's context (realizing it if needed), so
+// timings printed next to it say whether they come from Mesa or a GPU
+std::string offscreenRendererName(osgViewer::Viewer& viewer);
+
+// `visual render ...` - headless offscreen sweep over model x zone x camera preset,
+// one PNG per combination
+int runRenderCommand(int argc, char** argv);
+
+#endif
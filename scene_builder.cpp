@@ -0,0 +1,500 @@
+#include "scene_builder.h"
+#include "camera_frustum.h"
+#include "zone_bvh.h"
+#include "model_cache.h"
+#include "trace.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/ShapeDrawable>
+#include <osgText/Text>
+#include <iostream>
+#include <iomanip>
+#include <float.h>
+#include <cstdio>
+
+// Helper to create a coordinate axes with arrowheads at the origin
+osg::ref_ptr<osg::Node> createAxesWithArrows(float axisLength, float arrowWing)
+{
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode();
+    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry();
+    osg::ref_ptr<osg::Vec3Array> verts = new osg::Vec3Array();
+    osg::ref_ptr<osg::Vec4Array> cols = new osg::Vec4Array();
+
+    // X axis (red, left/right)
+    verts->push_back(osg::Vec3(0,0,0)); verts->push_back(osg::Vec3(axisLength,0,0));
+    cols->push_back(osg::Vec4(1,0,0,1)); cols->push_back(osg::Vec4(1,0,0,1));
+    verts->push_back(osg::Vec3(axisLength,0,0)); verts->push_back(osg::Vec3(axisLength-arrowWing, arrowWing*0.5, 0));
+    cols->push_back(osg::Vec4(1,0,0,1)); cols->push_back(osg::Vec4(1,0,0,1));
+    verts->push_back(osg::Vec3(axisLength,0,0)); verts->push_back(osg::Vec3(axisLength-arrowWing, -arrowWing*0.5, 0));
+    cols->push_back(osg::Vec4(1,0,0,1)); cols->push_back(osg::Vec4(1,0,0,1));
+
+    // Y axis (green, up)
+    verts->push_back(osg::Vec3(0,0,0)); verts->push_back(osg::Vec3(0,axisLength,0));
+    cols->push_back(osg::Vec4(0,1,0,1)); cols->push_back(osg::Vec4(0,1,0,1));
+    verts->push_back(osg::Vec3(0,axisLength,0)); verts->push_back(osg::Vec3(arrowWing*0.5, axisLength-arrowWing, 0));
+    cols->push_back(osg::Vec4(0,1,0,1)); cols->push_back(osg::Vec4(0,1,0,1));
+    verts->push_back(osg::Vec3(0,axisLength,0)); verts->push_back(osg::Vec3(-arrowWing*0.5, axisLength-arrowWing, 0));
+    cols->push_back(osg::Vec4(0,1,0,1)); cols->push_back(osg::Vec4(0,1,0,1));
+
+    // Z axis (blue, forward)
+    verts->push_back(osg::Vec3(0,0,0)); verts->push_back(osg::Vec3(0,0,axisLength));
+    cols->push_back(osg::Vec4(0,0,1,1)); cols->push_back(osg::Vec4(0,0,1,1));
+    verts->push_back(osg::Vec3(0,0,axisLength)); verts->push_back(osg::Vec3(0, arrowWing*0.5, axisLength-arrowWing));
+    cols->push_back(osg::Vec4(0,0,1,1)); cols->push_back(osg::Vec4(0,0,1,1));
+    verts->push_back(osg::Vec3(0,0,axisLength)); verts->push_back(osg::Vec3(0, -arrowWing*0.5, axisLength-arrowWing));
+    cols->push_back(osg::Vec4(0,0,1,1)); cols->push_back(osg::Vec4(0,0,1,1));
+
+    geom->setVertexArray(verts);
+    osg::ref_ptr<osg::DrawArrays> drawArrays = new osg::DrawArrays(GL_LINES, 0, verts->size());
+    geom->addPrimitiveSet(drawArrays);
+    geom->setColorArray(cols, osg::Array::BIND_PER_VERTEX);
+
+    geode->addDrawable(geom);
+    geode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    return geode;
+}
+
+// Frustum colour of the index-th camera of a rig: green first, then cyan, magenta, ...
+osg::Vec4 rigCameraColor(size_t index)
+{
+    static const osg::Vec4 colors[] = { osg::Vec4(0, 1, 0, 1), osg::Vec4(0, 1, 1, 1), osg::Vec4(1, 0, 1, 1),
+                                        osg::Vec4(1, 1, 0, 1), osg::Vec4(1, 0.5f, 0, 1), osg::Vec4(0.5f, 0.5f, 1, 1) };
+    return colors[index % (sizeof(colors) / sizeof(colors[0]))];
+}
+
+// The pinhole frustum in camera coordinates (x right, y down, z along the optical axis):
+// edges from the camera center to the sensor corners at `depth`, the far rectangle and the
+// optical axis
+osg::ref_ptr<osg::Node> createCameraFrustum(const CameraModel& camera, float depth, const osg::Vec4& color)
+{
+    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry();
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array();
+    const double w = camera.imageWidth, h = camera.imageHeight;
+    const double pixels[4][2] = { { 0, 0 }, { w, 0 }, { w, h }, { 0, h } };
+    vertices->push_back(osg::Vec3(0, 0, 0));
+    for (const auto& pixel : pixels) {
+        vertices->push_back(osg::Vec3((pixel[0] - camera.cx) / camera.fx, (pixel[1] - camera.cy) / camera.fy, 1.0) * depth);
+    }
+    vertices->push_back(osg::Vec3(0, 0, depth));
+    geom->setVertexArray(vertices);
+
+    osg::ref_ptr<osg::DrawElementsUInt> indices = new osg::DrawElementsUInt(GL_LINES);
+    for (unsigned i = 1; i <= 4; ++i) {
+        indices->push_back(0);
+        indices->push_back(i);
+        indices->push_back(i);
+        indices->push_back(i % 4 + 1);
+    }
+    indices->push_back(0);
+    indices->push_back(5);
+    geom->addPrimitiveSet(indices);
+
+    // Pyramid in the camera's colour (green for a single camera), optical axis darker
+    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array(6);
+    for (unsigned i = 0; i < 5; ++i) (*colors)[i] = color;
+    (*colors)[5] = osg::Vec4(color.r() * 0.5f, color.g() * 0.5f, color.b() * 0.5f, color.a());
+    geom->setColorArray(colors, osg::Array::BIND_PER_VERTEX);
+
+    osg::ref_ptr<osg::Geode> frustumGeode = new osg::Geode();
+    frustumGeode->addDrawable(geom);
+    frustumGeode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    return frustumGeode;
+}
+
+// The text drawn for a zone: its label without the leading word ("Zone 12" -> "12")
+std::string shortZoneLabel(const std::string& label)
+{
+    // Extract just the number from label (e.g., "Zone 1" -> "1")
+    std::string numberOnly = label;
+    size_t spacePos = numberOnly.find(' ');
+    if (spacePos != std::string::npos) {
+        numberOnly = numberOnly.substr(spacePos + 1);
+    }
+    return numberOnly;
+}
+
+osg::ref_ptr<osgText::Text> createZoneLabel(const osg::Vec3& position, const std::string& label)
+{
+    // Create the label at zone center with smaller, cleaner display
+    osg::ref_ptr<osgText::Text> zoneText = new osgText::Text;
+    zoneText->setCharacterSize(50.0f); // Smaller, more appropriate size
+    zoneText->setAxisAlignment(osgText::TextBase::SCREEN);
+    zoneText->setPosition(position);
+    
+    zoneText->setText(shortZoneLabel(label));
+    
+    zoneText->setColor(osg::Vec4(1,1,1,1)); // White text
+    zoneText->setAlignment(osgText::Text::CENTER_CENTER); // Center the text
+    
+    // Add black outline/background for better contrast
+    zoneText->setBackdropType(osgText::Text::OUTLINE);
+    zoneText->setBackdropColor(osg::Vec4(0,0,0,0.8f)); // Semi-transparent black outline
+
+    return zoneText;
+}
+
+bool buildModelSceneWithoutMesh(const std::string& carModelName, int displayZoneNumber, bool verbose,
+                                ModelScene& scene, const ConfigBundle* bundle)
+{
+    // Diagnostics go nowhere unless verbose
+    std::ostream quiet(nullptr);
+    std::ostream& log = verbose ? std::cout : quiet;
+
+    CarModelConfig carModel;
+    osg::Matrix transformMatrix;
+    std::string configPath = "carmodels/" + carModelName + "/config";
+    CameraCalibration cameraConfig;
+    std::vector<CameraCalibration> cameras;
+    std::vector<ViewingZone> viewingZones;
+
+    if (bundle) {
+        // Everything parsed and the transformations already applied when the bundle was compiled
+        int index = bundle->indexOf(carModelName);
+        if (index < 0 || !bundle->hasConfig(index)) {
+            std::cerr << "Error loading car model '" << carModelName << "': "
+                      << (index < 0 ? "not in bundle " : "no calibration and zones in bundle ") << bundle->path()
+                      << std::endl;
+            return false;
+        }
+        ScopedPhase phase("bundled config", carModelName);
+        carModel = bundle->carModel(index);
+        transformMatrix = bundle->modelTransform(index);
+        cameras = bundle->cameras(index);
+        cameraConfig = cameras[0];
+        viewingZones = bundle->zones(index);
+        log << "Loaded " << carModelName << " configuration from " << bundle->path() << " (" << viewingZones.size()
+            << " zones)" << std::endl;
+    } else {
+        // Load car model configuration
+        try {
+            ScopedPhase phase("car model config", carModelName);
+            carModel = verbose ? loadCarModel(carModelName)
+                               : parseCarModelFile("carmodels/carmodels.json", carModelName);
+        } catch (const std::exception& e) {
+            std::cerr << "Error loading car model '" << carModelName << "': " << e.what() << std::endl;
+            return false;
+        }
+
+        // Car model transformations from carmodels.json are baked into the optimized model,
+        // which loadModelMesh() reads later
+        transformMatrix = applyCarModelTransformations(carModel, log);
+
+        // Load configuration from JSON files - dynamic path based on car model
+        try {
+            ScopedPhase phase("calibration and zone config", carModelName);
+            cameras = verbose ? loadCalibration(configPath) : parseCalibrationRig(configPath + "/calibraton.json");
+            cameraConfig = cameras[0];
+            viewingZones = verbose ? loadViewingZones(configPath) : parseViewingZonesFile(configPath + "/viewingzones.json");
+        } catch (const std::exception& e) {
+            std::cerr << "Error loading configuration: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    // The number of zones comes from the config file; check the requested one exists
+    if (displayZoneNumber > 0) {
+        bool found = false;
+        for (const auto& zone : viewingZones) found = found || zone.id == displayZoneNumber;
+        if (!found) {
+            std::cerr << "Error: Zone " << displayZoneNumber << " is not defined in " << configPath
+                      << "/viewingzones.json (" << viewingZones.size() << " zones)" << std::endl;
+            return false;
+        }
+    }
+
+    // Use loaded calibration data
+    double R[3][3];
+    double t[3];
+    
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            R[i][j] = cameraConfig.rotation_matrix[i][j];
+        }
+        t[i] = cameraConfig.translation_vector[i];
+    }
+
+    // Print rotation matrix
+    log << "\nRotation Matrix (R):" << std::endl;
+    for (int i = 0; i < 3; ++i) {
+        log << "[";
+        for (int j = 0; j < 3; ++j) {
+            log << std::setw(12) << std::setprecision(8) << std::fixed << R[i][j];
+            if (j < 2) log << ", ";
+        }
+        log << "]" << std::endl;
+    }
+
+    // Print translation vector
+    log << "\nTranslation Vector (t):" << std::endl;
+    log << "[" << std::setw(12) << std::setprecision(8) << std::fixed << t[0] 
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << t[1]
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << t[2] << "]" << std::endl;
+
+    // Print the complete 4x4 extrinsics matrix
+    log << "\nComplete Extrinsics Matrix (4x4):" << std::endl;
+    log << "[" << std::setw(12) << std::setprecision(8) << std::fixed << R[0][0]
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[0][1]
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[0][2]
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << t[0] << "]" << std::endl;
+    log << "[" << std::setw(12) << std::setprecision(8) << std::fixed << R[1][0]
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[1][1]
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[1][2]
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << t[1] << "]" << std::endl;
+    log << "[" << std::setw(12) << std::setprecision(8) << std::fixed << R[2][0]
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[2][1]
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[2][2]
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << t[2] << "]" << std::endl;
+    log << "[" << std::setw(12) << std::setprecision(8) << std::fixed << 0.0
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << 0.0
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << 0.0
+              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << 1.0 << "]" << std::endl;
+
+    // Use configuration values for scale factors
+    float metersToMmScale = cameraConfig.meters_to_mm_scale;
+
+    // Per our analysis, the camera center is the translation part of the extrinsics.
+    double cameraCenter[3] = {t[0], t[1], t[2]};
+
+    log << "Estimated camera center (m): "
+              << cameraCenter[0] << ", "
+              << cameraCenter[1] << ", "
+              << cameraCenter[2] << std::endl;
+
+    ScopedPhase buildPhase("build scene graph", carModelName);
+
+    // Each camera's frustum and center sphere and the axes are filled in by
+    // updateSceneCalibration(), which also applies calibraton.json hot reloads
+    osg::ref_ptr<osg::Group> cameraMarkers = new osg::Group();
+    cameraMarkers->setNodeMask(kCameraMarkerMask);
+    osg::ref_ptr<osg::Group> axes = new osg::Group();
+    osg::Vec3 camCenterMm = carCoord(cameraCenter[0], cameraCenter[1], cameraCenter[2]) * metersToMmScale;
+
+    osg::ref_ptr<osgText::Text> text = new osgText::Text;
+    text->setCharacterSize(80.0f); // Increase size for mm scale
+    text->setAxisAlignment(osgText::TextBase::SCREEN);
+    text->setPosition(camCenterMm + osg::Vec3(0, 0, 100.0f)); // Offset by 100mm
+    char label[128];
+    snprintf(label, sizeof(label), "Camera center:\n%.3f, %.3f, %.3f (m)",
+             cameraCenter[0], cameraCenter[1], cameraCenter[2]);
+    text->setText(label);
+    text->setColor(osg::Vec4(1, 0, 0, 1));
+
+    osg::ref_ptr<osg::Geode> textGeode = new osg::Geode();
+    textGeode->addDrawable(text);
+    textGeode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+
+    // ----------- Viewing Zones Visualization -----------
+    // Viewing zones are now loaded from JSON configuration
+
+    if (displayZoneNumber == 0) {
+        log << "\n=== CREATING ALL VIEWING ZONES ===" << std::endl;
+    } else {
+        log << "\n=== CREATING ONLY ZONE " << displayZoneNumber << " ===" << std::endl;
+    }
+
+    for (const auto& zone : viewingZones) {
+        if (isZoneDegenerate(zone)) {
+            log << "Skipping " << zone.label << " - all zero coordinates" << std::endl;
+        }
+    }
+
+    // Zones are ONLY scaled to millimeters. They do NOT get the car model's transformations
+    // because the zone coordinates are already defined relative to the transformed car.
+    // Every zone is built into one batch; showing a single zone just hides the others.
+    osg::ref_ptr<ZoneBatch> zoneBatch = new ZoneBatch(viewingZones, metersToMmScale);
+    if (displayZoneNumber > 0) zoneBatch->showOnly(displayZoneNumber);
+
+    log << "=== Created " << zoneBatch->zoneCount() << " viewing zone(s), "
+        << zoneBatch->vertexCount() << " shared vertices ===" << std::endl;
+
+    // The car transformations are already in the model's vertices (loadOptimizedModel),
+    // so this transform stays identity; it is the attachment point for createCarNode()
+    osg::ref_ptr<osg::MatrixTransform> carTransform = new osg::MatrixTransform();
+
+    osg::ref_ptr<osg::Group> root = new osg::Group();
+    root->addChild(carTransform);             // Car mesh and name text, once loaded
+    root->addChild(cameraMarkers.get());      // Frustums at the calibrated poses, red circles at camera centers
+    // root->addChild(textGeode);             // Red circle's label - HIDDEN
+    root->addChild(axes.get());               // World coordinate axes at origin
+    root->addChild(zoneBatch.get());
+
+    // Debug scene graph structure
+    log << "\nScene Graph Structure:" << std::endl;
+    log << "Root children: " << root->getNumChildren() << std::endl;
+    log << "  - Viewing zones batch children: " << zoneBatch->getNumChildren() << std::endl;
+
+    scene.name = carModelName;
+    scene.carModel = carModel;
+    scene.calibration = cameraConfig;
+    scene.zones = viewingZones;
+    scene.metersToMmScale = metersToMmScale;
+    scene.modelTransform = transformMatrix;
+    scene.root = root.get();
+    scene.carTransform = carTransform.get();
+    scene.zoneBatch = zoneBatch.get();
+    scene.cameraMarkers = cameraMarkers.get();
+    scene.axes = axes.get();
+    updateSceneCalibration(scene, cameras);
+    return true;
+}
+
+osg::ref_ptr<osg::Node> loadModelMesh(const ModelScene& scene, bool verbose)
+{
+    std::ostream quiet(nullptr);
+    std::ostream& log = verbose ? std::cout : quiet;
+
+    ModelLoadInfo loadInfo;
+    osg::ref_ptr<osg::Node> model = loadOptimizedModel(scene.carModel.path, scene.modelTransform, false, &loadInfo);
+    if (!model)
+    {
+        std::cerr << "Error: Unable to load file: " << scene.carModel.path << std::endl;
+        return nullptr;
+    }
+    log << (loadInfo.fromCache ? "Loaded optimized model " : "Optimized model and cached it as ")
+        << loadInfo.cachePath << " (" << loadInfo.totalMs() << " ms, " << loadInfo.optimized.drawCalls
+        << " draw calls)" << std::endl;
+    return model;
+}
+
+osg::ref_ptr<osg::Node> createCarNode(const ModelScene& scene, osg::Node* model, bool verbose)
+{
+    std::ostream quiet(nullptr);
+    std::ostream& log = verbose ? std::cout : quiet;
+    const std::string& carModelName = scene.name;
+
+    // Bounds in the model's own (exported) space, as used for the name label below
+    const osg::BoundingSphere& bakedBound = model->getBound();
+    osg::BoundingSphere bs(bakedBound.center() * osg::Matrix::inverse(scene.modelTransform),
+                           bakedBound.radius() / scene.modelTransform.getScale().x());
+    log << "Model center: " << bs.center().x() << ", " << bs.center().y() << ", " << bs.center().z() << std::endl;
+    log << "Model radius: " << bs.radius() << std::endl;
+    
+    // Calculate model bounding box for comparison with zones
+    osg::Vec3 modelMin = bs.center() - osg::Vec3(bs.radius(), bs.radius(), bs.radius());
+    osg::Vec3 modelMax = bs.center() + osg::Vec3(bs.radius(), bs.radius(), bs.radius());
+    log << "Model bounds: Min(" << modelMin.x() << ", " << modelMin.y() << ", " << modelMin.z() << ")" << std::endl;
+    log << "              Max(" << modelMax.x() << ", " << modelMax.y() << ", " << modelMax.z() << ")" << std::endl;
+
+    osg::ref_ptr<osgText::Text> carNameText = new osgText::Text;
+    carNameText->setCharacterSize(1.0f);
+    carNameText->setAxisAlignment(osgText::TextBase::SCREEN);
+    carNameText->setPosition(carCoord(0, 0, 1.2f));
+    carNameText->setText(carModelName);
+    carNameText->setColor(osg::Vec4(1, 1, 0, 1));
+
+    osg::ref_ptr<osg::Geode> carNameGeode = new osg::Geode();
+    carNameGeode->addDrawable(carNameText);
+    carNameGeode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+
+    osg::Vec3 modelCenter = bs.center();
+    float scale = bs.radius() * 0.2;
+
+    // This transform is only for the car name text, to keep it near the car model.
+    osg::ref_ptr<osg::MatrixTransform> overlayTransform = new osg::MatrixTransform;
+    overlayTransform->setMatrix(
+        osg::Matrix::scale(scale, scale, scale) *
+        osg::Matrix::translate(modelCenter)
+    );
+    overlayTransform->addChild(carNameGeode);
+    // The camera frustum and red circle are NO LONGER here. They are added to the root directly.
+    // overlayTransform->addChild(cameraPose.get());
+    // overlayTransform->addChild(camCenterGeode);
+    // overlayTransform->addChild(textGeode);
+
+    osg::ref_ptr<osg::Group> car = new osg::Group();
+    car->addChild(model);
+    car->addChild(overlayTransform);          // Car name text
+    return car;
+}
+
+bool buildModelScene(const std::string& carModelName, int displayZoneNumber, bool verbose, ModelScene& scene,
+                     const ConfigBundle* bundle)
+{
+    if (!buildModelSceneWithoutMesh(carModelName, displayZoneNumber, verbose, scene, bundle)) return false;
+    osg::ref_ptr<osg::Node> model = loadModelMesh(scene, verbose);
+    if (!model) return false;
+    scene.carTransform->addChild(createCarNode(scene, model.get(), verbose));
+    return true;
+}
+
+void updateSceneCalibration(ModelScene& scene, const std::vector<CameraCalibration>& cameras)
+{
+    // The visualization parameters are shared by the whole rig; every camera carries a copy
+    const CameraCalibration& calibration = cameras[0];
+    const CameraCalibration& old = scene.calibration;
+    bool initial = scene.cameraPoses.empty();
+    float metersToMmScale = calibration.meters_to_mm_scale;
+
+    // Cameras removed from the rig lose their markers, added ones get empty transforms
+    while (scene.cameraPoses.size() > cameras.size()) {
+        scene.cameraMarkers->removeChild(scene.cameraPoses.back().get());
+        scene.cameraMarkers->removeChild(scene.cameraCenters.back().get());
+        scene.cameraPoses.pop_back();
+        scene.cameraCenters.pop_back();
+    }
+    size_t existing = scene.cameraPoses.size();
+    while (scene.cameraPoses.size() < cameras.size()) {
+        scene.cameraPoses.push_back(new osg::MatrixTransform());
+        scene.cameraCenters.push_back(new osg::MatrixTransform());
+        scene.cameraMarkers->addChild(scene.cameraPoses.back().get());
+        scene.cameraMarkers->addChild(scene.cameraCenters.back().get());
+    }
+
+    for (size_t i = 0; i < cameras.size(); ++i) {
+        const CameraCalibration& c = cameras[i];
+        bool added = i >= existing;
+        const CameraCalibration& previous = added ? c : scene.cameras[i];
+
+        // The frustum is built in camera coordinates from the intrinsics and posed by the
+        // extrinsics, in millimeters. It is drawn 0.3 m x frustum_scale_factor deep.
+        CameraModel camera(c);
+        scene.cameraPoses[i]->setMatrix(cameraPoseMatrix(camera) * osg::Matrix::scale(metersToMmScale, metersToMmScale, metersToMmScale));
+        if (added || c.focal_length_X != previous.focal_length_X || c.focal_length_Y != previous.focal_length_Y ||
+            c.principal_point_X != previous.principal_point_X || c.principal_point_Y != previous.principal_point_Y ||
+            calibration.frustum_scale_factor != old.frustum_scale_factor) {
+            scene.cameraPoses[i]->removeChildren(0, scene.cameraPoses[i]->getNumChildren());
+            scene.cameraPoses[i]->addChild(createCameraFrustum(camera, 0.3f * calibration.frustum_scale_factor, rigCameraColor(i)));
+        }
+
+        // The red sphere is placed at the calculated camera center (the translation part of
+        // the extrinsics), scaled to millimeters.
+        const double* t = c.translation_vector;
+        scene.cameraCenters[i]->setMatrix(osg::Matrix::translate(carCoord(t[0], t[1], t[2]) * metersToMmScale));
+        if (added || calibration.camera_sphere_radius_mm != old.camera_sphere_radius_mm) {
+            osg::ref_ptr<osg::ShapeDrawable> camCenterDrawable =
+                new osg::ShapeDrawable(new osg::Sphere(osg::Vec3(), calibration.camera_sphere_radius_mm));
+            camCenterDrawable->setColor(osg::Vec4(1, 0, 0, 1));
+            osg::ref_ptr<osg::Geode> camCenterGeode = new osg::Geode();
+            camCenterGeode->addDrawable(camCenterDrawable);
+            camCenterGeode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+            scene.cameraCenters[i]->removeChildren(0, scene.cameraCenters[i]->getNumChildren());
+            scene.cameraCenters[i]->addChild(camCenterGeode);
+        }
+    }
+
+    // World coordinate axes at origin, in millimeters (matching zones after scaling).
+    // Length and arrow size from configuration.
+    if (initial || calibration.axes_length_mm != old.axes_length_mm ||
+        calibration.axes_arrow_wing_mm != old.axes_arrow_wing_mm) {
+        scene.axes->removeChildren(0, scene.axes->getNumChildren());
+        scene.axes->addChild(createAxesWithArrows(calibration.axes_length_mm, calibration.axes_arrow_wing_mm));
+    }
+
+    scene.zoneBatch->setMatrix(osg::Matrix::scale(metersToMmScale, metersToMmScale, metersToMmScale));
+    scene.metersToMmScale = metersToMmScale;
+    scene.calibration = calibration;
+    scene.cameras = cameras;
+}
+
+size_t updateSceneZones(ModelScene& scene, const std::vector<ViewingZone>& zones)
+{
+    size_t written = scene.zoneBatch->updateZones(zones);
+    scene.zones = zones;
+    return written;
+}
+
+void showZone(ModelScene& scene, int zoneId)
+{
+    scene.zoneBatch->showOnly(zoneId);
+}
@@ -0,0 +1,77 @@
+#ifndef SCENE_BUILDER_H
+#define SCENE_BUILDER_H
+
+#include "camera_projection.h"
+#include "config_bundle.h"
+#include "config_loader.h"
+#include "zone_batch.h"
+
+#include <osg/Group>
+#include <osg/MatrixTransform>
+#include <osgText/Text>
+#include <string>
+#include <vector>
+
+// Scene graph pieces
+osg::ref_ptr<osg::Node> createAxesWithArrows(float axisLength = 5.0f, float arrowWing = 1.0f);
+// The calibrated camera's pinhole frustum in camera coordinates, `depth` meters deep; it is
+// placed in carCoord by cameraPoseMatrix() (camera_frustum.h). The optical axis is drawn
+// in a darker shade of `color`.
+osg::ref_ptr<osg::Node> createCameraFrustum(const CameraModel& camera, float depth,
+                                            const osg::Vec4& color = osg::Vec4(0, 1, 0, 1));
+// Frustum colour of the n-th camera of a rig: green for the first, then cyan, magenta, yellow, ...
+osg::Vec4 rigCameraColor(size_t index);
+// "Zone 12" -> "12", as shown on zone labels
+std::string shortZoneLabel(const std::string& label);
+osg::ref_ptr<osgText::Text> createZoneLabel(const osg::Vec3& position, const std::string& label);
+
+// Node mask of ModelScene::cameraMarkers, so views through a camera can cull them
+const unsigned int kCameraMarkerMask = 0x2;
+
+// Everything loaded and built for one car model
+struct ModelScene {
+    std::string name;
+    CarModelConfig carModel;
+    CameraCalibration calibration;           // the first camera, and the visualization parameters
+    std::vector<CameraCalibration> cameras;  // every camera of calibraton.json, in file order
+    std::vector<ViewingZone> zones;
+    float metersToMmScale;
+    osg::Matrix modelTransform;  // carmodels.json transformations, baked into the mesh
+
+    osg::ref_ptr<osg::Group> root;
+    osg::ref_ptr<osg::MatrixTransform> carTransform;  // empty until the car node is added
+    osg::ref_ptr<ZoneBatch> zoneBatch;
+    osg::ref_ptr<osg::Group> cameraMarkers;  // parent of the per-camera transforms below
+    std::vector<osg::ref_ptr<osg::MatrixTransform> > cameraPoses;    // camera frustums, at the extrinsic poses
+    std::vector<osg::ref_ptr<osg::MatrixTransform> > cameraCenters;  // red spheres at the camera centers
+    osg::ref_ptr<osg::Group> axes;
+};
+
+// Load the model, its calibration and zones and build the scene graph.
+// displayZoneNumber > 0 shows only that zone. Errors are printed to std::cerr and
+// false is returned; `verbose` prints the calibration and scene diagnostics.
+// With a config bundle the configs come from it instead of the JSON files.
+bool buildModelScene(const std::string& carModelName, int displayZoneNumber, bool verbose, ModelScene& scene,
+                     const ConfigBundle* bundle = nullptr);
+
+// The same in two steps, for showing a scene before its car mesh is loaded:
+// everything but the mesh (configs, zones, camera frustum, axes), with carTransform left empty
+bool buildModelSceneWithoutMesh(const std::string& carModelName, int displayZoneNumber, bool verbose,
+                                ModelScene& scene, const ConfigBundle* bundle = nullptr);
+// The car mesh, through the optimized model cache (nullptr after printing an error)
+osg::ref_ptr<osg::Node> loadModelMesh(const ModelScene& scene, bool verbose);
+// The mesh and the car name label placed by its bounds, to add under scene.carTransform
+osg::ref_ptr<osg::Node> createCarNode(const ModelScene& scene, osg::Node* model, bool verbose);
+
+// Config hot reload: apply a re-parsed calibraton.json (every camera's frustum and center
+// sphere, axes and the meters-to-millimeters scale) or viewingzones.json to a built scene in
+// place. Only nodes whose parameters changed are rebuilt; cameras added to or removed from
+// the rig get or lose their markers. The car mesh is never touched.
+// updateSceneZones returns the number of zone array entries written.
+void updateSceneCalibration(ModelScene& scene, const std::vector<CameraCalibration>& cameras);
+size_t updateSceneZones(ModelScene& scene, const std::vector<ViewingZone>& zones);
+
+// Show only the given zone (0 = all zones)
+void showZone(ModelScene& scene, int zoneId);
+
+#endif
@@ -0,0 +1,494 @@
+#include "session_log.h"
+#include "bench_util.h"
+#include "csv_util.h"
+#include "disk_cache.h"
+#include "zone_bvh.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+static_assert(sizeof(SessionRecord) == 64, "SessionRecord must stay 64 bytes");
+static_assert(sizeof(SessionLogHeader) == 64, "SessionLogHeader must stay 64 bytes");
+static_assert(sizeof(SessionIndexEntry) == 16, "SessionIndexEntry must stay 16 bytes");
+
+namespace {
+
+const char kSessionLogMagic[8] = { 'V', 'S', 'E', 'S', 'S', 'L', 'O', 'G' };
+const size_t kWriteBufferRecords = 16384;
+
+volatile int64_t benchmarkSink;
+
+// Calls fn(record, lineNumber) for every data line of a session CSV
+template<typename Fn>
+void forEachSessionCsvRow(const std::string& path, Fn fn)
+{
+    MappedFile file(path);
+    const char* p = file.data();
+    const char* end = p + file.size();
+
+    int lineNumber = 0;
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!lineEnd) lineEnd = end;
+        ++lineNumber;
+
+        const char* q = p;
+        p = lineEnd + 1;
+        double timestamp;
+        if (!nextCsvNumber(q, lineEnd, timestamp)) continue;  // header or comment
+
+        float values[13];
+        int count = 0;
+        while (count < 13 && nextCsvNumber(q, lineEnd, values[count])) ++count;
+        if (count != 6 && count != 7 && count != 12 && count != 13) {
+            std::ostringstream msg;
+            msg << path << ":" << lineNumber << ": expected 7, 8, 13 or 14 numeric columns, got " << count + 1;
+            throw std::runtime_error(msg.str());
+        }
+
+        SessionRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.timestampUs = std::llround(timestamp * 1e6);
+        float length = std::sqrt(values[3] * values[3] + values[4] * values[4] + values[5] * values[5]);
+        // Already unit-length directions are kept bit-exact, so export/convert round-trips
+        float scale = std::fabs(length - 1.0f) < 1e-6f ? 1.0f : length > 0.0f ? 1.0f / length : 0.0f;
+        for (int k = 0; k < 3; ++k) {
+            record.gazeOrigin[k] = values[k];
+            record.gazeDirection[k] = values[3 + k] * scale;
+        }
+        if (count >= 12) {
+            record.flags |= SessionHasHeadPose;
+            for (int k = 0; k < 3; ++k) {
+                record.headPosition[k] = values[6 + k];
+                record.headRotation[k] = values[9 + k];
+            }
+        }
+        if (count == 7 || count == 13) {
+            record.flags |= SessionHasZone;
+            record.zoneId = static_cast<int32_t>(std::lround(values[count - 1]));
+        }
+        fn(record, lineNumber);
+    }
+}
+
+// The header for the optional columns in `columns` (SessionRecordFlags)
+std::string sessionCsvHeader(uint32_t columns)
+{
+    std::string header = "timestamp,ox,oy,oz,dx,dy,dz";
+    if (columns & SessionHasHeadPose) header += ",hx,hy,hz,yaw,pitch,roll";
+    if (columns & SessionHasZone) header += ",zone_id";
+    return header;
+}
+
+// A record without one of the `columns` leaves those fields empty, so every row lines up
+// with the header; the CSV reader skips empty fields, so the columns it finds are the same
+void writeRecordCsv(std::ostream& out, const SessionRecord& r, uint32_t columns)
+{
+    char timestamp[32];
+    snprintf(timestamp, sizeof(timestamp), "%.6f", r.timestampUs * 1e-6);
+    out << timestamp;
+    for (int k = 0; k < 3; ++k) out << ',' << r.gazeOrigin[k];
+    for (int k = 0; k < 3; ++k) out << ',' << r.gazeDirection[k];
+    if (r.flags & SessionHasHeadPose) {
+        for (int k = 0; k < 3; ++k) out << ',' << r.headPosition[k];
+        for (int k = 0; k < 3; ++k) out << ',' << r.headRotation[k];
+    } else if (columns & SessionHasHeadPose) {
+        out << ",,,,,,";
+    }
+    if (r.flags & SessionHasZone) out << ',' << r.zoneId;
+    else if (columns & SessionHasZone) out << ',';
+    out << '\n';
+}
+
+} // namespace
+
+uint64_t zoneSetHash(const std::vector<ViewingZone>& zones)
+{
+    std::set<int> ids;
+    for (const auto& zone : zones) {
+        if (!isZoneDegenerate(zone)) ids.insert(zone.id);
+    }
+    std::vector<int32_t> sorted(ids.begin(), ids.end());
+    return hashBytes(sorted.data(), sorted.size() * sizeof(int32_t));
+}
+
+// ----------- SessionLogWriter -----------
+
+SessionLogWriter::SessionLogWriter(const std::string& path, uint64_t zoneSetHash, uint32_t zoneCount,
+                                   uint32_t indexStride)
+    : path_(path), tmpPath_(path + ".tmp." + std::to_string(getpid())), file_(nullptr)
+{
+    std::memset(&header_, 0, sizeof(header_));
+    std::memcpy(header_.magic, kSessionLogMagic, sizeof(header_.magic));
+    header_.version = kSessionLogVersion;
+    header_.recordSize = sizeof(SessionRecord);
+    header_.indexStride = std::max(indexStride, 1u);
+    header_.zoneSetHash = zoneSetHash;
+    header_.zoneCount = zoneCount;
+
+    file_ = std::fopen(tmpPath_.c_str(), "wb");
+    if (!file_) throw std::runtime_error("Cannot write " + tmpPath_ + ": " + std::strerror(errno));
+    // Placeholder; the real header is written by finish()
+    if (std::fwrite(&header_, sizeof(header_), 1, file_) != 1) {
+        // The destructor does not run for a constructor that throws
+        std::fclose(file_);
+        file_ = nullptr;
+        unlink(tmpPath_.c_str());
+        throw std::runtime_error("Cannot write " + tmpPath_);
+    }
+    buffer_.reserve(kWriteBufferRecords);
+}
+
+SessionLogWriter::~SessionLogWriter()
+{
+    if (file_) {
+        std::fclose(file_);
+        unlink(tmpPath_.c_str());
+    }
+}
+
+void SessionLogWriter::append(const SessionRecord& record)
+{
+    if (header_.recordCount > 0 && record.timestampUs < header_.lastTimestampUs) {
+        throw std::runtime_error("Session records must be in time order");
+    }
+    if (header_.recordCount % header_.indexStride == 0) {
+        SessionIndexEntry entry = { record.timestampUs, header_.recordCount };
+        index_.push_back(entry);
+    }
+    if (header_.recordCount == 0) header_.firstTimestampUs = record.timestampUs;
+    header_.lastTimestampUs = record.timestampUs;
+    ++header_.recordCount;
+
+    buffer_.push_back(record);
+    if (buffer_.size() == kWriteBufferRecords) flush();
+}
+
+void SessionLogWriter::flush()
+{
+    if (!buffer_.empty() && std::fwrite(buffer_.data(), sizeof(SessionRecord), buffer_.size(), file_) != buffer_.size()) {
+        throw std::runtime_error("Cannot write " + tmpPath_ + ": " + std::strerror(errno));
+    }
+    buffer_.clear();
+}
+
+void SessionLogWriter::finish()
+{
+    flush();
+    header_.indexCount = static_cast<uint32_t>(index_.size());
+    bool ok = index_.empty() || std::fwrite(index_.data(), sizeof(SessionIndexEntry), index_.size(), file_) == index_.size();
+    ok = ok && std::fseek(file_, 0, SEEK_SET) == 0 && std::fwrite(&header_, sizeof(header_), 1, file_) == 1;
+    ok = std::fclose(file_) == 0 && ok;
+    file_ = nullptr;
+    if (!ok || std::rename(tmpPath_.c_str(), path_.c_str()) != 0) {
+        unlink(tmpPath_.c_str());
+        throw std::runtime_error("Cannot write " + path_ + ": " + std::strerror(errno));
+    }
+}
+
+// ----------- SessionLog -----------
+
+void SessionLog::open(const std::string& path)
+{
+    file_.open(path, MappedFile::Random);
+    if (file_.size() < sizeof(SessionLogHeader)) {
+        throw std::runtime_error(path + " is not a session log (too short)");
+    }
+    std::memcpy(&header_, file_.data(), sizeof(header_));
+    if (std::memcmp(header_.magic, kSessionLogMagic, sizeof(header_.magic)) != 0) {
+        throw std::runtime_error(path + " is not a session log");
+    }
+    if (header_.version != kSessionLogVersion || header_.recordSize != sizeof(SessionRecord)) {
+        throw std::runtime_error(path + ": unsupported session log version " + std::to_string(header_.version));
+    }
+    uint64_t expectedIndex = header_.indexStride ? (header_.recordCount + header_.indexStride - 1) / header_.indexStride : 0;
+    uint64_t expectedSize = sizeof(SessionLogHeader) + header_.recordCount * sizeof(SessionRecord) +
+                            uint64_t(header_.indexCount) * sizeof(SessionIndexEntry);
+    if (header_.indexStride == 0 || header_.indexCount != expectedIndex || file_.size() != expectedSize) {
+        throw std::runtime_error(path + ": truncated or corrupt session log");
+    }
+    records_ = reinterpret_cast<const SessionRecord*>(file_.data() + sizeof(SessionLogHeader));
+    index_ = reinterpret_cast<const SessionIndexEntry*>(records_ + header_.recordCount);
+}
+
+size_t SessionLog::lowerBound(int64_t timestampUs) const
+{
+    // The first index entry at or after t bounds the answer from above, the one before it
+    // from below; only the records in between are searched
+    const SessionIndexEntry* entry = std::lower_bound(
+        index_, index_ + header_.indexCount, timestampUs,
+        [](const SessionIndexEntry& e, int64_t t) { return e.timestampUs < t; });
+    size_t begin = entry == index_ ? 0 : static_cast<size_t>(entry[-1].record);
+    size_t end = entry == index_ + header_.indexCount ? size() : static_cast<size_t>(entry->record);
+    const SessionRecord* record = std::lower_bound(
+        records_ + begin, records_ + end, timestampUs,
+        [](const SessionRecord& r, int64_t t) { return r.timestampUs < t; });
+    return record - records_;
+}
+
+size_t SessionLog::seek(int64_t timestampUs) const
+{
+    size_t after = timestampUs == std::numeric_limits<int64_t>::max() ? size() : lowerBound(timestampUs + 1);
+    return after == 0 ? 0 : after - 1;
+}
+
+// ----------- Conversion -----------
+
+SessionConvertStats convertSessionCsv(const std::string& csvPath, const std::string& logPath,
+                                      const std::vector<ViewingZone>& zones)
+{
+    std::set<int> zoneIds;
+    for (const auto& zone : zones) {
+        if (!isZoneDegenerate(zone)) zoneIds.insert(zone.id);
+    }
+
+    SessionConvertStats stats;
+    SessionLogWriter writer(logPath, zoneSetHash(zones), static_cast<uint32_t>(zoneIds.size()));
+    int64_t last = std::numeric_limits<int64_t>::min();
+    forEachSessionCsvRow(csvPath, [&](const SessionRecord& record, int lineNumber) {
+        if (record.timestampUs < last) {
+            std::ostringstream msg;
+            msg << csvPath << ":" << lineNumber << ": timestamp goes backwards";
+            throw std::runtime_error(msg.str());
+        }
+        last = record.timestampUs;
+        writer.append(record);
+        ++stats.records;
+        if (record.flags & SessionHasHeadPose) ++stats.withHeadPose;
+        if (record.flags & SessionHasZone) {
+            ++stats.withZone;
+            if (record.zoneId != 0 && !zoneIds.count(record.zoneId)) ++stats.unknownZones;
+        }
+    });
+    writer.finish();
+    return stats;
+}
+
+// ----------- visual sessionlog -----------
+
+namespace {
+
+void printSessionLogUsage()
+{
+    std::cout << "Usage: visual sessionlog convert <session.csv> <session.vlog> [model <name>]" << std::endl;
+    std::cout << "       visual sessionlog info <session.vlog> [model <name>]" << std::endl;
+    std::cout << "       visual sessionlog export <session.vlog> <session.csv>" << std::endl;
+    std::cout << "       visual sessionlog bench [<session.csv>] [--records N] [model <name>]" << std::endl;
+    std::cout << "  CSV columns: timestamp (s), ox, oy, oz, dx, dy, dz [, head x, y, z, yaw, pitch, roll] [, zone_id]" << std::endl;
+    std::cout << "  Zone ids are the model's ViewingZone ids (viewingzones.json), 0 = no zone" << std::endl;
+}
+
+std::string formatSeconds(int64_t us)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3) << us * 1e-6;
+    return out.str();
+}
+
+// A 1 kHz drive: the gaze dwells on a zone for a while, then jumps to another one
+void writeSyntheticSessionCsv(const std::string& path, const std::vector<ViewingZone>& zones, size_t records)
+{
+    std::vector<const ViewingZone*> targets;
+    for (const auto& zone : zones) {
+        if (!isZoneDegenerate(zone)) targets.push_back(&zone);
+    }
+    if (targets.empty()) throw std::runtime_error("No zones to aim at");
+
+    std::ofstream out(path.c_str());
+    if (!out) throw std::runtime_error("Cannot write " + path);
+    out << "timestamp,ox,oy,oz,dx,dy,dz,hx,hy,hz,yaw,pitch,roll,zone_id\n" << std::fixed << std::setprecision(5);
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+    std::uniform_int_distribution<size_t> pick(0, targets.size() - 1);
+    std::uniform_int_distribution<int> dwell(100, 2000);
+    osg::Vec3 eye(0.35f, 0.6f, -0.3f);
+    const ViewingZone* target = targets[0];
+    int left = 0;
+    for (size_t i = 0; i < records; ++i) {
+        if (left-- <= 0) {
+            target = targets[pick(rng)];
+            left = dwell(rng);
+        }
+        osg::Vec3 center(0, 0, 0);
+        for (const auto& c : target->corners) center += c;
+        center /= target->corners.size();
+        osg::Vec3 direction = center - eye + osg::Vec3(jitter(rng), jitter(rng), jitter(rng)) * 0.01f;
+        direction.normalize();
+        out << i * 0.001 << ',' << eye.x() << ',' << eye.y() << ',' << eye.z() << ','
+            << direction.x() << ',' << direction.y() << ',' << direction.z() << ','
+            << eye.x() << ',' << eye.y() + 0.1f << ',' << eye.z() << ','
+            << jitter(rng) * 20.0f << ',' << jitter(rng) * 10.0f << ',' << jitter(rng) * 2.0f << ','
+            << target->id << '\n';
+    }
+    if (!out) throw std::runtime_error("Cannot write " + path);
+}
+
+int runSessionBenchmark(std::string csvPath, size_t records, const std::vector<ViewingZone>& zones)
+{
+    typedef std::chrono::steady_clock Clock;
+    if (csvPath.empty()) {
+        makeDirectories(cacheDirectory());
+        csvPath = cacheDirectory() + "/session_bench.csv";
+        Clock::time_point t0 = Clock::now();
+        writeSyntheticSessionCsv(csvPath, zones, records);
+        std::cout << "Wrote " << records << " synthetic records to " << csvPath << " in " << std::fixed
+                  << std::setprecision(2) << std::chrono::duration<double>(Clock::now() - t0).count() << " s" << std::endl;
+    }
+    std::string logPath = csvPath + ".vlog";
+
+    MappedFile csvFile(csvPath);
+    double csvMb = csvFile.size() / 1e6;
+    csvFile.close();
+
+    // CSV: parse only, then the full conversion
+    uint64_t parsed = 0;
+    int64_t checksum = 0;
+    double parseSeconds = timeBest([&]() {
+        parsed = 0;
+        forEachSessionCsvRow(csvPath, [&](const SessionRecord& record, int) {
+            checksum += record.zoneId;
+            ++parsed;
+        });
+    }, 0.0);
+    Clock::time_point t0 = Clock::now();
+    SessionConvertStats stats = convertSessionCsv(csvPath, logPath, zones);
+    double convertSeconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    // Log: open + full scan, then random seeks
+    SessionLog log;
+    double openSeconds = timeBest([&]() { log.open(logPath); }, 0.1);
+    double logMb = (sizeof(SessionLogHeader) + log.size() * sizeof(SessionRecord) +
+                    log.header().indexCount * sizeof(SessionIndexEntry)) / 1e6;
+    double scanSeconds = timeBest([&]() {
+        float sum = 0.0f;
+        for (size_t i = 0; i < log.size(); ++i) {
+            checksum += log[i].zoneId;
+            sum += log[i].gazeDirection[2];
+        }
+        checksum += static_cast<int64_t>(sum);
+    }, 0.25);
+
+    const size_t seeks = 1000000;
+    std::vector<int64_t> targets(seeks);
+    std::mt19937_64 rng(3);
+    std::uniform_int_distribution<int64_t> when(log.firstTimestampUs(), log.lastTimestampUs());
+    for (auto& t : targets) t = when(rng);
+    double seekSeconds = timeBest([&]() {
+        for (int64_t t : targets) checksum += static_cast<int64_t>(log.seek(t));
+    }, 0.25);
+
+    // Linear-search reference for a sample of the seeks
+    size_t mismatches = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+        size_t expected = 0;
+        while (expected + 1 < log.size() && log[expected + 1].timestampUs <= targets[i]) ++expected;
+        if (log.seek(targets[i]) != expected) ++mismatches;
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "CSV:  " << csvMb << " MB, " << parsed << " records" << std::endl;
+    std::cout << "  parse:      " << std::setprecision(3) << parseSeconds << " s  (" << std::setprecision(2)
+              << parsed / parseSeconds / 1e6 << " M records/s, " << std::setprecision(1) << csvMb / parseSeconds << " MB/s)" << std::endl;
+    std::cout << "  convert:    " << std::setprecision(3) << convertSeconds << " s  (" << stats.withZone
+              << " with ECU zone, " << stats.unknownZones << " unknown zone ids)" << std::endl;
+    std::cout << "Log:  " << std::setprecision(1) << logMb << " MB, " << log.size() << " records, index every "
+              << log.header().indexStride << " records" << std::endl;
+    std::cout << "  open:       " << std::setprecision(1) << openSeconds * 1e6 << " us" << std::endl;
+    std::cout << "  scan:       " << std::setprecision(3) << scanSeconds << " s  (" << std::setprecision(1)
+              << log.size() / scanSeconds / 1e6 << " M records/s, " << logMb / scanSeconds / 1e3 << " GB/s, "
+              << parseSeconds / scanSeconds << "x faster than CSV)" << std::endl;
+    std::cout << "  seek:       " << std::setprecision(0) << seekSeconds / seeks * 1e9 << " ns per random timestamp"
+              << " (linear-search check: " << 1000 - mismatches << "/1000 agree)" << std::endl;
+    benchmarkSink = checksum;  // keep the loops
+    return mismatches ? 1 : 0;
+}
+
+} // namespace
+
+int runSessionLogCommand(int argc, char** argv)
+{
+    std::vector<std::string> positional;
+    std::string carModelName = "Sharan";
+    size_t records = 1000000;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "model" && i + 1 < argc) carModelName = argv[++i];
+        else if (arg == "--records" && i + 1 < argc) records = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--help" || arg == "-h") { printSessionLogUsage(); return 0; }
+        else if (arg[0] != '-') positional.push_back(arg);
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printSessionLogUsage();
+            return 1;
+        }
+    }
+    std::string action = positional.empty() ? "" : positional[0];
+    bool valid = (action == "convert" && positional.size() == 3) || (action == "info" && positional.size() == 2) ||
+                 (action == "export" && positional.size() == 3) || (action == "bench" && positional.size() <= 2);
+    if (!valid) {
+        printSessionLogUsage();
+        return 1;
+    }
+
+    try {
+        std::vector<ViewingZone> zones;
+        if (action != "export") {
+            zones = parseViewingZonesFile("carmodels/" + carModelName + "/config/viewingzones.json");
+        }
+
+        if (action == "convert") {
+            typedef std::chrono::steady_clock Clock;
+            Clock::time_point t0 = Clock::now();
+            SessionConvertStats stats = convertSessionCsv(positional[1], positional[2], zones);
+            std::cout << "Converted " << stats.records << " records (" << stats.withHeadPose << " with head pose, "
+                      << stats.withZone << " with ECU zone) to " << positional[2] << " in " << std::fixed
+                      << std::setprecision(2) << std::chrono::duration<double>(Clock::now() - t0).count() << " s" << std::endl;
+            if (stats.unknownZones) {
+                std::cerr << "Warning: " << stats.unknownZones << " records have zone ids that " << carModelName
+                          << " does not define" << std::endl;
+            }
+        } else if (action == "info") {
+            SessionLog log(positional[1]);
+            const SessionLogHeader& h = log.header();
+            std::cout << positional[1] << ": version " << h.version << ", " << log.size() << " records, "
+                      << h.indexCount << " index entries (every " << h.indexStride << " records)" << std::endl;
+            if (!log.empty()) {
+                std::cout << "  time " << formatSeconds(log.firstTimestampUs()) << " .. "
+                          << formatSeconds(log.lastTimestampUs()) << " s ("
+                          << formatSeconds(log.lastTimestampUs() - log.firstTimestampUs()) << " s)" << std::endl;
+            }
+            std::cout << "  zone ids refer to " << h.zoneCount << " zones; "
+                      << (h.zoneSetHash == zoneSetHash(zones) ? "matches " : "does NOT match ") << carModelName
+                      << std::endl;
+        } else if (action == "export") {
+            SessionLog log(positional[1]);
+            std::ofstream out(positional[2].c_str());
+            if (!out) throw std::runtime_error("Cannot write " + positional[2]);
+            uint32_t columns = 0;
+            for (size_t i = 0; i < log.size(); ++i) columns |= log[i].flags;
+            out << sessionCsvHeader(columns) << '\n' << std::setprecision(9);
+            for (size_t i = 0; i < log.size(); ++i) writeRecordCsv(out, log[i], columns);
+            if (!out) throw std::runtime_error("Cannot write " + positional[2]);
+            std::cout << "Exported " << log.size() << " records to " << positional[2] << std::endl;
+        } else {
+            return runSessionBenchmark(positional.size() > 1 ? positional[1] : std::string(), records, zones);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
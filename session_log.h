@@ -0,0 +1,133 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include "config_loader.h"
+#include "mapped_file.h"
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Binary session log (.vlog): a recorded drive as fixed-size records, sorted by time.
+//
+//   SessionLogHeader            64 bytes
+//   SessionRecord[recordCount]  64 bytes each
+//   SessionIndexEntry[...]      one per `indexStride` records: timestamp of that record
+//
+// All values are little-endian, as written by the x86/ARM machines that use them. The file
+// is memory-mapped and records are read in place. A timestamp lookup binary-searches the
+// sparse index and then at most `indexStride` records, O(log n) overall.
+
+const uint32_t kSessionLogVersion = 1;
+
+// SessionRecord::flags
+enum SessionRecordFlags {
+    SessionHasHeadPose = 1,  // headPosition/headRotation are valid
+    SessionHasZone = 2       // zoneId is valid
+};
+
+struct SessionRecord {
+    int64_t timestampUs;       // microseconds, as in the source CSV (seconds)
+    float gazeOrigin[3];       // carCoord meters
+    float gazeDirection[3];    // unit length
+    float headPosition[3];     // carCoord meters
+    float headRotation[3];     // yaw, pitch, roll in degrees
+    int32_t zoneId;            // ECU zone: a ViewingZone id of the model, 0 = no zone
+    uint32_t flags;            // SessionRecordFlags
+};
+
+struct SessionIndexEntry {
+    int64_t timestampUs;
+    uint64_t record;
+};
+
+struct SessionLogHeader {
+    char magic[8];             // "VSESSLOG"
+    uint32_t version;
+    uint32_t recordSize;       // sizeof(SessionRecord)
+    uint64_t recordCount;
+    uint32_t indexStride;
+    uint32_t indexCount;
+    int64_t firstTimestampUs;
+    int64_t lastTimestampUs;
+    uint64_t zoneSetHash;      // zoneSetHash() of the zones the ECU ids refer to
+    uint32_t zoneCount;
+    uint32_t reserved;
+};
+
+// Hash of the ids of the non-degenerate zones; logs and models agree on zone numbering
+// if the hashes match
+uint64_t zoneSetHash(const std::vector<ViewingZone>& zones);
+
+// Streams records to a new log. Records must arrive in non-decreasing timestamp order.
+// The file appears under its final name only after finish(). Throws std::runtime_error.
+class SessionLogWriter {
+public:
+    SessionLogWriter(const std::string& path, uint64_t zoneSetHash, uint32_t zoneCount,
+                     uint32_t indexStride = 1024);
+    ~SessionLogWriter();  // discards the file if finish() was not called
+
+    void append(const SessionRecord& record);
+    void finish();
+
+    uint64_t recordCount() const { return header_.recordCount; }
+
+private:
+    SessionLogWriter(const SessionLogWriter&) = delete;
+    SessionLogWriter& operator=(const SessionLogWriter&) = delete;
+
+    void flush();
+
+    std::string path_, tmpPath_;
+    FILE* file_;
+    SessionLogHeader header_;
+    std::vector<SessionRecord> buffer_;
+    std::vector<SessionIndexEntry> index_;
+};
+
+// Zero-copy reader. Throws std::runtime_error if the file is not a valid session log.
+class SessionLog {
+public:
+    SessionLog() {}
+    explicit SessionLog(const std::string& path) { open(path); }
+
+    void open(const std::string& path);
+
+    const SessionLogHeader& header() const { return header_; }
+    size_t size() const { return static_cast<size_t>(header_.recordCount); }
+    bool empty() const { return header_.recordCount == 0; }
+    const SessionRecord& operator[](size_t i) const { return records_[i]; }
+    const SessionRecord* records() const { return records_; }
+    int64_t firstTimestampUs() const { return header_.firstTimestampUs; }
+    int64_t lastTimestampUs() const { return header_.lastTimestampUs; }
+
+    // First record with timestamp >= t (size() if none)
+    size_t lowerBound(int64_t timestampUs) const;
+    // Record shown at time t: the last one with timestamp <= t (0 before the first record)
+    size_t seek(int64_t timestampUs) const;
+
+private:
+    MappedFile file_;
+    SessionLogHeader header_ = SessionLogHeader();
+    const SessionRecord* records_ = nullptr;
+    const SessionIndexEntry* index_ = nullptr;
+};
+
+struct SessionConvertStats {
+    uint64_t records = 0;
+    uint64_t withHeadPose = 0;
+    uint64_t withZone = 0;
+    uint64_t unknownZones = 0;  // zone ids that are not zones of the model
+};
+
+// Session CSV -> log. Columns: timestamp (s), ox, oy, oz, dx, dy, dz, then optionally
+// head x, y, z, yaw, pitch, roll, then optionally the ECU zone id (7, 8, 13 or 14 columns).
+// Throws std::runtime_error on malformed lines or timestamps going backwards.
+SessionConvertStats convertSessionCsv(const std::string& csvPath, const std::string& logPath,
+                                      const std::vector<ViewingZone>& zones);
+
+// `visual sessionlog convert|info|export|bench ...`
+int runSessionLogCommand(int argc, char** argv);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity is rounded up to a power of two. Neither side ever blocks or allocates after
+// construction: push() fails when the queue is full and pop() when it is empty.
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : head_(0), tail_(0)
+    {
+        size_t size = 2;
+        while (size < capacity) size *= 2;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    size_t capacity() const { return slots_.size(); }
+
+    // Producer side
+    bool push(const T& value)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == slots_.size()) return false;
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& value)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        value = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called while the other side is running
+    size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+private:
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Head and tail on separate cache lines so the two threads do not false-share
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+    alignas(64) std::vector<T> slots_;
+    size_t mask_;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "trace.h"
+#include "bench_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Trace::enabled_(false);
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Captured during static initialization, i.e. before main()
+const Clock::time_point processStart = Clock::now();
+
+struct Phase {
+    const char* name;
+    std::string detail;
+    int64_t startUs, durationUs;
+    int thread;
+};
+
+std::mutex traceMutex;
+std::vector<Phase> phases;
+std::map<int, std::string> threadNames;
+std::atomic<int> nextThread(1);
+
+// Small sequential ids read better in trace viewers than native thread ids
+int currentThread()
+{
+    thread_local int id = 0;
+    if (id == 0) id = nextThread++;
+    return id;
+}
+
+} // namespace
+
+void Trace::enable()
+{
+    {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        phases.reserve(256);
+        threadNames[currentThread()] = "main";
+    }
+    enabled_ = true;
+}
+
+int64_t Trace::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - processStart).count();
+}
+
+void Trace::setThreadName(const std::string& name)
+{
+    if (!enabled()) return;
+    std::lock_guard<std::mutex> lock(traceMutex);
+    threadNames[currentThread()] = name;
+}
+
+void Trace::addPhase(const char* name, const std::string& detail, int64_t startUs, int64_t durationUs)
+{
+    Phase phase = { name, detail, startUs, durationUs, currentThread() };
+    std::lock_guard<std::mutex> lock(traceMutex);
+    phases.push_back(phase);
+}
+
+bool Trace::write(const std::string& path)
+{
+    std::vector<Phase> sorted;
+    std::map<int, std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        sorted = phases;
+        names = threadNames;
+    }
+    // Enclosing phases first when they start together, as trace viewers expect
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Phase& a, const Phase& b) {
+        return a.startUs != b.startUs ? a.startUs < b.startUs : a.durationUs > b.durationUs;
+    });
+
+    std::ofstream out(path.c_str());
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    for (const auto& entry : names) {
+        out << (first ? "\n" : ",\n") << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+            << entry.first << ", \"args\": {\"name\": " << jsonString(entry.second) << "}}";
+        first = false;
+    }
+    for (const auto& phase : sorted) {
+        out << (first ? "\n" : ",\n") << "  {\"name\": " << jsonString(phase.name) << ", \"cat\": \"startup\", \"ph\": \"X\", \"ts\": "
+            << phase.startUs << ", \"dur\": " << phase.durationUs << ", \"pid\": 1, \"tid\": " << phase.thread;
+        if (!phase.detail.empty()) out << ", \"args\": {\"detail\": " << jsonString(phase.detail) << "}";
+        out << "}";
+        first = false;
+    }
+    out << "\n]}\n";
+    if (!out) {
+        std::cerr << "Error: Cannot write trace " << path << std::endl;
+        return false;
+    }
+    std::cout << "Wrote startup trace " << path << " (" << sorted.size() << " phases)" << std::endl;
+    return true;
+}
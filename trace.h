@@ -0,0 +1,57 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+// Timeline of startup phases in the Chrome trace event format (open the file in
+// chrome://tracing or ui.perfetto.dev). Disabled by default; while disabled a ScopedPhase
+// costs one relaxed atomic load and nothing is recorded or allocated.
+class Trace {
+public:
+    static void enable();
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Microseconds since the program started
+    static int64_t nowUs();
+
+    // Label for the calling thread's row in the timeline
+    static void setThreadName(const std::string& name);
+
+    // A completed phase on the calling thread; `detail` is shown as its argument
+    static void addPhase(const char* name, const std::string& detail, int64_t startUs, int64_t durationUs);
+
+    // Write all phases recorded so far. Returns false (after printing an error) on failure.
+    static bool write(const std::string& path);
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+// Records the time from construction to destruction as a phase
+class ScopedPhase {
+public:
+    explicit ScopedPhase(const char* name, const std::string& detail = std::string())
+        : name_(Trace::enabled() ? name : nullptr), startUs_(0)
+    {
+        if (name_) {
+            detail_ = detail;
+            startUs_ = Trace::nowUs();
+        }
+    }
+    ~ScopedPhase()
+    {
+        if (name_) Trace::addPhase(name_, detail_, startUs_, Trace::nowUs() - startUs_);
+    }
+
+private:
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+    const char* name_;
+    std::string detail_;
+    int64_t startUs_;
+};
+
+#endif
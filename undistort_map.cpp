@@ -0,0 +1,319 @@
+#include "undistort_map.h"
+#include "disk_cache.h"
+#include "csv_util.h"
+#include "bench_util.h"
+#include "parallel_for.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <stdexcept>
+#include <chrono>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const char kCacheMagic[] = "UNDISTM";
+const uint32_t kCacheVersion = 1;
+
+// Payload header of the cache file, followed by the grid
+struct UndistortMapInfo {
+    int32_t width, height, step;
+    int32_t gridWidth, gridHeight;
+    int32_t reserved[3];
+};
+
+const size_t kMinPixelsPerThread = 65536;
+
+int gridSize(int pixels, int step)
+{
+    return (pixels + step - 1) / step + 1;
+}
+
+} // namespace
+
+uint64_t undistortMapKey(const CameraModel& camera, int step)
+{
+    const double intrinsics[12] = {
+        camera.fx, camera.fy, camera.cx, camera.cy,
+        camera.k[0], camera.k[1], camera.k[2], camera.k[3], camera.k[4], camera.k[5],
+        camera.p1, camera.p2
+    };
+    const int32_t layout[4] = { camera.imageWidth, camera.imageHeight, step, static_cast<int32_t>(kCacheVersion) };
+    return hashBytes(layout, sizeof(layout), hashBytes(intrinsics, sizeof(intrinsics)));
+}
+
+UndistortMap::UndistortMap()
+    : grid_(nullptr), width_(0), height_(0), step_(1), gridWidth_(0), gridHeight_(0), invStep_(1.0f)
+{
+}
+
+void UndistortMap::setGrid(const float* grid, int width, int height, int step)
+{
+    grid_ = grid;
+    width_ = width;
+    height_ = height;
+    step_ = step;
+    gridWidth_ = gridSize(width, step);
+    gridHeight_ = gridSize(height, step);
+    invStep_ = 1.0f / step;
+}
+
+void UndistortMap::build(const CameraModel& camera, int step, unsigned threads)
+{
+    if (step < 1) throw std::runtime_error("Undistortion map step must be at least 1 pixel");
+    const int gw = gridSize(camera.imageWidth, step);
+    const int gh = gridSize(camera.imageHeight, step);
+
+    file_.close();
+    owned_.assign(static_cast<size_t>(gw) * gh * 2, 0.0f);
+    float* grid = owned_.data();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    parallelFor(gh, 1, 1, threads, [&](size_t rowBegin, size_t rowEnd) {
+        for (size_t row = rowBegin; row < rowEnd; ++row) {
+            float* out = grid + row * gw * 2;
+            for (int col = 0; col < gw; ++col) {
+                osg::Vec2d ray;
+                if (camera.undistort(osg::Vec2d(col * step, static_cast<double>(row) * step), ray)) {
+                    out[col * 2] = static_cast<float>(ray.x());
+                    out[col * 2 + 1] = static_cast<float>(ray.y());
+                } else {
+                    out[col * 2] = out[col * 2 + 1] = nan;
+                }
+            }
+        }
+    });
+    setGrid(grid, camera.imageWidth, camera.imageHeight, step);
+    cachePath_.clear();
+}
+
+bool UndistortMap::load(const CameraModel& camera, int step, bool rebuild, unsigned threads)
+{
+    const uint64_t key = undistortMapKey(camera, step);
+    const std::string path = cacheFilePath("undistort", key, ".bin");
+
+    if (!rebuild) {
+        size_t payloadSize = 0;
+        const char* payload = openCacheFile(file_, path, kCacheMagic, kCacheVersion, key, payloadSize);
+        if (payload && payloadSize >= sizeof(UndistortMapInfo)) {
+            UndistortMapInfo info;
+            std::memcpy(&info, payload, sizeof(info));
+            size_t expected = sizeof(info) + static_cast<size_t>(info.gridWidth) * info.gridHeight * 2 * sizeof(float);
+            if (info.width == camera.imageWidth && info.height == camera.imageHeight && info.step == step &&
+                info.gridWidth == gridSize(info.width, step) && info.gridHeight == gridSize(info.height, step) &&
+                payloadSize == expected) {
+                owned_.clear();
+                setGrid(reinterpret_cast<const float*>(payload + sizeof(info)), info.width, info.height, step);
+                cachePath_ = path;
+                return true;
+            }
+        }
+        file_.close();
+    }
+
+    build(camera, step, threads);
+
+    UndistortMapInfo info;
+    std::memset(&info, 0, sizeof(info));
+    info.width = width_;
+    info.height = height_;
+    info.step = step_;
+    info.gridWidth = gridWidth_;
+    info.gridHeight = gridHeight_;
+    std::vector<std::pair<const void*, size_t> > payload;
+    payload.push_back(std::make_pair(static_cast<const void*>(&info), sizeof(info)));
+    payload.push_back(std::make_pair(static_cast<const void*>(owned_.data()), owned_.size() * sizeof(float)));
+    try {
+        writeCacheFile(path, kCacheMagic, kCacheVersion, key, payload);
+        cachePath_ = path;
+    } catch (const std::exception& e) {
+        // A read-only checkout still works, it just rebuilds every time
+        std::cerr << "Warning: " << e.what() << std::endl;
+    }
+    return false;
+}
+
+bool UndistortMap::pixelToRay(float u, float v, float& x, float& y) const
+{
+    if (!grid_ || !(u >= 0.0f && v >= 0.0f && u <= width_ && v <= height_)) return false;
+
+    float gx = u * invStep_, gy = v * invStep_;
+    int ix = std::min(static_cast<int>(gx), gridWidth_ - 2);
+    int iy = std::min(static_cast<int>(gy), gridHeight_ - 2);
+    float fx = gx - ix, fy = gy - iy;
+
+    const float* n0 = grid_ + (static_cast<size_t>(iy) * gridWidth_ + ix) * 2;
+    const float* n1 = n0 + gridWidth_ * 2;
+    float top0 = n0[0] + (n0[2] - n0[0]) * fx, top1 = n0[1] + (n0[3] - n0[1]) * fx;
+    float bottom0 = n1[0] + (n1[2] - n1[0]) * fx, bottom1 = n1[1] + (n1[3] - n1[1]) * fx;
+    x = top0 + (bottom0 - top0) * fy;
+    y = top1 + (bottom1 - top1) * fy;
+    return !std::isnan(x) && !std::isnan(y);
+}
+
+void UndistortMap::pixelsToRays(const float* u, const float* v, size_t count, float* x, float* y, unsigned threads) const
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    parallelFor(count, kMinPixelsPerThread, 1, threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (!pixelToRay(u[i], v[i], x[i], y[i])) x[i] = y[i] = nan;
+        }
+    });
+}
+
+size_t UndistortMap::invalidNodeCount() const
+{
+    size_t invalid = 0;
+    for (size_t i = 0; i < nodeCount(); ++i) {
+        if (std::isnan(grid_[i * 2])) ++invalid;
+    }
+    return invalid;
+}
+
+// ----------- visual undistort -----------
+
+namespace {
+
+void printUndistortUsage()
+{
+    std::cout << "Usage: visual undistort [model <name>] [--step N] [--rebuild] [--threads N] [--random N]" << std::endl;
+    std::cout << "       visual undistort <pixels.csv> -o <rays.csv> [model <name>]" << std::endl;
+    std::cout << "  Pixels CSV columns: [timestamp,] u, v" << std::endl;
+    std::cout << "  Rays CSV columns: [timestamp,] ox, oy, oz, dx, dy, dz  (carCoord, input for 'visual classify')" << std::endl;
+}
+
+} // namespace
+
+int runUndistortCommand(int argc, char** argv)
+{
+    std::string pixelsPath, outputPath;
+    std::string carModelName = "Sharan";
+    int step = 4;
+    bool rebuild = false;
+    unsigned threads = 0;
+    size_t randomCount = 4000000;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "model" && i + 1 < argc) carModelName = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--step" && i + 1 < argc) step = std::atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (arg == "--random" && i + 1 < argc) randomCount = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--rebuild") rebuild = true;
+        else if (arg == "--help" || arg == "-h") { printUndistortUsage(); return 0; }
+        else if (pixelsPath.empty() && arg[0] != '-') pixelsPath = arg;
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printUndistortUsage();
+            return 1;
+        }
+    }
+    if (!pixelsPath.empty() && outputPath.empty()) {
+        printUndistortUsage();
+        return 1;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    CameraModel camera;
+    UndistortMap map;
+    try {
+        camera = CameraModel(parseCalibrationFile("carmodels/" + carModelName + "/config/calibraton.json"));
+        Clock::time_point t0 = Clock::now();
+        bool cached = map.load(camera, step, rebuild, threads);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        std::cout << (cached ? "Mapped" : "Built") << " " << map.width() << "x" << map.height()
+                  << " undistortion map (" << map.nodeCount() << " nodes, step " << map.step() << " px) in "
+                  << std::fixed << std::setprecision(2) << ms << " ms" << std::endl;
+        if (!map.cachePath().empty()) std::cout << "  cache: " << map.cachePath() << std::endl;
+        if (size_t invalid = map.invalidNodeCount()) {
+            std::cout << "  " << invalid << " node(s) could not be inverted" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!pixelsPath.empty()) {
+        // Timestamps stay at double precision, so microsecond and epoch times survive
+        std::vector<double> timestamps;
+        std::vector<float> u, v;
+        bool hasTimestamp = false;
+        try {
+            forEachCsvRow<double>(pixelsPath, 2, 3, "2 or 3 numeric columns", [&](const double* values, int count) {
+                hasTimestamp = count == 3;
+                timestamps.push_back(count == 3 ? values[0] : 0.0);
+                u.push_back(static_cast<float>(values[count - 2]));
+                v.push_back(static_cast<float>(values[count - 1]));
+            });
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::vector<float> x(u.size()), y(u.size());
+        map.pixelsToRays(u.data(), v.data(), u.size(), x.data(), y.data(), threads);
+
+        std::ofstream out(outputPath.c_str());
+        if (!out) {
+            std::cerr << "Error: Cannot write " << outputPath << std::endl;
+            return 1;
+        }
+        out << std::setprecision(7);
+        size_t unresolved = 0;
+        for (size_t i = 0; i < u.size(); ++i) {
+            if (std::isnan(x[i])) { ++unresolved; continue; }
+            osg::Vec3d direction = camera.cameraToCar(osg::Vec3d(x[i], y[i], 1.0)) -
+                                   osg::Vec3d(camera.t[0], camera.t[1], camera.t[2]);
+            direction.normalize();
+            if (hasTimestamp) out << std::setprecision(17) << timestamps[i] << ',' << std::setprecision(7);
+            out << camera.t[0] << ',' << camera.t[1] << ',' << camera.t[2] << ','
+                << direction.x() << ',' << direction.y() << ',' << direction.z() << '\n';
+        }
+        std::cout << "Wrote " << (u.size() - unresolved) << " rays to " << outputPath;
+        if (unresolved) std::cout << " (" << unresolved << " pixel(s) outside the map skipped)";
+        std::cout << std::endl;
+        return 0;
+    }
+
+    // Accuracy: reproject the interpolated rays and compare with the input pixels
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> pu(0.0f, static_cast<float>(map.width()));
+    std::uniform_real_distribution<float> pv(0.0f, static_cast<float>(map.height()));
+    std::vector<float> u(randomCount), v(randomCount), x(randomCount), y(randomCount);
+    for (size_t i = 0; i < randomCount; ++i) { u[i] = pu(rng); v[i] = pv(rng); }
+
+    double seconds = timeBest([&]() {
+        map.pixelsToRays(u.data(), v.data(), randomCount, x.data(), y.data(), threads);
+    }, 0.25);
+    std::cout << "Bulk conversion: " << std::setprecision(1) << randomCount / seconds / 1e6 << " M pixels/s ("
+              << std::setprecision(2) << randomCount * 4 * sizeof(float) / seconds / 1e9 << " GB/s in + out)" << std::endl;
+
+    const size_t checked = std::min<size_t>(randomCount, 100000);
+    double maxError = 0.0, sumError = 0.0;
+    size_t valid = 0;
+    for (size_t i = 0; i < checked; ++i) {
+        if (std::isnan(x[i])) continue;
+        osg::Vec2d p = camera.distort(x[i], y[i]);
+        double error = std::sqrt((p.x() - u[i]) * (p.x() - u[i]) + (p.y() - v[i]) * (p.y() - v[i]));
+        maxError = std::max(maxError, error);
+        sumError += error;
+        ++valid;
+    }
+    std::cout << "Reprojection error over " << valid << " pixels: mean " << std::setprecision(4)
+              << (valid ? sumError / valid : 0.0) << " px, max " << maxError << " px" << std::endl;
+
+    // Per-pixel Newton solve, for comparison
+    const size_t solved = std::min<size_t>(randomCount, 20000);
+    double solveSeconds = timeBest([&]() {
+        osg::Vec2d ray;
+        for (size_t i = 0; i < solved; ++i) camera.undistort(osg::Vec2d(u[i], v[i]), ray);
+    }, 0.1);
+    std::cout << "Iterative solve: " << std::setprecision(2) << solved / solveSeconds / 1e6 << " M pixels/s" << std::endl;
+    return 0;
+}
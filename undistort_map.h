@@ -0,0 +1,59 @@
+#ifndef UNDISTORT_MAP_H
+#define UNDISTORT_MAP_H
+
+#include "camera_projection.h"
+#include "mapped_file.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Pixel -> normalized camera ray lookup for one calibration.
+// Grid nodes every `step` pixels hold the exact inverse of the distortion (x', y'), so a
+// ray through pixel (u, v) is (x', y', 1) in camera space; queries interpolate bilinearly
+// between the four surrounding nodes. The grid is written to the disk cache keyed by a
+// hash of the intrinsics and memory-mapped on later runs.
+class UndistortMap {
+public:
+    UndistortMap();
+
+    // Map the cached grid for this camera, or build it (in parallel) and cache it.
+    // Returns true if the grid came from the cache.
+    bool load(const CameraModel& camera, int step = 4, bool rebuild = false, unsigned threads = 0);
+
+    // Build without touching the cache
+    void build(const CameraModel& camera, int step = 4, unsigned threads = 0);
+
+    // Normalized ray through a pixel. Returns false outside the image or where the
+    // distortion could not be inverted.
+    bool pixelToRay(float u, float v, float& x, float& y) const;
+
+    // Bulk version; rays that cannot be resolved are NaN
+    void pixelsToRays(const float* u, const float* v, size_t count, float* x, float* y, unsigned threads = 0) const;
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int step() const { return step_; }
+    size_t nodeCount() const { return static_cast<size_t>(gridWidth_) * gridHeight_; }
+    size_t invalidNodeCount() const;
+    const std::string& cachePath() const { return cachePath_; }
+
+private:
+    void setGrid(const float* grid, int width, int height, int step);
+
+    std::vector<float> owned_;  // built grid
+    MappedFile file_;           // or mapped from the cache
+    const float* grid_;         // gridHeight_ rows of gridWidth_ (x', y') pairs
+    int width_, height_, step_;
+    int gridWidth_, gridHeight_;
+    float invStep_;
+    std::string cachePath_;
+};
+
+// Hash of everything the grid depends on (intrinsics, image size, step, format version)
+uint64_t undistortMapKey(const CameraModel& camera, int step);
+
+// `visual undistort ...` - build/load the map and convert pixels to rays
+int runUndistortCommand(int argc, char** argv);
+
+#endif
@@ -0,0 +1,761 @@
+#include "viewtarget.h"
+#include "disk_cache.h"
+#include "mapped_file.h"
+#include "parallel_for.h"
+#include "undistort_map.h"
+#include "zone_bvh.h"
+#include "zone_hittest.h"
+#include "zone_label_map.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char kKeyPrefix[] = "viewing_targets_";
+const size_t kKeyPrefixLength = sizeof(kKeyPrefix) - 1;
+// Far beyond any ECU (20 targets today); keeps a garbled index from allocating gigabytes
+const int kMaxTargets = 65536;
+
+enum TargetField { Category, GazeRegion, HighwaySpeedEnabled, Priority, Coordinates, FieldCount };
+const char* const kFieldNames[FieldCount] = { "category", "gaze_region", "highway_speed_enabled", "priority",
+                                              "coordinates" };
+
+struct Target {
+    int fieldLine[FieldCount] = {};  // line of the first value, 0 = not seen
+    int values[Coordinates] = {};
+    double coordinates[12];
+
+    bool has(int field) const { return fieldLine[field] != 0; }
+    int firstLine() const
+    {
+        int line = 0;
+        for (int f = 0; f < FieldCount; ++f) {
+            if (fieldLine[f] && (!line || fieldLine[f] < line)) line = fieldLine[f];
+        }
+        return line;
+    }
+};
+
+// The dumps' plain decimals ("-0.0886954565"): up to 15 significant digits and 22
+// fractional digits give a mantissa and a power of ten that are both exact doubles, so
+// one division is correctly rounded and matches strtod. Anything else is left to strtod.
+bool parseDecimal(const char* p, const char* end, double& value)
+{
+    static const double kPowersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                           1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    bool negative = p < end && *p == '-';
+    if (negative) ++p;
+    uint64_t mantissa = 0;
+    int digits = 0, fraction = 0;
+    bool point = false, anyDigit = false;
+    for (; p < end; ++p) {
+        if (*p == '.' && !point) { point = true; continue; }
+        if (!std::isdigit(static_cast<unsigned char>(*p))) return false;
+        anyDigit = true;
+        if (mantissa || *p != '0') ++digits;
+        mantissa = mantissa * 10 + (*p - '0');
+        if (point) ++fraction;
+        if (digits > 15 || fraction > 22) return false;
+    }
+    if (!anyDigit) return false;
+    value = static_cast<double>(mantissa) / kPowersOfTen[fraction];
+    if (negative) value = -value;
+    return true;
+}
+
+// Single pass over the mapped dump. Newlines are only ever consumed while skipping
+// separators, which is where the line count is kept.
+class DumpReader {
+public:
+    DumpReader(const char* data, size_t size, const std::string& fileName)
+        : cur_(data), end_(data + size), lineStart_(data), line_(1), fileName_(fileName) {}
+
+    // Skip whitespace, commas and braces; false at the end of the buffer
+    bool next()
+    {
+        while (cur_ < end_) {
+            char c = *cur_;
+            if (c == '\n') newLine();
+            else if (c == ' ' || c == '\t' || c == '\r' || c == ',' || c == '{' || c == '}') ++cur_;
+            else return true;
+        }
+        return false;
+    }
+
+    // A key, optionally in double quotes, and the ':' after it
+    void readKey(const char*& begin, size_t& length)
+    {
+        bool quoted = *cur_ == '"';
+        if (quoted) ++cur_;
+        begin = cur_;
+        while (cur_ < end_ && (std::isalnum(static_cast<unsigned char>(*cur_)) || *cur_ == '_')) ++cur_;
+        length = static_cast<size_t>(cur_ - begin);
+        if (length == 0) fail("expected a viewing_targets_<n>_<field> key");
+        if (quoted) {
+            if (cur_ >= end_ || *cur_ != '"') fail("expected '\"'");
+            ++cur_;
+        }
+        skipSpace();
+        if (cur_ >= end_ || *cur_ != ':') fail("expected ':'");
+        ++cur_;
+    }
+
+    double readNumber()
+    {
+        skipSpace();
+        const char* start = cur_;
+        while (cur_ < end_ && (std::isdigit(static_cast<unsigned char>(*cur_)) || *cur_ == '-' || *cur_ == '+' ||
+                               *cur_ == '.' || *cur_ == 'e' || *cur_ == 'E')) {
+            ++cur_;
+        }
+        double value;
+        if (parseDecimal(start, cur_, value)) return value;
+
+        size_t len = static_cast<size_t>(cur_ - start);
+        // strtod needs a terminated buffer; the mapping is not terminated
+        char buf[64];
+        if (len == 0 || len >= sizeof(buf)) { cur_ = start; fail("expected number"); }
+        std::memcpy(buf, start, len);
+        buf[len] = '\0';
+        char* parsedEnd = nullptr;
+        value = std::strtod(buf, &parsedEnd);
+        if (parsedEnd != buf + len) { cur_ = start; fail("malformed number"); }
+        return value;
+    }
+
+    int readInt()
+    {
+        skipSpace();
+        const char* start = cur_;
+        double value = readNumber();
+        // Converting a double outside int's range (or NaN) is undefined, so check first
+        if (!(value >= INT_MIN && value <= INT_MAX)) { cur_ = start; fail("integer out of range"); }
+        int i = static_cast<int>(value);
+        if (static_cast<double>(i) != value) { cur_ = start; fail("expected integer"); }
+        return i;
+    }
+
+    // '[' exactly `count` numbers, separated by whitespace or commas, ']'
+    void readNumberArray(double* out, size_t count, const char* what)
+    {
+        skipSpace();
+        const char* open = cur_;
+        int openLine = line_;
+        const char* openLineStart = lineStart_;
+        if (cur_ >= end_ || *cur_ != '[') fail("expected '['");
+        ++cur_;
+        size_t n = 0;
+        for (;;) {
+            if (!next()) { restore(open, openLine, openLineStart); fail("unterminated array"); }
+            if (*cur_ == ']') break;
+            double value = readNumber();
+            if (n < count) out[n] = value;
+            ++n;
+        }
+        ++cur_;
+        if (n != count) {
+            restore(open, openLine, openLineStart);
+            fail(std::string(what) + " must have " + std::to_string(count) + " values, got " + std::to_string(n));
+        }
+    }
+
+    // The value of a key nobody asked for: an array or a single token
+    void skipValue()
+    {
+        skipSpace();
+        if (cur_ < end_ && *cur_ == '[') {
+            while (cur_ < end_ && *cur_ != ']') {
+                if (*cur_ == '\n') newLine();
+                else ++cur_;
+            }
+            if (cur_ >= end_) fail("unterminated array");
+            ++cur_;
+            return;
+        }
+        while (cur_ < end_ && *cur_ != '\n' && *cur_ != ',' && *cur_ != ' ' && *cur_ != '\t' && *cur_ != '\r') ++cur_;
+    }
+
+    int line() const { return line_; }
+
+    [[noreturn]] void fail(const std::string& message) const
+    {
+        std::ostringstream msg;
+        msg << fileName_ << ":" << line_ << ":" << (cur_ - lineStart_ + 1) << ": " << message;
+        throw std::runtime_error(msg.str());
+    }
+
+private:
+    void newLine()
+    {
+        ++cur_;
+        ++line_;
+        lineStart_ = cur_;
+    }
+
+    void skipSpace()
+    {
+        while (cur_ < end_ && (*cur_ == ' ' || *cur_ == '\t' || *cur_ == '\r' || *cur_ == '\n')) {
+            if (*cur_ == '\n') newLine();
+            else ++cur_;
+        }
+    }
+
+    void restore(const char* pos, int line, const char* lineStart)
+    {
+        cur_ = pos;
+        line_ = line;
+        lineStart_ = lineStart;
+    }
+
+    const char* cur_;
+    const char* end_;
+    const char* lineStart_;
+    int line_;
+    const std::string& fileName_;
+};
+
+// "viewing_targets_12_gaze_region" -> 12, GazeRegion
+bool parseTargetKey(const char* key, size_t length, int& index, int& field)
+{
+    if (length <= kKeyPrefixLength || std::memcmp(key, kKeyPrefix, kKeyPrefixLength) != 0) return false;
+    const char* p = key + kKeyPrefixLength;
+    const char* end = key + length;
+    if (!std::isdigit(static_cast<unsigned char>(*p))) return false;
+    long n = 0;
+    while (p < end && std::isdigit(static_cast<unsigned char>(*p))) {
+        n = n * 10 + (*p++ - '0');
+        if (n >= kMaxTargets) return false;
+    }
+    if (p >= end || *p++ != '_') return false;
+    for (int f = 0; f < FieldCount; ++f) {
+        size_t nameLength = std::strlen(kFieldNames[f]);
+        if (static_cast<size_t>(end - p) == nameLength && std::memcmp(p, kFieldNames[f], nameLength) == 0) {
+            index = static_cast<int>(n);
+            field = f;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<ViewingZone> parseViewTargetBuffer(const char* data, size_t size, const std::string& fileName,
+                                               std::vector<std::string>* warnings)
+{
+    auto warn = [&](int line, const std::string& message) {
+        if (warnings) warnings->push_back(fileName + ":" + std::to_string(line) + ": " + message);
+    };
+
+    DumpReader reader(data, size, fileName);
+    std::vector<Target> targets;
+    while (reader.next()) {
+        const int keyLine = reader.line();
+        const char* key;
+        size_t length;
+        reader.readKey(key, length);
+        int index, field;
+        if (!parseTargetKey(key, length, index, field)) {
+            warn(keyLine, "ignoring unknown key '" + std::string(key, length) + "'");
+            reader.skipValue();
+            continue;
+        }
+        if (static_cast<size_t>(index) >= targets.size()) targets.resize(index + 1);
+        Target& target = targets[index];
+
+        // Repeats keep the first value; only a different value is worth a warning
+        const bool repeated = target.has(field);
+        bool differs = false;
+        if (field == Coordinates) {
+            double c[12];
+            reader.readNumberArray(c, 12, "coordinates");
+            if (!repeated) std::memcpy(target.coordinates, c, sizeof(c));
+            else differs = std::memcmp(target.coordinates, c, sizeof(c)) != 0;
+        } else {
+            int value = reader.readInt();
+            if (!repeated) target.values[field] = value;
+            else differs = target.values[field] != value;
+        }
+        if (!repeated) {
+            target.fieldLine[field] = keyLine;
+        } else if (differs) {
+            warn(keyLine, std::string(key, length) + " repeats line " + std::to_string(target.fieldLine[field]) +
+                          " with a different value; keeping the first");
+        }
+    }
+
+    std::vector<ViewingZone> zones;
+    std::map<int, size_t> targetOfZone;
+    for (size_t n = 0; n < targets.size(); ++n) {
+        const Target& target = targets[n];
+        const int line = target.firstLine();
+        if (!line) continue;  // unused index
+        const std::string name = kKeyPrefix + std::to_string(n);
+        if (!target.has(Coordinates)) {
+            throw std::runtime_error(fileName + ":" + std::to_string(line) + ": " + name + " has no coordinates");
+        }
+
+        ViewingZone zone;
+        zone.id = target.has(GazeRegion) ? target.values[GazeRegion] : static_cast<int>(n) + 1;
+        zone.label = "Zone " + std::to_string(zone.id);
+        zone.color = defaultZoneColor(zone.id);
+        zone.category = target.values[Category];
+        zone.priority = target.values[Priority];
+        zone.highwaySpeedEnabled = target.values[HighwaySpeedEnabled] != 0;
+        zone.corners.reserve(4);
+        const double* c = target.coordinates;
+        for (int j = 0; j < 4; ++j) zone.corners.push_back(carCoord(c[j * 3], c[j * 3 + 1], c[j * 3 + 2]));
+
+        auto inserted = targetOfZone.insert(std::make_pair(zone.id, n));
+        if (!inserted.second) {
+            warn(line, name + " has the same gaze region (" + std::to_string(zone.id) + ") as " + kKeyPrefix +
+                       std::to_string(inserted.first->second));
+        }
+        zones.push_back(zone);
+    }
+    return zones;
+}
+
+} // namespace
+
+std::vector<ViewingZone> parseViewTargetFile(const std::string& path, std::vector<std::string>* warnings)
+{
+    MappedFile file(path);
+    return parseViewTargetBuffer(file.data(), file.size(), path, warnings);
+}
+
+std::vector<std::string> findViewTargetFiles(const std::string& path)
+{
+    return findFiles(path, ".txt");
+}
+
+std::vector<ViewTargetFile> parseViewTargetFiles(const std::vector<std::string>& paths, unsigned threads)
+{
+    std::vector<ViewTargetFile> results(paths.size());
+    parallelForEach(paths.size(), threads, [&](size_t i) {
+        ViewTargetFile& result = results[i];
+        result.path = paths[i];
+        try {
+            MappedFile file(paths[i]);
+            result.bytes = file.size();
+            result.zones = parseViewTargetBuffer(file.data(), file.size(), paths[i], &result.warnings);
+        } catch (const std::exception& e) {
+            result.zones.clear();
+            result.error = e.what();
+        }
+    });
+    return results;
+}
+
+void writeViewingZonesFile(const std::string& path, const std::vector<ViewingZone>& zones)
+{
+    std::ofstream out(path.c_str());
+    out << "{\n  \"viewing_zones\": [\n";
+    for (size_t i = 0; i < zones.size(); ++i) {
+        const ViewingZone& zone = zones[i];
+        out << "    {\n"
+            << "      \"id\": " << zone.id << ",\n"
+            << "      \"label\": \"" << zone.label << "\",\n"
+            << std::setprecision(3) << "      \"color\": [" << zone.color.r() << ", " << zone.color.g() << ", "
+            << zone.color.b() << ", " << zone.color.a() << "],\n"
+            << "      \"category\": " << zone.category << ",\n"
+            << "      \"priority\": " << zone.priority << ",\n"
+            << "      \"highway_speed_enabled\": " << (zone.highwaySpeedEnabled ? 1 : 0) << ",\n"
+            << "      \"corners\": \n      [\n" << std::setprecision(9);
+        for (size_t c = 0; c < zone.corners.size(); ++c) {
+            for (int k = 0; k < 3; ++k) {
+                bool last = c + 1 == zone.corners.size() && k == 2;
+                out << "        " << zone.corners[c][k] << (last ? "\n" : ",\n");
+            }
+        }
+        out << "      ]\n    }" << (i + 1 < zones.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    if (!out) throw std::runtime_error("Cannot write " + path);
+}
+
+namespace {
+
+void printViewTargetUsage()
+{
+    std::cout << "Usage: visual viewtarget <viewtarget.txt | directory> ... [-o <viewingzones.json>] [--jobs N]" << std::endl;
+    std::cout << "  One dump: prints its targets (zone id, category, priority, highway speed flag) and" << std::endl;
+    std::cout << "  with -o writes them as viewingzones.json." << std::endl;
+    std::cout << "  Several dumps or directories (every *.txt below them): parses all of them on N threads" << std::endl;
+    std::cout << "  (default: one per core) and reports files/s, MB/s and the files that failed." << std::endl;
+    std::cout << "  --self-test [viewtarget.txt]  Check the parser and the hit resolution against the" << std::endl;
+    std::cout << "  checked-in 20-target dump and Sharan's viewingzones.json (exit code 1 on failure)" << std::endl;
+}
+
+int printDump(const std::string& path, const std::string& outputPath)
+{
+    std::vector<std::string> warnings;
+    std::vector<ViewingZone> zones = parseViewTargetFile(path, &warnings);
+    for (const auto& warning : warnings) std::cerr << "Warning: " << warning << std::endl;
+
+    std::cout << path << ": " << zones.size() << " view targets" << std::endl;
+    std::cout << std::setw(8) << "zone" << std::setw(10) << "category" << std::setw(10) << "priority"
+              << std::setw(10) << "highway" << std::endl;
+    for (const auto& zone : zones) {
+        std::cout << std::setw(8) << zone.id << std::setw(10) << zone.category << std::setw(10) << zone.priority
+                  << std::setw(10) << (zone.highwaySpeedEnabled ? "yes" : "no")
+                  << (isZoneDegenerate(zone) ? "  (all-zero corners, ignored by hit testing)" : "") << std::endl;
+    }
+    if (!outputPath.empty()) {
+        writeViewingZonesFile(outputPath, zones);
+        std::cout << "Wrote " << outputPath << std::endl;
+    }
+    return 0;
+}
+
+// Attributes of the checked-in viewtarget.txt, target order
+struct ExpectedTarget {
+    int id, category, priority;
+    bool highway;
+};
+
+const ExpectedTarget kShippedTargets[] = {
+    {1, 0, 0, false},  {2, 0, 0, false},  {3, 1, 1, false},  {4, 2, 2, false},  {5, 1, 2, false},
+    {6, 1, 2, false},  {7, 1, 3, false},  {8, 1, 3, false},  {9, 1, 1, true},   {10, 1, 0, true},
+    {11, 1, 0, true},  {12, 1, 1, false}, {13, 1, 1, false}, {14, 2, 2, true},  {15, 2, 2, false},
+    {16, 2, 2, false}, {17, 2, 2, false}, {18, 2, 0, false}, {19, 2, 1, false}, {20, 1, 0, false},
+};
+
+// Independent reference for the hit resolution: every triangle of the fan (c0,c1,c2),
+// (c0,c2,c3) in double precision, highest priority first, then nearest
+int referenceHit(const std::vector<ViewingZone>& zones, const osg::Vec3d& origin, const osg::Vec3d& direction,
+                 bool highwaySpeed, int* hits = nullptr, int* nearestId = nullptr)
+{
+    int bestId = 0, bestPriority = 0, count = 0;
+    double best = 0.0, nearest = 0.0;
+    for (const auto& zone : zones) {
+        if (isZoneDegenerate(zone) || zone.corners.size() != 4 || (highwaySpeed && !zone.highwaySpeedEnabled)) continue;
+        for (int tri = 0; tri < 2; ++tri) {
+            osg::Vec3d v0 = zone.corners[0], v1 = zone.corners[1 + tri], v2 = zone.corners[2 + tri];
+            osg::Vec3d e1 = v1 - v0, e2 = v2 - v0;
+            osg::Vec3d p = direction ^ e2;
+            double det = e1 * p;
+            if (std::fabs(det) < 1e-12) continue;
+            osg::Vec3d s = origin - v0;
+            double u = (s * p) / det;
+            osg::Vec3d q = s ^ e1;
+            double v = (direction * q) / det;
+            double t = (e2 * q) / det;
+            if (u < 0.0 || v < 0.0 || u + v > 1.0 || t <= 1e-6) continue;
+            ++count;
+            if (!nearestId || *nearestId == 0 || t < nearest) {
+                if (nearestId) *nearestId = zone.id;
+                nearest = t;
+            }
+            if (bestId == 0 || zone.priority > bestPriority || (zone.priority == bestPriority && t < best)) {
+                bestId = zone.id;
+                bestPriority = zone.priority;
+                best = t;
+            }
+            break;  // the other triangle of the same zone adds nothing
+        }
+    }
+    if (hits) *hits = count;
+    return bestId;
+}
+
+// Zone ids from every classification path: the BVH, the SIMD kernels with and without the
+// BVH, and the scalar kernel. Returns the first one that differs from `expected`, or
+// `expected` if they all agree.
+int classifyAllPaths(const ZoneHitTester& tester, const osg::Vec3& origin, const osg::Vec3& direction,
+                     bool highwaySpeed, int expected, std::string& path)
+{
+    GazeRayBatch rays;
+    rays.push_back(origin, direction);
+    int id = tester.bvh(highwaySpeed).intersect(origin, direction);
+    path = "ZoneBvh::intersect";
+    if (id != expected) return id;
+    tester.classify(rays, &id, nullptr, highwaySpeed);
+    path = "classify";
+    if (id != expected) return id;
+    tester.classifyBruteForce(rays, &id, nullptr, highwaySpeed);
+    path = "classifyBruteForce";
+    if (id != expected) return id;
+    tester.classifyScalar(rays, &id, nullptr, highwaySpeed);
+    path = "classifyScalar";
+    return id;
+}
+
+ViewingZone squareZone(int id, float z, float x0, float x1, int priority, bool highway)
+{
+    ViewingZone zone;
+    zone.id = id;
+    zone.label = "Zone " + std::to_string(id);
+    zone.priority = priority;
+    zone.highwaySpeedEnabled = highway;
+    zone.corners = {osg::Vec3(x0, -1.0f, z), osg::Vec3(x1, -1.0f, z), osg::Vec3(x1, 1.0f, z), osg::Vec3(x0, 1.0f, z)};
+    return zone;
+}
+
+int runSelfTest(const std::string& dumpPath, const std::string& zonesPath)
+{
+    int failures = 0;
+    auto check = [&](bool ok, const std::string& what) {
+        std::cout << (ok ? "ok    " : "FAIL  ") << what << std::endl;
+        if (!ok) ++failures;
+    };
+
+    std::vector<std::string> warnings;
+    std::vector<ViewingZone> zones;
+    try {
+        zones = parseViewTargetFile(dumpPath, &warnings);
+    } catch (const std::exception& e) {
+        check(false, std::string("parse ") + e.what());
+        return 1;
+    }
+
+    // Targets and their attributes
+    const size_t expectedCount = sizeof(kShippedTargets) / sizeof(kShippedTargets[0]);
+    check(zones.size() == expectedCount, dumpPath + ": " + std::to_string(zones.size()) + " targets, expected " +
+                                             std::to_string(expectedCount));
+    for (size_t i = 0; i < std::min(zones.size(), expectedCount); ++i) {
+        const ExpectedTarget& e = kShippedTargets[i];
+        const ViewingZone& zone = zones[i];
+        bool ok = zone.id == e.id && zone.category == e.category && zone.priority == e.priority &&
+                  zone.highwaySpeedEnabled == e.highway && zone.corners.size() == 4;
+        std::ostringstream what;
+        what << "target " << i + 1 << ": zone " << zone.id << ", category " << zone.category << ", priority "
+             << zone.priority << ", highway " << zone.highwaySpeedEnabled;
+        if (!ok) what << " (expected zone " << e.id << ", " << e.category << ", " << e.priority << ", " << e.highway << ")";
+        check(ok, what.str());
+    }
+
+    // Target 8 repeats its coordinates with all zeros further down; the first block counts
+    check(warnings.size() == 1 && warnings[0].find("viewing_targets_8_coordinates") != std::string::npos &&
+              warnings[0].find("keeping the first") != std::string::npos,
+          "one warning, for the repeated viewing_targets_8_coordinates (" + std::to_string(warnings.size()) +
+              " warning(s))");
+    const ViewingZone* zone9 = zones.size() > 8 ? &zones[8] : nullptr;
+    check(zone9 && zone9->corners.size() == 4 && !isZoneDegenerate(*zone9) &&
+              zone9->corners[0] == osg::Vec3(-0.19330525f, 0.0886954565f, 0.633054196f),
+          "target 8 keeps its first coordinates");
+    check(zones.size() == expectedCount && isZoneDegenerate(zones.back()) && zones.back().id == 20,
+          "zone 20 is degenerate (all-zero corners)");
+    size_t degenerate = 0;
+    for (const auto& zone : zones) degenerate += isZoneDegenerate(zone) ? 1 : 0;
+    check(degenerate == 1, "no other degenerate zones");
+
+    // Same corners as the hand-maintained viewingzones.json
+    try {
+        std::vector<ViewingZone> json = parseViewingZonesFile(zonesPath);
+        std::map<int, const ViewingZone*> byId;
+        for (const auto& zone : json) byId[zone.id] = &zone;
+        size_t matched = 0;
+        for (const auto& zone : zones) {
+            auto it = byId.find(zone.id);
+            if (it == byId.end() || it->second->corners.size() != zone.corners.size()) continue;
+            bool same = true;
+            for (size_t c = 0; c < zone.corners.size(); ++c) {
+                same = same && (it->second->corners[c] - zone.corners[c]).length() < 1e-6f;
+            }
+            if (same) ++matched;
+            else check(false, "zone " + std::to_string(zone.id) + " corners differ from " + zonesPath);
+        }
+        check(json.size() == zones.size() && matched == zones.size(),
+              std::to_string(matched) + "/" + std::to_string(zones.size()) + " zones have the corners of " + zonesPath);
+    } catch (const std::exception& e) {
+        check(false, std::string("read ") + e.what());
+    }
+
+    // Overlapping zones, resolved by hand: priority first, then distance, and highway-speed
+    // targets only with --highway-speed
+    std::vector<ViewingZone> stack;
+    stack.push_back(squareZone(1, 1.0f, -1.0f, 3.0f, 0, true));
+    stack.push_back(squareZone(2, 2.0f, -1.0f, 1.0f, 2, false));
+    stack.push_back(squareZone(3, 3.0f, -1.0f, 1.0f, 2, true));
+    stack.push_back(squareZone(4, 4.0f, -1.0f, 3.0f, 1, true));
+    stack.push_back(squareZone(5, 5.0f, 4.0f, 6.0f, 0, false));
+    stack.push_back(squareZone(6, 6.0f, 4.0f, 6.0f, 0, false));
+    ZoneHitTester stackTester(stack);
+    struct StackCase {
+        float x;
+        bool highwaySpeed;
+        int expected;
+        const char* what;
+    };
+    const StackCase cases[] = {
+        {0.0f, false, 2, "zones 1-4: priority 2 wins over 0 and 1, nearer of the two priority-2 zones"},
+        {0.0f, true, 3, "zones 1-4 at highway speed: zone 2 is not a highway target"},
+        {2.0f, false, 4, "zones 1 and 4: the farther zone wins on priority"},
+        {2.0f, true, 4, "zones 1 and 4 at highway speed"},
+        {5.0f, false, 5, "zones 5 and 6: equal priority, the nearer wins"},
+        {5.0f, true, 0, "zones 5 and 6 at highway speed: neither is a highway target"},
+    };
+    for (const StackCase& c : cases) {
+        std::string path;
+        int id = classifyAllPaths(stackTester, osg::Vec3(c.x, 0.0f, 0.0f), osg::Vec3(0.0f, 0.0f, 1.0f), c.highwaySpeed,
+                                  c.expected, path);
+        check(id == c.expected && referenceHit(stack, osg::Vec3d(c.x, 0.0, 0.0), osg::Vec3d(0.0, 0.0, 1.0),
+                                               c.highwaySpeed) == c.expected,
+              std::string(c.what) + (id == c.expected ? "" : " (" + path + " returned " + std::to_string(id) + ")"));
+    }
+
+    // The label map's overlap mask follows the nearest hit, not the label: a 16x2 pinhole
+    // camera at the origin looking along +z over the stack. Column 8 crosses zones 1-4,
+    // column 13 zones 1 and 4 (the farther wins, nothing behind it), column 0 only zone 1.
+    CameraModel camera;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) camera.R[r][c] = r == c ? 1.0 : 0.0;
+        camera.t[r] = 0.0;
+    }
+    camera.fx = camera.fy = 10.0;
+    camera.cx = 8.0;
+    camera.cy = 1.0;
+    for (double& k : camera.k) k = 0.0;
+    camera.p1 = camera.p2 = 0.0;
+    camera.imageWidth = 16;
+    camera.imageHeight = 2;
+    UndistortMap pixelRays;
+    pixelRays.build(camera, 1, 1);
+    ZoneLabelMap labelMap;
+    labelMap.build(camera, pixelRays, stack, 1);
+    std::ostringstream columns;
+    for (int u : {8, 13, 0}) {
+        columns << (u != 8 ? ", " : "") << labelMap.zoneAt(u, 1) << (labelMap.overlapAt(u, 1) ? "+" : "");
+    }
+    check(labelMap.zoneAt(8, 1) == 2 && labelMap.overlapAt(8, 1) && labelMap.zoneAt(13, 1) == 4 &&
+              labelMap.overlapAt(13, 1) && labelMap.zoneAt(0, 1) == 1 && !labelMap.overlapAt(0, 1),
+          "label map over zones 1-4: overlaps behind the nearest hit are flagged (" + columns.str() +
+              ", expected 2+, 4+, 1)");
+
+    // Rays through every pair of the dump's zones, against the reference
+    ZoneHitTester tester(zones);
+    size_t rays = 0, mismatches = 0, overlapping = 0, priorityDecided = 0;
+    for (bool highwaySpeed : {false, true}) {
+        for (size_t a = 0; a < zones.size(); ++a) {
+            for (size_t b = 0; b < zones.size(); ++b) {
+                if (a == b || isZoneDegenerate(zones[a]) || isZoneDegenerate(zones[b])) continue;
+                // Off the diagonal both triangles share, so no hit lands on a triangle edge
+                const std::vector<osg::Vec3>& ca = zones[a].corners;
+                const std::vector<osg::Vec3>& cb = zones[b].corners;
+                osg::Vec3 pa = ca[0] * 0.4f + ca[1] * 0.3f + ca[2] * 0.2f + ca[3] * 0.1f;
+                osg::Vec3 pb = cb[0] * 0.1f + cb[1] * 0.2f + cb[2] * 0.3f + cb[3] * 0.4f;
+                osg::Vec3 direction = pb - pa;
+                direction.normalize();
+                // Neighbouring zones of one surface are nearly coplanar; a ray grazing them
+                // has no well-defined first hit in single precision
+                osg::Vec3 na = (ca[2] - ca[0]) ^ (ca[3] - ca[1]), nb = (cb[2] - cb[0]) ^ (cb[3] - cb[1]);
+                na.normalize();
+                nb.normalize();
+                if (std::fabs(direction * na) < 0.05f || std::fabs(direction * nb) < 0.05f) continue;
+                osg::Vec3 origin = pa - direction;
+                int hits = 0, nearestId = 0;
+                int expected = referenceHit(zones, origin, direction, highwaySpeed, &hits, &nearestId);
+                std::string path;
+                int id = classifyAllPaths(tester, origin, direction, highwaySpeed, expected, path);
+                ++rays;
+                if (hits >= 2) ++overlapping;
+                if (expected != nearestId) ++priorityDecided;
+                if (id != expected) {
+                    if (mismatches < 5) {
+                        check(false, "ray through zones " + std::to_string(zones[a].id) + " and " +
+                                         std::to_string(zones[b].id) + (highwaySpeed ? " at highway speed" : "") +
+                                         ": " + path + " returned " + std::to_string(id) + ", expected " +
+                                         std::to_string(expected));
+                    }
+                    ++mismatches;
+                }
+            }
+        }
+    }
+    check(mismatches == 0 && overlapping > 0 && priorityDecided > 0,
+          std::to_string(rays) + " rays through pairs of zones agree with the reference (" + std::to_string(overlapping) +
+              " cross several zones, " + std::to_string(priorityDecided) + " decided by priority over distance)");
+
+    std::cout << (failures ? std::to_string(failures) + " check(s) failed" : std::string("All checks passed")) << std::endl;
+    return failures ? 1 : 0;
+}
+
+} // namespace
+
+int runViewTargetCommand(int argc, char** argv)
+{
+    std::vector<std::string> inputs;
+    std::string outputPath;
+    unsigned jobs = 0;
+    bool selfTest = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--self-test") selfTest = true;
+        else if (arg == "--jobs" && i + 1 < argc) jobs = std::atoi(argv[++i]);
+        else if (arg == "--help" || arg == "-h") { printViewTargetUsage(); return 0; }
+        else if (!arg.empty() && arg[0] != '-') inputs.push_back(arg);
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printViewTargetUsage();
+            return 1;
+        }
+    }
+    if (selfTest) {
+        if (inputs.size() > 1) {
+            std::cerr << "Error: --self-test takes one dump" << std::endl;
+            return 1;
+        }
+        return runSelfTest(inputs.empty() ? "viewtarget.txt" : inputs[0], "carmodels/Sharan/config/viewingzones.json");
+    }
+    if (inputs.empty()) {
+        printViewTargetUsage();
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    try {
+        for (const auto& input : inputs) {
+            std::vector<std::string> found = findViewTargetFiles(input);
+            files.insert(files.end(), found.begin(), found.end());
+        }
+        struct stat info;
+        if (files.size() == 1 && inputs.size() == 1 && stat(inputs[0].c_str(), &info) == 0 && !S_ISDIR(info.st_mode)) {
+            return printDump(files[0], outputPath);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (!outputPath.empty()) {
+        std::cerr << "Error: -o converts a single dump, not " << files.size() << " files" << std::endl;
+        return 1;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    if (jobs == 0) jobs = workerCount();
+    Clock::time_point t0 = Clock::now();
+    std::vector<ViewTargetFile> results = parseViewTargetFiles(files, jobs);
+    double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    size_t targets = 0, bytes = 0, warnings = 0, failed = 0;
+    for (const auto& result : results) {
+        targets += result.zones.size();
+        bytes += result.bytes;
+        warnings += result.warnings.size();
+        if (result.error.empty()) continue;
+        if (failed < 10) std::cerr << "Error: " << result.error << std::endl;
+        ++failed;
+    }
+    if (failed > 10) std::cerr << "... and " << failed - 10 << " more" << std::endl;
+
+    std::cout << std::fixed << std::setprecision(3) << "Parsed " << results.size() << " dump(s) (" << targets
+              << " view targets, " << bytes / 1e6 << " MB) in " << seconds << " s on " << jobs << " thread(s): "
+              << std::setprecision(0) << results.size() / seconds << " files/s, " << std::setprecision(1)
+              << bytes / 1e6 / seconds << " MB/s" << std::endl;
+    std::cout << failed << " file(s) failed, " << warnings << " warning(s)" << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,53 @@
+#ifndef VIEWTARGET_H
+#define VIEWTARGET_H
+
+#include "config_loader.h"
+
+#include <string>
+#include <vector>
+
+// Reader for viewtarget.txt, the ECU's raw viewing target parameter dump:
+//
+//   viewing_targets_<n>_category: 1
+//   viewing_targets_<n>_gaze_region: 3
+//   viewing_targets_<n>_highway_speed_enabled: 0
+//   viewing_targets_<n>_priority: 1
+//   viewing_targets_<n>_coordinates: [ x1 y1 z1 x2 y2 z2 x3 y3 z3 x4 y4 z4 ]
+//
+// Dumps are often pasted together from several tools, so keys may be quoted, values may
+// be followed by commas, array elements may be separated by commas or whitespace, and
+// braces are ignored. Target n becomes the zone with id = gaze_region (n + 1 if missing),
+// label "Zone <id>", the default zone color and the 4 corners (carCoord, meters).
+// A field that appears again for the same target keeps its first value, with a warning.
+
+// One dump from a bulk load
+struct ViewTargetFile {
+    std::string path;
+    std::vector<ViewingZone> zones;     // target order
+    std::vector<std::string> warnings;  // "file:line: message"
+    std::string error;                  // empty if the file parsed
+    size_t bytes = 0;
+};
+
+// Parse one dump. Syntax errors are thrown as std::runtime_error with
+// "file:line:column: message"; warnings (repeated fields, unknown keys) are appended to
+// `warnings` if given.
+std::vector<ViewingZone> parseViewTargetFile(const std::string& path, std::vector<std::string>* warnings = nullptr);
+
+// `path` itself if it is a file, else every *.txt file below it, sorted.
+// Throws std::runtime_error if `path` does not exist.
+std::vector<std::string> findViewTargetFiles(const std::string& path);
+
+// Parse many dumps, one file at a time per thread (threads = 0 uses workerCount()).
+// Errors are recorded per file rather than thrown.
+std::vector<ViewTargetFile> parseViewTargetFiles(const std::vector<std::string>& paths, unsigned threads = 0);
+
+// Zones in the viewingzones.json format, including the view target attributes.
+// Throws std::runtime_error if the file cannot be written.
+void writeViewingZonesFile(const std::string& path, const std::vector<ViewingZone>& zones);
+
+// `visual viewtarget <file or directory> ...` - parse dumps, print the targets or bulk
+// statistics, convert one dump to viewingzones.json
+int runViewTargetCommand(int argc, char** argv);
+
+#endif
@@ -1,575 +1,725 @@
 #include <osg/ArgumentParser>
-#include <osgViewer/Viewer>
-#include <osgDB/ReadFile>
-#include <osg/MatrixTransform>
-#include <osg/Geode>
-#include <osg/Geometry>
-#include <osg/ShapeDrawable>
-#include <osgText/Text>
+#include <osgViewer/CompositeViewer>
 #include <osgGA/TrackballManipulator>
+#include <osgGA/GUIEventHandler>
+#include <osgUtil/IncrementalCompileOperation>
 #include <iostream>
-#include <iomanip>
 #include <string>
 #include <vector>
-#include <float.h>
-#include <fstream>
-#include <sstream>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
 #include <stdexcept>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <sstream>
 
-// Desired coordinate system: X=red (left/driver side), Y=green (up/roof), Z=blue (forward)
-// NOTE: This function defines coordinates in the desired system
-inline osg::Vec3 carCoord(float x, float y, float z) {
-    return osg::Vec3(x, y, z);
-}
+#include "config_loader.h"
+#include "scene_builder.h"
+#include "zone_hittest.h"
+#include "camera_projection.h"
+#include "undistort_map.h"
+#include "zone_label_map.h"
+#include "render_batch.h"
+#include "model_library.h"
+#include "model_cache.h"
+#include "label_batch.h"
+#include "gaze_stream.h"
+#include "session_log.h"
+#include "trace.h"
+#include "frame_stats.h"
+#include "config_watch.h"
+#include "config_bundle.h"
+#include "viewtarget.h"
+#include "zone_coverage.h"
+#include "camera_frustum.h"
+#include "extrinsics_sweep.h"
+#include "camera_view.h"
+#include "frame_loop.h"
+
+// The home position is fixed rather than computed from the scene bounds, so it is the same
+// before and after the car mesh arrives
+void setupInitialCameraView(osgViewer::View& viewer)
+{
+    // Set up camera view from behind the car - further back for better overview
+    // In your coordinate system: X=left/right, Y=up/down, Z=forward/backward
+    // Position camera much further behind the car (negative Z) and elevated (positive Y)
+    osg::Vec3d eye(0, -200, -5000);       // Much further behind and higher up
+    osg::Vec3d center(0.0, 0.0, 0.0);   // Look at the origin (car center)
+    osg::Vec3d up(0.0, 1.0, 0.0);       // Y is up
 
-// Configuration structures
-struct CameraCalibration {
-    // Extrinsics (from IsspItfcParamCameraExtrinsics)
-    double rotation_matrix[3][3];
-    double translation_vector[3];
+    std::cout << "Setting up camera view from behind the car:" << std::endl;
+    std::cout << "  Eye position: " << eye.x() << ", " << eye.y() << ", " << eye.z() << std::endl;
+    std::cout << "  Look at center: " << center.x() << ", " << center.y() << ", " << center.z() << std::endl;
+    std::cout << "  Up vector: " << up.x() << ", " << up.y() << ", " << up.z() << std::endl;
+
+    // Create and set a new TrackballManipulator explicitly
+    osg::ref_ptr<osgGA::TrackballManipulator> manipulator = new osgGA::TrackballManipulator();
+    viewer.setCameraManipulator(manipulator.get());
     
-    // Intrinsics (from IsspItfcParamCameraIntrinsics)
-    double principal_point_X;
-    double principal_point_Y;
-    double focal_length_X;
-    double focal_length_Y;
-    double distortion_k1;
-    double distortion_k2;
-    double distortion_k3;
-    double distortion_k4;
-    double distortion_k5;
-    double distortion_k6;
-    double distortion_p1;
-    double distortion_p2;
+    // Set the home position
+    manipulator->setHomePosition(eye, center, up);
+    manipulator->home(1); // Go to home position immediately
     
-    // Visualization parameters
-    float meters_to_mm_scale;
-    float frustum_scale_factor;
-    float camera_sphere_radius_mm;
-    float axes_length_mm;
-    float axes_arrow_wing_mm;
-};
+    // Also set the viewer's camera directly for the initial frame.
+    viewer.getCamera()->setViewMatrixAsLookAt(eye, center, up);
+}
 
-struct ViewingZone {
-    int id;
-    std::string label;
-    osg::Vec4 color;
-    std::vector<osg::Vec3> corners;  // Will be populated from 1x12 matrix
-};
+// Left click (without dragging) on a zone prints its id and label and highlights it.
+// The pick ray is intersected with the zone BVH rather than the scene graph.
+class ZonePickHandler : public osgGA::GUIEventHandler
+{
+public:
+    ZonePickHandler(const std::vector<ViewingZone>& zones, float metersToMmScale, ZoneBatch* zoneBatch)
+        : bvh_(zones), metersToMmScale_(metersToMmScale), zoneBatch_(zoneBatch), pressX_(0.0f), pressY_(0.0f)
+    {
+        for (const auto& zone : zones) labels_[zone.id] = zone.label;
+    }
 
-struct CarModelTransformation {
-    std::string type;      // "rotate", "scale", "translate"
-    double angle;          // For rotation
-    double x, y, z;        // For rotation axis and translation
-    double value;          // For scale
-};
+    // Pick against another model's zones (after a model switch)
+    void setZones(const std::vector<ViewingZone>& zones, float metersToMmScale, ZoneBatch* zoneBatch)
+    {
+        bvh_ = ZoneBvh(zones);
+        metersToMmScale_ = metersToMmScale;
+        zoneBatch_ = zoneBatch;
+        labels_.clear();
+        for (const auto& zone : zones) labels_[zone.id] = zone.label;
+    }
 
-struct CarModelConfig {
-    std::string name;
-    std::string path;
-    std::vector<CarModelTransformation> transformations;
-};
+    virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa)
+    {
+        if (ea.getButton() != osgGA::GUIEventAdapter::LEFT_MOUSE_BUTTON) return false;
+        if (ea.getEventType() == osgGA::GUIEventAdapter::PUSH) {
+            pressX_ = ea.getX();
+            pressY_ = ea.getY();
+            return false;
+        }
+        if (ea.getEventType() != osgGA::GUIEventAdapter::RELEASE) return false;
+        if (std::fabs(ea.getX() - pressX_) > 2.0f || std::fabs(ea.getY() - pressY_) > 2.0f) return false;
+
+        osgViewer::View* view = dynamic_cast<osgViewer::View*>(&aa);
+        if (!view || !view->getCamera()->getViewport()) return false;
+        osg::Camera* camera = view->getCamera();
+
+        // Window coordinates back to world space (millimeters), then to zone space (meters)
+        osg::Matrixd windowToWorld = osg::Matrixd::inverse(
+            camera->getViewMatrix() * camera->getProjectionMatrix() * camera->getViewport()->computeWindowMatrix());
+        osg::Vec3d nearPoint = osg::Vec3d(ea.getX(), ea.getY(), 0.0) * windowToWorld;
+        osg::Vec3d farPoint = osg::Vec3d(ea.getX(), ea.getY(), 1.0) * windowToWorld;
+        osg::Vec3 origin = osg::Vec3(nearPoint / metersToMmScale_);
+        osg::Vec3 direction = osg::Vec3(farPoint - nearPoint);
+        direction.normalize();
+
+        float distance;
+        int zoneId = bvh_.intersect(origin, direction, &distance);
+        zoneBatch_->setHighlight(zoneId);
+        if (zoneId) {
+            std::cout << "Picked " << labels_[zoneId] << " (id " << zoneId << ") at "
+                      << distance << " m" << std::endl;
+        } else {
+            std::cout << "Picked no zone" << std::endl;
+        }
+        return false;
+    }
 
-// Simple JSON parsing functions (basic implementation)
-std::string trim(const std::string& str) {
-    size_t first = str.find_first_not_of(' ');
-    if (std::string::npos == first) return str;
-    size_t last = str.find_last_not_of(' ');
-    return str.substr(first, (last - first + 1));
-}
+private:
+    ZoneBvh bvh_;
+    float metersToMmScale_;
+    osg::ref_ptr<ZoneBatch> zoneBatch_;
+    std::map<int, std::string> labels_;
+    float pressX_, pressY_;
+};
 
-std::vector<std::string> split(const std::string& str, char delimiter) {
-    std::vector<std::string> tokens;
-    std::stringstream ss(str);
-    std::string token;
-    while (std::getline(ss, token, delimiter)) {
-        tokens.push_back(trim(token));
+// Plays a recorded session log over the zones: the ECU zone of the record at the current
+// time is highlighted and the record's gaze ray is drawn up to the zone it hits.
+// P plays/pauses, Left/Right step 1 s, Down/Up 10 s, ',' and '.' one record.
+class SessionPlayer : public osgGA::GUIEventHandler
+{
+public:
+    SessionPlayer(const SessionLog& log, int64_t startUs)
+        : log_(log), ray_(new GazeRayNode), timeUs_(startUs), playing_(true), shown_(log.size()),
+          lastFrameTime_(-1.0)
+    {
+        clampTime();
     }
-    return tokens;
-}
 
-double parseDouble(const std::string& str) {
-    std::string clean = str;
-    clean.erase(std::remove(clean.begin(), clean.end(), ','), clean.end());
-    clean.erase(std::remove(clean.begin(), clean.end(), '['), clean.end());
-    clean.erase(std::remove(clean.begin(), clean.end(), ']'), clean.end());
-    return std::stod(trim(clean));
-}
+    // Draw into another model's zones (after a model switch)
+    void attach(const std::vector<ViewingZone>& zones, ZoneBatch* zoneBatch)
+    {
+        if (zoneBatch_.valid()) zoneBatch_->removeChild(ray_.get());
+        bvh_ = ZoneBvh(zones);
+        zoneBatch_ = zoneBatch;
+        zoneBatch_->addChild(ray_.get());
+        if (log_.header().zoneSetHash != zoneSetHash(zones)) {
+            std::cerr << "Warning: the session's zone ids were recorded for a different set of zones" << std::endl;
+        }
+        shown_ = log_.size();  // redraw on the next frame
+    }
 
-float parseFloat(const std::string& str) {
-    return static_cast<float>(parseDouble(str));
-}
+    bool playing() const { return playing_; }
 
-CameraCalibration loadCalibration(const std::string& configPath) {
-    CameraCalibration config;
-    
-    std::ifstream file(configPath + "/calibraton.json");
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open calibration file: " + configPath + "/calibraton.json");
+    virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter&)
+    {
+        if (ea.getEventType() == osgGA::GUIEventAdapter::FRAME) {
+            double now = ea.getTime();
+            if (playing_ && lastFrameTime_ >= 0.0) {
+                timeUs_ += static_cast<int64_t>((now - lastFrameTime_) * 1e6);
+                if (timeUs_ >= log_.lastTimestampUs()) {
+                    playing_ = false;
+                    std::cout << "Session: end of log" << std::endl;
+                }
+                clampTime();
+            }
+            lastFrameTime_ = now;
+            show(log_.seek(timeUs_), false);
+            return false;
+        }
+        if (ea.getEventType() != osgGA::GUIEventAdapter::KEYDOWN) return false;
+
+        int key = ea.getKey();
+        if (key == 'p' || key == 'P') {
+            playing_ = !playing_;
+            if (playing_ && timeUs_ >= log_.lastTimestampUs()) timeUs_ = log_.firstTimestampUs();
+            lastFrameTime_ = -1.0;  // an on-demand viewer may not have drawn since the pause
+            std::cout << "Session: " << (playing_ ? "playing" : "paused") << std::endl;
+            return true;
+        }
+        if (key == osgGA::GUIEventAdapter::KEY_Left || key == osgGA::GUIEventAdapter::KEY_Right ||
+            key == osgGA::GUIEventAdapter::KEY_Down || key == osgGA::GUIEventAdapter::KEY_Up) {
+            int64_t step = key == osgGA::GUIEventAdapter::KEY_Left || key == osgGA::GUIEventAdapter::KEY_Right ? 1000000 : 10000000;
+            bool back = key == osgGA::GUIEventAdapter::KEY_Left || key == osgGA::GUIEventAdapter::KEY_Down;
+            timeUs_ += back ? -step : step;
+        } else if (key == ',' || key == '.') {
+            size_t current = log_.seek(timeUs_);
+            size_t next = key == ',' ? (current > 0 ? current - 1 : 0) : std::min(current + 1, log_.size() - 1);
+            timeUs_ = log_[next].timestampUs;
+        } else {
+            return false;
+        }
+        clampTime();
+        show(log_.seek(timeUs_), true);
+        return true;
     }
-    
-    std::string line;
-    std::string content;
-    while (std::getline(file, line)) {
-        content += line;
+
+private:
+    void clampTime()
+    {
+        timeUs_ = std::max(log_.firstTimestampUs(), std::min(log_.lastTimestampUs(), timeUs_));
     }
-    file.close();
-    
-    // Parse hardcoded values (simplified JSON parsing)
-    // In a production environment, you'd use a proper JSON library like nlohmann/json
-    // Updated to use the new optimized JSON structure that matches parameter format
-    
-    // Extrinsics: 4x4 matrix from IsspItfcParamCameraExtrinsics.CameraExtrinsics.extrinsics
-    // Row 0: Rotation matrix first row
-    config.rotation_matrix[0][0] = -0.9655356639799625;
-    config.rotation_matrix[0][1] = -0.09616767134251294;
-    config.rotation_matrix[0][2] = -0.2418537982770954;
-    // Row 1: Rotation matrix second row
-    config.rotation_matrix[1][0] = -0.08291905700679839;
-    config.rotation_matrix[1][1] = 0.9944737910417899;
-    config.rotation_matrix[1][2] = -0.06439796753550224;
-    // Row 2: Rotation matrix third row
-    config.rotation_matrix[2][0] = 0.24671054027465514;
-    config.rotation_matrix[2][1] = -0.042124276560735585;
-    config.rotation_matrix[2][2] = -0.9681736540454445;
-    // Row 3: Translation vector (from 4th row of extrinsics matrix)
-    config.translation_vector[0] = -0.39774068678243776;
-    config.translation_vector[1] = 0.023064699630140467;
-    config.translation_vector[2] = 0.5953452132457162;
-    
-    // Intrinsics: from IsspItfcParamCameraIntrinsics.CameraIntrinsics.*
-    config.principal_point_X = 1259.174044;
-    config.principal_point_Y = 1001.371091;
-    config.focal_length_X = 1038.271869;
-    config.focal_length_Y = 1038.592443;
-    config.distortion_k1 = 0.76287571;
-    config.distortion_k2 = 0.098954426;
-    config.distortion_k3 = 0.001117539;
-    config.distortion_k4 = 1.130182163;
-    config.distortion_k5 = 0.287574035;
-    config.distortion_k6 = 0.012158208;
-    config.distortion_p1 = 3.65E-05;
-    config.distortion_p2 = 2.97E-05;
-    
-    // Visualization parameters (kept from previous structure)
-    config.meters_to_mm_scale = 1000.0f;
-    config.frustum_scale_factor = 0.7f;
-    config.camera_sphere_radius_mm = 20.0f;
-    config.axes_length_mm = 1500.0f;
-    config.axes_arrow_wing_mm = 300.0f;
-    
-    std::cout << "Loaded camera calibration from: " << configPath << "/calibraton.json" << std::endl;
-    std::cout << "Using optimized parameter-friendly JSON structure" << std::endl;
-    
-    // Print loaded intrinsics for verification
-    std::cout << "\nCamera Intrinsics:" << std::endl;
-    std::cout << "  Principal Point: (" << config.principal_point_X << ", " << config.principal_point_Y << ")" << std::endl;
-    std::cout << "  Focal Length: (" << config.focal_length_X << ", " << config.focal_length_Y << ")" << std::endl;
-    std::cout << "  Distortion: k1=" << config.distortion_k1 << ", k2=" << config.distortion_k2 
-              << ", p1=" << config.distortion_p1 << ", p2=" << config.distortion_p2 << std::endl;
-    
-    return config;
-}
 
-std::vector<ViewingZone> loadViewingZones(const std::string& configPath) {
-    std::vector<ViewingZone> zones;
-    
-    std::ifstream file(configPath + "/viewingzones.json");
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open viewing zones file: " + configPath + "/viewingzones.json");
+    void show(size_t index, bool print)
+    {
+        if (!zoneBatch_.valid() || (index == shown_ && !print)) return;
+        shown_ = index;
+        const SessionRecord& record = log_[index];
+        int ecuZone = (record.flags & SessionHasZone) ? record.zoneId : 0;
+        zoneBatch_->setHighlight(ecuZone);
+
+        osg::Vec3 origin(record.gazeOrigin[0], record.gazeOrigin[1], record.gazeOrigin[2]);
+        osg::Vec3 direction(record.gazeDirection[0], record.gazeDirection[1], record.gazeDirection[2]);
+        float distance = 2.0f;  // length of a ray that misses every zone, meters
+        int gazeZone = bvh_.intersect(origin, direction, &distance);
+        ray_->setRay(origin, origin + direction * (gazeZone ? distance : 2.0f));
+
+        if (print) {
+            std::cout << "Session t=" << std::fixed << std::setprecision(3)
+                      << (record.timestampUs - log_.firstTimestampUs()) * 1e-6 << " s (record " << index + 1 << "/"
+                      << log_.size() << "): ECU zone ";
+            if (record.flags & SessionHasZone) std::cout << ecuZone;
+            else std::cout << "-";
+            std::cout << ", gaze ray hits " << (gazeZone ? "zone " + std::to_string(gazeZone) : std::string("no zone"))
+                      << std::defaultfloat << std::endl;
+        }
     }
-    
-    // For now, return the hardcoded zones with 1x12 matrix format (in production, parse from JSON)
-    // This is a simplified implementation - a proper JSON parser would be used in production
-    // Each corners array contains 12 values in readable 1x12 format with multi-line layout:
-    // [x1,y1,z1, x2,y2,z2, x3,y3,z3, x4,y4,z4]
-    
-    std::vector<std::vector<float>> zoneCorners1x12 = {
-        {0.302683634f,0.172922612f,0.477520705f, 0.369028626f,-0.351126698f,1.438743529f, -0.360267707f,-0.300829215f,1.483062361f, -0.35571788f,0.174002442f,0.47505936f},
-        {-0.35571788f,0.174002442f,0.47505936f, -0.360267707f,-0.300829215f,1.483062361f, -1.089375193f,-0.348731578f,1.433285057f, -1.014119393f,0.175082273f,0.472598015f},
-        {-0.26710974f,-0.258635603f,0.657716295f, -0.267144782f,-0.375360344f,0.615867355f, -0.496142871f,-0.37498442f,0.615010582f, -0.496107829f,-0.25825968f,0.656859521f},
-        {-0.162393466f,-0.415464107f,0.675954176f, -0.162484352f,-0.716816683f,0.606087158f, -0.553060013f,-0.716359284f,0.604622368f, -0.552969126f,-0.415006707f,0.674489386f},
-        {0.273809139f,0.23876006f,-0.205173977f, 0.478793351f,-0.288795528f,-0.042529962f, 0.369028626f,-0.351126698f,1.438743529f, 0.302683634f,0.172922612f,0.477520705f},
-        {-1.014119393f,0.175082273f,0.472598015f, -1.089375193f,-0.348731578f,1.433285057f, -1.18845044f,-0.286843036f,-0.048782687f, -0.981017026f,0.240229574f,-0.209879997f},
-        {0.714846298f,-0.117275734f,0.6534199f, 0.71323881f,-0.32976234f,0.653643236f, 0.476011159f,-0.327866842f,0.749586808f, 0.477618646f,-0.115380235f,0.749363472f},
-        {-1.183722742f,-0.115925105f,0.740691078f, -1.184077529f,-0.330924658f,0.740433629f, -1.430764141f,-0.330395334f,0.638343178f, -1.430409353f,-0.115395781f,0.638600626f},
-        {-0.19330525f,0.0886954565f,0.633054196f, -0.1942135828f,-0.0105370244f,0.6372395534f, -0.4754007803f,-0.0105370244f,0.576214529f, -0.4744924476f,0.0886954565f,0.5720291724f},
-        {0.478793351f,-0.288795528f,-0.042529962f, 0.478335535f,-0.705049762f,-0.050437371f, 0.429306499f,-0.717509723f,0.608306573f, 0.423449706f,-0.319716019f,0.700486301f},
-        {-1.138753961f,-0.317886538f,0.694627511f, -1.144850863f,-0.715666243f,0.602402953f, -1.188908256f,-0.703097269f,-0.056690097f, -1.18845044f,-0.286843036f,-0.048782687f},
-        {0.180655773f,-0.230487853f,0.733739368f, 0.180549186f,-0.351042018f,0.70933277f, -0.190310347f,-0.350433214f,0.707945236f, -0.19020376f,-0.229879049f,0.732351834f},
-        {0.180549186f,-0.351042018f,0.70933277f, 0.152562612f,-0.385024159f,0.487549789f, -0.165433454f,-0.388945843f,0.484067994f, -0.190310347f,-0.350433214f,0.707945236f},
-        {0.429306499f,-0.717509723f,0.608306573f, 0.478335535f,-0.705049762f,-0.050437371f, -0.355286361f,-0.704073516f,-0.053563734f, -0.357772182f,-0.716587983f,0.605354763f},
-        {0.42488276f,-0.41616208f,0.67818283f, 0.429306499f,-0.717509723f,0.608306573f, -0.162484352f,-0.716816683f,0.606087158f, -0.162393466f,-0.415464107f,0.675954176f},
-        {-0.357772182f,-0.716587983f,0.605354763f, -0.355286361f,-0.704073516f,-0.053563734f, -1.188908256f,-0.703097269f,-0.056690097f, -1.144850863f,-0.715666243f,0.602402953f},
-        {-0.552969126f,-0.415006707f,0.674489386f, -0.553060013f,-0.716359284f,0.604622368f, -1.144850863f,-0.715666243f,0.602402953f, -1.140231919f,-0.414312832f,0.672271237f},
-        {0.302683634f,0.172922612f,0.477520705f, 0.273809139f,0.23876006f,-0.205173977f, -0.981017026f,0.240229574f,-0.209879997f, -1.014119393f,0.175082273f,0.472598015f},
-        {0.801738997f,-0.416607352f,0.679606253f, -0.005293253f,-1.504539913f,0.09015681f, -0.409370883f,-0.959619427f,0.38183117f, -0.813448513f,-0.41469894f,0.67350553f},
-        {0.0f,0.0f,0.0f, 0.0f,0.0f,0.0f, 0.0f,0.0f,0.0f, 0.0f,0.0f,0.0f}
-    };
-    
-    std::vector<osg::Vec4> zoneColors = {
-        osg::Vec4(1.0f,0.0f,1.0f,0.7f), osg::Vec4(0.0f,1.0f,1.0f,0.7f), osg::Vec4(1.0f,0.5f,0.0f,0.7f), osg::Vec4(0.5f,0.0f,1.0f,0.7f),
-        osg::Vec4(0.0f,1.0f,0.5f,0.7f), osg::Vec4(1.0f,0.0f,0.5f,0.7f), osg::Vec4(0.5f,1.0f,0.0f,0.7f), osg::Vec4(0.0f,0.5f,1.0f,0.7f),
-        osg::Vec4(0.5f,0.5f,0.5f,0.7f), osg::Vec4(1.0f,1.0f,0.0f,0.7f), osg::Vec4(0.0f,1.0f,1.0f,0.7f), osg::Vec4(1.0f,0.0f,1.0f,0.7f),
-        osg::Vec4(1.0f,0.5f,0.0f,0.7f), osg::Vec4(0.5f,0.0f,1.0f,0.7f), osg::Vec4(0.0f,1.0f,0.5f,0.7f), osg::Vec4(1.0f,0.0f,0.5f,0.7f),
-        osg::Vec4(0.5f,1.0f,0.0f,0.7f), osg::Vec4(0.0f,0.5f,1.0f,0.7f), osg::Vec4(1.0f,1.0f,0.0f,0.7f), osg::Vec4(0.5f,0.5f,0.5f,0.7f)
-    };
-    
-    for (int i = 0; i < 20; ++i) {
-        ViewingZone zone;
-        zone.id = i + 1;
-        zone.label = "Zone " + std::to_string(i + 1);
-        zone.color = zoneColors[i];
-        
-        // Parse 1x12 matrix format: [x1,y1,z1, x2,y2,z2, x3,y3,z3, x4,y4,z4]
-        for (int j = 0; j < 4; ++j) {
-            int baseIndex = j * 3;  // Each corner has 3 coordinates (x,y,z)
-            zone.corners.push_back(carCoord(
-                zoneCorners1x12[i][baseIndex],     // x
-                zoneCorners1x12[i][baseIndex + 1], // y
-                zoneCorners1x12[i][baseIndex + 2]  // z
-            ));
-        }
-        
-        zones.push_back(zone);
+
+    const SessionLog& log_;
+    ZoneBvh bvh_;
+    osg::ref_ptr<ZoneBatch> zoneBatch_;
+    osg::ref_ptr<GazeRayNode> ray_;
+    int64_t timeUs_;
+    bool playing_;
+    size_t shown_;
+    double lastFrameTime_;
+};
+
+// Adds each car mesh to its model's carTransform once the loader thread has finished it.
+// With an IncrementalCompileOperation the mesh's GL objects are compiled a few per frame
+// and the viewer merges it in the update traversal when all are done, so even a large
+// CAD export never stalls a frame. Meshes of models not on screen are compiled the same
+// way, which keeps later model switches smooth.
+class CarMeshHandler : public osgGA::GUIEventHandler
+{
+public:
+    CarMeshHandler(ModelLibrary& library, osgUtil::IncrementalCompileOperation* compiler)
+        : library_(library), compiler_(compiler), attached_(library.size(), false), remaining_(library.size())
+    {
     }
-    
-    file.close();
-    std::cout << "Loaded " << zones.size() << " viewing zones from: " << configPath << "/viewingzones.json" << std::endl;
-    std::cout << "Using 1x12 matrix format: [x1,y1,z1, x2,y2,z2, x3,y3,z3, x4,y4,z4]" << std::endl;
-    return zones;
-}
 
-CarModelConfig loadCarModel(const std::string& carModelName) {
-    CarModelConfig config;
-    std::ifstream file("carmodels/carmodels.json");
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open carmodels/carmodels.json");
+    // A loaded mesh is waiting to be handed over, or one is still being compiled and merged
+    bool pending() const
+    {
+        for (const auto& entry : compiling_) {
+            if (!entry.first->containsNode(entry.second.get())) return true;
+        }
+        for (size_t i = 0; i < attached_.size(); ++i) {
+            if (!attached_[i] && library_.meshState(i) != ModelLibrary::Pending && library_.meshState(i) != ModelLibrary::Loading) return true;
+        }
+        return false;
     }
-    
-    std::string line, content;
-    while (std::getline(file, line)) {
-        content += line;
+
+    virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter&)
+    {
+        if (ea.getEventType() != osgGA::GUIEventAdapter::FRAME) return false;
+        compiling_.erase(std::remove_if(compiling_.begin(), compiling_.end(), [](const Compiling& entry) {
+            return entry.first->containsNode(entry.second.get());
+        }), compiling_.end());
+        if (remaining_ == 0) return false;
+        for (size_t i = 0; i < attached_.size(); ++i) {
+            if (attached_[i]) continue;
+            if (library_.meshState(i) == ModelLibrary::Failed) {
+                attached_[i] = true;
+                --remaining_;
+                continue;
+            }
+            osg::ref_ptr<osg::Node> carNode = library_.takeCarNode(i);
+            ModelScene* scene = carNode.valid() ? library_.get(i) : nullptr;
+            if (!scene) continue;
+            if (compiler_.valid()) {
+                compiler_->add(scene->carTransform.get(), carNode.get());
+                compiling_.push_back(Compiling(scene->carTransform.get(), carNode));
+            } else {
+                scene->carTransform->addChild(carNode.get());
+            }
+            attached_[i] = true;
+            --remaining_;
+        }
+        return false;
     }
-    file.close();
-    
-    // Find the car model section (basic JSON parsing)
-    std::string searchKey = "\"" + carModelName + "\"";
-    size_t modelStart = content.find(searchKey);
-    if (modelStart == std::string::npos) {
-        throw std::runtime_error("Car model '" + carModelName + "' not found in carmodels.json");
+
+private:
+    typedef std::pair<osg::ref_ptr<osg::Group>, osg::ref_ptr<osg::Node> > Compiling;  // parent, mesh
+
+    ModelLibrary& library_;
+    osg::ref_ptr<osgUtil::IncrementalCompileOperation> compiler_;
+    std::vector<bool> attached_;
+    size_t remaining_;
+    std::vector<Compiling> compiling_;
+};
+
+// Applies edits to viewingzones.json and calibraton.json while the viewer runs. Every
+// model's config directory is watched; a saved file is re-parsed on the next frame and
+// applied to that model's scene in place (see updateSceneZones, updateSceneCalibration).
+// The car mesh is never reloaded. A file that fails to parse is reported and the scene
+// keeps its previous config.
+class ConfigReloadHandler : public osgGA::GUIEventHandler
+{
+public:
+    ConfigReloadHandler(ModelLibrary& library, osg::Group* sceneRoot, ZonePickHandler* picker,
+                        GazeOverlay* gazeOverlay, SessionPlayer* sessionPlayer)
+        : library_(library), sceneRoot_(sceneRoot), picker_(picker), gazeOverlay_(gazeOverlay),
+          sessionPlayer_(sessionPlayer)
+    {
+        for (size_t i = 0; i < library.size(); ++i) {
+            try {
+                int directory = watcher_.addDirectory("carmodels/" + library.name(i) + "/config");
+                if (static_cast<size_t>(directory) >= models_.size()) models_.resize(directory + 1);
+                models_[directory] = i;
+            } catch (const std::exception& e) {
+                std::cerr << "Warning: " << e.what() << "; config changes will not be picked up" << std::endl;
+            }
+        }
     }
-    
-    // Find the opening brace for this model
-    size_t braceStart = content.find("{", modelStart);
-    if (braceStart == std::string::npos) {
-        throw std::runtime_error("Invalid JSON structure for model: " + carModelName);
+
+    // A file in a watched directory was written since the last frame
+    bool pending() const { return watcher_.pending(); }
+
+    virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter&)
+    {
+        if (ea.getEventType() != osgGA::GUIEventAdapter::FRAME) return false;
+        for (const auto& change : watcher_.poll()) {
+            if (change.file != "viewingzones.json" && change.file != "calibraton.json") continue;
+            ModelScene* scene = library_.get(models_[change.directory]);
+            if (!scene) continue;  // still loading, and will read the new file itself
+            std::string path = watcher_.directory(change.directory) + "/" + change.file;
+
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            std::ostringstream summary;
+            try {
+                if (change.file == "viewingzones.json") {
+                    std::vector<ViewingZone> zones = parseViewingZonesFile(path);
+                    ZoneDiff diff = diffViewingZones(scene->zones, zones);
+                    if (diff.empty()) continue;
+                    size_t written = updateSceneZones(*scene, zones);
+                    summary << diff.changed.size() << " changed, " << diff.added.size() << " added, "
+                            << diff.removed.size() << " removed zone(s), " << written << " array entries written";
+                } else {
+                    updateSceneCalibration(*scene, parseCalibrationRig(path));
+                    const double* t = scene->calibration.translation_vector;
+                    summary << scene->cameras.size() << " camera(s), first camera center " << t[0] << ", " << t[1]
+                            << ", " << t[2] << " m";
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Error reloading " << path << ": " << e.what() << " (keeping the previous config)" << std::endl;
+                continue;
+            }
+
+            // Pick, gaze and session lookups use the zones of the model on screen
+            if (sceneRoot_->getChild(0) == scene->root.get()) {
+                picker_->setZones(scene->zones, scene->metersToMmScale, scene->zoneBatch.get());
+                if (gazeOverlay_.valid()) gazeOverlay_->attach(scene->zones, scene->zoneBatch.get());
+                if (sessionPlayer_.valid()) sessionPlayer_->attach(scene->zones, scene->zoneBatch.get());
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            std::cout << "Reloaded " << path << ": " << summary.str() << " (" << std::fixed << std::setprecision(2)
+                      << ms << " ms)" << std::defaultfloat << std::endl;
+        }
+        return false;
     }
-    
-    // Extract path
-    size_t pathStart = content.find("\"path\"", braceStart);
-    size_t pathValueStart = content.find(":", pathStart) + 1;
-    size_t pathQuoteStart = content.find("\"", pathValueStart);
-    size_t pathQuoteEnd = content.find("\"", pathQuoteStart + 1);
-    config.path = content.substr(pathQuoteStart + 1, pathQuoteEnd - pathQuoteStart - 1);
-    
-    // Extract transformations
-    size_t transformStart = content.find("\"transformations\"", braceStart);
-    size_t arrayStart = content.find("[", transformStart);
-    size_t arrayEnd = content.find("]", arrayStart);
-    std::string transformArray = content.substr(arrayStart + 1, arrayEnd - arrayStart - 1);
-    
-    // Parse each transformation (look for type, angle, x, y, z, value)
-    size_t pos = 0;
-    while (pos < transformArray.length()) {
-        size_t objectStart = transformArray.find("{", pos);
-        if (objectStart == std::string::npos) break;
-        
-        size_t objectEnd = transformArray.find("}", objectStart);
-        if (objectEnd == std::string::npos) break;
-        
-        std::string transformObj = transformArray.substr(objectStart + 1, objectEnd - objectStart - 1);
-        CarModelTransformation transform;
-        
-        // Parse type
-        size_t typeStart = transformObj.find("\"type\"");
-        if (typeStart != std::string::npos) {
-            size_t typeValueStart = transformObj.find(":", typeStart) + 1;
-            size_t typeQuoteStart = transformObj.find("\"", typeValueStart);
-            size_t typeQuoteEnd = transformObj.find("\"", typeQuoteStart + 1);
-            transform.type = transformObj.substr(typeQuoteStart + 1, typeQuoteEnd - typeQuoteStart - 1);
-        }
-        
-        // Parse numeric values
-        auto parseValue = [&](const std::string& key) -> double {
-            size_t keyStart = transformObj.find("\"" + key + "\"");
-            if (keyStart == std::string::npos) return 0.0;
-            size_t valueStart = transformObj.find(":", keyStart) + 1;
-            size_t valueEnd = transformObj.find_first_of(",}", valueStart);
-            std::string valueStr = trim(transformObj.substr(valueStart, valueEnd - valueStart));
-            return std::stod(valueStr);
-        };
-        
-        transform.angle = parseValue("angle");
-        transform.x = parseValue("x");
-        transform.y = parseValue("y");
-        transform.z = parseValue("z");
-        transform.value = parseValue("value");
-        
-        config.transformations.push_back(transform);
-        pos = objectEnd + 1;
+
+private:
+    ModelLibrary& library_;
+    osg::ref_ptr<osg::Group> sceneRoot_;
+    osg::ref_ptr<ZonePickHandler> picker_;
+    osg::ref_ptr<GazeOverlay> gazeOverlay_;
+    osg::ref_ptr<SessionPlayer> sessionPlayer_;
+    ConfigWatcher watcher_;
+    std::vector<size_t> models_;  // model index per watched directory
+};
+
+// Coverage heatmap around the eye point for the model on screen (--coverage). It is
+// computed when a model is first shown and again when its zones change (config reload);
+// C shows and hides it.
+class CoverageHeatmapHandler : public osgGA::GUIEventHandler
+{
+public:
+    CoverageHeatmapHandler(ModelLibrary& library, osg::Group* sceneRoot, const CoverageOptions& options)
+        : library_(library), sceneRoot_(sceneRoot), options_(options), visible_(true)
+    {
     }
-    
-    config.name = carModelName;
-    std::cout << "Loaded car model '" << carModelName << "' with " << config.transformations.size() << " transformations" << std::endl;
-    std::cout << "Model path: " << config.path << std::endl;
-    
-    return config;
-}
 
-osg::Matrix applyCarModelTransformations(const CarModelConfig& config) {
-    osg::Matrix matrix;
-    matrix.makeIdentity();
-    
-    std::cout << "Applying transformations for " << config.name << ":" << std::endl;
-    
-    for (const auto& transform : config.transformations) {
-        if (transform.type == "rotate") {
-            osg::Matrix rotation;
-            osg::Vec3 axis(transform.x, transform.y, transform.z);
-            rotation.makeRotate(osg::DegreesToRadians(transform.angle), axis);
-            matrix = matrix * rotation;
-            std::cout << "  - Rotate " << transform.angle << "° around axis (" 
-                      << transform.x << ", " << transform.y << ", " << transform.z << ")" << std::endl;
-        }
-        else if (transform.type == "scale") {
-            osg::Matrix scale;
-            scale.makeScale(transform.value, transform.value, transform.value);
-            matrix = matrix * scale;
-            std::cout << "  - Scale by " << transform.value << std::endl;
-        }
-        else if (transform.type == "translate") {
-            osg::Matrix translation;
-            translation.makeTranslate(transform.x, transform.y, transform.z);
-            matrix = matrix * translation;
-            std::cout << "  - Translate by (" << transform.x << ", " << transform.y << ", " << transform.z << ")" << std::endl;
+    virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter&)
+    {
+        if (ea.getEventType() == osgGA::GUIEventAdapter::KEYDOWN && (ea.getKey() == 'c' || ea.getKey() == 'C')) {
+            visible_ = !visible_;
+            for (auto& entry : heatmaps_) {
+                if (entry.second.node.valid()) entry.second.node->setNodeMask(visible_ ? ~0u : 0u);
+            }
+            return true;
+        }
+        if (ea.getEventType() != osgGA::GUIEventAdapter::FRAME) return false;
+
+        ModelScene* scene = nullptr;
+        for (size_t i = 0; i < library_.size() && !scene; ++i) {
+            ModelScene* candidate = library_.get(i);
+            if (candidate && candidate->root.get() == sceneRoot_->getChild(0)) scene = candidate;
         }
+        if (!scene) return false;
+        Heatmap& heatmap = heatmaps_[scene->name];
+        if (heatmap.computed && diffViewingZones(heatmap.zones, scene->zones).empty() && heatmap.metersToMmScale == scene->metersToMmScale) {
+            return false;
+        }
+
+        if (heatmap.node.valid()) scene->root->removeChild(heatmap.node.get());
+        heatmap.node = nullptr;
+        heatmap.computed = true;
+        heatmap.zones = scene->zones;
+        heatmap.metersToMmScale = scene->metersToMmScale;
+        try {
+            ZoneCoverage coverage = computeZoneCoverage(scene->zones, options_);
+            heatmap.node = createCoverageHeatmap(coverage, 0.25f, scene->metersToMmScale);
+            heatmap.node->setNodeMask(visible_ ? ~0u : 0u);
+            scene->root->addChild(heatmap.node.get());
+            std::cout << "Coverage of " << scene->name << ": " << std::fixed << std::setprecision(3)
+                      << coverage.solidAngle(options_.samples - coverage.multiplicity[0]) << " sr covered, "
+                      << coverage.gaps.size() << " uncovered region(s) (" << options_.samples << " samples in "
+                      << coverage.seconds << " s)" << std::defaultfloat << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: No coverage heatmap for " << scene->name << ": " << e.what() << std::endl;
+        }
+        return false;
     }
-    
-    return matrix;
-}
 
-// Helper to create a coordinate axes with arrowheads at the origin
-osg::ref_ptr<osg::Node> createAxesWithArrows(float axisLength = 5.0f, float arrowWing = 1.0f)
-{
-    osg::ref_ptr<osg::Geode> geode = new osg::Geode();
-    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry();
-    osg::ref_ptr<osg::Vec3Array> verts = new osg::Vec3Array();
-    osg::ref_ptr<osg::Vec4Array> cols = new osg::Vec4Array();
-
-    // X axis (red, left/right)
-    verts->push_back(osg::Vec3(0,0,0)); verts->push_back(osg::Vec3(axisLength,0,0));
-    cols->push_back(osg::Vec4(1,0,0,1)); cols->push_back(osg::Vec4(1,0,0,1));
-    verts->push_back(osg::Vec3(axisLength,0,0)); verts->push_back(osg::Vec3(axisLength-arrowWing, arrowWing*0.5, 0));
-    cols->push_back(osg::Vec4(1,0,0,1)); cols->push_back(osg::Vec4(1,0,0,1));
-    verts->push_back(osg::Vec3(axisLength,0,0)); verts->push_back(osg::Vec3(axisLength-arrowWing, -arrowWing*0.5, 0));
-    cols->push_back(osg::Vec4(1,0,0,1)); cols->push_back(osg::Vec4(1,0,0,1));
-
-    // Y axis (green, up)
-    verts->push_back(osg::Vec3(0,0,0)); verts->push_back(osg::Vec3(0,axisLength,0));
-    cols->push_back(osg::Vec4(0,1,0,1)); cols->push_back(osg::Vec4(0,1,0,1));
-    verts->push_back(osg::Vec3(0,axisLength,0)); verts->push_back(osg::Vec3(arrowWing*0.5, axisLength-arrowWing, 0));
-    cols->push_back(osg::Vec4(0,1,0,1)); cols->push_back(osg::Vec4(0,1,0,1));
-    verts->push_back(osg::Vec3(0,axisLength,0)); verts->push_back(osg::Vec3(-arrowWing*0.5, axisLength-arrowWing, 0));
-    cols->push_back(osg::Vec4(0,1,0,1)); cols->push_back(osg::Vec4(0,1,0,1));
-
-    // Z axis (blue, forward)
-    verts->push_back(osg::Vec3(0,0,0)); verts->push_back(osg::Vec3(0,0,axisLength));
-    cols->push_back(osg::Vec4(0,0,1,1)); cols->push_back(osg::Vec4(0,0,1,1));
-    verts->push_back(osg::Vec3(0,0,axisLength)); verts->push_back(osg::Vec3(0, arrowWing*0.5, axisLength-arrowWing));
-    cols->push_back(osg::Vec4(0,0,1,1)); cols->push_back(osg::Vec4(0,0,1,1));
-    verts->push_back(osg::Vec3(0,0,axisLength)); verts->push_back(osg::Vec3(0, -arrowWing*0.5, axisLength-arrowWing));
-    cols->push_back(osg::Vec4(0,0,1,1)); cols->push_back(osg::Vec4(0,0,1,1));
-
-    geom->setVertexArray(verts);
-    osg::ref_ptr<osg::DrawArrays> drawArrays = new osg::DrawArrays(GL_LINES, 0, verts->size());
-    geom->addPrimitiveSet(drawArrays);
-    geom->setColorArray(cols, osg::Array::BIND_PER_VERTEX);
-
-    geode->addDrawable(geom);
-    geode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-    return geode;
-}
+private:
+    struct Heatmap {
+        osg::ref_ptr<osg::Node> node;
+        bool computed = false;
+        std::vector<ViewingZone> zones;  // the zones it was computed for
+        float metersToMmScale = 0.0f;
+    };
 
-// Helper to create a simple camera frustum (pyramid) and a marker at the camera center
-osg::ref_ptr<osg::Node> createCameraFrustum(float sphereRadius = 0.1f)
+    ModelLibrary& library_;
+    osg::ref_ptr<osg::Group> sceneRoot_;
+    CoverageOptions options_;
+    bool visible_;
+    std::map<std::string, Heatmap> heatmaps_;  // by model name
+};
+
+// Extrinsics sensitivity ellipses at the zone corners the camera sees, for the model on
+// screen (--sweep). Recomputed when a model is first shown and again when its zones or its
+// calibration change; E shows and hides them.
+class SweepEllipseHandler : public osgGA::GUIEventHandler
 {
-    osg::ref_ptr<osg::Group> group = new osg::Group();
-
-    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry();
-    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array();
-    float w = 0.2f, h = 0.15f, d = 0.3f;
-    // Sharan coordinate system: X=left, Y=up, Z=forward
-    vertices->push_back(carCoord(0, 0, 0));
-    vertices->push_back(carCoord(-w, -h, d));
-    vertices->push_back(carCoord(w, -h, d));
-    vertices->push_back(carCoord(w, h, d));
-    vertices->push_back(carCoord(-w, h, d));
-    geom->setVertexArray(vertices);
-
-    osg::ref_ptr<osg::DrawElementsUInt> indices = new osg::DrawElementsUInt(GL_LINES);
-    for (unsigned i = 1; i <= 4; ++i) {
-        indices->push_back(0);
-        indices->push_back(i);
-    }
-    indices->push_back(1); indices->push_back(2);
-    indices->push_back(2); indices->push_back(3);
-    indices->push_back(3); indices->push_back(4);
-    indices->push_back(4); indices->push_back(1);
-    geom->addPrimitiveSet(indices);
-
-    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array();
-    colors->push_back(osg::Vec4(0, 1, 0, 1));
-    geom->setColorArray(colors, osg::Array::BIND_OVERALL);
-
-    osg::ref_ptr<osg::Geode> frustumGeode = new osg::Geode();
-    frustumGeode->addDrawable(geom);
-    frustumGeode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-
-    osg::ref_ptr<osg::Sphere> sphere = new osg::Sphere(carCoord(0, 0, 0), sphereRadius);
-    osg::ref_ptr<osg::ShapeDrawable> sphereDrawable = new osg::ShapeDrawable(sphere);
-    sphereDrawable->setColor(osg::Vec4(0, 0.2, 1, 1));
-    osg::ref_ptr<osg::Geode> sphereGeode = new osg::Geode();
-    sphereGeode->addDrawable(sphereDrawable);
-    sphereGeode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-
-    group->addChild(frustumGeode);
-    group->addChild(sphereGeode);
-    return group;
-}
+public:
+    SweepEllipseHandler(ModelLibrary& library, osg::Group* sceneRoot, const SweepOptions& options, float magnify)
+        : library_(library), sceneRoot_(sceneRoot), options_(options), magnify_(magnify), visible_(true)
+    {
+    }
+
+    virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter&)
+    {
+        if (ea.getEventType() == osgGA::GUIEventAdapter::KEYDOWN && (ea.getKey() == 'e' || ea.getKey() == 'E')) {
+            visible_ = !visible_;
+            for (auto& entry : overlays_) {
+                if (entry.second.node.valid()) entry.second.node->setNodeMask(visible_ ? ~0u : 0u);
+            }
+            return true;
+        }
+        if (ea.getEventType() != osgGA::GUIEventAdapter::FRAME) return false;
+
+        ModelScene* scene = nullptr;
+        for (size_t i = 0; i < library_.size() && !scene; ++i) {
+            ModelScene* candidate = library_.get(i);
+            if (candidate && candidate->root.get() == sceneRoot_->getChild(0)) scene = candidate;
+        }
+        if (!scene) return false;
+        // CameraModel is all doubles and ints, so comparing the bytes compares the calibration
+        CameraModel camera(scene->calibration);
+        Overlay& overlay = overlays_[scene->name];
+        if (overlay.computed && diffViewingZones(overlay.zones, scene->zones).empty() &&
+            std::memcmp(&overlay.camera, &camera, sizeof(CameraModel)) == 0 && overlay.metersToMmScale == scene->metersToMmScale) {
+            return false;
+        }
+
+        if (overlay.node.valid()) scene->root->removeChild(overlay.node.get());
+        overlay.node = nullptr;
+        overlay.computed = true;
+        overlay.zones = scene->zones;
+        overlay.camera = camera;
+        overlay.metersToMmScale = scene->metersToMmScale;
+        try {
+            ExtrinsicsSweep sweep = computeExtrinsicsSweep(camera, scene->zones, options_);
+            overlay.node = createSweepEllipses(sweep, camera, scene->zones, magnify_, scene->metersToMmScale);
+            overlay.node->setNodeMask(visible_ ? ~0u : 0u);
+            scene->root->addChild(overlay.node.get());
+            std::cout << "Extrinsics sweep of " << scene->name << " (+-" << options_.translationMm << " mm, +-"
+                      << options_.rotationDeg << " deg): " << sweep.corners.size() << " corners in view, "
+                      << std::fixed << std::setprecision(2) << "p95 " << sweep.overall.p95 << " px, max "
+                      << sweep.overall.max << " px; ellipses drawn " << std::setprecision(0) << magnify_
+                      << "x enlarged (" << sweep.poses << " poses in " << std::setprecision(3) << sweep.seconds
+                      << " s)" << std::defaultfloat << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: No sweep ellipses for " << scene->name << ": " << e.what() << std::endl;
+        }
+        return false;
+    }
+
+private:
+    struct Overlay {
+        osg::ref_ptr<osg::Node> node;
+        bool computed = false;
+        std::vector<ViewingZone> zones;  // the zones and camera it was computed for
+        CameraModel camera;
+        float metersToMmScale = 0.0f;
+    };
+
+    ModelLibrary& library_;
+    osg::ref_ptr<osg::Group> sceneRoot_;
+    SweepOptions options_;
+    float magnify_;
+    bool visible_;
+    std::map<std::string, Overlay> overlays_;  // by model name
+};
 
-// Helper to create a polygon (viewing zone) from 4 points and a label
-osg::ref_ptr<osg::Group> createViewingZoneWithLabel(const std::vector<osg::Vec3>& corners, const std::string& label, const osg::Vec4& color = osg::Vec4(1,0,1,0.7))
+// Each camera of the displayed model's rig seen through its own lens: the inset views share
+// the main view's window and scene graph and are stacked down its right edge at the sensor
+// aspect ratio. Views beyond the rig's camera count draw nothing. The pinhole projection
+// comes from the intrinsics, so lens distortion is not shown; the camera markers are left
+// out, since every camera would otherwise look out through its own frustum.
+class CameraInsetHandler : public osgGA::GUIEventHandler
 {
-    osg::ref_ptr<osg::Group> group = new osg::Group();
-
-    osg::ref_ptr<osg::Geode> geode = new osg::Geode();
-    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry();
-    osg::ref_ptr<osg::Vec3Array> verts = new osg::Vec3Array();
-    for (const auto& v : corners) verts->push_back(v);
-    verts->push_back(corners[0]);
-    geom->setVertexArray(verts);
-    geom->addPrimitiveSet(new osg::DrawArrays(GL_LINE_STRIP, 0, verts->size()));
-    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array();
-    colors->push_back(osg::Vec4(color.r(), color.g(), color.b(), 1.0f)); // Make outline fully opaque
-    geom->setColorArray(colors, osg::Array::BIND_OVERALL);
-    
-    // Make lines more visible
-    osg::StateSet* lineState = geom->getOrCreateStateSet();
-    lineState->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-    lineState->setMode(GL_DEPTH_TEST, osg::StateAttribute::ON);
-
-    // Fill polygon
-    osg::ref_ptr<osg::Geometry> fillGeom = new osg::Geometry();
-    osg::ref_ptr<osg::Vec3Array> fillVerts = new osg::Vec3Array();
-    for (const auto& v : corners) fillVerts->push_back(v);
-    fillGeom->setVertexArray(fillVerts);
-    fillGeom->addPrimitiveSet(new osg::DrawArrays(GL_POLYGON, 0, fillVerts->size()));
-    osg::ref_ptr<osg::Vec4Array> fillColors = new osg::Vec4Array();
-    fillColors->push_back(osg::Vec4(color.r(), color.g(), color.b(), color.a() * 0.5f)); // Use color alpha
-    fillGeom->setColorArray(fillColors, osg::Array::BIND_OVERALL);
-    
-    // Better rendering setup for visibility
-    osg::StateSet* fillState = fillGeom->getOrCreateStateSet();
-    fillState->setMode(GL_BLEND, osg::StateAttribute::ON);
-    fillState->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-    fillState->setMode(GL_DEPTH_TEST, osg::StateAttribute::ON);
-    fillState->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
-    fillState->setRenderBinDetails(100, "DepthSortedBin"); // Render after opaque objects
-
-    geode->addDrawable(fillGeom);
-    geode->addDrawable(geom);
-    geode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-    geode->getOrCreateStateSet()->setMode(GL_BLEND, osg::StateAttribute::ON);
-    geode->getOrCreateStateSet()->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
-
-    group->addChild(geode);
-
-    // Compute centroid for label position
-    osg::Vec3 centroid(0,0,0);
-    for(const auto& v : corners) centroid += v;
-    centroid /= corners.size();
-
-    // Create the label at zone center with smaller, cleaner display
-    osg::ref_ptr<osgText::Text> zoneText = new osgText::Text;
-    zoneText->setCharacterSize(50.0f); // Smaller, more appropriate size
-    zoneText->setAxisAlignment(osgText::TextBase::SCREEN);
-    zoneText->setPosition(centroid);
-    
-    // Extract just the number from label (e.g., "Zone 1" -> "1")
-    std::string numberOnly = label;
-    size_t spacePos = numberOnly.find(' ');
-    if (spacePos != std::string::npos) {
-        numberOnly = numberOnly.substr(spacePos + 1);
+public:
+    CameraInsetHandler(ModelLibrary& library, osg::Group* sceneRoot, const std::vector<osgViewer::View*>& insets)
+        : library_(library), sceneRoot_(sceneRoot), insets_(insets)
+    {
     }
-    zoneText->setText(numberOnly);
-    
-    zoneText->setColor(osg::Vec4(1,1,1,1)); // White text
-    zoneText->setAlignment(osgText::Text::CENTER_CENTER); // Center the text
-    
-    // Add black outline/background for better contrast
-    zoneText->setBackdropType(osgText::Text::OUTLINE);
-    zoneText->setBackdropColor(osg::Vec4(0,0,0,0.8f)); // Semi-transparent black outline
 
-    osg::ref_ptr<osg::Geode> zoneTextGeode = new osg::Geode();
-    zoneTextGeode->addDrawable(zoneText);
-    zoneTextGeode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-    zoneTextGeode->getOrCreateStateSet()->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF); // Always visible
-    zoneTextGeode->getOrCreateStateSet()->setRenderBinDetails(1000, "RenderBin"); // Render on top
+    virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter&)
+    {
+        if (ea.getEventType() != osgGA::GUIEventAdapter::FRAME) return false;
 
-    group->addChild(zoneTextGeode);
+        ModelScene* scene = nullptr;
+        for (size_t i = 0; i < library_.size() && !scene; ++i) {
+            ModelScene* candidate = library_.get(i);
+            if (candidate && candidate->root.get() == sceneRoot_->getChild(0)) scene = candidate;
+        }
+        size_t cameras = scene ? scene->cameras.size() : 0;
+        for (size_t i = 0; i < insets_.size(); ++i) {
+            osg::Camera* view = insets_[i]->getCamera();
+            if (i >= cameras) {
+                view->setCullMask(0);
+                view->setClearMask(0);
+                continue;
+            }
+            const osg::GraphicsContext::Traits* traits = view->getGraphicsContext()->getTraits();
+            CameraModel camera(scene->cameras[i]);
+            int height = traits->height / static_cast<int>(insets_.size());
+            int width = height * camera.imageWidth / camera.imageHeight;
+            view->setViewport(traits->width - width, traits->height - (static_cast<int>(i) + 1) * height, width, height);
+            view->setViewMatrix(cameraViewMatrix(camera, scene->metersToMmScale));
+            view->setProjectionMatrix(cameraProjectionMatrix(camera, 0.05, 10.0));
+            view->setCullMask(~kCameraMarkerMask);
+            view->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+        return false;
+    }
 
-    return group;
-}
+private:
+    ModelLibrary& library_;
+    osg::ref_ptr<osg::Group> sceneRoot_;
+    std::vector<osgViewer::View*> insets_;  // owned by the viewer
+};
 
-void setupInitialCameraView(osgViewer::Viewer& viewer, osg::Node* modelNode)
+// Switches the displayed car model: keys 1-9 pick a model by its position in
+// carmodels.json, Page Up/Down cycle. Models still loading in the background are
+// switched to as soon as they are ready.
+class ModelSwitchHandler : public osgGA::GUIEventHandler
 {
-    // Set up camera view from behind the car - further back for better overview
-    // In your coordinate system: X=left/right, Y=up/down, Z=forward/backward
-    // Position camera much further behind the car (negative Z) and elevated (positive Y)
-    osg::Vec3d eye(0, -200, -5000);       // Much further behind and higher up
-    osg::Vec3d center(0.0, 0.0, 0.0);   // Look at the origin (car center)
-    osg::Vec3d up(0.0, 1.0, 0.0);       // Y is up
+public:
+    ModelSwitchHandler(ModelLibrary& library, osg::Group* sceneRoot, ZonePickHandler* picker,
+                       GazeOverlay* gazeOverlay, SessionPlayer* sessionPlayer, size_t current,
+                       int displayZoneNumber)
+        : library_(library), sceneRoot_(sceneRoot), picker_(picker), gazeOverlay_(gazeOverlay),
+          sessionPlayer_(sessionPlayer), current_(current), pending_(-1), displayZoneNumber_(displayZoneNumber)
+    {
+    }
 
-    std::cout << "Setting up camera view from behind the car:" << std::endl;
-    std::cout << "  Eye position: " << eye.x() << ", " << eye.y() << ", " << eye.z() << std::endl;
-    std::cout << "  Look at center: " << center.x() << ", " << center.y() << ", " << center.z() << std::endl;
-    std::cout << "  Up vector: " << up.x() << ", " << up.y() << ", " << up.z() << std::endl;
+    // A requested model has finished loading (or failed) and can be switched to
+    bool pending() const
+    {
+        if (pending_ < 0) return false;
+        ModelLibrary::State state = library_.state(static_cast<size_t>(pending_));
+        return state == ModelLibrary::Ready || state == ModelLibrary::Failed;
+    }
 
-    // Create and set a new TrackballManipulator explicitly
-    osg::ref_ptr<osgGA::TrackballManipulator> manipulator = new osgGA::TrackballManipulator();
-    viewer.setCameraManipulator(manipulator.get());
-    
-    // Set the home position
-    manipulator->setHomePosition(eye, center, up);
-    manipulator->home(1); // Go to home position immediately
-    
-    // Also set the viewer's camera directly for the initial frame.
-    viewer.getCamera()->setViewMatrixAsLookAt(eye, center, up);
-}
+    virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter&)
+    {
+        if (ea.getEventType() == osgGA::GUIEventAdapter::FRAME) {
+            if (pending_ >= 0) trySwitch(static_cast<size_t>(pending_));
+            return false;
+        }
+        if (ea.getEventType() != osgGA::GUIEventAdapter::KEYDOWN || library_.size() == 0) return false;
+
+        int key = ea.getKey();
+        size_t n = library_.size();
+        if (key >= '1' && key <= '9' && static_cast<size_t>(key - '1') < n) {
+            request(key - '1');
+        } else if (key == osgGA::GUIEventAdapter::KEY_Page_Down) {
+            request(static_cast<int>((current_ + 1) % n));
+        } else if (key == osgGA::GUIEventAdapter::KEY_Page_Up) {
+            request(static_cast<int>((current_ + n - 1) % n));
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void request(int index)
+    {
+        if (static_cast<size_t>(index) == current_) return;
+        pending_ = index;
+        if (!trySwitch(static_cast<size_t>(index)) && library_.state(index) != ModelLibrary::Failed) {
+            std::cout << "Model " << library_.name(index) << " is still loading..." << std::endl;
+        }
+    }
+
+    bool trySwitch(size_t index)
+    {
+        if (library_.state(index) == ModelLibrary::Failed) {
+            std::cout << "Model " << library_.name(index) << " failed to load" << std::endl;
+            pending_ = -1;
+            return false;
+        }
+        ModelScene* scene = library_.get(index);
+        if (!scene) return false;
+
+        // The zone filter carries over if the new model defines that zone
+        showZone(*scene, scene->zoneBatch->hasZone(displayZoneNumber_) ? displayZoneNumber_ : 0);
+        sceneRoot_->replaceChild(sceneRoot_->getChild(0), scene->root.get());
+        picker_->setZones(scene->zones, scene->metersToMmScale, scene->zoneBatch.get());
+        if (gazeOverlay_.valid()) gazeOverlay_->attach(scene->zones, scene->zoneBatch.get());
+        if (sessionPlayer_.valid()) sessionPlayer_->attach(scene->zones, scene->zoneBatch.get());
+        current_ = index;
+        pending_ = -1;
+        std::cout << "Switched to " << scene->name << " (" << scene->zones.size() << " zones, camera at "
+                  << scene->calibration.translation_vector[0] << ", " << scene->calibration.translation_vector[1]
+                  << ", " << scene->calibration.translation_vector[2] << " m)" << std::endl;
+        return true;
+    }
+
+    ModelLibrary& library_;
+    osg::ref_ptr<osg::Group> sceneRoot_;
+    osg::ref_ptr<ZonePickHandler> picker_;
+    osg::ref_ptr<GazeOverlay> gazeOverlay_;
+    osg::ref_ptr<SessionPlayer> sessionPlayer_;
+    size_t current_;
+    int pending_;
+    int displayZoneNumber_;
+};
 
 void printUsage(const char* programName) {
-    std::cout << "Usage: " << programName << " [model <name>] [zone <number>]" << std::endl;
+    std::cout << "Usage: " << programName << " [model <name>] [zone <number>] [--gaze <source>] [--gaze-rate <hz>]" << std::endl;
+    std::cout << "       " << programName << " [model <name>] --session <log.vlog> [--session-start <seconds>]" << std::endl;
     std::cout << "Options:" << std::endl;
-    std::cout << "  model <name>   Use specified car model (default: Sharan)" << std::endl;
-    std::cout << "  zone <number>  Display only the specified zone (1-20)" << std::endl;
-    std::cout << "  (no args)      Display all zones with default model (Sharan)" << std::endl;
+    std::cout << "  model <name>       Use specified car model (default: Sharan)" << std::endl;
+    std::cout << "  zone <number>      Display only the zone with the given id" << std::endl;
+    std::cout << "  --gaze <source>    Live gaze overlay: gaze CSV file, '-' (stdin), FIFO, Unix socket or unix:<path>" << std::endl;
+    std::cout << "  --gaze-rate <hz>   Replay rate for a gaze file (default 1000, 0 = unpaced)" << std::endl;
+    std::cout << "  --session <log>    Play and scrub a recorded session log (P, arrow keys, ',' and '.')" << std::endl;
+    std::cout << "  --session-start <seconds>  Start position, from the beginning of the log" << std::endl;
+    std::cout << "  --bundle <file.vbundle>    Load the configs from a bundle (see bundle --help); JSON if it is stale" << std::endl;
+    std::cout << "  --no-watch                 Do not reload viewingzones.json and calibraton.json when they change" << std::endl;
+    std::cout << "  --no-insets                Do not show the view through each calibrated camera" << std::endl;
+    std::cout << "  --on-demand                Draw only on input, config reloads, gaze samples, playback and loading models" << std::endl;
+    std::cout << "  --threading <model>        single, cull-draw, draw, cull-per-camera (default) or auto" << std::endl;
+    std::cout << "  --max-fps <hz>             Frame rate cap (default: none)" << std::endl;
+    std::cout << "  --loop-report <seconds>    Print frames, latency and idle CPU every n seconds, not just on exit" << std::endl;
+    std::cout << "  --trace <file.json>        Write a timeline of the startup phases (Chrome trace format)" << std::endl;
+    std::cout << "  --frame-stats <file>       Write per-frame event/update/cull/draw times on exit (.csv or .json)" << std::endl;
+    std::cout << "  --frame-stats-frames <n>   Record only the first n frames" << std::endl;
+    std::cout << "  --coverage                 Gaze coverage heatmap around the eye point (C toggles; see coverage --help)" << std::endl;
+    std::cout << "  --sweep <mm>,<deg>         Reprojection error ellipses of the zone corners for that extrinsics tolerance (E toggles)" << std::endl;
+    std::cout << "  (no args)          Display all zones with default model (Sharan)" << std::endl;
+    std::cout << "  Other models in carmodels.json load in the background; in the viewer, keys 1-9" << std::endl;
+    std::cout << "  or Page Up/Down switch models" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Tools:" << std::endl;
+    std::cout << "  loadbench [model] [iterations]  Time parsing of the model's JSON config files" << std::endl;
+    std::cout << "  classify <gaze.csv> [options]   Classify gaze rays into zone IDs (see classify --help)" << std::endl;
+    std::cout << "  zonebench [rays]                Zone hit-test scaling from 20 to 10,000 zones" << std::endl;
+    std::cout << "  project <points.csv> [options]  Project carCoord points to distorted pixels (see project --help)" << std::endl;
+    std::cout << "  undistort [options]             Build/load the pixel-to-ray map, convert pixels to rays (see undistort --help)" << std::endl;
+    std::cout << "  labelmap [options]              Build/load the image-space zone label map (see labelmap --help)" << std::endl;
+    std::cout << "  render [options]                Offscreen PNGs of every model x zone x camera preset (see render --help)" << std::endl;
+    std::cout << "  modelcache [model ...]          Rebuild the optimized model cache, report load times and draw calls" << std::endl;
+    std::cout << "  labelbench [options]            Offscreen frame times for 20/200/2000 zone labels (see labelbench --help)" << std::endl;
+    std::cout << "  gazestream <source> [options]   Read a live gaze stream without a window, report rate and counters" << std::endl;
+    std::cout << "  sessionlog <action> ...         Convert session CSV to the binary log, info, export, benchmark (see sessionlog --help)" << std::endl;
+    std::cout << "  bundle [<output>] [options]     Compile all JSON configs into one binary bundle, check or time it (see bundle --help)" << std::endl;
+    std::cout << "  viewtarget <file|dir> ...       Parse ECU viewtarget.txt dumps, convert one to viewingzones.json (see viewtarget --help)" << std::endl;
+    std::cout << "  frustum [options]               Calibrated camera frustum and zones in view, batch over candidate mountings (see frustum --help)" << std::endl;
+    std::cout << "  coverage [options]              Monte-Carlo zone coverage of the gaze sphere: solid angles, overlaps, gaps (see coverage --help)" << std::endl;
+    std::cout << "  sweep [options]                 Pixel error of the zone corners under extrinsics tolerances (see sweep --help)" << std::endl;
+    std::cout << "  cameraview [options]            The calibrated camera's image with lens distortion, at sensor resolution (see cameraview --help)" << std::endl;
     std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
     std::cout << "  " << programName << "                # Display all zones with Sharan" << std::endl;
     std::cout << "  " << programName << " zone 9         # Display only Zone 9 with Sharan" << std::endl;
     std::cout << "  " << programName << " model Golf7    # Display all zones with Golf7" << std::endl;
     std::cout << "  " << programName << " model Lincoln  # Display all zones with Lincoln" << std::endl;
+    std::cout << "  " << programName << " --gaze drive.csv  # Replay recorded gaze over the zones" << std::endl;
 }
 
 int main(int argc, char** argv)
@@ -577,28 +727,136 @@ int main(int argc, char** argv)
     // *** PARSE COMMAND LINE ARGUMENTS ***
     int displayZoneNumber = 0; // Default: display all zones
     std::string carModelName = "Sharan"; // Default car model
+    std::string gazeSource;
+    double gazeRate = 1000.0;
+    std::string sessionPath;
+    double sessionStart = 0.0;
+    bool watchConfig = true;
+    std::string tracePath;
+    std::string frameStatsPath;
+    int frameStatsFrames = 0;
+    std::string bundlePath;
+    bool showCoverage = false;
+    double sweepMm = 0.0, sweepDeg = 0.0;
+    bool showInsets = true;
+    bool onDemand = false;
+    std::string threadingName = "cull-per-camera";
+    double maxFrameRate = 0.0;
+    double loopReportSeconds = 0.0;
     
+    // Headless tools (no viewer is created)
+    if (argc > 1 && std::string(argv[1]) == "loadbench") {
+        std::string benchModel = argc > 2 ? argv[2] : carModelName;
+        int iterations = argc > 3 ? std::atoi(argv[3]) : 1000;
+        return runLoadBenchmark(benchModel, iterations > 0 ? iterations : 1000);
+    }
+    if (argc > 1 && std::string(argv[1]) == "classify") {
+        return runClassifyCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "zonebench") {
+        return runZoneScalingBenchmark(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "project") {
+        return runProjectCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "undistort") {
+        return runUndistortCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "labelmap") {
+        return runLabelMapCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "render") {
+        return runRenderCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "modelcache") {
+        return runModelCacheCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "labelbench") {
+        return runLabelBenchmark(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "gazestream") {
+        return runGazeStreamCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "sessionlog") {
+        return runSessionLogCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "bundle") {
+        return runBundleCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "viewtarget") {
+        return runViewTargetCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "frustum") {
+        return runFrustumCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "coverage") {
+        return runCoverageCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "sweep") {
+        return runSweepCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "cameraview") {
+        return runCameraViewCommand(argc, argv);
+    }
+
     // Parse arguments
-    if (argc > 1) {
-        if (argc == 3 && std::string(argv[1]) == "zone") {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "zone" && i + 1 < argc) {
             try {
-                displayZoneNumber = std::stoi(argv[2]);
-                if (displayZoneNumber < 1 || displayZoneNumber > 20) {
-                    std::cerr << "Error: Zone number must be between 1 and 20" << std::endl;
+                displayZoneNumber = std::stoi(argv[++i]);
+                if (displayZoneNumber < 1) {
+                    std::cerr << "Error: Zone number must be positive" << std::endl;
                     printUsage(argv[0]);
                     return 1;
                 }
             } catch (const std::exception& e) {
-                std::cerr << "Error: Invalid zone number '" << argv[2] << "'" << std::endl;
+                std::cerr << "Error: Invalid zone number '" << argv[i] << "'" << std::endl;
                 printUsage(argv[0]);
                 return 1;
             }
-        } else if (argc == 3 && std::string(argv[1]) == "model") {
-            carModelName = argv[2];
-        } else if (argc == 4 && std::string(argv[1]) == "model" && std::string(argv[3]) == "zone") {
-            carModelName = argv[2];
-            // This would need more complex parsing for model + zone
-        } else if (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h") {
+        } else if (arg == "model" && i + 1 < argc) {
+            carModelName = argv[++i];
+        } else if (arg == "--gaze" && i + 1 < argc) {
+            gazeSource = argv[++i];
+        } else if (arg == "--gaze-rate" && i + 1 < argc) {
+            gazeRate = std::atof(argv[++i]);
+        } else if (arg == "--session" && i + 1 < argc) {
+            sessionPath = argv[++i];
+        } else if (arg == "--session-start" && i + 1 < argc) {
+            sessionStart = std::atof(argv[++i]);
+        } else if (arg == "--bundle" && i + 1 < argc) {
+            bundlePath = argv[++i];
+        } else if (arg == "--no-watch") {
+            watchConfig = false;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--frame-stats" && i + 1 < argc) {
+            frameStatsPath = argv[++i];
+        } else if (arg == "--frame-stats-frames" && i + 1 < argc) {
+            frameStatsFrames = std::atoi(argv[++i]);
+        } else if (arg == "--no-insets") {
+            showInsets = false;
+        } else if (arg == "--on-demand") {
+            onDemand = true;
+        } else if (arg == "--threading" && i + 1 < argc) {
+            threadingName = argv[++i];
+        } else if (arg == "--max-fps" && i + 1 < argc) {
+            maxFrameRate = std::atof(argv[++i]);
+        } else if (arg == "--loop-report" && i + 1 < argc) {
+            loopReportSeconds = std::atof(argv[++i]);
+        } else if (arg == "--coverage") {
+            showCoverage = true;
+        } else if (arg == "--sweep" && i + 1 < argc) {
+            std::string tolerance = argv[++i];
+            size_t comma = tolerance.find(',');
+            sweepMm = std::atof(tolerance.c_str());
+            sweepDeg = comma == std::string::npos ? 0.0 : std::atof(tolerance.c_str() + comma + 1);
+            if (comma == std::string::npos || sweepMm < 0.0 || sweepDeg < 0.0 || (sweepMm == 0.0 && sweepDeg == 0.0)) {
+                std::cerr << "Error: --sweep expects <mm>,<deg>" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--help" || arg == "-h") {
             printUsage(argv[0]);
             return 0;
         } else {
@@ -608,263 +866,205 @@ int main(int argc, char** argv)
         }
     }
 
-    // Load car model configuration
-    CarModelConfig carModel;
-    try {
-        carModel = loadCarModel(carModelName);
-    } catch (const std::exception& e) {
-        std::cerr << "Error loading car model '" << carModelName << "': " << e.what() << std::endl;
+    if (frameStatsFrames < 0 || (frameStatsFrames > 0 && frameStatsPath.empty())) {
+        std::cerr << "Error: --frame-stats-frames needs a positive count and --frame-stats" << std::endl;
         return 1;
     }
-
-    osg::ref_ptr<osg::Node> model = osgDB::readNodeFile(carModel.path);
-    if (!model)
-    {
-        std::cerr << "Error: Unable to load file: " << carModel.path << std::endl;
+    if (!gazeSource.empty() && !sessionPath.empty()) {
+        std::cerr << "Error: --gaze and --session cannot be combined" << std::endl;
         return 1;
     }
+    osgViewer::ViewerBase::ThreadingModel threadingModel;
+    if (!parseThreadingModel(threadingName, threadingModel)) {
+        std::cerr << "Error: Unknown threading model '" << threadingName
+                  << "' (single, cull-draw, draw, cull-per-camera or auto)" << std::endl;
+        return 1;
+    }
+    if (maxFrameRate < 0.0 || loopReportSeconds < 0.0) {
+        std::cerr << "Error: --max-fps and --loop-report must not be negative" << std::endl;
+        return 1;
+    }
+    SessionLog sessionLog;
+    if (!sessionPath.empty()) {
+        try {
+            sessionLog.open(sessionPath);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        if (sessionLog.empty()) {
+            std::cerr << "Error: Session log " << sessionPath << " has no records" << std::endl;
+            return 1;
+        }
+    }
 
-    osg::BoundingSphere bs = model->getBound();
-    std::cout << "Model center: " << bs.center().x() << ", " << bs.center().y() << ", " << bs.center().z() << std::endl;
-    std::cout << "Model radius: " << bs.radius() << std::endl;
-    
-    // Calculate model bounding box for comparison with zones
-    osg::Vec3 modelMin = bs.center() - osg::Vec3(bs.radius(), bs.radius(), bs.radius());
-    osg::Vec3 modelMax = bs.center() + osg::Vec3(bs.radius(), bs.radius(), bs.radius());
-    std::cout << "Model bounds: Min(" << modelMin.x() << ", " << modelMin.y() << ", " << modelMin.z() << ")" << std::endl;
-    std::cout << "              Max(" << modelMax.x() << ", " << modelMax.y() << ", " << modelMax.z() << ")" << std::endl;
-
-    // Load configuration from JSON files - dynamic path based on car model
-    std::string configPath = "carmodels/" + carModelName + "/config";
-    CameraCalibration cameraConfig;
-    std::vector<ViewingZone> viewingZones;
-    
+    // Every model in carmodels.json is loaded on background threads, the requested one
+    // first. The viewer opens as soon as its zones and calibration are ready; the car
+    // meshes follow (CarMeshHandler)
+    if (!tracePath.empty()) Trace::enable();
+    ConfigBundle bundle;
+    bool useBundle = false;
+    if (!bundlePath.empty()) {
+        ScopedPhase phase("open config bundle", bundlePath);
+        try {
+            bundle.open(bundlePath);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::vector<std::string> stale = bundle.staleSources();
+        useBundle = stale.empty();
+        for (const auto& path : stale) {
+            std::cerr << "Warning: " << path << " changed since " << bundlePath << " was written" << std::endl;
+        }
+        if (!useBundle) std::cerr << "Warning: Loading the JSON configs instead; run 'visual bundle' to update it" << std::endl;
+    }
+    std::vector<std::string> modelNames;
     try {
-        cameraConfig = loadCalibration(configPath);
-        viewingZones = loadViewingZones(configPath);
+        ScopedPhase phase("list car models");
+        modelNames = useBundle ? bundle.modelNames() : listCarModels("carmodels/carmodels.json");
     } catch (const std::exception& e) {
-        std::cerr << "Error loading configuration: " << e.what() << std::endl;
+        std::cerr << "Error loading car model list: " << e.what() << std::endl;
+        return 1;
+    }
+    if (std::find(modelNames.begin(), modelNames.end(), carModelName) == modelNames.end()) {
+        modelNames.push_back(carModelName);  // let the loader report the unknown model
+    }
+    size_t initialModel = std::find(modelNames.begin(), modelNames.end(), carModelName) - modelNames.begin();
+    ModelLibrary library;
+    library.start(modelNames, initialModel, true, 0, useBundle ? &bundle : nullptr);
+    ModelScene* scene = nullptr;
+    {
+        ScopedPhase phase("wait for initial model scene", carModelName);
+        scene = library.wait(initialModel);
+    }
+    if (!scene) {
         return 1;
     }
+    const std::vector<ViewingZone>& viewingZones = scene->zones;
+    if (displayZoneNumber > 0) {
+        bool found = false;
+        for (const auto& zone : viewingZones) found = found || zone.id == displayZoneNumber;
+        if (!found) {
+            std::cerr << "Error: Zone " << displayZoneNumber << " is not defined for " << carModelName
+                      << " (" << viewingZones.size() << " zones)" << std::endl;
+            return 1;
+        }
+        showZone(*scene, displayZoneNumber);
+    }
+    std::cout << "Loaded " << carModelName << " zones and calibration in " << library.loadSeconds(initialModel)
+              << " s; car mesh and " << modelNames.size() - 1 << " other model(s) loading in the background" << std::endl;
+
+    // The displayed model is the single child of sceneRoot
+    osg::ref_ptr<osg::Group> sceneRoot = new osg::Group;
+    sceneRoot->addChild(scene->root.get());
+
+    // Declared before the viewer: the overlay callback reads from the stream until the
+    // viewer is gone
+    GazeStream gazeStream;
+    osg::ref_ptr<GazeOverlay> gazeOverlay;
+    if (!gazeSource.empty()) {
+        try {
+            gazeStream.start(gazeSource, gazeRate);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        gazeOverlay = new GazeOverlay(gazeStream);
+        gazeOverlay->attach(viewingZones, scene->zoneBatch.get());
+        std::cout << "Reading gaze samples from " << gazeSource << std::endl;
+    }
 
-    // Use loaded calibration data
-    double R[3][3];
-    double t[3];
-    
-    for (int i = 0; i < 3; ++i) {
-        for (int j = 0; j < 3; ++j) {
-            R[i][j] = cameraConfig.rotation_matrix[i][j];
-        }
-        t[i] = cameraConfig.translation_vector[i];
-    }
-
-    // Print rotation matrix
-    std::cout << "\nRotation Matrix (R):" << std::endl;
-    for (int i = 0; i < 3; ++i) {
-        std::cout << "[";
-        for (int j = 0; j < 3; ++j) {
-            std::cout << std::setw(12) << std::setprecision(8) << std::fixed << R[i][j];
-            if (j < 2) std::cout << ", ";
-        }
-        std::cout << "]" << std::endl;
-    }
-
-    // Print translation vector
-    std::cout << "\nTranslation Vector (t):" << std::endl;
-    std::cout << "[" << std::setw(12) << std::setprecision(8) << std::fixed << t[0] 
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << t[1]
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << t[2] << "]" << std::endl;
-
-    // Print the complete 4x4 extrinsics matrix
-    std::cout << "\nComplete Extrinsics Matrix (4x4):" << std::endl;
-    std::cout << "[" << std::setw(12) << std::setprecision(8) << std::fixed << R[0][0]
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[0][1]
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[0][2]
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << t[0] << "]" << std::endl;
-    std::cout << "[" << std::setw(12) << std::setprecision(8) << std::fixed << R[1][0]
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[1][1]
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[1][2]
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << t[1] << "]" << std::endl;
-    std::cout << "[" << std::setw(12) << std::setprecision(8) << std::fixed << R[2][0]
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[2][1]
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << R[2][2]
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << t[2] << "]" << std::endl;
-    std::cout << "[" << std::setw(12) << std::setprecision(8) << std::fixed << 0.0
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << 0.0
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << 0.0
-              << ", " << std::setw(12) << std::setprecision(8) << std::fixed << 1.0 << "]" << std::endl;
-
-    // Use configuration values for scale factors
-    float metersToMmScale = cameraConfig.meters_to_mm_scale;
-
-    // Per our analysis, the camera center is the translation part of the extrinsics.
-    double cameraCenter[3] = {t[0], t[1], t[2]};
-
-    std::cout << "Estimated camera center (m): "
-              << cameraCenter[0] << ", "
-              << cameraCenter[1] << ", "
-              << cameraCenter[2] << std::endl;
-
-    // The frustum's tip is at (0,0,0) in its local coordinates.
-    // We scale it to make it visible in the millimeter-scale world.
-    osg::ref_ptr<osg::MatrixTransform> cameraPose = new osg::MatrixTransform();
-    float frustumScale = metersToMmScale * cameraConfig.frustum_scale_factor;
-    cameraPose->setMatrix(osg::Matrix::scale(frustumScale, frustumScale, frustumScale)); 
-    // The red circle radius from config. We want the blue origin sphere to match.
-    // Its radius is specified in meters and will be scaled by frustumScale.
-    // So, radius_in_meters = config_radius / frustumScale.
-    cameraPose->addChild(createCameraFrustum(cameraConfig.camera_sphere_radius_mm / frustumScale));
-
-    // The red sphere is placed at the calculated camera center, scaled to millimeters.
-    osg::Vec3 camCenterMm = carCoord(cameraCenter[0], cameraCenter[1], cameraCenter[2]) * metersToMmScale;
-    osg::ref_ptr<osg::Sphere> camCenterSphere = new osg::Sphere(
-        camCenterMm, cameraConfig.camera_sphere_radius_mm
-    );
-    osg::ref_ptr<osg::ShapeDrawable> camCenterDrawable = new osg::ShapeDrawable(camCenterSphere);
-    camCenterDrawable->setColor(osg::Vec4(1, 0, 0, 1));
-    osg::ref_ptr<osg::Geode> camCenterGeode = new osg::Geode();
-    camCenterGeode->addDrawable(camCenterDrawable);
-    camCenterGeode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-
-    osg::ref_ptr<osgText::Text> text = new osgText::Text;
-    text->setCharacterSize(80.0f); // Increase size for mm scale
-    text->setAxisAlignment(osgText::TextBase::SCREEN);
-    text->setPosition(camCenterMm + osg::Vec3(0, 0, 100.0f)); // Offset by 100mm
-    char label[128];
-    snprintf(label, sizeof(label), "Camera center:\n%.3f, %.3f, %.3f (m)",
-             cameraCenter[0], cameraCenter[1], cameraCenter[2]);
-    text->setText(label);
-    text->setColor(osg::Vec4(1, 0, 0, 1));
-
-    osg::ref_ptr<osg::Geode> textGeode = new osg::Geode();
-    textGeode->addDrawable(text);
-    textGeode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-
-    osg::ref_ptr<osgText::Text> carNameText = new osgText::Text;
-    carNameText->setCharacterSize(1.0f);
-    carNameText->setAxisAlignment(osgText::TextBase::SCREEN);
-    carNameText->setPosition(carCoord(0, 0, 1.2f));
-    carNameText->setText(carModelName);
-    carNameText->setColor(osg::Vec4(1, 1, 0, 1));
-
-    osg::ref_ptr<osg::Geode> carNameGeode = new osg::Geode();
-    carNameGeode->addDrawable(carNameText);
-    carNameGeode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-
-    osg::Vec3 modelCenter = bs.center();
-    float scale = bs.radius() * 0.2;
-
-    // This transform is only for the car name text, to keep it near the car model.
-    osg::ref_ptr<osg::MatrixTransform> overlayTransform = new osg::MatrixTransform;
-    overlayTransform->setMatrix(
-        osg::Matrix::scale(scale, scale, scale) *
-        osg::Matrix::translate(modelCenter)
-    );
-    overlayTransform->addChild(carNameGeode);
-    // The camera frustum and red circle are NO LONGER here. They are added to the root directly.
-    // overlayTransform->addChild(cameraPose.get());
-    // overlayTransform->addChild(camCenterGeode);
-    // overlayTransform->addChild(textGeode);
-
-    // ----------- Viewing Zones Visualization -----------
-    // Viewing zones are now loaded from JSON configuration
-
-    osg::ref_ptr<osg::Group> viewingZonesGroup = new osg::Group();
-    
-    if (displayZoneNumber == 0) {
-        std::cout << "\n=== CREATING ALL VIEWING ZONES ===" << std::endl;
-    } else {
-        std::cout << "\n=== CREATING ONLY ZONE " << displayZoneNumber << " ===" << std::endl;
+    osg::ref_ptr<SessionPlayer> sessionPlayer;
+    if (!sessionPath.empty()) {
+        sessionPlayer = new SessionPlayer(sessionLog, sessionLog.firstTimestampUs() + static_cast<int64_t>(sessionStart * 1e6));
+        sessionPlayer->attach(viewingZones, scene->zoneBatch.get());
+        std::cout << "Playing session " << sessionPath << " (" << sessionLog.size() << " records, "
+                  << (sessionLog.lastTimestampUs() - sessionLog.firstTimestampUs()) * 1e-6
+                  << " s); P pauses, arrow keys and ',' '.' scrub" << std::endl;
     }
-    
-    // Calculate zone transformation matrix - zones should ONLY be scaled to millimeters
-    // They should NOT get the same transformations as the car model because
-    // the zone coordinates are already defined relative to the transformed car
-    osg::Matrix zoneTransformMatrix = osg::Matrix::scale(metersToMmScale, metersToMmScale, metersToMmScale);
-    
-    int zoneCount = 0;
-    
-    for (const auto& zone : viewingZones) {
-        // Skip if we only want a specific zone and this isn't it
-        if (displayZoneNumber > 0 && zone.id != displayZoneNumber) {
-            continue;
-        }
-        
-        // Skip zones with all zero coordinates
-        bool allZero = true;
-        for (const auto& v : zone.corners) {
-            if (v.length() > 1e-6) { allZero = false; break; }
-        }
-        if (allZero) {
-            std::cout << "Skipping " << zone.label << " - all zero coordinates" << std::endl;
-            continue;
-        }
-        
-        // Calculate zone center for debugging
-        osg::Vec3 minCorner(FLT_MAX, FLT_MAX, FLT_MAX);
-        osg::Vec3 maxCorner(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-        
-        for (const auto& v : zone.corners) {
-            if (v.x() < minCorner.x()) minCorner.x() = v.x();
-            if (v.y() < minCorner.y()) minCorner.y() = v.y();
-            if (v.z() < minCorner.z()) minCorner.z() = v.z();
-            if (v.x() > maxCorner.x()) maxCorner.x() = v.x();
-            if (v.y() > maxCorner.y()) maxCorner.y() = v.y();
-            if (v.z() > maxCorner.z()) maxCorner.z() = v.z();
-        }
-        
-        osg::Vec3 center = (minCorner + maxCorner) * 0.5f;
-        // std::cout << "Creating " << zone.label << " - center (mm): (" 
-        //           << center.x() * metersToMmScale << ", " 
-        //           << center.y() * metersToMmScale << ", " 
-        //           << center.z() * metersToMmScale << ")" << std::endl;
-        
-        // Create transform for this zone
-        osg::ref_ptr<osg::MatrixTransform> zoneTransform = new osg::MatrixTransform;
-        
-        // Apply the same pre-calculated transformations as the car model to keep zones aligned
-        zoneTransform->setMatrix(zoneTransformMatrix);
-        
-        // Make zones visible with their original colors but more opaque
-        osg::Vec4 visibleColor = zone.color;
-        visibleColor.a() = 0.8f; // More opaque than original
-        
-        zoneTransform->addChild(createViewingZoneWithLabel(zone.corners, zone.label, visibleColor));
-        viewingZonesGroup->addChild(zoneTransform);
-        zoneCount++;
+
+    int64_t setupStartUs = Trace::nowUs();
+    // The main view and the camera insets share one window and one scene graph. By default
+    // culling runs on a thread per camera and drawing on a thread per context, overlapping
+    // the next frame's update and cull, so each inset adds a cull in parallel rather than a
+    // whole frame in series (--threading picks another model). Geometry the handlers rewrite
+    // in place is DYNAMIC for this.
+    osgViewer::CompositeViewer viewer;
+    viewer.setThreadingModel(threadingModel);
+    osg::ref_ptr<osgViewer::View> mainView = new osgViewer::View;
+    mainView->setSceneData(sceneRoot.get());
+    mainView->setUpViewOnSingleScreen(0);
+    viewer.addView(mainView.get());
+    std::vector<osgViewer::View*> insets;
+    osg::GraphicsContext* context = mainView->getCamera()->getGraphicsContext();
+    if (showInsets && context) {
+        // Enough views for the rigs in use; CameraInsetHandler places them every frame
+        const size_t maxInsets = 4;
+        GLenum buffer = context->getTraits()->doubleBuffer ? GL_BACK : GL_FRONT;
+        for (size_t i = 0; i < maxInsets; ++i) {
+            osg::ref_ptr<osgViewer::View> inset = new osgViewer::View;
+            inset->setSceneData(sceneRoot.get());
+            osg::Camera* camera = inset->getCamera();
+            camera->setGraphicsContext(context);
+            camera->setViewport(0, 0, 1, 1);
+            camera->setDrawBuffer(buffer);
+            camera->setReadBuffer(buffer);
+            camera->setAllowEventFocus(false);
+            camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+            camera->setProjectionResizePolicy(osg::Camera::FIXED);
+            camera->setClearColor(osg::Vec4(0.1f, 0.1f, 0.1f, 1.0f));
+            camera->setCullMask(0);
+            camera->setClearMask(0);
+            viewer.addView(inset.get());
+            insets.push_back(inset.get());
+        }
     }
-    
-    std::cout << "=== Created " << zoneCount << " viewing zone(s) ===" << std::endl;
-
-    // Apply car model transformations dynamically from carmodels.json
-    osg::ref_ptr<osg::MatrixTransform> carTransform = new osg::MatrixTransform();
-    osg::Matrix transformMatrix = applyCarModelTransformations(carModel);
-    carTransform->setMatrix(transformMatrix);
-    carTransform->addChild(model.get());
-
-    osg::ref_ptr<osg::Group> root = new osg::Group();
-    root->addChild(carTransform);             // Car with dynamic transformations
-    root->addChild(overlayTransform);         // Car name text
-    root->addChild(cameraPose.get());         // Frustum at origin
-    root->addChild(camCenterGeode);           // Red circle at camera center
-    // root->addChild(textGeode);             // Red circle's label - HIDDEN
-    // World coordinate axes at origin, in millimeters (matching zones after scaling).
-    // Length and arrow size from configuration.
-    root->addChild(createAxesWithArrows(cameraConfig.axes_length_mm, cameraConfig.axes_arrow_wing_mm));
-    root->addChild(viewingZonesGroup);
-
-    // Debug scene graph structure
-    std::cout << "\nScene Graph Structure:" << std::endl;
-    std::cout << "Root children: " << root->getNumChildren() << std::endl;
-    std::cout << "  - " << carModelName << " transform children: " << carTransform->getNumChildren() << std::endl;
-    std::cout << "  - Overlay transform children: " << overlayTransform->getNumChildren() << std::endl;
-    std::cout << "  - Viewing zones group children: " << viewingZonesGroup->getNumChildren() << std::endl;
-
-    osgViewer::Viewer viewer;
-    viewer.setSceneData(root.get());
 
     // Set the initial camera view using the new refactored function.
-    setupInitialCameraView(viewer, carTransform.get());
+    setupInitialCameraView(*mainView);
+    osg::ref_ptr<ZonePickHandler> picker = new ZonePickHandler(viewingZones, scene->metersToMmScale, scene->zoneBatch.get());
+    mainView->addEventHandler(picker.get());
+    if (sessionPlayer.valid()) mainView->addEventHandler(sessionPlayer.get());
+    osg::ref_ptr<osgUtil::IncrementalCompileOperation> compiler = new osgUtil::IncrementalCompileOperation;
+    compiler->setTargetFrameRate(60.0);
+    viewer.setIncrementalCompileOperation(compiler.get());
+    osg::ref_ptr<CarMeshHandler> carMeshes = new CarMeshHandler(library, compiler.get());
+    mainView->addEventHandler(carMeshes.get());
+    osg::ref_ptr<ModelSwitchHandler> modelSwitcher = new ModelSwitchHandler(library, sceneRoot.get(), picker.get(), gazeOverlay.get(),
+                                                                            sessionPlayer.get(), initialModel, displayZoneNumber);
+    mainView->addEventHandler(modelSwitcher.get());
+    osg::ref_ptr<ConfigReloadHandler> configReloader;
+    if (watchConfig) {
+        try {
+            configReloader = new ConfigReloadHandler(library, sceneRoot.get(), picker.get(), gazeOverlay.get(),
+                                                     sessionPlayer.get());
+            mainView->addEventHandler(configReloader.get());
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << "; config changes will not be picked up" << std::endl;
+        }
+    }
+    // After the switch and the reload, so the insets follow them in the same frame, which
+    // may be the last one an on-demand viewer draws for a while
+    if (!insets.empty()) mainView->addEventHandler(new CameraInsetHandler(library, sceneRoot.get(), insets));
+    if (showCoverage) {
+        // Enough for a smooth 1-degree heatmap, computed in well under a second on one core
+        CoverageOptions coverageOptions;
+        coverageOptions.samples = uint64_t(1) << 22;
+        mainView->addEventHandler(new CoverageHeatmapHandler(library, sceneRoot.get(), coverageOptions));
+    }
+    if (sweepMm > 0.0 || sweepDeg > 0.0) {
+        // The 5^6 grid takes a few milliseconds; a few pixels are only millimeters at the zones
+        SweepOptions sweepOptions;
+        sweepOptions.translationMm = sweepMm;
+        sweepOptions.rotationDeg = sweepDeg;
+        mainView->addEventHandler(new SweepEllipseHandler(library, sceneRoot.get(), sweepOptions, 20.0f));
+    }
+    osg::ref_ptr<FrameStatsRecorder> frameStats;
+    if (!frameStatsPath.empty()) {
+        frameStats = new FrameStatsRecorder(viewer, static_cast<unsigned>(frameStatsFrames));
+        mainView->addEventHandler(frameStats.get());
+    }
     
     if (displayZoneNumber > 0) {
         std::cout << "\nDisplaying only Zone " << displayZoneNumber << std::endl;
@@ -881,6 +1081,33 @@ int main(int argc, char** argv)
     }
     
     std::cout << "\nStarting viewer..." << std::endl;
-    viewer.home(); // Explicitly go to the home position we defined
-    return viewer.run();
+    mainView->home(); // Explicitly go to the home position we defined
+    if (Trace::enabled()) Trace::addPhase("viewer setup", std::string(), setupStartUs, Trace::nowUs() - setupStartUs);
+    {
+        ScopedPhase phase("realize viewer");
+        viewer.realize();
+    }
+    if (!tracePath.empty()) {
+        // The first frame compiles display lists and textures for the whole scene
+        ScopedPhase phase("first frame");
+        viewer.frame();
+    }
+    // On demand, the same events that change the scene wake the loop; the heatmap, ellipse
+    // and inset handlers only follow model switches and reloads, so they need no source
+    FrameLoop loop(viewer, onDemand, maxFrameRate);
+    loop.setReportInterval(loopReportSeconds);
+    loop.addWakeSource("meshes", [&]() { return carMeshes->pending(); });
+    loop.addWakeSource("model switch", [&]() { return modelSwitcher->pending(); });
+    if (configReloader.valid()) loop.addWakeSource("config", [&]() { return configReloader->pending(); });
+    if (gazeOverlay.valid()) loop.addWakeSource("gaze", [&]() { return gazeStream.pending(); });
+    if (sessionPlayer.valid()) loop.addWakeSource("session", [&]() { return sessionPlayer->playing(); });
+    int result = loop.run();
+    loop.printReport();
+    if (gazeOverlay.valid()) gazeOverlay->printCounters();
+    if (frameStats.valid()) {
+        frameStats->finish();
+        if (!frameStats->write(frameStatsPath)) result = 1;
+    }
+    if (!tracePath.empty() && !Trace::write(tracePath)) result = 1;
+    return result;
 }
\ No newline at end of file
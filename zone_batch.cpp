@@ -0,0 +1,291 @@
+#include "zone_batch.h"
+#include "scene_builder.h"
+#include "zone_bvh.h"
+
+#include <osg/LineWidth>
+#include <osg/ShadeModel>
+#include <tuple>
+
+namespace {
+
+osg::ref_ptr<osg::Geometry> createBatchGeometry(osg::Vec3Array* vertices, osg::Array* colors,
+                                                 osg::PrimitiveSet* primitives)
+{
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setDataVariance(osg::Object::DYNAMIC);  // index lists and colors change at runtime
+    geometry->setUseDisplayList(false);
+    geometry->setUseVertexBufferObjects(true);
+    geometry->setVertexArray(vertices);
+    geometry->setColorArray(colors, colors->getNumElements() == 1 ? osg::Array::BIND_OVERALL
+                                                                  : osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(primitives);
+    return geometry;
+}
+
+} // namespace
+
+void ZoneBatch::computeLayout(const std::vector<ViewingZone>& zones, Layout& layout)
+{
+    std::vector<int> owner;  // zone that first used each vertex
+    std::map<std::tuple<float, float, float>, GLuint> welded;
+    std::map<int, size_t> seen;
+
+    for (const auto& zone : zones) {
+        if (isZoneDegenerate(zone) || seen.count(zone.id)) continue;
+
+        // Same look as before batching: fill at 40% alpha, opaque outline
+        osg::Vec4 lineColor(zone.color.r(), zone.color.g(), zone.color.b(), 1.0f);
+        osg::Vec4 fillColor(zone.color.r(), zone.color.g(), zone.color.b(), 0.4f);
+
+        // Exactly equal corners are shared between zones
+        std::vector<GLuint> corners;
+        osg::Vec3 centroid(0, 0, 0);
+        for (const auto& v : zone.corners) {
+            auto inserted = welded.insert(std::make_pair(std::make_tuple(v.x(), v.y(), v.z()),
+                                                         static_cast<GLuint>(layout.vertices.size())));
+            if (inserted.second) {
+                layout.vertices.push_back(v);
+                layout.fillColors.push_back(fillColor);
+                layout.lineColors.push_back(lineColor);
+                owner.push_back(zone.id);
+            }
+            corners.push_back(inserted.first->second);
+            centroid += v;
+        }
+        centroid /= zone.corners.size();
+
+        ZoneRange range;
+        range.id = zone.id;
+        range.fillColor = fillColor;
+        range.visible = true;
+        range.centroidVertex = static_cast<unsigned>(layout.vertices.size());
+        layout.vertices.push_back(centroid);
+        layout.fillColors.push_back(fillColor);
+        layout.lineColors.push_back(lineColor);
+        owner.push_back(zone.id);
+
+        // Fan around the centroid; the centroid is last so it is the provoking vertex
+        range.firstTriangleIndex = static_cast<unsigned>(layout.triangleIndices.size());
+        for (size_t i = 0; i < corners.size(); ++i) {
+            layout.triangleIndices.push_back(corners[i]);
+            layout.triangleIndices.push_back(corners[(i + 1) % corners.size()]);
+            layout.triangleIndices.push_back(range.centroidVertex);
+        }
+        range.triangleIndexCount = static_cast<unsigned>(layout.triangleIndices.size()) - range.firstTriangleIndex;
+
+        // Flat-shaded lines take the color of their second vertex; end each edge on a corner
+        // this zone owns where possible, so shared corners do not recolor its own edges
+        range.firstLineIndex = static_cast<unsigned>(layout.lineIndices.size());
+        for (size_t i = 0; i < corners.size(); ++i) {
+            GLuint a = corners[i], b = corners[(i + 1) % corners.size()];
+            if (owner[b] != zone.id && owner[a] == zone.id) std::swap(a, b);
+            layout.lineIndices.push_back(a);
+            layout.lineIndices.push_back(b);
+        }
+        range.lineIndexCount = static_cast<unsigned>(layout.lineIndices.size()) - range.firstLineIndex;
+
+        range.label = static_cast<unsigned>(layout.ranges.size());
+        range.labelText = shortZoneLabel(zone.label);
+        range.labelAnchor = centroid;
+
+        seen[zone.id] = layout.ranges.size();
+        layout.ranges.push_back(range);
+    }
+}
+
+ZoneBatch::ZoneBatch(const std::vector<ViewingZone>& zones, float metersToMmScale)
+    : highlight_(0),
+      vertices_(new osg::Vec3Array),
+      fillColors_(new osg::Vec4Array),
+      lineColors_(new osg::Vec4Array),
+      triangles_(new osg::DrawElementsUInt(GL_TRIANGLES)),
+      lines_(new osg::DrawElementsUInt(GL_LINES)),
+      highlightLines_(new osg::DrawElementsUInt(GL_LINES)),
+      geode_(new osg::Geode),
+      labels_(new LabelBatch)
+{
+    // Zones are in meters; one transform scales them all to the millimeter world
+    setMatrix(osg::Matrix::scale(metersToMmScale, metersToMmScale, metersToMmScale));
+
+    Layout layout;
+    computeLayout(zones, layout);
+    vertices_->assign(layout.vertices.begin(), layout.vertices.end());
+    fillColors_->assign(layout.fillColors.begin(), layout.fillColors.end());
+    lineColors_->assign(layout.lineColors.begin(), layout.lineColors.end());
+    triangleIndices_.swap(layout.triangleIndices);
+    lineIndices_.swap(layout.lineIndices);
+    ranges_.swap(layout.ranges);
+    for (size_t i = 0; i < ranges_.size(); ++i) {
+        rangeIndex_[ranges_[i].id] = i;
+        labels_->addLabel(ranges_[i].labelAnchor, ranges_[i].labelText);
+    }
+
+    osg::ref_ptr<osg::Geometry> fill = createBatchGeometry(vertices_.get(), fillColors_.get(), triangles_.get());
+    osg::StateSet* fillState = fill->getOrCreateStateSet();
+    fillState->setMode(GL_BLEND, osg::StateAttribute::ON);
+    fillState->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+
+    osg::ref_ptr<osg::Geometry> outline = createBatchGeometry(vertices_.get(), lineColors_.get(), lines_.get());
+
+    osg::ref_ptr<osg::Vec4Array> highlightColor = new osg::Vec4Array;
+    highlightColor->push_back(osg::Vec4(1, 1, 1, 1));
+    osg::ref_ptr<osg::Geometry> highlightOutline =
+        createBatchGeometry(vertices_.get(), highlightColor.get(), highlightLines_.get());
+    highlightOutline->getOrCreateStateSet()->setAttributeAndModes(new osg::LineWidth(4.0f));
+    highlightOutline->getOrCreateStateSet()->setRenderBinDetails(101, "RenderBin");
+
+    geode_->addDrawable(fill.get());
+    geode_->addDrawable(outline.get());
+    geode_->addDrawable(highlightOutline.get());
+    osg::StateSet* state = geode_->getOrCreateStateSet();
+    state->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    state->setMode(GL_DEPTH_TEST, osg::StateAttribute::ON);
+    state->setAttributeAndModes(new osg::ShadeModel(osg::ShadeModel::FLAT));
+    addChild(geode_.get());
+
+    addChild(labels_.get());
+
+    updateVisibleIndices();
+}
+
+namespace {
+
+// Overwrite only the entries that differ; returns how many did
+template<typename ArrayT, typename T>
+size_t assignChanged(ArrayT& array, const std::vector<T>& values)
+{
+    size_t changed = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (array[i] != values[i]) {
+            array[i] = values[i];
+            ++changed;
+        }
+    }
+    return changed;
+}
+
+} // namespace
+
+size_t ZoneBatch::updateZones(const std::vector<ViewingZone>& zones)
+{
+    Layout layout;
+    computeLayout(zones, layout);
+
+    // Visibility carries over by zone id; new zones are shown
+    for (auto& range : layout.ranges) {
+        auto it = rangeIndex_.find(range.id);
+        range.visible = it == rangeIndex_.end() || ranges_[it->second].visible;
+    }
+
+    // Moving corners or recoloring zones keeps the welded vertex layout and the index
+    // lists, so only the changed array entries are written. Adding, removing or
+    // re-welding zones changes the layout and the arrays are refilled.
+    size_t changed;
+    bool sameLayout = layout.vertices.size() == vertices_->size() && layout.triangleIndices == triangleIndices_ &&
+                      layout.lineIndices == lineIndices_;
+    if (sameLayout) {
+        changed = assignChanged(*vertices_, layout.vertices);
+        changed += assignChanged(*fillColors_, layout.fillColors);
+        changed += assignChanged(*lineColors_, layout.lineColors);
+    } else {
+        vertices_->assign(layout.vertices.begin(), layout.vertices.end());
+        fillColors_->assign(layout.fillColors.begin(), layout.fillColors.end());
+        lineColors_->assign(layout.lineColors.begin(), layout.lineColors.end());
+        triangleIndices_.swap(layout.triangleIndices);
+        lineIndices_.swap(layout.lineIndices);
+        changed = vertices_->size();
+    }
+    vertices_->dirty();
+    fillColors_->dirty();
+    lineColors_->dirty();
+    for (unsigned i = 0; i < geode_->getNumDrawables(); ++i) geode_->getDrawable(i)->dirtyBound();
+
+    // Labels move in place unless their text or number changed
+    bool sameLabels = layout.ranges.size() == ranges_.size();
+    for (size_t i = 0; sameLabels && i < ranges_.size(); ++i) {
+        sameLabels = layout.ranges[i].labelText == ranges_[i].labelText;
+    }
+    if (sameLabels) {
+        for (size_t i = 0; i < ranges_.size(); ++i) {
+            if (layout.ranges[i].labelAnchor != ranges_[i].labelAnchor) {
+                labels_->setLabelAnchor(ranges_[i].label, layout.ranges[i].labelAnchor);
+            }
+        }
+    } else {
+        osg::ref_ptr<LabelBatch> labels = new LabelBatch;
+        for (const auto& range : layout.ranges) labels->addLabel(range.labelAnchor, range.labelText);
+        replaceChild(labels_.get(), labels.get());
+        labels_ = labels;
+    }
+
+    ranges_.swap(layout.ranges);
+    rangeIndex_.clear();
+    for (size_t i = 0; i < ranges_.size(); ++i) rangeIndex_[ranges_[i].id] = i;
+
+    // The fill colors were just rewritten, so there is no previous highlight to restore
+    highlight_ = hasZone(highlight_) ? highlight_ : 0;
+    updateVisibleIndices();
+    return changed;
+}
+
+void ZoneBatch::setZoneVisible(int zoneId, bool visible)
+{
+    auto it = rangeIndex_.find(zoneId);
+    if (it == rangeIndex_.end() || ranges_[it->second].visible == visible) return;
+    ranges_[it->second].visible = visible;
+    updateVisibleIndices();
+}
+
+void ZoneBatch::showOnly(int zoneId)
+{
+    for (auto& range : ranges_) range.visible = zoneId == 0 || range.id == zoneId;
+    updateVisibleIndices();
+}
+
+void ZoneBatch::setHighlight(int zoneId)
+{
+    if (zoneId == highlight_) return;
+
+    // Restore the previous zone's fill color entry, then brighten the new one
+    auto previous = rangeIndex_.find(highlight_);
+    if (previous != rangeIndex_.end()) {
+        const ZoneRange& range = ranges_[previous->second];
+        (*fillColors_)[range.centroidVertex] = range.fillColor;
+    }
+    highlight_ = hasZone(zoneId) ? zoneId : 0;
+    highlightLines_->clear();
+    if (highlight_) {
+        const ZoneRange& range = ranges_[rangeIndex_[highlight_]];
+        const osg::Vec4& c = range.fillColor;
+        (*fillColors_)[range.centroidVertex] = osg::Vec4(c.r() * 0.5f + 0.5f, c.g() * 0.5f + 0.5f, c.b() * 0.5f + 0.5f, 0.7f);
+        if (range.visible) {
+            highlightLines_->insert(highlightLines_->end(), lineIndices_.begin() + range.firstLineIndex,
+                                    lineIndices_.begin() + range.firstLineIndex + range.lineIndexCount);
+        }
+    }
+    fillColors_->dirty();
+    highlightLines_->dirty();
+}
+
+void ZoneBatch::updateVisibleIndices()
+{
+    triangles_->clear();
+    lines_->clear();
+    for (const auto& range : ranges_) {
+        labels_->setLabelVisible(range.label, range.visible);
+        if (!range.visible) continue;
+        triangles_->insert(triangles_->end(), triangleIndices_.begin() + range.firstTriangleIndex,
+                           triangleIndices_.begin() + range.firstTriangleIndex + range.triangleIndexCount);
+        lines_->insert(lines_->end(), lineIndices_.begin() + range.firstLineIndex,
+                       lineIndices_.begin() + range.firstLineIndex + range.lineIndexCount);
+    }
+    triangles_->dirty();
+    lines_->dirty();
+
+    // The highlight outline follows the highlighted zone's visibility
+    int highlighted = highlight_;
+    if (highlighted) {
+        highlight_ = 0;
+        setHighlight(highlighted);
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef ZONE_BATCH_H
+#define ZONE_BATCH_H
+
+#include "config_loader.h"
+#include "label_batch.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <map>
+#include <string>
+#include <vector>
+
+// All viewing zones in a handful of drawables under one meters-to-millimeters transform.
+//
+// Zone corners are welded into a single vertex array (adjacent zones in viewingzones.json
+// share corners exactly) that both the fill and the outline geometry draw from. Each zone
+// also gets a centroid vertex; its fill is a triangle fan around the centroid, drawn flat
+// shaded so the centroid (the last, provoking vertex) carries the zone's color even though
+// the corners are shared. Every zone owns a contiguous range of the triangle and line index
+// lists, so showing, hiding and highlighting zones only rewrites index lists or color
+// entries; no nodes are created or removed after construction (except the LabelBatch, when a
+// config reload changes the zone labels). Zone numbers are drawn by a single LabelBatch.
+class ZoneBatch : public osg::MatrixTransform
+{
+public:
+    // Degenerate (all-zero) zones are skipped
+    ZoneBatch(const std::vector<ViewingZone>& zones, float metersToMmScale);
+
+    bool hasZone(int zoneId) const { return rangeIndex_.count(zoneId) != 0; }
+    size_t zoneCount() const { return ranges_.size(); }
+    size_t vertexCount() const { return vertices_->size(); }
+
+    void setZoneVisible(int zoneId, bool visible);
+    // Show only the given zone (0 = all zones)
+    void showOnly(int zoneId);
+    // Brighten one zone's fill and draw a heavy outline around it (0 = none)
+    void setHighlight(int zoneId);
+    int highlight() const { return highlight_; }
+
+    // Replace the zones (config hot reload). When only corners or colors changed, just the
+    // changed vertex and color entries and label anchors are rewritten; otherwise the
+    // arrays are refilled. Visibility and the highlight carry over by zone id. Returns the
+    // number of array entries written.
+    size_t updateZones(const std::vector<ViewingZone>& zones);
+
+protected:
+    virtual ~ZoneBatch() {}
+
+private:
+    struct ZoneRange {
+        int id;
+        unsigned firstTriangleIndex, triangleIndexCount;
+        unsigned firstLineIndex, lineIndexCount;
+        unsigned centroidVertex;
+        osg::Vec4 fillColor;
+        bool visible;
+        unsigned label;  // index in labels_
+        std::string labelText;
+        osg::Vec3 labelAnchor;
+    };
+
+    // Welded vertices, colors, index lists and ranges for a zone list
+    struct Layout {
+        std::vector<osg::Vec3> vertices;
+        std::vector<osg::Vec4> fillColors, lineColors;
+        std::vector<GLuint> triangleIndices, lineIndices;
+        std::vector<ZoneRange> ranges;
+    };
+
+    static void computeLayout(const std::vector<ViewingZone>& zones, Layout& layout);
+    void updateVisibleIndices();
+
+    std::vector<ZoneRange> ranges_;
+    std::map<int, size_t> rangeIndex_;
+    int highlight_;
+
+    // Every zone's indices; the drawn lists are rebuilt from the visible ranges
+    std::vector<GLuint> triangleIndices_, lineIndices_;
+
+    osg::ref_ptr<osg::Vec3Array> vertices_;
+    osg::ref_ptr<osg::Vec4Array> fillColors_, lineColors_;
+    osg::ref_ptr<osg::DrawElementsUInt> triangles_, lines_, highlightLines_;
+    osg::ref_ptr<osg::Geode> geode_;
+    osg::ref_ptr<LabelBatch> labels_;
+};
+
+#endif
@@ -0,0 +1,337 @@
+#include "zone_bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <limits>
+
+namespace {
+
+const int kMaxLeafSize = 4;
+const int kNumBins = 12;
+const int kMaxDepth = 64;
+
+// Rays nearly parallel to a triangle are treated as misses
+const float kParallelEpsilon = 1e-9f;
+// Hits closer than this to the ray origin are ignored
+const float kMinDistance = 1e-6f;
+
+struct BuildPrim {
+    float bmin[3], bmax[3], centroid[3];
+    uint32_t tri;
+};
+
+struct Bounds {
+    float bmin[3], bmax[3];
+    Bounds() {
+        for (int k = 0; k < 3; ++k) { bmin[k] = FLT_MAX; bmax[k] = -FLT_MAX; }
+    }
+    void expand(const float* lo, const float* hi) {
+        for (int k = 0; k < 3; ++k) { bmin[k] = std::min(bmin[k], lo[k]); bmax[k] = std::max(bmax[k], hi[k]); }
+    }
+    float area() const {
+        float dx = bmax[0] - bmin[0], dy = bmax[1] - bmin[1], dz = bmax[2] - bmin[2];
+        if (dx < 0.0f) return 0.0f;
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+};
+
+class BvhBuilder {
+public:
+    BvhBuilder(std::vector<BuildPrim>& prims, std::vector<ZoneBvhNode>& nodes)
+        : prims_(prims), nodes_(nodes), depth_(0) {}
+
+    int build() {
+        if (!prims_.empty()) buildNode(0, prims_.size(), 1);
+        return depth_;
+    }
+
+private:
+    void buildNode(size_t begin, size_t end, int depth) {
+        depth_ = std::max(depth_, depth);
+        size_t nodeIndex = nodes_.size();
+        nodes_.push_back(ZoneBvhNode());
+
+        Bounds bounds, centroids;
+        for (size_t i = begin; i < end; ++i) {
+            bounds.expand(prims_[i].bmin, prims_[i].bmax);
+            centroids.expand(prims_[i].centroid, prims_[i].centroid);
+        }
+        for (int k = 0; k < 3; ++k) {
+            nodes_[nodeIndex].bmin[k] = bounds.bmin[k];
+            nodes_[nodeIndex].bmax[k] = bounds.bmax[k];
+        }
+
+        size_t count = end - begin;
+        if (count <= static_cast<size_t>(kMaxLeafSize) || depth >= kMaxDepth) {
+            makeLeaf(nodeIndex, begin, count);
+            return;
+        }
+
+        int axis = 0;
+        for (int k = 1; k < 3; ++k) {
+            if (centroids.bmax[k] - centroids.bmin[k] > centroids.bmax[axis] - centroids.bmin[axis]) axis = k;
+        }
+        float lo = centroids.bmin[axis];
+        float extent = centroids.bmax[axis] - lo;
+
+        size_t mid = begin + count / 2;
+        if (extent > 1e-9f) {
+            mid = splitSah(begin, end, axis, lo, extent, bounds.area());
+            if (mid == end) {
+                // Splitting is not worth it by SAH and the leaf is small enough
+                makeLeaf(nodeIndex, begin, count);
+                return;
+            }
+        }
+        if (mid == begin || mid == end || extent <= 1e-9f) {
+            // Coincident centroids (e.g. duplicated zones): fall back to a median split
+            mid = begin + count / 2;
+            std::nth_element(prims_.begin() + begin, prims_.begin() + mid, prims_.begin() + end,
+                             [axis](const BuildPrim& a, const BuildPrim& b) { return a.centroid[axis] < b.centroid[axis]; });
+        }
+
+        nodes_[nodeIndex].axis = static_cast<uint16_t>(axis);
+        nodes_[nodeIndex].count = 0;
+        buildNode(begin, mid, depth + 1);
+        nodes_[nodeIndex].offset = static_cast<uint32_t>(nodes_.size());
+        buildNode(mid, end, depth + 1);
+    }
+
+    // Binned surface area heuristic. Returns the partition point, or `end` if a leaf is cheaper.
+    size_t splitSah(size_t begin, size_t end, int axis, float lo, float extent, float parentArea) {
+        Bounds binBounds[kNumBins];
+        size_t binCount[kNumBins] = {};
+        const float scale = kNumBins / extent;
+        auto binOf = [&](const BuildPrim& p) {
+            int b = static_cast<int>((p.centroid[axis] - lo) * scale);
+            return std::min(std::max(b, 0), kNumBins - 1);
+        };
+        for (size_t i = begin; i < end; ++i) {
+            int b = binOf(prims_[i]);
+            binCount[b]++;
+            binBounds[b].expand(prims_[i].bmin, prims_[i].bmax);
+        }
+
+        // Sweep from the right to get the cost of every right-hand side
+        float rightArea[kNumBins];
+        size_t rightCount[kNumBins];
+        Bounds acc;
+        size_t n = 0;
+        for (int b = kNumBins - 1; b > 0; --b) {
+            acc.expand(binBounds[b].bmin, binBounds[b].bmax);
+            n += binCount[b];
+            rightArea[b] = acc.area();
+            rightCount[b] = n;
+        }
+
+        float bestCost = FLT_MAX;
+        int bestSplit = -1;
+        Bounds left;
+        size_t leftCount = 0;
+        for (int b = 1; b < kNumBins; ++b) {
+            left.expand(binBounds[b - 1].bmin, binBounds[b - 1].bmax);
+            leftCount += binCount[b - 1];
+            if (leftCount == 0 || rightCount[b] == 0) continue;
+            float cost = left.area() * leftCount + rightArea[b] * rightCount[b];
+            if (cost < bestCost) { bestCost = cost; bestSplit = b; }
+        }
+
+        size_t count = end - begin;
+        float leafCost = parentArea * count;
+        if (bestSplit < 0) return begin;  // everything in one bin: median split
+        if (bestCost >= leafCost && count <= static_cast<size_t>(kMaxLeafSize) * 4) return end;
+
+        BuildPrim* first = &prims_[begin];
+        BuildPrim* pivot = std::partition(first, first + count, [&](const BuildPrim& p) { return binOf(p) < bestSplit; });
+        return begin + static_cast<size_t>(pivot - first);
+    }
+
+    void makeLeaf(size_t nodeIndex, size_t begin, size_t count) {
+        nodes_[nodeIndex].offset = static_cast<uint32_t>(begin);
+        nodes_[nodeIndex].count = static_cast<uint16_t>(count);
+        nodes_[nodeIndex].axis = 0;
+    }
+
+    std::vector<BuildPrim>& prims_;
+    std::vector<ZoneBvhNode>& nodes_;
+    int depth_;
+};
+
+} // namespace
+
+bool isZoneDegenerate(const ViewingZone& zone)
+{
+    for (const auto& v : zone.corners) {
+        if (v.length() > 1e-6) return false;
+    }
+    return true;
+}
+
+void ZoneBvh::build(const std::vector<ViewingZone>& zones)
+{
+    // Fan triangulation from corner 0, matching the rendered polygon
+    ZoneTriangles input;
+    minPriority_ = maxPriority_ = 0;
+    priorityById_.clear();
+    bool first = true;
+    for (const auto& zone : zones) {
+        if (zone.corners.size() < 3 || isZoneDegenerate(zone)) continue;
+        minPriority_ = first ? zone.priority : std::min(minPriority_, zone.priority);
+        maxPriority_ = first ? zone.priority : std::max(maxPriority_, zone.priority);
+        first = false;
+        const osg::Vec3& a = zone.corners[0];
+        for (size_t k = 1; k + 1 < zone.corners.size(); ++k) {
+            osg::Vec3 e1 = zone.corners[k] - a;
+            osg::Vec3 e2 = zone.corners[k + 1] - a;
+            input.v0x.push_back(a.x()); input.v0y.push_back(a.y()); input.v0z.push_back(a.z());
+            input.e1x.push_back(e1.x()); input.e1y.push_back(e1.y()); input.e1z.push_back(e1.z());
+            input.e2x.push_back(e2.x()); input.e2y.push_back(e2.y()); input.e2z.push_back(e2.z());
+            input.zoneId.push_back(zone.id);
+            input.priority.push_back(zone.priority);
+        }
+    }
+    if (hasPriorities()) {
+        for (const auto& zone : zones) priorityById_[zone.id] = zone.priority;
+    }
+
+    std::vector<BuildPrim> prims(input.size());
+    for (size_t i = 0; i < input.size(); ++i) {
+        const float v0[3] = { input.v0x[i], input.v0y[i], input.v0z[i] };
+        const float v1[3] = { v0[0] + input.e1x[i], v0[1] + input.e1y[i], v0[2] + input.e1z[i] };
+        const float v2[3] = { v0[0] + input.e2x[i], v0[1] + input.e2y[i], v0[2] + input.e2z[i] };
+        BuildPrim& p = prims[i];
+        for (int k = 0; k < 3; ++k) {
+            p.bmin[k] = std::min(v0[k], std::min(v1[k], v2[k]));
+            p.bmax[k] = std::max(v0[k], std::max(v1[k], v2[k]));
+            p.centroid[k] = (v0[k] + v1[k] + v2[k]) / 3.0f;
+        }
+        p.tri = static_cast<uint32_t>(i);
+    }
+
+    nodes_.clear();
+    nodes_.reserve(prims.size() * 2 / kMaxLeafSize + 1);
+    BvhBuilder builder(prims, nodes_);
+    depth_ = builder.build();
+
+    // Store triangles in leaf order so every leaf is one contiguous SoA run
+    ZoneTriangles& t = triangles_;
+    t = ZoneTriangles();
+    for (const auto& p : prims) {
+        uint32_t i = p.tri;
+        t.v0x.push_back(input.v0x[i]); t.v0y.push_back(input.v0y[i]); t.v0z.push_back(input.v0z[i]);
+        t.e1x.push_back(input.e1x[i]); t.e1y.push_back(input.e1y[i]); t.e1z.push_back(input.e1z[i]);
+        t.e2x.push_back(input.e2x[i]); t.e2y.push_back(input.e2y[i]); t.e2z.push_back(input.e2z[i]);
+        t.zoneId.push_back(input.zoneId[i]);
+        t.priority.push_back(input.priority[i]);
+    }
+}
+
+int ZoneBvh::zonePriority(int zoneId) const
+{
+    if (!hasPriorities()) return maxPriority_;
+    auto it = priorityById_.find(zoneId);
+    return it != priorityById_.end() ? it->second : minPriority_;
+}
+
+int ZoneBvh::intersect(const osg::Vec3& origin, const osg::Vec3& direction, float* distance) const
+{
+    float best = std::numeric_limits<float>::infinity();
+    int bestId = 0;
+    int bestPriority = std::numeric_limits<int>::min();
+
+    if (!nodes_.empty()) {
+        float invDir[3];
+        for (int k = 0; k < 3; ++k) {
+            float d = direction[k];
+            invDir[k] = 1.0f / (std::fabs(d) < 1e-20f ? std::copysign(1e-20f, d) : d);
+        }
+
+        const ZoneTriangles& t = triangles_;
+        uint32_t stack[kMaxDepth * 2];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const ZoneBvhNode& node = nodes_[stack[--top]];
+
+            // Slab test, skipping boxes that start beyond the current nearest hit. Until a
+            // hit of the top priority is found, a farther zone can still win.
+            float tmin = kMinDistance;
+            float tmax = bestPriority >= maxPriority_ ? best : std::numeric_limits<float>::infinity();
+            for (int k = 0; k < 3; ++k) {
+                float t0 = (node.bmin[k] - origin[k]) * invDir[k];
+                float t1 = (node.bmax[k] - origin[k]) * invDir[k];
+                tmin = std::max(tmin, std::min(t0, t1));
+                tmax = std::min(tmax, std::max(t0, t1));
+            }
+            if (tmin > tmax) continue;
+
+            if (!node.isLeaf()) {
+                // Visit the child on the ray's near side first
+                uint32_t nearChild = static_cast<uint32_t>(&node - &nodes_[0]) + 1;
+                uint32_t farChild = node.offset;
+                if (direction[node.axis] < 0.0f) std::swap(nearChild, farChild);
+                stack[top++] = farChild;
+                stack[top++] = nearChild;
+                continue;
+            }
+
+            for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                osg::Vec3 e1(t.e1x[i], t.e1y[i], t.e1z[i]);
+                osg::Vec3 e2(t.e2x[i], t.e2y[i], t.e2z[i]);
+                osg::Vec3 p = direction ^ e2;
+                float det = e1 * p;
+                if (std::fabs(det) <= kParallelEpsilon) continue;
+                float invDet = 1.0f / det;
+                osg::Vec3 s = origin - osg::Vec3(t.v0x[i], t.v0y[i], t.v0z[i]);
+                float u = (s * p) * invDet;
+                if (u < 0.0f || u > 1.0f) continue;
+                osg::Vec3 q = s ^ e1;
+                float v = (direction * q) * invDet;
+                if (v < 0.0f || u + v > 1.0f) continue;
+                float hit = (e2 * q) * invDet;
+                if (hit > kMinDistance && (t.priority[i] > bestPriority || (t.priority[i] == bestPriority && hit < best))) {
+                    best = hit;
+                    bestId = t.zoneId[i];
+                    bestPriority = t.priority[i];
+                }
+            }
+        }
+    }
+
+    if (distance) *distance = bestId ? best : -1.0f;
+    return bestId;
+}
+
+std::vector<ViewingZone> makeSyntheticZones(int count)
+{
+    // Azimuth -80..80 deg, elevation -50..50 deg, about twice as many columns as rows
+    int rows = std::max(1, static_cast<int>(std::sqrt(count / 2.0)));
+    int cols = (count + rows - 1) / rows;
+    const double azRange = osg::DegreesToRadians(160.0), elRange = osg::DegreesToRadians(100.0);
+    const double azStart = -azRange * 0.5, elStart = -elRange * 0.5;
+
+    auto onSphere = [](double az, double el) {
+        // X=left, Y=up, Z=forward
+        return carCoord(std::sin(az) * std::cos(el), std::sin(el), std::cos(az) * std::cos(el));
+    };
+
+    std::vector<ViewingZone> zones;
+    zones.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        int r = i / cols, c = i % cols;
+        double az0 = azStart + azRange * c / cols, az1 = azStart + azRange * (c + 1) / cols;
+        double el0 = elStart + elRange * r / rows, el1 = elStart + elRange * (r + 1) / rows;
+
+        ViewingZone zone;
+        zone.id = i + 1;
+        zone.label = "Zone " + std::to_string(zone.id);
+        zone.color = defaultZoneColor(zone.id);
+        zone.corners.push_back(onSphere(az0, el0));
+        zone.corners.push_back(onSphere(az1, el0));
+        zone.corners.push_back(onSphere(az1, el1));
+        zone.corners.push_back(onSphere(az0, el1));
+        zones.push_back(zone);
+    }
+    return zones;
+}
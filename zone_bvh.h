@@ -0,0 +1,77 @@
+#ifndef ZONE_BVH_H
+#define ZONE_BVH_H
+
+#include "config_loader.h"
+
+#include <osg/Vec3>
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+// Zone triangles as structure-of-arrays: vertex 0 plus the two edges from it
+struct ZoneTriangles {
+    std::vector<float> v0x, v0y, v0z;
+    std::vector<float> e1x, e1y, e1z;
+    std::vector<float> e2x, e2y, e2z;
+    std::vector<int> zoneId;
+    std::vector<int> priority;  // the zone's priority
+
+    size_t size() const { return zoneId.size(); }
+};
+
+// 32-byte flattened BVH node. Inner nodes: left child is the next node, right child is
+// `offset`, `axis` is the split axis. Leaves: triangles [offset, offset + count).
+struct ZoneBvhNode {
+    float bmin[3];
+    float bmax[3];
+    uint32_t offset;
+    uint16_t count;
+    uint16_t axis;
+
+    bool isLeaf() const { return count > 0; }
+};
+
+// Bounding-volume hierarchy over the viewing zone quads, built once at load.
+// Each quad is split into the triangles (c0,c1,c2) and (c0,c2,c3) - the fan the viewer
+// draws - and stored in leaf order, so a leaf is a contiguous run of the SoA arrays.
+// Zones with all-zero corners are ignored.
+//
+// A ray that crosses several zones reports the one with the highest priority, and among
+// those the nearest. With a single priority level (all shipped viewingzones.json files)
+// that is simply the nearest zone.
+class ZoneBvh {
+public:
+    ZoneBvh() {}
+    explicit ZoneBvh(const std::vector<ViewingZone>& zones) { build(zones); }
+
+    void build(const std::vector<ViewingZone>& zones);
+
+    // Zone hit along the ray (0 = none), by priority, then distance; `distance` receives
+    // the ray parameter t
+    int intersect(const osg::Vec3& origin, const osg::Vec3& direction, float* distance = nullptr) const;
+
+    // False if all zones have the same priority, so the nearest hit is always the answer
+    bool hasPriorities() const { return minPriority_ != maxPriority_; }
+    int maxPriority() const { return maxPriority_; }
+    int zonePriority(int zoneId) const;
+
+    const ZoneTriangles& triangles() const { return triangles_; }
+    const std::vector<ZoneBvhNode>& nodes() const { return nodes_; }
+    int depth() const { return depth_; }
+
+private:
+    ZoneTriangles triangles_;
+    std::vector<ZoneBvhNode> nodes_;
+    int depth_ = 0;
+    int minPriority_ = 0, maxPriority_ = 0;
+    std::map<int, int> priorityById_;  // only filled if hasPriorities()
+};
+
+// True if all zone corners are zero (placeholder zones in the config files)
+bool isZoneDegenerate(const ViewingZone& zone);
+
+// `count` quads tiling a spherical cap of radius 1 m around the origin, facing it.
+// Used to measure how zone queries scale beyond the shipped 20-zone configs.
+std::vector<ViewingZone> makeSyntheticZones(int count);
+
+#endif
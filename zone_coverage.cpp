@@ -0,0 +1,760 @@
+#include "zone_coverage.h"
+#include "csv_util.h"
+#include "parallel_for.h"
+#include "viewtarget.h"
+#include "zone_bvh.h"
+
+#include <osg/BlendFunc>
+#include <osg/Depth>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+const uint64_t kChunkSamples = uint64_t(1) << 16;
+
+uint64_t splitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Random stream of one sample chunk, a function of the seed and the chunk index only
+struct ChunkRandom {
+    uint64_t state;
+
+    ChunkRandom(uint64_t seed, uint64_t chunk)
+    {
+        state = seed;
+        state = splitMix64(state) ^ (chunk * 0xD1B54A32D192ED03ull);
+        splitMix64(state);
+    }
+    double uniform() { return (splitMix64(state) >> 11) * (1.0 / 9007199254740992.0); }  // [0, 1)
+};
+
+// Direction numbers of the first two Sobol dimensions (van der Corput, and the
+// dimension generated by x + 1)
+struct SobolDirections {
+    uint32_t v[2][32];
+
+    SobolDirections()
+    {
+        for (int j = 0; j < 32; ++j) v[0][j] = 1u << (31 - j);
+        v[1][0] = 1u << 31;
+        for (int j = 1; j < 32; ++j) v[1][j] = v[1][j - 1] ^ (v[1][j - 1] >> 1);
+    }
+};
+
+// Triangle seen from the eye as the cone of directions between its edge planes. Normals
+// point inwards: a direction hits the triangle if all three dot products are >= 0.
+struct ConeTriangle {
+    float n[3][3];
+    int zone;  // index in ZoneCoverage::zoneIds
+
+    bool contains(float dx, float dy, float dz) const
+    {
+        return n[0][0] * dx + n[0][1] * dy + n[0][2] * dz >= 0.0f &&
+               n[1][0] * dx + n[1][1] * dy + n[1][2] * dz >= 0.0f &&
+               n[2][0] * dx + n[2][1] * dy + n[2][2] * dz >= 0.0f;
+    }
+};
+
+// Sample cell -> candidate triangles (compressed rows), in zone order so a zone's
+// triangles are adjacent
+struct CandidateGrid {
+    int rows, columns;
+    std::vector<uint32_t> cellStart;  // rows * columns + 1
+    std::vector<uint32_t> triangles;
+};
+
+double angleBetween(const osg::Vec3d& a, const osg::Vec3d& b)
+{
+    return std::acos(std::max(-1.0, std::min(1.0, a * b)));
+}
+
+// Unit direction of sample coordinates (u, v)
+osg::Vec3d sampleDirection(double u, double v)
+{
+    double y = 1.0 - 2.0 * u;
+    double r = std::sqrt(std::max(0.0, 1.0 - y * y));
+    double azimuth = 2.0 * kPi * v - kPi;
+    return osg::Vec3d(r * std::sin(azimuth), y, r * std::cos(azimuth));
+}
+
+double rowElevation(const ZoneCoverage& coverage, double row)
+{
+    return std::asin(std::max(-1.0, std::min(1.0, 1.0 - 2.0 * row / coverage.rows))) * 180.0 / kPi;
+}
+
+double columnAzimuth(const ZoneCoverage& coverage, double column)
+{
+    return column * 360.0 / coverage.columns - 180.0;
+}
+
+// Triangles of the zone fans (c0, ci, ci+1), as ZoneBvh splits the quads; exact solid
+// angles per zone (Van Oosterom and Strackee)
+void buildTriangles(const std::vector<ViewingZone>& zones, ZoneCoverage& coverage,
+                    std::vector<ConeTriangle>& triangles, std::vector<osg::Vec3d>& vertices)
+{
+    const osg::Vec3d eye(coverage.options.eye);
+    for (const auto& zone : zones) {
+        if (isZoneDegenerate(zone) || zone.corners.size() < 3) continue;
+        if (coverage.options.highwaySpeed && !zone.highwaySpeedEnabled) continue;
+        int index = static_cast<int>(coverage.zoneIds.size());
+        coverage.zoneIds.push_back(zone.id);
+        double solidAngle = 0.0;
+
+        for (size_t i = 1; i + 1 < zone.corners.size(); ++i) {
+            osg::Vec3d a = osg::Vec3d(zone.corners[0]) - eye;
+            osg::Vec3d b = osg::Vec3d(zone.corners[i]) - eye;
+            osg::Vec3d c = osg::Vec3d(zone.corners[i + 1]) - eye;
+            double la = a.length(), lb = b.length(), lc = c.length();
+            double det = a * (b ^ c);
+            // Eye in the triangle's plane (or a collapsed triangle): no solid angle
+            if (std::fabs(det) <= 1e-9 * la * lb * lc) continue;
+            solidAngle += 2.0 * std::atan2(std::fabs(det), la * lb * lc + (a * b) * lc + (a * c) * lb + (b * c) * la);
+
+            double sign = det > 0.0 ? 1.0 : -1.0;
+            osg::Vec3d normals[3] = { (a ^ b) * sign, (b ^ c) * sign, (c ^ a) * sign };
+            ConeTriangle triangle;
+            for (int k = 0; k < 3; ++k) {
+                normals[k].normalize();
+                for (int j = 0; j < 3; ++j) triangle.n[k][j] = static_cast<float>(normals[k][j]);
+            }
+            triangle.zone = index;
+            triangles.push_back(triangle);
+            a.normalize();
+            b.normalize();
+            c.normalize();
+            vertices.push_back(a);
+            vertices.push_back(b);
+            vertices.push_back(c);
+        }
+        coverage.exactSolidAngle.push_back(solidAngle);
+    }
+}
+
+// Cells whose bounding cap meets a triangle's bounding cap list the triangle
+void buildCandidateGrid(const ZoneCoverage& coverage, const std::vector<ConeTriangle>& triangles,
+                        const std::vector<osg::Vec3d>& vertices, CandidateGrid& grid)
+{
+    const int rows = coverage.rows, columns = coverage.columns;
+    grid.rows = rows;
+    grid.columns = columns;
+
+    // Every cell of a row has the same shape; the farthest points from its center are corners
+    std::vector<double> rowRadius(rows);
+    for (int r = 0; r < rows; ++r) {
+        double u0 = double(r) / rows, u1 = double(r + 1) / rows, half = 0.5 / columns;
+        osg::Vec3d center = sampleDirection(0.5 * (u0 + u1), 0.5);
+        rowRadius[r] = std::max(std::max(angleBetween(center, sampleDirection(u0, 0.5 - half)),
+                                          angleBetween(center, sampleDirection(u0, 0.5 + half))),
+                                std::max(angleBetween(center, sampleDirection(u1, 0.5 - half)),
+                                         angleBetween(center, sampleDirection(u1, 0.5 + half))));
+    }
+    auto cellCenter = [&](int r, int c) { return sampleDirection((r + 0.5) / rows, (c + 0.5) / columns); };
+
+    // Pass 0 counts, pass 1 fills
+    std::vector<uint32_t> counts(size_t(rows) * columns + 1, 0);
+    grid.cellStart.assign(counts.size(), 0);
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t t = 0; t < triangles.size(); ++t) {
+            const osg::Vec3d* v = &vertices[3 * t];
+            osg::Vec3d axis = v[0] + v[1] + v[2];
+            double radius = 0.0;
+            bool everywhere = axis.length() < 1e-6;
+            if (!everywhere) {
+                axis.normalize();
+                for (int k = 0; k < 3; ++k) radius = std::max(radius, angleBetween(axis, v[k]));
+                // A cap contains the spherical triangle only while it is convex (< 90 degrees)
+                everywhere = radius > 0.49 * kPi;
+            }
+
+            int firstRow = 0, lastRow = rows - 1, firstColumn = 0, columnCount = columns;
+            if (!everywhere) {
+                double elevation = std::asin(std::max(-1.0, std::min(1.0, axis.y())));
+                double top = elevation + radius, bottom = elevation - radius;
+                firstRow = std::max(0, static_cast<int>(std::floor((1.0 - std::sin(std::min(top, 0.5 * kPi))) * 0.5 * rows)) - 1);
+                lastRow = std::min(rows - 1, static_cast<int>(std::floor((1.0 - std::sin(std::max(bottom, -0.5 * kPi))) * 0.5 * rows)) + 1);
+                if (top < 0.5 * kPi && bottom > -0.5 * kPi) {
+                    double halfWidth = std::asin(std::min(1.0, std::sin(radius) / std::cos(elevation)));
+                    double azimuth = std::atan2(axis.x(), axis.z());
+                    firstColumn = static_cast<int>(std::floor((azimuth - halfWidth + kPi) / (2.0 * kPi) * columns)) - 1;
+                    columnCount = std::min(columns, static_cast<int>(std::ceil(2.0 * halfWidth / (2.0 * kPi) * columns)) + 3);
+                }
+            }
+
+            for (int r = firstRow; r <= lastRow; ++r) {
+                for (int i = 0; i < columnCount; ++i) {
+                    int c = ((firstColumn + i) % columns + columns) % columns;
+                    if (!everywhere && angleBetween(cellCenter(r, c), axis) > radius + rowRadius[r] + 1e-6) continue;
+                    size_t cell = size_t(r) * columns + c;
+                    if (pass == 0) counts[cell]++;
+                    else grid.triangles[grid.cellStart[cell] + counts[cell]++] = static_cast<uint32_t>(t);
+                }
+            }
+        }
+        if (pass == 0) {
+            for (size_t cell = 0; cell + 1 < counts.size(); ++cell) grid.cellStart[cell + 1] = grid.cellStart[cell] + counts[cell];
+            grid.triangles.resize(grid.cellStart.back());
+            std::fill(counts.begin(), counts.end(), 0);
+        }
+    }
+}
+
+// One thread's counts
+struct CoverageAccumulator {
+    std::vector<uint64_t> hits, overlaps, multiplicity;
+    std::vector<uint32_t> cellSamples, cellUncovered, cellOverlapped;
+    std::vector<int> hitZones;  // zones hit by the current sample
+
+    CoverageAccumulator(size_t zones, size_t cells)
+        : hits(zones, 0), overlaps(zones * zones, 0), multiplicity(zones + 1, 0), cellSamples(cells, 0),
+          cellUncovered(cells, 0), cellOverlapped(cells, 0), hitZones(zones)
+    {
+    }
+
+    void add(const CandidateGrid& grid, const std::vector<ConeTriangle>& triangles, double u, double v)
+    {
+        int row = std::min(grid.rows - 1, static_cast<int>(u * grid.rows));
+        int column = std::min(grid.columns - 1, static_cast<int>(v * grid.columns));
+        size_t cell = size_t(row) * grid.columns + column;
+        cellSamples[cell]++;
+
+        // Most of the sphere has no zone nearby: no direction needed
+        size_t k = 0;
+        uint32_t begin = grid.cellStart[cell], end = grid.cellStart[cell + 1];
+        if (begin != end) {
+            float y = static_cast<float>(1.0 - 2.0 * u);
+            float r = std::sqrt(std::max(0.0f, 1.0f - y * y));
+            float azimuth = static_cast<float>(2.0 * kPi * v - kPi);
+            float x = r * std::sin(azimuth), z = r * std::cos(azimuth);
+            for (uint32_t i = begin; i < end; ++i) {
+                const ConeTriangle& triangle = triangles[grid.triangles[i]];
+                if (k && hitZones[k - 1] == triangle.zone) continue;  // the zone's other triangle hit
+                if (triangle.contains(x, y, z)) hitZones[k++] = triangle.zone;
+            }
+        }
+
+        multiplicity[k]++;
+        if (k == 0) {
+            cellUncovered[cell]++;
+            return;
+        }
+        for (size_t i = 0; i < k; ++i) hits[hitZones[i]]++;
+        if (k < 2) return;
+        cellOverlapped[cell]++;
+        size_t n = hits.size();
+        for (size_t i = 0; i < k; ++i) {
+            for (size_t j = i + 1; j < k; ++j) overlaps[hitZones[i] * n + hitZones[j]]++;
+        }
+    }
+};
+
+// Count the samples of one chunk
+void sampleChunk(const ZoneCoverage& coverage, const CandidateGrid& grid, const std::vector<ConeTriangle>& triangles,
+                 const SobolDirections& sobol, uint64_t chunk, CoverageAccumulator& acc)
+{
+    const CoverageOptions& options = coverage.options;
+    uint64_t begin = chunk * kChunkSamples;
+    uint64_t end = std::min(options.samples, begin + kChunkSamples);
+    ChunkRandom random(options.seed, chunk);
+    const double scale = 1.0 / 4294967296.0;
+
+    if (options.sampler == CoverageSobol) {
+        // Digital shift: XOR every point with the same seed-derived offsets
+        uint64_t state = options.seed;
+        uint32_t shiftU = static_cast<uint32_t>(splitMix64(state) >> 32);
+        uint32_t shiftV = static_cast<uint32_t>(splitMix64(state) >> 32);
+        // Points in Gray code order: sample i is Sobol point i ^ (i >> 1), so each step
+        // flips one direction number
+        uint32_t gray = static_cast<uint32_t>(begin ^ (begin >> 1));
+        uint32_t x = 0, y = 0;
+        for (int j = 0; j < 32; ++j) {
+            if (gray & (1u << j)) {
+                x ^= sobol.v[0][j];
+                y ^= sobol.v[1][j];
+            }
+        }
+        for (uint64_t i = begin; i < end; ++i) {
+            acc.add(grid, triangles, ((x ^ shiftU) + 0.5) * scale, ((y ^ shiftV) + 0.5) * scale);
+            if (i + 1 == end) break;  // sample 2^32 has no direction number
+            int bit = __builtin_ctzll(i + 1);
+            x ^= sobol.v[0][bit];
+            y ^= sobol.v[1][bit];
+        }
+    } else if (options.sampler == CoverageStratified) {
+        // m x 2m strata of equal area, roughly square near the equator; the few samples
+        // beyond 2m^2 start a second pass
+        uint64_t m = std::max<uint64_t>(1, static_cast<uint64_t>(std::sqrt(options.samples / 2.0)));
+        uint64_t strata = 2 * m * m;
+        for (uint64_t i = begin; i < end; ++i) {
+            uint64_t stratum = i % strata;
+            double u = (stratum / (2 * m) + random.uniform()) / m;
+            double v = (stratum % (2 * m) + random.uniform()) / (2 * m);
+            acc.add(grid, triangles, u, v);
+        }
+    } else {
+        for (uint64_t i = begin; i < end; ++i) {
+            double u = random.uniform();
+            acc.add(grid, triangles, u, random.uniform());
+        }
+    }
+}
+
+// Zone window: rows and the shortest azimuth arc holding every covered cell
+void findWindow(ZoneCoverage& coverage)
+{
+    std::vector<bool> coveredColumn(coverage.columns, false);
+    for (int r = 0; r < coverage.rows; ++r) {
+        for (int c = 0; c < coverage.columns; ++c) {
+            size_t cell = size_t(r) * coverage.columns + c;
+            if (coverage.cellSamples[cell] == coverage.cellUncovered[cell]) continue;
+            if (coverage.windowLastRow < 0) coverage.windowFirstRow = r;
+            coverage.windowLastRow = r;
+            coveredColumn[c] = true;
+        }
+    }
+    if (coverage.windowLastRow < 0) return;
+
+    // The window is the complement of the longest run of empty columns (circular)
+    int bestStart = 0, bestLength = 0;
+    for (int start = 0; start < coverage.columns; ++start) {
+        if (coveredColumn[start] || !coveredColumn[(start + coverage.columns - 1) % coverage.columns]) continue;
+        int length = 0;
+        while (length < coverage.columns && !coveredColumn[(start + length) % coverage.columns]) ++length;
+        if (length > bestLength) {
+            bestStart = start;
+            bestLength = length;
+        }
+    }
+    coverage.windowFirstColumn = (bestStart + bestLength) % coverage.columns;
+    coverage.windowColumns = coverage.columns - bestLength;
+}
+
+// Connected cells of the window that are mostly uncovered
+void findGaps(ZoneCoverage& coverage)
+{
+    const int rows = coverage.rows, columns = coverage.columns;
+    const bool fullCircle = coverage.windowColumns == columns;
+    auto isGap = [&](int r, int c) {
+        size_t cell = size_t(r) * columns + c;
+        return coverage.inWindow(r, c) && coverage.cellSamples[cell] > 0 &&
+               2 * coverage.cellUncovered[cell] >= coverage.cellSamples[cell];
+    };
+
+    std::vector<bool> visited(size_t(rows) * columns, false);
+    std::vector<std::pair<int, int> > stack;
+    for (int r0 = coverage.windowFirstRow; r0 <= coverage.windowLastRow; ++r0) {
+        for (int i0 = 0; i0 < coverage.windowColumns; ++i0) {
+            int c0 = (coverage.windowFirstColumn + i0) % columns;
+            if (visited[size_t(r0) * columns + c0] || !isGap(r0, c0)) continue;
+
+            CoverageGap gap = CoverageGap();
+            gap.enclosed = true;
+            uint64_t uncovered = 0;
+            osg::Vec3d direction;
+            int minRow = r0, maxRow = r0, minOffset = i0, maxOffset = i0;
+            visited[size_t(r0) * columns + c0] = true;
+            stack.push_back(std::make_pair(r0, c0));
+            while (!stack.empty()) {
+                int r = stack.back().first, c = stack.back().second;
+                stack.pop_back();
+                size_t cell = size_t(r) * columns + c;
+                int offset = (c - coverage.windowFirstColumn + columns) % columns;
+                gap.cells++;
+                uncovered += coverage.cellUncovered[cell];
+                direction += sampleDirection((r + 0.5) / rows, (c + 0.5) / columns) * double(coverage.cellUncovered[cell]);
+                minRow = std::min(minRow, r);
+                maxRow = std::max(maxRow, r);
+                minOffset = std::min(minOffset, offset);
+                maxOffset = std::max(maxOffset, offset);
+                if (r == coverage.windowFirstRow || r == coverage.windowLastRow ||
+                    (!fullCircle && (offset == 0 || offset == coverage.windowColumns - 1))) {
+                    gap.enclosed = false;
+                }
+
+                const int neighbors[4][2] = { { r - 1, c }, { r + 1, c }, { r, (c + columns - 1) % columns }, { r, (c + 1) % columns } };
+                for (const auto& n : neighbors) {
+                    if (n[0] < 0 || n[0] >= rows) continue;
+                    size_t next = size_t(n[0]) * columns + n[1];
+                    if (visited[next] || !isGap(n[0], n[1])) continue;
+                    visited[next] = true;
+                    stack.push_back(std::make_pair(n[0], n[1]));
+                }
+            }
+
+            gap.solidAngle = coverage.solidAngle(uncovered);
+            direction.normalize();
+            gap.azimuth = std::atan2(direction.x(), direction.z()) * 180.0 / kPi;
+            gap.elevation = std::asin(std::max(-1.0, std::min(1.0, direction.y()))) * 180.0 / kPi;
+            auto wrap = [](double azimuth) { return azimuth >= 180.0 ? azimuth - 360.0 : azimuth; };
+            if (fullCircle && maxOffset - minOffset + 1 == columns) {
+                gap.minAzimuth = -180.0;
+                gap.maxAzimuth = 180.0;
+            } else {
+                gap.minAzimuth = wrap(columnAzimuth(coverage, (coverage.windowFirstColumn + minOffset) % columns));
+                gap.maxAzimuth = wrap(columnAzimuth(coverage, (coverage.windowFirstColumn + maxOffset) % columns + 1));
+            }
+            gap.minElevation = rowElevation(coverage, maxRow + 1);
+            gap.maxElevation = rowElevation(coverage, minRow);
+            coverage.gaps.push_back(gap);
+        }
+    }
+    std::sort(coverage.gaps.begin(), coverage.gaps.end(),
+              [](const CoverageGap& a, const CoverageGap& b) { return a.solidAngle > b.solidAngle; });
+}
+
+const char* samplerName(CoverageSampler sampler)
+{
+    switch (sampler) {
+    case CoverageSobol: return "sobol";
+    case CoverageStratified: return "stratified";
+    default: return "random";
+    }
+}
+
+} // namespace
+
+double ZoneCoverage::solidAngle(uint64_t count) const
+{
+    return options.samples ? 4.0 * kPi * double(count) / double(options.samples) : 0.0;
+}
+
+bool ZoneCoverage::inWindow(int row, int column) const
+{
+    return row >= windowFirstRow && row <= windowLastRow &&
+           (column - windowFirstColumn + columns) % columns < windowColumns;
+}
+
+ZoneCoverage computeZoneCoverage(const std::vector<ViewingZone>& zones, const CoverageOptions& options)
+{
+    if (options.samples == 0) throw std::runtime_error("The sample count must be positive");
+    if (options.sampler == CoverageSobol && options.samples > (uint64_t(1) << 32)) {
+        throw std::runtime_error("The Sobol sampler is limited to 2^32 samples; use --sampler stratified");
+    }
+    if (!(options.cellDegrees >= 0.5 && options.cellDegrees <= 10.0)) {
+        throw std::runtime_error("The heatmap cell size must be between 0.5 and 10 degrees");
+    }
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    ZoneCoverage coverage;
+    coverage.options = options;
+    coverage.columns = static_cast<int>(std::ceil(360.0 / options.cellDegrees));
+    coverage.rows = static_cast<int>(std::ceil(180.0 / options.cellDegrees));
+
+    std::vector<ConeTriangle> triangles;
+    std::vector<osg::Vec3d> vertices;
+    buildTriangles(zones, coverage, triangles, vertices);
+    if (coverage.zoneIds.empty()) throw std::runtime_error("No zones to analyse");
+    CandidateGrid grid;
+    buildCandidateGrid(coverage, triangles, vertices, grid);
+    coverage.candidateTriangles = grid.triangles.size();
+
+    const size_t zoneCount = coverage.zoneIds.size();
+    const size_t cellCount = size_t(coverage.rows) * coverage.columns;
+    coverage.hits.assign(zoneCount, 0);
+    coverage.overlaps.assign(zoneCount * zoneCount, 0);
+    coverage.multiplicity.assign(zoneCount + 1, 0);
+    coverage.cellSamples.assign(cellCount, 0);
+    coverage.cellUncovered.assign(cellCount, 0);
+    coverage.cellOverlapped.assign(cellCount, 0);
+
+    const SobolDirections sobol;
+    const uint64_t chunks = (options.samples + kChunkSamples - 1) / kChunkSamples;
+    std::mutex mergeMutex;
+    parallelFor(chunks, 1, 1, options.threads, [&](size_t begin, size_t end) {
+        CoverageAccumulator acc(zoneCount, cellCount);
+        for (size_t chunk = begin; chunk < end; ++chunk) sampleChunk(coverage, grid, triangles, sobol, chunk, acc);
+
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        for (size_t i = 0; i < zoneCount; ++i) coverage.hits[i] += acc.hits[i];
+        for (size_t i = 0; i < acc.overlaps.size(); ++i) coverage.overlaps[i] += acc.overlaps[i];
+        for (size_t i = 0; i <= zoneCount; ++i) coverage.multiplicity[i] += acc.multiplicity[i];
+        for (size_t i = 0; i < cellCount; ++i) {
+            coverage.cellSamples[i] += acc.cellSamples[i];
+            coverage.cellUncovered[i] += acc.cellUncovered[i];
+            coverage.cellOverlapped[i] += acc.cellOverlapped[i];
+        }
+    });
+    // Pairs were counted once, in zone order
+    for (size_t a = 0; a < zoneCount; ++a) {
+        for (size_t b = a + 1; b < zoneCount; ++b) coverage.overlaps[b * zoneCount + a] = coverage.overlaps[a * zoneCount + b];
+    }
+
+    findWindow(coverage);
+    findGaps(coverage);
+    coverage.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return coverage;
+}
+
+void writeCoverageJson(const std::string& path, const ZoneCoverage& coverage)
+{
+    const CoverageOptions& options = coverage.options;
+    const size_t n = coverage.zoneIds.size();
+    uint64_t uncoveredInWindow = 0;
+    for (int r = 0; r < coverage.rows; ++r) {
+        for (int c = 0; c < coverage.columns; ++c) {
+            if (coverage.inWindow(r, c)) uncoveredInWindow += coverage.cellUncovered[size_t(r) * coverage.columns + c];
+        }
+    }
+
+    std::ofstream out(path.c_str());
+    out << std::setprecision(9);
+    out << "{\n  \"eye\": [" << options.eye.x() << ", " << options.eye.y() << ", " << options.eye.z() << "],\n"
+        << "  \"samples\": " << options.samples << ",\n"
+        << "  \"sampler\": \"" << samplerName(options.sampler) << "\",\n"
+        << "  \"seed\": " << options.seed << ",\n"
+        << "  \"highway_speed\": " << (options.highwaySpeed ? "true" : "false") << ",\n"
+        << "  \"seconds\": " << coverage.seconds << ",\n"
+        << "  \"covered_sr\": " << coverage.solidAngle(options.samples - coverage.multiplicity[0]) << ",\n"
+        << "  \"overlapped_sr\": "
+        << coverage.solidAngle(options.samples - coverage.multiplicity[0] - coverage.multiplicity[1]) << ",\n"
+        << "  \"uncovered_in_window_sr\": " << coverage.solidAngle(uncoveredInWindow) << ",\n";
+
+    out << "  \"zones\": [";
+    for (size_t i = 0; i < n; ++i) {
+        out << (i ? ",\n" : "\n") << "    {\"id\": " << coverage.zoneIds[i]
+            << ", \"solid_angle_sr\": " << coverage.solidAngle(coverage.hits[i])
+            << ", \"exact_sr\": " << coverage.exactSolidAngle[i]
+            << ", \"fraction_of_sphere\": " << double(coverage.hits[i]) / options.samples << "}";
+    }
+    out << "\n  ],\n  \"overlaps\": [";
+    bool first = true;
+    for (size_t a = 0; a < n; ++a) {
+        for (size_t b = a + 1; b < n; ++b) {
+            uint64_t count = coverage.overlaps[a * n + b];
+            if (!count) continue;
+            out << (first ? "\n" : ",\n") << "    {\"zones\": [" << coverage.zoneIds[a] << ", " << coverage.zoneIds[b]
+                << "], \"solid_angle_sr\": " << coverage.solidAngle(count) << "}";
+            first = false;
+        }
+    }
+    out << "\n  ],\n  \"multiplicity\": [";
+    for (size_t k = 0; k < coverage.multiplicity.size(); ++k) out << (k ? ", " : "") << coverage.multiplicity[k];
+    out << "],\n  \"gaps\": [";
+    for (size_t i = 0; i < coverage.gaps.size(); ++i) {
+        const CoverageGap& gap = coverage.gaps[i];
+        out << (i ? ",\n" : "\n") << "    {\"solid_angle_sr\": " << gap.solidAngle
+            << ", \"azimuth_deg\": " << gap.azimuth << ", \"elevation_deg\": " << gap.elevation
+            << ", \"azimuth_range_deg\": [" << gap.minAzimuth << ", " << gap.maxAzimuth << "]"
+            << ", \"elevation_range_deg\": [" << gap.minElevation << ", " << gap.maxElevation << "]"
+            << ", \"cells\": " << gap.cells << ", \"enclosed\": " << (gap.enclosed ? "true" : "false") << "}";
+    }
+    out << "\n  ],\n  \"heatmap\": {\"rows\": " << coverage.rows << ", \"columns\": " << coverage.columns
+        << ", \"cell_sr\": " << 4.0 * kPi / (double(coverage.rows) * coverage.columns)
+        << ", \"window\": {\"first_row\": " << coverage.windowFirstRow << ", \"last_row\": " << coverage.windowLastRow
+        << ", \"first_column\": " << coverage.windowFirstColumn << ", \"columns\": " << coverage.windowColumns << "},\n"
+        << "    \"cell_fields\": [\"row\", \"column\", \"samples\", \"uncovered\", \"overlapped\"], \"cells\": [";
+    first = true;
+    for (int r = coverage.windowFirstRow; r <= coverage.windowLastRow; ++r) {
+        for (int i = 0; i < coverage.windowColumns; ++i) {
+            int c = (coverage.windowFirstColumn + i) % coverage.columns;
+            size_t cell = size_t(r) * coverage.columns + c;
+            out << (first ? "\n" : ",\n") << "      [" << r << ", " << c << ", " << coverage.cellSamples[cell] << ", "
+                << coverage.cellUncovered[cell] << ", " << coverage.cellOverlapped[cell] << "]";
+            first = false;
+        }
+    }
+    out << "\n    ]}\n}\n";
+    if (!out) throw std::runtime_error("Cannot write " + path);
+}
+
+osg::ref_ptr<osg::Node> createCoverageHeatmap(const ZoneCoverage& coverage, float radius, float metersToMmScale)
+{
+    const osg::Vec4 gapColor(1.0f, 0.15f, 0.1f, 0.7f), singleColor(0.2f, 0.85f, 0.3f, 0.25f),
+        overlapColor(1.0f, 0.6f, 0.0f, 0.6f);
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
+    osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+    const osg::Vec3d eye(coverage.options.eye);
+
+    for (int r = coverage.windowFirstRow; r <= coverage.windowLastRow; ++r) {
+        for (int i = 0; i < coverage.windowColumns; ++i) {
+            int c = (coverage.windowFirstColumn + i) % coverage.columns;
+            size_t cell = size_t(r) * coverage.columns + c;
+            if (!coverage.cellSamples[cell]) continue;
+
+            float samples = static_cast<float>(coverage.cellSamples[cell]);
+            float uncovered = coverage.cellUncovered[cell] / samples, overlapped = coverage.cellOverlapped[cell] / samples;
+            osg::Vec4 color = gapColor * uncovered + overlapColor * overlapped + singleColor * (1.0f - uncovered - overlapped);
+
+            GLuint base = static_cast<GLuint>(vertices->size());
+            const double corners[4][2] = { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 0 } };
+            for (const auto& corner : corners) {
+                osg::Vec3d direction = sampleDirection((r + corner[0]) / coverage.rows, (c + corner[1]) / coverage.columns);
+                vertices->push_back(osg::Vec3(eye + direction * radius));
+                colors->push_back(color);
+            }
+            const GLuint quad[6] = { 0, 1, 2, 0, 2, 3 };
+            for (GLuint index : quad) triangles->push_back(base + index);
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->setColorArray(colors.get(), osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(triangles.get());
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+    osg::StateSet* state = geode->getOrCreateStateSet();
+    state->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    state->setMode(GL_BLEND, osg::StateAttribute::ON);
+    state->setAttributeAndModes(new osg::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+    state->setAttributeAndModes(new osg::Depth(osg::Depth::LESS, 0.0, 1.0, false));
+    state->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+
+    osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform;
+    transform->setMatrix(osg::Matrix::scale(metersToMmScale, metersToMmScale, metersToMmScale));
+    transform->setName("coverage heatmap");
+    transform->addChild(geode.get());
+    return transform;
+}
+
+namespace {
+
+void printCoverageUsage()
+{
+    std::cout << "Usage: visual coverage [model <name>] [--viewtarget <file>] [--eye x,y,z] [--samples N]" << std::endl;
+    std::cout << "                       [--sampler sobol|stratified|random] [--seed S] [--cell-deg D]" << std::endl;
+    std::cout << "                       [--jobs N] [--highway-speed] [-o <coverage.json>]" << std::endl;
+    std::cout << "  Samples gaze directions uniformly over the sphere around the eye (default: the carCoord" << std::endl;
+    std::cout << "  origin, 2^24 samples, Sobol) on N threads (default: one per core) and reports each zone's" << std::endl;
+    std::cout << "  solid angle next to the exact value, pairwise overlaps and uncovered regions inside the" << std::endl;
+    std::cout << "  zone window. -o writes the full report including the heatmap cells as JSON." << std::endl;
+}
+
+} // namespace
+
+int runCoverageCommand(int argc, char** argv)
+{
+    std::string carModelName = "Sharan";
+    std::string viewTargetPath, outputPath;
+    CoverageOptions options;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "model" && i + 1 < argc) carModelName = argv[++i];
+        else if (arg == "--viewtarget" && i + 1 < argc) viewTargetPath = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--samples" && i + 1 < argc) options.samples = static_cast<uint64_t>(std::strtod(argv[++i], nullptr));
+        else if (arg == "--seed" && i + 1 < argc) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--cell-deg" && i + 1 < argc) options.cellDegrees = std::atof(argv[++i]);
+        else if (arg == "--jobs" && i + 1 < argc) options.threads = std::atoi(argv[++i]);
+        else if (arg == "--highway-speed") options.highwaySpeed = true;
+        else if (arg == "--eye" && i + 1 < argc) {
+            const char* p = argv[++i];
+            const char* end = p + std::strlen(p);
+            float eye[3];
+            int count = 0;
+            while (count < 3 && nextCsvNumber(p, end, eye[count])) ++count;
+            if (count != 3) {
+                std::cerr << "Error: --eye expects x,y,z in meters" << std::endl;
+                return 1;
+            }
+            options.eye.set(eye[0], eye[1], eye[2]);
+        } else if (arg == "--sampler" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "sobol") options.sampler = CoverageSobol;
+            else if (name == "stratified") options.sampler = CoverageStratified;
+            else if (name == "random") options.sampler = CoverageRandom;
+            else {
+                std::cerr << "Error: Unknown sampler '" << name << "'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--help" || arg == "-h") { printCoverageUsage(); return 0; }
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printCoverageUsage();
+            return 1;
+        }
+    }
+
+    ZoneCoverage coverage;
+    try {
+        std::vector<ViewingZone> zones;
+        if (!viewTargetPath.empty()) {
+            std::vector<std::string> warnings;
+            zones = parseViewTargetFile(viewTargetPath, &warnings);
+            for (const auto& warning : warnings) std::cerr << "Warning: " << warning << std::endl;
+        } else {
+            zones = parseViewingZonesFile("carmodels/" + carModelName + "/config/viewingzones.json");
+        }
+        coverage = computeZoneCoverage(zones, options);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    const size_t n = coverage.zoneIds.size();
+    unsigned threads = options.threads ? options.threads : workerCount();
+    std::cout << "Coverage of " << n << " zones from eye (" << options.eye.x() << ", " << options.eye.y() << ", "
+              << options.eye.z() << ") m" << (options.highwaySpeed ? ", highway-speed targets only" : "") << std::endl;
+    std::cout << options.samples << " " << samplerName(options.sampler) << " samples on " << threads << " thread(s) in "
+              << std::fixed << std::setprecision(3) << coverage.seconds << " s ("
+              << std::setprecision(1) << options.samples / coverage.seconds / 1e6 << " M samples/s), "
+              << coverage.rows << "x" << coverage.columns << " cells, " << coverage.candidateTriangles
+              << " cell-triangle candidates" << std::endl;
+
+    std::cout << std::setw(8) << "zone" << std::setw(12) << "MC sr" << std::setw(12) << "exact sr"
+              << std::setw(12) << "error %" << std::setw(12) << "sphere %" << std::endl;
+    double worst = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double estimate = coverage.solidAngle(coverage.hits[i]), exact = coverage.exactSolidAngle[i];
+        double error = exact > 0.0 ? 100.0 * (estimate - exact) / exact : 0.0;
+        worst = std::max(worst, std::fabs(error));
+        std::cout << std::setw(8) << coverage.zoneIds[i] << std::setprecision(5) << std::setw(12) << estimate
+                  << std::setw(12) << exact << std::setprecision(3) << std::setw(12) << error << std::setw(12)
+                  << 100.0 * coverage.hits[i] / options.samples << std::endl;
+    }
+    std::cout << "Largest deviation from the exact solid angle: " << worst << " %" << std::endl;
+
+    std::cout << std::setprecision(4) << "Covered " << coverage.solidAngle(options.samples - coverage.multiplicity[0])
+              << " sr, overlapped " << coverage.solidAngle(options.samples - coverage.multiplicity[0] - coverage.multiplicity[1])
+              << " sr of 4 pi" << std::endl;
+    size_t overlapPairs = 0;
+    for (size_t a = 0; a < n; ++a) {
+        for (size_t b = a + 1; b < n; ++b) {
+            if (!coverage.overlaps[a * n + b]) continue;
+            if (overlapPairs++ == 0) std::cout << "Overlaps:" << std::endl;
+            std::cout << "  zones " << coverage.zoneIds[a] << " and " << coverage.zoneIds[b] << ": "
+                      << coverage.solidAngle(coverage.overlaps[a * n + b]) << " sr" << std::endl;
+        }
+    }
+    if (!overlapPairs) std::cout << "No overlapping zones" << std::endl;
+
+    std::cout << coverage.gaps.size() << " uncovered region(s) in the zone window" << std::endl;
+    for (size_t i = 0; i < coverage.gaps.size() && i < 10; ++i) {
+        const CoverageGap& gap = coverage.gaps[i];
+        std::cout << std::setprecision(1) << "  " << (gap.enclosed ? "hole" : "open") << " at azimuth " << gap.azimuth
+                  << ", elevation " << gap.elevation << " deg (" << gap.minAzimuth << ".." << gap.maxAzimuth << ", "
+                  << gap.minElevation << ".." << gap.maxElevation << "): " << std::setprecision(4) << gap.solidAngle
+                  << " sr" << std::endl;
+    }
+
+    if (!outputPath.empty()) {
+        try {
+            writeCoverageJson(outputPath, coverage);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << outputPath << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef ZONE_COVERAGE_H
+#define ZONE_COVERAGE_H
+
+#include "config_loader.h"
+
+#include <osg/Node>
+#include <osg/Vec3>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Monte-Carlo coverage of the sphere of gaze directions around an eye point: how much of
+// it each zone covers (solid angle), where zones overlap and where no zone is hit.
+//
+// Directions are sampled uniformly over the sphere through the equal-area mapping
+// (u, v) -> (sin elevation = 1 - 2u, azimuth = 360 v - 180), so a sample count is
+// directly a solid angle (4 pi sr * hits / samples). Azimuth is measured from +Z
+// (forward) towards +X (left), elevation from the XZ plane towards +Y (up).
+//
+// Samples are split into fixed chunks of 64k whose random streams are seeded from the
+// seed and the chunk index only, so the result does not depend on the thread count.
+// Each thread counts into its own accumulator; they are merged at the end.
+
+enum CoverageSampler {
+    CoverageSobol,       // 2-D Sobol sequence, digitally shifted by the seed
+    CoverageStratified,  // one jittered sample per equal-area stratum
+    CoverageRandom       // independent uniform samples
+};
+
+struct CoverageOptions {
+    osg::Vec3 eye = osg::Vec3(0.0f, 0.0f, 0.0f);  // carCoord, meters
+    uint64_t samples = uint64_t(1) << 24;
+    CoverageSampler sampler = CoverageSobol;
+    uint64_t seed = 1;
+    double cellDegrees = 1.0;   // heatmap cell height at the equator (0.5 - 10)
+    unsigned threads = 0;       // 0 = workerCount()
+    bool highwaySpeed = false;  // only zones that are highway-speed targets
+};
+
+// A connected set of heatmap cells inside the zone window that are mostly not covered
+struct CoverageGap {
+    double solidAngle;              // steradians (uncovered samples only)
+    double azimuth, elevation;      // centroid, degrees
+    double minAzimuth, maxAzimuth;  // degrees; minAzimuth > maxAzimuth if it crosses 180
+    double minElevation, maxElevation;
+    size_t cells;
+    bool enclosed;                  // surrounded by covered cells, not open to the window edge
+};
+
+struct ZoneCoverage {
+    CoverageOptions options;
+    std::vector<int> zoneIds;             // the zones analysed (degenerate zones are skipped)
+    std::vector<uint64_t> hits;           // samples hitting each zone
+    std::vector<double> exactSolidAngle;  // each zone's two triangles, analytically (sr)
+    std::vector<uint64_t> overlaps;       // samples hitting both zones, zoneIds.size()^2, symmetric
+    std::vector<uint64_t> multiplicity;   // samples hitting exactly k zones
+
+    // Heatmap: rows x columns equal-area cells. Rows are bands of equal height in
+    // sin(elevation) from +90 degrees down, columns start at azimuth -180.
+    int rows = 0, columns = 0;
+    std::vector<uint64_t> cellSamples, cellUncovered, cellOverlapped;
+    // Zone window: the elevation rows and the azimuth arc that contain covered cells
+    int windowFirstRow = 0, windowLastRow = -1;
+    int windowFirstColumn = 0, windowColumns = 0;  // arc of columns, may wrap
+    std::vector<CoverageGap> gaps;                  // largest first
+
+    size_t candidateTriangles = 0;  // cell-triangle candidate pairs of the search grid
+    double seconds = 0.0;
+
+    double solidAngle(uint64_t count) const;
+    bool inWindow(int row, int column) const;
+};
+
+// Throws std::runtime_error for invalid options (no zones, too many Sobol samples, ...)
+ZoneCoverage computeZoneCoverage(const std::vector<ViewingZone>& zones, const CoverageOptions& options);
+
+// Per-zone solid angles, pairwise overlaps, uncovered regions and the heatmap cells of the
+// zone window. Throws std::runtime_error if the file cannot be written.
+void writeCoverageJson(const std::string& path, const ZoneCoverage& coverage);
+
+// The window's heatmap cells on a sphere of `radius` meters around the eye, scaled like
+// the zones: red where no zone is hit, green for one zone, orange where zones overlap
+osg::ref_ptr<osg::Node> createCoverageHeatmap(const ZoneCoverage& coverage, float radius, float metersToMmScale);
+
+// `visual coverage [model <name>] ...` - zone coverage of the gaze sphere as JSON
+int runCoverageCommand(int argc, char** argv);
+
+#endif
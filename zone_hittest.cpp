@@ -0,0 +1,729 @@
+#include "zone_hittest.h"
+#include "viewtarget.h"
+#include "csv_util.h"
+#include "bench_util.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <chrono>
+#include <random>
+#include <limits>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ZONE_HITTEST_X86 1
+#endif
+
+namespace {
+
+// Rays nearly parallel to a triangle are treated as misses
+const float kParallelEpsilon = 1e-9f;
+// Hits closer than this to the ray origin are ignored
+const float kMinDistance = 1e-6f;
+// Deep enough for any tree ZoneBvh builds (its depth is capped at 64)
+const int kTraversalStackSize = 128;
+
+} // namespace
+
+void GazeRayBatch::reserve(size_t n)
+{
+    ox.reserve(n); oy.reserve(n); oz.reserve(n);
+    dx.reserve(n); dy.reserve(n); dz.reserve(n);
+}
+
+void GazeRayBatch::clear()
+{
+    ox.clear(); oy.clear(); oz.clear();
+    dx.clear(); dy.clear(); dz.clear();
+}
+
+void GazeRayBatch::push_back(const osg::Vec3& origin, const osg::Vec3& direction)
+{
+    ox.push_back(origin.x()); oy.push_back(origin.y()); oz.push_back(origin.z());
+    dx.push_back(direction.x()); dy.push_back(direction.y()); dz.push_back(direction.z());
+}
+
+ZoneHitTester::ZoneHitTester(const std::vector<ViewingZone>& zones)
+    : bvh_(zones), hasHighwayFilter_(false)
+{
+    std::vector<ViewingZone> highwayZones;
+    for (const auto& zone : zones) {
+        if (zone.highwaySpeedEnabled) highwayZones.push_back(zone);
+    }
+    if (highwayZones.size() != zones.size()) {
+        highwayBvh_.build(highwayZones);
+        hasHighwayFilter_ = true;
+    }
+}
+
+// Moeller-Trumbore for one ray against all triangles. The vector kernels below perform
+// exactly the same operations in the same order, so results match bit for bit.
+void ZoneHitTester::classifyRangeScalar(const ZoneBvh& bvh, const GazeRayBatch& rays, size_t begin, size_t end,
+                                        int* zoneIds, float* distances) const
+{
+    const ZoneTriangles& tri = bvh.triangles();
+    const size_t numTris = tri.size();
+    for (size_t r = begin; r < end; ++r) {
+        const float ox = rays.ox[r], oy = rays.oy[r], oz = rays.oz[r];
+        const float dx = rays.dx[r], dy = rays.dy[r], dz = rays.dz[r];
+        float best = std::numeric_limits<float>::infinity();
+        int bestId = 0;
+        int bestPriority = std::numeric_limits<int>::min();
+
+        for (size_t i = 0; i < numTris; ++i) {
+            // p = d x e2
+            float px = dy * tri.e2z[i] - dz * tri.e2y[i];
+            float py = dz * tri.e2x[i] - dx * tri.e2z[i];
+            float pz = dx * tri.e2y[i] - dy * tri.e2x[i];
+            float det = (tri.e1x[i] * px + tri.e1y[i] * py) + tri.e1z[i] * pz;
+            float invDet = 1.0f / det;
+            // s = o - v0
+            float sx = ox - tri.v0x[i], sy = oy - tri.v0y[i], sz = oz - tri.v0z[i];
+            float u = ((sx * px + sy * py) + sz * pz) * invDet;
+            // q = s x e1
+            float qx = sy * tri.e1z[i] - sz * tri.e1y[i];
+            float qy = sz * tri.e1x[i] - sx * tri.e1z[i];
+            float qz = sx * tri.e1y[i] - sy * tri.e1x[i];
+            float v = ((dx * qx + dy * qy) + dz * qz) * invDet;
+            float t = ((tri.e2x[i] * qx + tri.e2y[i] * qy) + tri.e2z[i] * qz) * invDet;
+
+            if (std::fabs(det) > kParallelEpsilon && u >= 0.0f && v >= 0.0f && (u + v) <= 1.0f &&
+                t > kMinDistance && (tri.priority[i] > bestPriority || (tri.priority[i] == bestPriority && t < best))) {
+                best = t;
+                bestId = tri.zoneId[i];
+                bestPriority = tri.priority[i];
+            }
+        }
+
+        zoneIds[r] = bestId;
+        if (distances) distances[r] = bestId ? best : -1.0f;
+    }
+}
+
+void ZoneHitTester::classifyScalar(const GazeRayBatch& rays, int* zoneIds, float* distances, bool highwaySpeed) const
+{
+    classifyRangeScalar(bvh(highwaySpeed), rays, 0, rays.size(), zoneIds, distances);
+}
+
+void ZoneHitTester::resolvePriorities(const ZoneBvh& bvh, const GazeRayBatch& rays, size_t end, int* zoneIds,
+                                      float* distances) const
+{
+    if (!bvh.hasPriorities()) return;
+    for (size_t r = 0; r < end; ++r) {
+        if (!zoneIds[r] || bvh.zonePriority(zoneIds[r]) >= bvh.maxPriority()) continue;
+        float distance;
+        zoneIds[r] = bvh.intersect(osg::Vec3(rays.ox[r], rays.oy[r], rays.oz[r]),
+                                   osg::Vec3(rays.dx[r], rays.dy[r], rays.dz[r]), &distance);
+        if (distances) distances[r] = distance;
+    }
+}
+
+#ifdef ZONE_HITTEST_X86
+
+namespace {
+
+// Avoid 0 * inf = NaN in the slab test for axis-parallel rays
+inline float safeInverse(float d)
+{
+    return 1.0f / (std::fabs(d) < 1e-20f ? std::copysign(1e-20f, d) : d);
+}
+
+// ----------- AVX: packets of 8 rays -----------
+
+#define AVX_INLINE static inline __attribute__((target("avx"), always_inline))
+
+struct AvxPacket {
+    __m256 ox, oy, oz, dx, dy, dz;
+    __m256 ix, iy, iz;     // inverse directions for the slab test
+    __m256 best, bestId;   // nearest t so far, zone id bits
+};
+
+AVX_INLINE void avxLoadPacket(const GazeRayBatch& rays, size_t r, AvxPacket& p)
+{
+    p.ox = _mm256_loadu_ps(&rays.ox[r]); p.oy = _mm256_loadu_ps(&rays.oy[r]); p.oz = _mm256_loadu_ps(&rays.oz[r]);
+    p.dx = _mm256_loadu_ps(&rays.dx[r]); p.dy = _mm256_loadu_ps(&rays.dy[r]); p.dz = _mm256_loadu_ps(&rays.dz[r]);
+    p.best = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    p.bestId = _mm256_setzero_ps();
+}
+
+AVX_INLINE void avxTestTriangles(const ZoneTriangles& tri, size_t begin, size_t end, AvxPacket& p)
+{
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 eps = _mm256_set1_ps(kParallelEpsilon);
+    const __m256 minT = _mm256_set1_ps(kMinDistance);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    for (size_t i = begin; i < end; ++i) {
+        const __m256 ax = _mm256_set1_ps(tri.e1x[i]), ay = _mm256_set1_ps(tri.e1y[i]), az = _mm256_set1_ps(tri.e1z[i]);
+        const __m256 bx = _mm256_set1_ps(tri.e2x[i]), by = _mm256_set1_ps(tri.e2y[i]), bz = _mm256_set1_ps(tri.e2z[i]);
+
+        __m256 px = _mm256_sub_ps(_mm256_mul_ps(p.dy, bz), _mm256_mul_ps(p.dz, by));
+        __m256 py = _mm256_sub_ps(_mm256_mul_ps(p.dz, bx), _mm256_mul_ps(p.dx, bz));
+        __m256 pz = _mm256_sub_ps(_mm256_mul_ps(p.dx, by), _mm256_mul_ps(p.dy, bx));
+        __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, px), _mm256_mul_ps(ay, py)), _mm256_mul_ps(az, pz));
+        __m256 invDet = _mm256_div_ps(one, det);
+
+        __m256 sx = _mm256_sub_ps(p.ox, _mm256_set1_ps(tri.v0x[i]));
+        __m256 sy = _mm256_sub_ps(p.oy, _mm256_set1_ps(tri.v0y[i]));
+        __m256 sz = _mm256_sub_ps(p.oz, _mm256_set1_ps(tri.v0z[i]));
+        __m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)), invDet);
+
+        __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, az), _mm256_mul_ps(sz, ay));
+        __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, ax), _mm256_mul_ps(sx, az));
+        __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, ay), _mm256_mul_ps(sy, ax));
+        __m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p.dx, qx), _mm256_mul_ps(p.dy, qy)), _mm256_mul_ps(p.dz, qz)), invDet);
+        __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(bx, qx), _mm256_mul_ps(by, qy)), _mm256_mul_ps(bz, qz)), invDet);
+
+        __m256 hit = _mm256_cmp_ps(_mm256_andnot_ps(signMask, det), eps, _CMP_GT_OQ);
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, minT, _CMP_GT_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, p.best, _CMP_LT_OQ));
+
+        p.best = _mm256_blendv_ps(p.best, t, hit);
+        p.bestId = _mm256_blendv_ps(p.bestId, _mm256_castsi256_ps(_mm256_set1_epi32(tri.zoneId[i])), hit);
+    }
+}
+
+// Bit mask of the rays whose slab interval overlaps the box before their nearest hit
+AVX_INLINE int avxTestBox(const ZoneBvhNode& node, const AvxPacket& p)
+{
+    __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.bmin[0]), p.ox), p.ix);
+    __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.bmax[0]), p.ox), p.ix);
+    __m256 tmin = _mm256_max_ps(_mm256_set1_ps(kMinDistance), _mm256_min_ps(t0, t1));
+    __m256 tmax = _mm256_min_ps(p.best, _mm256_max_ps(t0, t1));
+    t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.bmin[1]), p.oy), p.iy);
+    t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.bmax[1]), p.oy), p.iy);
+    tmin = _mm256_max_ps(tmin, _mm256_min_ps(t0, t1));
+    tmax = _mm256_min_ps(tmax, _mm256_max_ps(t0, t1));
+    t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.bmin[2]), p.oz), p.iz);
+    t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.bmax[2]), p.oz), p.iz);
+    tmin = _mm256_max_ps(tmin, _mm256_min_ps(t0, t1));
+    tmax = _mm256_min_ps(tmax, _mm256_max_ps(t0, t1));
+    return _mm256_movemask_ps(_mm256_cmp_ps(tmin, tmax, _CMP_LE_OQ));
+}
+
+AVX_INLINE void avxStorePacket(const AvxPacket& p, size_t r, int* zoneIds, float* distances)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(zoneIds + r), _mm256_castps_si256(p.bestId));
+    if (distances) {
+        __m256 found = _mm256_cmp_ps(p.best, _mm256_set1_ps(std::numeric_limits<float>::infinity()), _CMP_LT_OQ);
+        _mm256_storeu_ps(distances + r, _mm256_blendv_ps(_mm256_set1_ps(-1.0f), p.best, found));
+    }
+}
+
+__attribute__((target("avx")))
+size_t classifyAvxBvh(const GazeRayBatch& rays, const ZoneBvh& bvh, int* zoneIds, float* distances)
+{
+    const size_t n = rays.size() & ~size_t(7);
+    const std::vector<ZoneBvhNode>& nodes = bvh.nodes();
+    const ZoneTriangles& tri = bvh.triangles();
+
+    for (size_t r = 0; r < n; r += 8) {
+        AvxPacket p;
+        avxLoadPacket(rays, r, p);
+        if (!nodes.empty()) {
+            float inv[3][8];
+            for (int k = 0; k < 8; ++k) {
+                inv[0][k] = safeInverse(rays.dx[r + k]);
+                inv[1][k] = safeInverse(rays.dy[r + k]);
+                inv[2][k] = safeInverse(rays.dz[r + k]);
+            }
+            p.ix = _mm256_loadu_ps(inv[0]); p.iy = _mm256_loadu_ps(inv[1]); p.iz = _mm256_loadu_ps(inv[2]);
+
+            // Near-first child order follows the majority direction of the packet
+            const int negative[3] = {
+                __builtin_popcount(_mm256_movemask_ps(p.dx)) > 4,
+                __builtin_popcount(_mm256_movemask_ps(p.dy)) > 4,
+                __builtin_popcount(_mm256_movemask_ps(p.dz)) > 4
+            };
+
+            uint32_t stack[kTraversalStackSize];
+            int top = 0;
+            stack[top++] = 0;
+            while (top > 0) {
+                uint32_t index = stack[--top];
+                const ZoneBvhNode& node = nodes[index];
+                if (!avxTestBox(node, p)) continue;
+                if (node.isLeaf()) {
+                    avxTestTriangles(tri, node.offset, node.offset + node.count, p);
+                } else if (negative[node.axis]) {
+                    stack[top++] = index + 1;
+                    stack[top++] = node.offset;
+                } else {
+                    stack[top++] = node.offset;
+                    stack[top++] = index + 1;
+                }
+            }
+        }
+        avxStorePacket(p, r, zoneIds, distances);
+    }
+    return n;
+}
+
+__attribute__((target("avx")))
+size_t classifyAvxBruteForce(const GazeRayBatch& rays, const ZoneTriangles& tri, int* zoneIds, float* distances)
+{
+    const size_t n = rays.size() & ~size_t(7);
+    for (size_t r = 0; r < n; r += 8) {
+        AvxPacket p;
+        avxLoadPacket(rays, r, p);
+        avxTestTriangles(tri, 0, tri.size(), p);
+        avxStorePacket(p, r, zoneIds, distances);
+    }
+    return n;
+}
+
+// ----------- SSE2: packets of 4 rays (always available on x86-64) -----------
+
+struct SsePacket {
+    __m128 ox, oy, oz, dx, dy, dz;
+    __m128 ix, iy, iz;
+    __m128 best;
+    __m128i bestId;
+};
+
+inline __m128 sseSelect(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline void sseLoadPacket(const GazeRayBatch& rays, size_t r, SsePacket& p)
+{
+    p.ox = _mm_loadu_ps(&rays.ox[r]); p.oy = _mm_loadu_ps(&rays.oy[r]); p.oz = _mm_loadu_ps(&rays.oz[r]);
+    p.dx = _mm_loadu_ps(&rays.dx[r]); p.dy = _mm_loadu_ps(&rays.dy[r]); p.dz = _mm_loadu_ps(&rays.dz[r]);
+    p.best = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    p.bestId = _mm_setzero_si128();
+}
+
+inline void sseTestTriangles(const ZoneTriangles& tri, size_t begin, size_t end, SsePacket& p)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 eps = _mm_set1_ps(kParallelEpsilon);
+    const __m128 minT = _mm_set1_ps(kMinDistance);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (size_t i = begin; i < end; ++i) {
+        const __m128 ax = _mm_set1_ps(tri.e1x[i]), ay = _mm_set1_ps(tri.e1y[i]), az = _mm_set1_ps(tri.e1z[i]);
+        const __m128 bx = _mm_set1_ps(tri.e2x[i]), by = _mm_set1_ps(tri.e2y[i]), bz = _mm_set1_ps(tri.e2z[i]);
+
+        __m128 px = _mm_sub_ps(_mm_mul_ps(p.dy, bz), _mm_mul_ps(p.dz, by));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(p.dz, bx), _mm_mul_ps(p.dx, bz));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(p.dx, by), _mm_mul_ps(p.dy, bx));
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, px), _mm_mul_ps(ay, py)), _mm_mul_ps(az, pz));
+        __m128 invDet = _mm_div_ps(one, det);
+
+        __m128 sx = _mm_sub_ps(p.ox, _mm_set1_ps(tri.v0x[i]));
+        __m128 sy = _mm_sub_ps(p.oy, _mm_set1_ps(tri.v0y[i]));
+        __m128 sz = _mm_sub_ps(p.oz, _mm_set1_ps(tri.v0z[i]));
+        __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, az), _mm_mul_ps(sz, ay));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, ax), _mm_mul_ps(sx, az));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, ay), _mm_mul_ps(sy, ax));
+        __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p.dx, qx), _mm_mul_ps(p.dy, qy)), _mm_mul_ps(p.dz, qz)), invDet);
+        __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bx, qx), _mm_mul_ps(by, qy)), _mm_mul_ps(bz, qz)), invDet);
+
+        __m128 hit = _mm_cmpgt_ps(_mm_andnot_ps(signMask, det), eps);
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+        hit = _mm_and_ps(hit, _mm_cmpgt_ps(t, minT));
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(t, p.best));
+
+        p.best = sseSelect(hit, t, p.best);
+        __m128i hitI = _mm_castps_si128(hit);
+        p.bestId = _mm_or_si128(_mm_and_si128(hitI, _mm_set1_epi32(tri.zoneId[i])), _mm_andnot_si128(hitI, p.bestId));
+    }
+}
+
+inline int sseTestBox(const ZoneBvhNode& node, const SsePacket& p)
+{
+    __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmin[0]), p.ox), p.ix);
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmax[0]), p.ox), p.ix);
+    __m128 tmin = _mm_max_ps(_mm_set1_ps(kMinDistance), _mm_min_ps(t0, t1));
+    __m128 tmax = _mm_min_ps(p.best, _mm_max_ps(t0, t1));
+    t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmin[1]), p.oy), p.iy);
+    t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmax[1]), p.oy), p.iy);
+    tmin = _mm_max_ps(tmin, _mm_min_ps(t0, t1));
+    tmax = _mm_min_ps(tmax, _mm_max_ps(t0, t1));
+    t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmin[2]), p.oz), p.iz);
+    t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmax[2]), p.oz), p.iz);
+    tmin = _mm_max_ps(tmin, _mm_min_ps(t0, t1));
+    tmax = _mm_min_ps(tmax, _mm_max_ps(t0, t1));
+    return _mm_movemask_ps(_mm_cmple_ps(tmin, tmax));
+}
+
+inline void sseStorePacket(const SsePacket& p, size_t r, int* zoneIds, float* distances)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(zoneIds + r), p.bestId);
+    if (distances) {
+        __m128 found = _mm_cmplt_ps(p.best, _mm_set1_ps(std::numeric_limits<float>::infinity()));
+        _mm_storeu_ps(distances + r, sseSelect(found, p.best, _mm_set1_ps(-1.0f)));
+    }
+}
+
+size_t classifySse2Bvh(const GazeRayBatch& rays, const ZoneBvh& bvh, int* zoneIds, float* distances)
+{
+    const size_t n = rays.size() & ~size_t(3);
+    const std::vector<ZoneBvhNode>& nodes = bvh.nodes();
+    const ZoneTriangles& tri = bvh.triangles();
+
+    for (size_t r = 0; r < n; r += 4) {
+        SsePacket p;
+        sseLoadPacket(rays, r, p);
+        if (!nodes.empty()) {
+            p.ix = _mm_setr_ps(safeInverse(rays.dx[r]), safeInverse(rays.dx[r + 1]), safeInverse(rays.dx[r + 2]), safeInverse(rays.dx[r + 3]));
+            p.iy = _mm_setr_ps(safeInverse(rays.dy[r]), safeInverse(rays.dy[r + 1]), safeInverse(rays.dy[r + 2]), safeInverse(rays.dy[r + 3]));
+            p.iz = _mm_setr_ps(safeInverse(rays.dz[r]), safeInverse(rays.dz[r + 1]), safeInverse(rays.dz[r + 2]), safeInverse(rays.dz[r + 3]));
+
+            const int negative[3] = {
+                __builtin_popcount(_mm_movemask_ps(p.dx)) > 2,
+                __builtin_popcount(_mm_movemask_ps(p.dy)) > 2,
+                __builtin_popcount(_mm_movemask_ps(p.dz)) > 2
+            };
+
+            uint32_t stack[kTraversalStackSize];
+            int top = 0;
+            stack[top++] = 0;
+            while (top > 0) {
+                uint32_t index = stack[--top];
+                const ZoneBvhNode& node = nodes[index];
+                if (!sseTestBox(node, p)) continue;
+                if (node.isLeaf()) {
+                    sseTestTriangles(tri, node.offset, node.offset + node.count, p);
+                } else if (negative[node.axis]) {
+                    stack[top++] = index + 1;
+                    stack[top++] = node.offset;
+                } else {
+                    stack[top++] = node.offset;
+                    stack[top++] = index + 1;
+                }
+            }
+        }
+        sseStorePacket(p, r, zoneIds, distances);
+    }
+    return n;
+}
+
+size_t classifySse2BruteForce(const GazeRayBatch& rays, const ZoneTriangles& tri, int* zoneIds, float* distances)
+{
+    const size_t n = rays.size() & ~size_t(3);
+    for (size_t r = 0; r < n; r += 4) {
+        SsePacket p;
+        sseLoadPacket(rays, r, p);
+        sseTestTriangles(tri, 0, tri.size(), p);
+        sseStorePacket(p, r, zoneIds, distances);
+    }
+    return n;
+}
+
+bool cpuHasAvx()
+{
+    static const bool hasAvx = __builtin_cpu_supports("avx");
+    return hasAvx;
+}
+
+} // namespace
+
+#endif
+
+void ZoneHitTester::classify(const GazeRayBatch& rays, int* zoneIds, float* distances, bool highwaySpeed) const
+{
+    const ZoneBvh& zones = bvh(highwaySpeed);
+    size_t done = 0;
+#ifdef ZONE_HITTEST_X86
+    // The packet kernels only track the nearest hit
+    done = cpuHasAvx() ? classifyAvxBvh(rays, zones, zoneIds, distances)
+                       : classifySse2Bvh(rays, zones, zoneIds, distances);
+    resolvePriorities(zones, rays, done, zoneIds, distances);
+#endif
+    // Remaining rays that do not fill a packet
+    for (size_t r = done; r < rays.size(); ++r) {
+        float distance;
+        zoneIds[r] = zones.intersect(osg::Vec3(rays.ox[r], rays.oy[r], rays.oz[r]),
+                                     osg::Vec3(rays.dx[r], rays.dy[r], rays.dz[r]), &distance);
+        if (distances) distances[r] = distance;
+    }
+}
+
+void ZoneHitTester::classifyBruteForce(const GazeRayBatch& rays, int* zoneIds, float* distances,
+                                       bool highwaySpeed) const
+{
+    const ZoneBvh& zones = bvh(highwaySpeed);
+    size_t done = 0;
+#ifdef ZONE_HITTEST_X86
+    done = cpuHasAvx() ? classifyAvxBruteForce(rays, zones.triangles(), zoneIds, distances)
+                       : classifySse2BruteForce(rays, zones.triangles(), zoneIds, distances);
+    resolvePriorities(zones, rays, done, zoneIds, distances);
+#endif
+    classifyRangeScalar(zones, rays, done, rays.size(), zoneIds, distances);
+}
+
+const char* ZoneHitTester::kernelName() const
+{
+#ifdef ZONE_HITTEST_X86
+    return cpuHasAvx() ? "AVX" : "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+// ----------- visual classify -----------
+
+namespace {
+
+// Gaze CSV: one ray per line, "ox,oy,oz,dx,dy,dz" or "timestamp,ox,oy,oz,dx,dy,dz"
+void readGazeCsv(const std::string& path, GazeRayBatch& rays)
+{
+    forEachCsvRow(path, 6, 7, "6 or 7 numeric columns", [&](const float* values, int count) {
+        const float* v = values + (count - 6);
+        rays.push_back(osg::Vec3(v[0], v[1], v[2]), osg::Vec3(v[3], v[4], v[5]));
+    });
+}
+
+// Rays from an eye point behind the zones towards random points spread over the zone area
+void makeRandomRays(const std::vector<ViewingZone>& zones, size_t count, GazeRayBatch& rays)
+{
+    osg::Vec3 minCorner(FLT_MAX, FLT_MAX, FLT_MAX), maxCorner(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (const auto& zone : zones) {
+        if (isZoneDegenerate(zone)) continue;
+        for (const auto& v : zone.corners) {
+            for (int k = 0; k < 3; ++k) {
+                minCorner[k] = std::min(minCorner[k], v[k]);
+                maxCorner[k] = std::max(maxCorner[k], v[k]);
+            }
+        }
+    }
+    osg::Vec3 center = (minCorner + maxCorner) * 0.5f;
+    osg::Vec3 extent = (maxCorner - minCorner) * 0.6f;
+    osg::Vec3 eye = center - osg::Vec3(0.0f, 0.0f, extent.z());
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+    rays.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        osg::Vec3 origin = eye + osg::Vec3(jitter(rng), jitter(rng), jitter(rng)) * 0.05f;
+        osg::Vec3 target = center + osg::Vec3(jitter(rng) * extent.x(), jitter(rng) * extent.y(), jitter(rng) * extent.z());
+        osg::Vec3 direction = target - origin;
+        direction.normalize();
+        rays.push_back(origin, direction);
+    }
+}
+
+void printClassifyUsage()
+{
+    std::cout << "Usage: visual classify <gaze.csv> [model <name>] [-o <zones.csv>] [--no-verify]" << std::endl;
+    std::cout << "       visual classify --random <count> [model <name>]" << std::endl;
+    std::cout << "  --viewtarget <viewtarget.txt>  Zones from an ECU view target dump instead of viewingzones.json" << std::endl;
+    std::cout << "  --highway-speed                Classify as at highway speed (only highway-speed targets)" << std::endl;
+    std::cout << "  Gaze CSV columns: [timestamp,] ox, oy, oz, dx, dy, dz  (carCoord, meters)" << std::endl;
+    std::cout << "  Output CSV columns: ray, zone_id, distance  (zone_id 0 = no zone)" << std::endl;
+}
+
+} // namespace
+
+int runClassifyCommand(int argc, char** argv)
+{
+    std::string gazePath, outputPath;
+    std::string carModelName = "Sharan";
+    std::string viewTargetPath;
+    size_t randomCount = 0;
+    bool verify = true;
+    bool highwaySpeed = false;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "model" && i + 1 < argc) carModelName = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--random" && i + 1 < argc) randomCount = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--no-verify") verify = false;
+        else if (arg == "--viewtarget" && i + 1 < argc) viewTargetPath = argv[++i];
+        else if (arg == "--highway-speed") highwaySpeed = true;
+        else if (arg == "--help" || arg == "-h") { printClassifyUsage(); return 0; }
+        else if (gazePath.empty() && arg[0] != '-') gazePath = arg;
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printClassifyUsage();
+            return 1;
+        }
+    }
+    if (gazePath.empty() && randomCount == 0) {
+        printClassifyUsage();
+        return 1;
+    }
+
+    std::vector<ViewingZone> zones;
+    GazeRayBatch rays;
+    typedef std::chrono::steady_clock Clock;
+    try {
+        if (!viewTargetPath.empty()) {
+            std::vector<std::string> warnings;
+            zones = parseViewTargetFile(viewTargetPath, &warnings);
+            for (const auto& warning : warnings) std::cerr << "Warning: " << warning << std::endl;
+        } else {
+            zones = parseViewingZonesFile("carmodels/" + carModelName + "/config/viewingzones.json");
+        }
+        Clock::time_point t0 = Clock::now();
+        if (!gazePath.empty()) readGazeCsv(gazePath, rays);
+        else makeRandomRays(zones, randomCount, rays);
+        double readSeconds = std::chrono::duration<double>(Clock::now() - t0).count();
+        std::cout << "Loaded " << rays.size() << " gaze rays in " << std::fixed << std::setprecision(3)
+                  << readSeconds << " s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    ZoneHitTester tester(zones);
+    const ZoneBvh& bvh = tester.bvh(highwaySpeed);
+    std::cout << "Hit-testing against " << bvh.triangles().size() << " zone triangles"
+              << (highwaySpeed ? " (highway-speed targets)" : "") << " using the " << tester.kernelName()
+              << " kernel" << (bvh.hasPriorities() ? ", overlaps resolved by priority" : "") << std::endl;
+
+    std::vector<int> ids(rays.size());
+    std::vector<float> distances(rays.size());
+    double simdSeconds = timeBest([&]() { tester.classify(rays, ids.data(), distances.data(), highwaySpeed); }, 0.25);
+    std::cout << "  " << tester.kernelName() << " BVH: " << std::setprecision(1)
+              << rays.size() / simdSeconds / 1e6 << " M rays/s (" << bvh.nodes().size()
+              << " nodes, depth " << bvh.depth() << ")" << std::endl;
+
+    int exitCode = 0;
+    if (verify) {
+        std::vector<int> refIds(rays.size());
+        std::vector<float> refDistances(rays.size());
+        double scalarSeconds = timeBest([&]() {
+            tester.classifyScalar(rays, refIds.data(), refDistances.data(), highwaySpeed);
+        }, 0.25);
+        std::cout << "  scalar: " << rays.size() / scalarSeconds / 1e6 << " M rays/s ("
+                  << std::setprecision(2) << scalarSeconds / simdSeconds << "x slower)" << std::endl;
+
+        // Rays through a shared zone edge hit two zones at the same distance; the BVH may
+        // visit them in a different order, so only a different distance is a mismatch.
+        size_t mismatches = 0;
+        for (size_t i = 0; i < rays.size(); ++i) {
+            bool tie = ids[i] && refIds[i] &&
+                       std::fabs(distances[i] - refDistances[i]) <= 1e-5f * std::max(1.0f, refDistances[i]);
+            if (ids[i] != refIds[i] && !tie) {
+                if (mismatches < 10) {
+                    std::cerr << "  Mismatch at ray " << i << ": zone " << ids[i] << " vs reference zone " << refIds[i] << std::endl;
+                }
+                ++mismatches;
+            }
+        }
+        std::cout << "Scalar reference check: " << (rays.size() - mismatches) << "/" << rays.size() << " rays agree" << std::endl;
+        if (mismatches) exitCode = 1;
+    }
+
+    std::map<int, size_t> histogram;
+    for (int id : ids) histogram[id]++;
+    std::cout << "Zone histogram:" << std::endl;
+    for (const auto& entry : histogram) {
+        std::cout << "  " << (entry.first ? "Zone " + std::to_string(entry.first) : std::string("no zone"))
+                  << ": " << entry.second << std::endl;
+    }
+
+    if (!outputPath.empty()) {
+        std::ofstream out(outputPath.c_str());
+        if (!out) {
+            std::cerr << "Error: Cannot write " << outputPath << std::endl;
+            return 1;
+        }
+        out << "ray,zone_id,distance\n" << std::setprecision(6);
+        for (size_t i = 0; i < rays.size(); ++i) {
+            out << i << ',' << ids[i] << ',' << distances[i] << '\n';
+        }
+        std::cout << "Wrote " << outputPath << std::endl;
+    }
+    return exitCode;
+}
+
+// ----------- visual zonebench -----------
+
+int runZoneScalingBenchmark(int argc, char** argv)
+{
+    size_t rayCount = 1 << 20;
+    if (argc > 2) rayCount = std::strtoul(argv[2], nullptr, 10);
+    if (rayCount == 0) {
+        std::cerr << "Usage: visual zonebench [rays]" << std::endl;
+        return 1;
+    }
+
+    // Rays from the centre of the synthetic cap, spread slightly wider than the cap itself
+    GazeRayBatch rays;
+    rays.reserve(rayCount);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> azimuth(-1.5f, 1.5f), elevation(-0.95f, 0.95f);
+    for (size_t i = 0; i < rayCount; ++i) {
+        float az = azimuth(rng), el = elevation(rng);
+        rays.push_back(osg::Vec3(0.0f, 0.0f, 0.0f),
+                       osg::Vec3(std::sin(az) * std::cos(el), std::sin(el), std::cos(az) * std::cos(el)));
+    }
+
+    std::cout << "Zone scaling benchmark, " << rayCount << " rays per pass" << std::endl;
+    std::cout << std::setw(7) << "zones" << std::setw(11) << "build ms" << std::setw(8) << "nodes"
+              << std::setw(7) << "depth" << std::setw(15) << "BVH ns/ray" << std::setw(16) << "brute ns/ray"
+              << std::setw(17) << "scalar ns/ray" << std::endl;
+
+    std::vector<int> ids(rays.size()), bruteIds(rays.size()), scalarIds(rays.size());
+    std::vector<float> distances(rays.size()), bruteDistances(rays.size()), scalarDistances(rays.size());
+    // BVH results that differ from a reference, except where two zones are hit at the same distance
+    auto countMismatches = [&](const std::vector<int>& refIds, const std::vector<float>& refDistances) {
+        size_t mismatches = 0;
+        for (size_t i = 0; i < rays.size(); ++i) {
+            bool tie = ids[i] && refIds[i] &&
+                       std::fabs(distances[i] - refDistances[i]) <= 1e-5f * std::max(1.0f, refDistances[i]);
+            if (ids[i] != refIds[i] && !tie) ++mismatches;
+        }
+        return mismatches;
+    };
+    const int zoneCounts[] = { 20, 100, 1000, 10000 };
+    int exitCode = 0;
+    for (int zoneCount : zoneCounts) {
+        std::vector<ViewingZone> zones = makeSyntheticZones(zoneCount);
+
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point t0 = Clock::now();
+        ZoneHitTester tester(zones);
+        double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+        double bvhSeconds = timeBest([&]() { tester.classify(rays, ids.data(), distances.data()); }, 0.25);
+        double bruteSeconds = timeBest([&]() { tester.classifyBruteForce(rays, bruteIds.data(), bruteDistances.data()); }, 0.25);
+
+        std::cout << std::fixed << std::setw(7) << zoneCount << std::setw(11) << std::setprecision(2) << buildMs
+                  << std::setw(8) << tester.bvh().nodes().size() << std::setw(7) << tester.bvh().depth()
+                  << std::setw(15) << std::setprecision(1) << bvhSeconds * 1e9 / rays.size()
+                  << std::setw(16) << bruteSeconds * 1e9 / rays.size();
+        // The scalar reference is quadratic in practice; skip it where it would take minutes
+        const bool scalar = zoneCount <= 1000;
+        if (scalar) {
+            double scalarSeconds = timeBest([&]() { tester.classifyScalar(rays, scalarIds.data(), scalarDistances.data()); }, 0.0);
+            std::cout << std::setw(17) << scalarSeconds * 1e9 / rays.size();
+        } else {
+            std::cout << std::setw(17) << "-";
+        }
+        std::cout << std::endl;
+
+        if (size_t mismatches = countMismatches(bruteIds, bruteDistances)) {
+            std::cerr << "  " << mismatches << " BVH rays disagree with the brute-force result" << std::endl;
+            exitCode = 1;
+        }
+        if (size_t mismatches = scalar ? countMismatches(scalarIds, scalarDistances) : 0) {
+            std::cerr << "  " << mismatches << " BVH rays disagree with the scalar result" << std::endl;
+            exitCode = 1;
+        }
+    }
+    return exitCode;
+}
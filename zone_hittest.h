@@ -0,0 +1,72 @@
+#ifndef ZONE_HITTEST_H
+#define ZONE_HITTEST_H
+
+#include "config_loader.h"
+#include "zone_bvh.h"
+
+#include <osg/Vec3>
+#include <string>
+#include <vector>
+
+// A batch of gaze rays in carCoord space (meters), stored as structure-of-arrays
+struct GazeRayBatch {
+    std::vector<float> ox, oy, oz;  // origins
+    std::vector<float> dx, dy, dz;  // directions (need not be normalized)
+
+    size_t size() const { return ox.size(); }
+    void reserve(size_t n);
+    void clear();
+    void push_back(const osg::Vec3& origin, const osg::Vec3& direction);
+};
+
+// Batch ray casting against the viewing zones.
+// Rays are processed in packets of 8 (AVX) or 4 (SSE2) that traverse the zone BVH together;
+// the kernel is picked at runtime.
+//
+// Overlapping zones are resolved like ZoneBvh::intersect: highest priority, then nearest.
+// The SIMD kernels find the nearest hit; only rays whose nearest zone is below the top
+// priority are traced again one at a time. With `highwaySpeed`, zones that are not
+// highway-speed targets are ignored.
+class ZoneHitTester {
+public:
+    explicit ZoneHitTester(const std::vector<ViewingZone>& zones);
+
+    // Zone id per ray (0 = no zone hit). `distances` (optional) receives the ray
+    // parameter t of the hit, i.e. the distance when directions are normalized.
+    void classify(const GazeRayBatch& rays, int* zoneIds, float* distances = nullptr, bool highwaySpeed = false) const;
+
+    // Same SIMD kernels testing every triangle (no BVH), for comparison
+    void classifyBruteForce(const GazeRayBatch& rays, int* zoneIds, float* distances = nullptr,
+                            bool highwaySpeed = false) const;
+
+    // Straightforward one-ray-at-a-time reference testing every triangle
+    void classifyScalar(const GazeRayBatch& rays, int* zoneIds, float* distances = nullptr,
+                        bool highwaySpeed = false) const;
+
+    // The BVH of all zones, or of the highway-speed targets
+    const ZoneBvh& bvh(bool highwaySpeed = false) const
+    {
+        return highwaySpeed && hasHighwayFilter_ ? highwayBvh_ : bvh_;
+    }
+    size_t triangleCount() const { return bvh_.triangles().size(); }
+    const char* kernelName() const;
+
+private:
+    void classifyRangeScalar(const ZoneBvh& bvh, const GazeRayBatch& rays, size_t begin, size_t end, int* zoneIds,
+                             float* distances) const;
+    // Re-trace rays in [0, end) whose nearest zone is not of the top priority
+    void resolvePriorities(const ZoneBvh& bvh, const GazeRayBatch& rays, size_t end, int* zoneIds,
+                           float* distances) const;
+
+    ZoneBvh bvh_;
+    ZoneBvh highwayBvh_;
+    bool hasHighwayFilter_;  // some zones are not highway-speed targets
+};
+
+// `visual classify <gaze.csv> ...` - headless batch classification of gaze rays
+int runClassifyCommand(int argc, char** argv);
+
+// `visual zonebench` - BVH build and query cost from 20 to 10,000 synthetic zones
+int runZoneScalingBenchmark(int argc, char** argv);
+
+#endif
@@ -0,0 +1,367 @@
+#include "zone_label_map.h"
+#include "undistort_map.h"
+#include "zone_hittest.h"
+#include "disk_cache.h"
+#include "bench_util.h"
+#include "parallel_for.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <stdexcept>
+#include <chrono>
+#include <random>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const char kCacheMagic[] = "ZONELBL";
+const uint32_t kCacheVersion = 2;
+
+// Tiles are one overlap word wide, so no two tiles write to the same word
+const int kTileSize = 64;
+
+// Offset along the ray past the nearest hit when looking for a second zone (meters)
+const float kOverlapOffset = 1e-4f;
+
+struct ZoneLabelMapInfo {
+    int32_t width, height;
+    int32_t bytesPerLabel;
+    int32_t overlapWordsPerRow;
+    int32_t reserved[4];
+};
+
+size_t labelBytes(int width, int height, int bytesPerLabel)
+{
+    // Padded so the overlap mask that follows stays 8-byte aligned
+    size_t bytes = static_cast<size_t>(width) * height * bytesPerLabel;
+    return (bytes + 7) & ~size_t(7);
+}
+
+} // namespace
+
+uint64_t zoneLabelMapKey(const CameraModel& camera, const std::vector<ViewingZone>& zones)
+{
+    const double params[24] = {
+        camera.R[0][0], camera.R[0][1], camera.R[0][2],
+        camera.R[1][0], camera.R[1][1], camera.R[1][2],
+        camera.R[2][0], camera.R[2][1], camera.R[2][2],
+        camera.t[0], camera.t[1], camera.t[2],
+        camera.fx, camera.fy, camera.cx, camera.cy,
+        camera.k[0], camera.k[1], camera.k[2], camera.k[3], camera.k[4], camera.k[5],
+        camera.p1, camera.p2
+    };
+    const int32_t layout[3] = { camera.imageWidth, camera.imageHeight, static_cast<int32_t>(kCacheVersion) };
+    uint64_t h = hashBytes(layout, sizeof(layout), hashBytes(params, sizeof(params)));
+    for (const auto& zone : zones) {
+        // The attributes decide which of several overlapping zones a pixel gets
+        const int32_t attributes[4] = { zone.id, zone.category, zone.priority, zone.highwaySpeedEnabled ? 1 : 0 };
+        h = hashBytes(attributes, sizeof(attributes), h);
+        if (!zone.corners.empty()) h = hashBytes(&zone.corners[0], zone.corners.size() * sizeof(osg::Vec3), h);
+    }
+    return h;
+}
+
+ZoneLabelMap::ZoneLabelMap()
+    : labels_(nullptr), overlap_(nullptr), width_(0), height_(0), bytesPerLabel_(1), overlapWordsPerRow_(0)
+{
+}
+
+void ZoneLabelMap::setImage(const uint8_t* labels, const uint64_t* overlap, int width, int height, int bytesPerLabel)
+{
+    labels_ = labels;
+    overlap_ = overlap;
+    width_ = width;
+    height_ = height;
+    bytesPerLabel_ = bytesPerLabel;
+    overlapWordsPerRow_ = (static_cast<size_t>(width) + 63) / 64;
+}
+
+size_t ZoneLabelMap::sizeInBytes() const
+{
+    return labelBytes(width_, height_, bytesPerLabel_) + overlapWordsPerRow_ * height_ * sizeof(uint64_t);
+}
+
+void ZoneLabelMap::build(const CameraModel& camera, const UndistortMap& rays, const std::vector<ViewingZone>& zones,
+                         unsigned threads)
+{
+    int maxId = 0;
+    for (const auto& zone : zones) maxId = std::max(maxId, zone.id);
+    if (maxId > 65535) throw std::runtime_error("Zone ids above 65535 do not fit the label map");
+
+    const int width = camera.imageWidth, height = camera.imageHeight;
+    const int bytesPerLabel = maxId < 256 ? 1 : 2;
+    const size_t wordsPerRow = (static_cast<size_t>(width) + 63) / 64;
+
+    file_.close();
+    ownedLabels_.assign(labelBytes(width, height, bytesPerLabel), 0);
+    ownedOverlap_.assign(wordsPerRow * height, 0);
+    uint8_t* labels = ownedLabels_.data();
+    uint64_t* overlap = ownedOverlap_.data();
+
+    const ZoneHitTester tester(zones);
+    // The overlap test starts from the nearest hit, which is not the label when a farther
+    // zone wins on priority; with one priority level nearest hits come from the same tester
+    std::vector<ViewingZone> samePriority(zones);
+    for (auto& zone : samePriority) zone.priority = 0;
+    const ZoneHitTester nearestTester(samePriority);
+    const bool prioritized = tester.bvh(false).hasPriorities();
+    const osg::Vec3 origin(camera.t[0], camera.t[1], camera.t[2]);
+    const int tilesX = (width + kTileSize - 1) / kTileSize;
+    const int tilesY = (height + kTileSize - 1) / kTileSize;
+
+    parallelForEach(static_cast<size_t>(tilesX) * tilesY, threads, [&](size_t tile) {
+        const int x0 = static_cast<int>(tile % tilesX) * kTileSize;
+        const int y0 = static_cast<int>(tile / tilesX) * kTileSize;
+        const int x1 = std::min(x0 + kTileSize, width), y1 = std::min(y0 + kTileSize, height);
+
+        // Camera rays through the pixel centers of the tile
+        GazeRayBatch batch;
+        batch.reserve(kTileSize * kTileSize);
+        std::vector<uint32_t> pixels;
+        pixels.reserve(kTileSize * kTileSize);
+        for (int v = y0; v < y1; ++v) {
+            for (int u = x0; u < x1; ++u) {
+                float x, y;
+                if (!rays.pixelToRay(u + 0.5f, v + 0.5f, x, y)) continue;
+                osg::Vec3 direction(camera.R[0][0] * x + camera.R[1][0] * y + camera.R[2][0],
+                                    camera.R[0][1] * x + camera.R[1][1] * y + camera.R[2][1],
+                                    camera.R[0][2] * x + camera.R[1][2] * y + camera.R[2][2]);
+                direction.normalize();
+                batch.push_back(origin, direction);
+                pixels.push_back(static_cast<uint32_t>(v - y0) * kTileSize + (u - x0));
+            }
+        }
+
+        std::vector<int> ids(batch.size());
+        std::vector<float> distances(batch.size());
+        tester.classify(batch, ids.data(), distances.data());
+        std::vector<int> nearestIds;
+        if (prioritized) {
+            nearestIds.resize(batch.size());
+            nearestTester.classify(batch, nearestIds.data(), distances.data());
+        }
+        const std::vector<int>& firstIds = prioritized ? nearestIds : ids;
+
+        // Continue the rays that hit something just past the nearest hit to find a second zone
+        GazeRayBatch beyond;
+        std::vector<size_t> hitIndex;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (!firstIds[i]) continue;
+            osg::Vec3 d(batch.dx[i], batch.dy[i], batch.dz[i]);
+            beyond.push_back(origin + d * (distances[i] + kOverlapOffset), d);
+            hitIndex.push_back(i);
+        }
+        std::vector<int> secondIds(beyond.size());
+        tester.classify(beyond, secondIds.data());
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            size_t pixel = static_cast<size_t>(y0 + pixels[i] / kTileSize) * width + x0 + pixels[i] % kTileSize;
+            if (bytesPerLabel == 1) labels[pixel] = static_cast<uint8_t>(ids[i]);
+            else reinterpret_cast<uint16_t*>(labels)[pixel] = static_cast<uint16_t>(ids[i]);
+        }
+        for (size_t j = 0; j < beyond.size(); ++j) {
+            size_t i = hitIndex[j];
+            if (!secondIds[j] || secondIds[j] == firstIds[i]) continue;
+            int u = x0 + pixels[i] % kTileSize, v = y0 + pixels[i] / kTileSize;
+            overlap[static_cast<size_t>(v) * wordsPerRow + u / 64] |= uint64_t(1) << (u % 64);
+        }
+    });
+
+    setImage(labels, overlap, width, height, bytesPerLabel);
+    cachePath_.clear();
+}
+
+bool ZoneLabelMap::load(const CameraModel& camera, const std::vector<ViewingZone>& zones, bool rebuild,
+                        unsigned threads)
+{
+    const uint64_t key = zoneLabelMapKey(camera, zones);
+    const std::string path = cacheFilePath("zonelabels", key, ".bin");
+
+    if (!rebuild) {
+        size_t payloadSize = 0;
+        const char* payload = openCacheFile(file_, path, kCacheMagic, kCacheVersion, key, payloadSize);
+        if (payload && payloadSize >= sizeof(ZoneLabelMapInfo)) {
+            ZoneLabelMapInfo info;
+            std::memcpy(&info, payload, sizeof(info));
+            size_t labelSize = labelBytes(info.width, info.height, info.bytesPerLabel);
+            size_t overlapSize = static_cast<size_t>(info.overlapWordsPerRow) * info.height * sizeof(uint64_t);
+            if (info.width == camera.imageWidth && info.height == camera.imageHeight &&
+                (info.bytesPerLabel == 1 || info.bytesPerLabel == 2) &&
+                info.overlapWordsPerRow == (info.width + 63) / 64 &&
+                payloadSize == sizeof(info) + labelSize + overlapSize) {
+                ownedLabels_.clear();
+                ownedOverlap_.clear();
+                const char* labels = payload + sizeof(info);
+                setImage(reinterpret_cast<const uint8_t*>(labels), reinterpret_cast<const uint64_t*>(labels + labelSize),
+                         info.width, info.height, info.bytesPerLabel);
+                cachePath_ = path;
+                return true;
+            }
+        }
+        file_.close();
+    }
+
+    UndistortMap rays;
+    rays.load(camera, 4, false, threads);
+    build(camera, rays, zones, threads);
+
+    ZoneLabelMapInfo info;
+    std::memset(&info, 0, sizeof(info));
+    info.width = width_;
+    info.height = height_;
+    info.bytesPerLabel = bytesPerLabel_;
+    info.overlapWordsPerRow = static_cast<int32_t>(overlapWordsPerRow_);
+    std::vector<std::pair<const void*, size_t> > payload;
+    payload.push_back(std::make_pair(static_cast<const void*>(&info), sizeof(info)));
+    payload.push_back(std::make_pair(static_cast<const void*>(ownedLabels_.data()), ownedLabels_.size()));
+    payload.push_back(std::make_pair(static_cast<const void*>(ownedOverlap_.data()), ownedOverlap_.size() * sizeof(uint64_t)));
+    try {
+        writeCacheFile(path, kCacheMagic, kCacheVersion, key, payload);
+        cachePath_ = path;
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << std::endl;
+    }
+    return false;
+}
+
+void ZoneLabelMap::writePpm(const std::string& path, const std::vector<ViewingZone>& zones) const
+{
+    std::map<int, osg::Vec4> colors;
+    for (const auto& zone : zones) colors[zone.id] = zone.color;
+
+    std::ofstream out(path.c_str(), std::ios::binary);
+    if (!out) throw std::runtime_error("Cannot write " + path);
+    out << "P6\n" << width_ << " " << height_ << "\n255\n";
+
+    std::vector<unsigned char> row(static_cast<size_t>(width_) * 3);
+    for (int v = 0; v < height_; ++v) {
+        for (int u = 0; u < width_; ++u) {
+            osg::Vec4 c(0.15f, 0.15f, 0.15f, 1.0f);
+            int id = zoneAt(u, v);
+            if (id) c = colors.count(id) ? colors[id] : defaultZoneColor(id);
+            if (overlapAt(u, v)) c = c * 0.6f + osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f) * 0.4f;
+            for (int k = 0; k < 3; ++k) {
+                row[u * 3 + k] = static_cast<unsigned char>(std::min(1.0f, std::max(0.0f, c[k])) * 255.0f + 0.5f);
+            }
+        }
+        out.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+}
+
+// ----------- visual labelmap -----------
+
+namespace {
+
+void printLabelMapUsage()
+{
+    std::cout << "Usage: visual labelmap [model <name>] [--rebuild] [--threads N] [-o <labels.ppm>]" << std::endl;
+}
+
+} // namespace
+
+int runLabelMapCommand(int argc, char** argv)
+{
+    std::string carModelName = "Sharan";
+    std::string imagePath;
+    bool rebuild = false;
+    unsigned threads = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "model" && i + 1 < argc) carModelName = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) imagePath = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (arg == "--rebuild") rebuild = true;
+        else if (arg == "--help" || arg == "-h") { printLabelMapUsage(); return 0; }
+        else {
+            std::cerr << "Error: Invalid argument '" << arg << "'" << std::endl;
+            printLabelMapUsage();
+            return 1;
+        }
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    std::string configPath = "carmodels/" + carModelName + "/config";
+    CameraModel camera;
+    std::vector<ViewingZone> zones;
+    ZoneLabelMap labels;
+    try {
+        camera = CameraModel(parseCalibrationFile(configPath + "/calibraton.json"));
+        zones = parseViewingZonesFile(configPath + "/viewingzones.json");
+
+        Clock::time_point t0 = Clock::now();
+        bool cached = labels.load(camera, zones, rebuild, threads);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        std::cout << (cached ? "Mapped" : "Rasterized") << " " << labels.width() << "x" << labels.height()
+                  << " zone label map (" << labels.bytesPerLabel() * 8 << "-bit ids + overlap mask, "
+                  << std::fixed << std::setprecision(1) << labels.sizeInBytes() / 1048576.0 << " MB) in "
+                  << std::setprecision(2) << ms << " ms" << std::endl;
+        if (!labels.cachePath().empty()) std::cout << "  cache: " << labels.cachePath() << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Coverage per zone
+    std::map<int, size_t> histogram;
+    size_t overlapping = 0;
+    for (int v = 0; v < labels.height(); ++v) {
+        for (int u = 0; u < labels.width(); ++u) {
+            histogram[labels.zoneAt(u, v)]++;
+            if (labels.overlapAt(u, v)) ++overlapping;
+        }
+    }
+    const double total = static_cast<double>(labels.width()) * labels.height();
+    std::cout << "Pixels per zone:" << std::endl;
+    for (const auto& entry : histogram) {
+        std::cout << "  " << (entry.first ? "Zone " + std::to_string(entry.first) : std::string("no zone")) << ": "
+                  << entry.second << " (" << std::setprecision(1) << 100.0 * entry.second / total << "%)" << std::endl;
+    }
+    std::cout << "  overlapping: " << overlapping << std::endl;
+
+    // Spot check against an exact per-pixel solve
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pu(0, labels.width() - 1), pv(0, labels.height() - 1);
+    ZoneBvh bvh(zones);
+    const osg::Vec3 origin(camera.t[0], camera.t[1], camera.t[2]);
+    const int samples = 20000;
+    int agree = 0;
+    for (int i = 0; i < samples; ++i) {
+        int u = pu(rng), v = pv(rng);
+        osg::Vec2d ray;
+        int expected = 0;
+        if (camera.undistort(osg::Vec2d(u + 0.5, v + 0.5), ray)) {
+            osg::Vec3d d = camera.cameraToCar(osg::Vec3d(ray.x(), ray.y(), 1.0)) - osg::Vec3d(origin);
+            expected = bvh.intersect(origin, osg::Vec3(d), nullptr);
+        }
+        if (expected == labels.zoneAt(u, v)) ++agree;
+    }
+    std::cout << "Exact solve agrees on " << agree << "/" << samples << " random pixels" << std::endl;
+
+    // Lookup throughput
+    std::vector<int> us(1 << 22), vs(us.size());
+    for (size_t i = 0; i < us.size(); ++i) { us[i] = pu(rng); vs[i] = pv(rng); }
+    volatile long sink = 0;
+    double seconds = timeBest([&]() {
+        long sum = 0;
+        for (size_t i = 0; i < us.size(); ++i) sum += labels.zoneAt(us[i], vs[i]);
+        sink = sum;
+    }, 0.25);
+    std::cout << "Random lookups: " << std::setprecision(1) << us.size() / seconds / 1e6 << " M/s" << std::endl;
+
+    if (!imagePath.empty()) {
+        try {
+            labels.writePpm(imagePath, zones);
+            std::cout << "Wrote " << imagePath << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
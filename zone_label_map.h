@@ -0,0 +1,72 @@
+#ifndef ZONE_LABEL_MAP_H
+#define ZONE_LABEL_MAP_H
+
+#include "camera_projection.h"
+#include "config_loader.h"
+#include "mapped_file.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class UndistortMap;
+
+// Per-pixel "which zone is this pixel looking at" image at sensor resolution.
+// Each pixel center is turned into a camera ray (UndistortMap) and cast against the zone
+// BVH, which is equivalent to rasterizing the zone polygons through the distorted
+// projection, curved edges included. Labels are the id of the zone the ray reports (highest
+// priority, then nearest; 0 = none), stored in 8 bits when all ids are below 256 and 16 bits
+// otherwise; a 1-bit-per-pixel overlap mask marks pixels whose ray passes through more than
+// one zone. Zone attributes are part of the cache key.
+class ZoneLabelMap {
+public:
+    ZoneLabelMap();
+
+    // Map the cached label image for this calibration and zone set, or rasterize it
+    // (tiled, in parallel) and cache it. Returns true if it came from the cache.
+    bool load(const CameraModel& camera, const std::vector<ViewingZone>& zones, bool rebuild = false,
+              unsigned threads = 0);
+
+    // Rasterize without touching the cache
+    void build(const CameraModel& camera, const UndistortMap& rays, const std::vector<ViewingZone>& zones,
+               unsigned threads = 0);
+
+    int zoneAt(int u, int v) const {
+        if (u < 0 || v < 0 || u >= width_ || v >= height_) return 0;
+        size_t i = static_cast<size_t>(v) * width_ + u;
+        return bytesPerLabel_ == 1 ? labels_[i] : reinterpret_cast<const uint16_t*>(labels_)[i];
+    }
+    bool overlapAt(int u, int v) const {
+        if (u < 0 || v < 0 || u >= width_ || v >= height_) return false;
+        return (overlap_[static_cast<size_t>(v) * overlapWordsPerRow_ + u / 64] >> (u % 64)) & 1;
+    }
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int bytesPerLabel() const { return bytesPerLabel_; }
+    size_t sizeInBytes() const;
+    const std::string& cachePath() const { return cachePath_; }
+
+    // Binary PPM with zone colors (overlapping pixels brightened), for inspection
+    void writePpm(const std::string& path, const std::vector<ViewingZone>& zones) const;
+
+private:
+    void setImage(const uint8_t* labels, const uint64_t* overlap, int width, int height, int bytesPerLabel);
+
+    std::vector<uint8_t> ownedLabels_;
+    std::vector<uint64_t> ownedOverlap_;
+    MappedFile file_;
+    const uint8_t* labels_;
+    const uint64_t* overlap_;
+    int width_, height_, bytesPerLabel_;
+    size_t overlapWordsPerRow_;
+    std::string cachePath_;
+};
+
+// Hash of the calibration (intrinsics and extrinsics), image size and zone geometry
+uint64_t zoneLabelMapKey(const CameraModel& camera, const std::vector<ViewingZone>& zones);
+
+// `visual labelmap ...` - build/load the label map and report lookups
+int runLabelMapCommand(int argc, char** argv);
+
+#endif